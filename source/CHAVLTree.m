@@ -18,23 +18,26 @@
 #import "CHAbstractBinarySearchTree_Internal.h"
 
 // Two-way single rotation
-static inline CHBinaryTreeNode* singleRotation(CHBinaryTreeNode *node, u_int32_t dir) {
+static inline CHBinaryTreeNode* singleRotation(CHBinaryTreeNode *node, u_int32_t dir, bool fCounted) {
     CHBinaryTreeNode *save = node->link[!dir];
     node->link[!dir] = save->link[dir];
     save->link[dir] = node;
+	CHBinaryTreeNodeCountRotation(fCounted, node, save);
 	return save;
 }
 
 // Two-way double rotation
-static inline CHBinaryTreeNode* doubleRotation(CHBinaryTreeNode *node, u_int32_t dir) {
+static inline CHBinaryTreeNode* doubleRotation(CHBinaryTreeNode *node, u_int32_t dir, bool fCounted) {
     CHBinaryTreeNode *save = node->link[!dir]->link[dir];
     node->link[!dir]->link[dir] = save->link[!dir];
     save->link[!dir] = node->link[!dir];
     node->link[!dir] = save;
+	CHBinaryTreeNodeCountRotation(fCounted, save->link[!dir], save);
 	
     save = node->link[!dir];
     node->link[!dir] = save->link[dir];
     save->link[dir] = node;
+	CHBinaryTreeNodeCountRotation(fCounted, node, save);
     return save;
 }
 
@@ -53,22 +56,222 @@ static inline void adjustBalance(CHBinaryTreeNode *root, u_int32_t dir, int32_t
     nn->balance = 0;
 }
 
+// The height of the child of a node of height h in direction dir, derived from the node's balance.
+static inline NSInteger childHeight(CHBinaryTreeNode *node, NSInteger h, u_int32_t dir) {
+	if (dir)
+		return (node->balance < 0) ? h - 1 + node->balance : h - 1;
+	else
+		return (node->balance > 0) ? h - 1 - node->balance : h - 1;
+}
+
+// Link two subtrees, of heights that differ by at most one, as the inner (!dir) and outer (dir) children of node, and return its height.
+static inline NSInteger linkChildren(CHBinaryTreeNode *node, u_int32_t dir,
+                                     CHBinaryTreeNode *inner, NSInteger innerHeight,
+                                     CHBinaryTreeNode *outer, NSInteger outerHeight, bool fCounted)
+{
+	node->link[!dir] = inner;
+	node->link[dir] = outer;
+	node->balance = (int32_t) (dir ? outerHeight - innerHeight : innerHeight - outerHeight);
+	if (fCounted)
+		CHBinaryTreeNodeCount(node) = CHBinaryTreeNodeCount(node->left) + CHBinaryTreeNodeCount(node->right) + 1;
+	return ((innerHeight > outerHeight) ? innerHeight : outerHeight) + 1;
+}
+
+// Join node and the lower subtree small to the higher subtree big, which is on the !dir side, by following the dir spine of big down to the
+// first subtree no more than one higher than small, and replacing it with node. Rotations on the way back up restore the balance, and every
+// node is relinked with the heights of its children, so the balances and counts are set as it goes.
+static CHBinaryTreeNode* joinSpine(CHBinaryTreeNode *big, NSInteger bigHeight, CHBinaryTreeNode *node,
+                                   CHBinaryTreeNode *small, NSInteger smallHeight, u_int32_t dir,
+                                   NSInteger *height, bool fCounted)
+{
+	CHBinaryTreeNode *spine = big->link[dir], *other = big->link[!dir], *joined;
+	NSInteger spineHeight = childHeight(big, bigHeight, dir), otherHeight = childHeight(big, bigHeight, !dir), joinedHeight;
+	
+	if (spineHeight <= smallHeight + 1) {
+		joined = node;
+		joinedHeight = linkChildren(node, dir, spine, spineHeight, small, smallHeight, fCounted);
+	} else
+		joined = joinSpine(spine, spineHeight, node, small, smallHeight, dir, &joinedHeight, fCounted);
+	if (joinedHeight <= otherHeight + 1) {
+		*height = linkChildren(big, dir, other, otherHeight, joined, joinedHeight, fCounted);
+		return big;
+	}
+	// The joined subtree is two higher than its sibling: rotate it up, once or twice.
+	CHBinaryTreeNode *inner = joined->link[!dir], *outer = joined->link[dir];
+	NSInteger innerHeight = childHeight(joined, joinedHeight, !dir), outerHeight = childHeight(joined, joinedHeight, dir);
+	if (innerHeight <= outerHeight) {
+		NSInteger h = linkChildren(big, dir, other, otherHeight, inner, innerHeight, fCounted);
+		*height = linkChildren(joined, dir, big, h, outer, outerHeight, fCounted);
+		return joined;
+	}
+	CHBinaryTreeNode *a = inner->link[!dir], *b = inner->link[dir];
+	NSInteger aHeight = childHeight(inner, innerHeight, !dir), bHeight = childHeight(inner, innerHeight, dir);
+	NSInteger h1 = linkChildren(big, dir, other, otherHeight, a, aHeight, fCounted);
+	NSInteger h2 = linkChildren(joined, dir, b, bHeight, outer, outerHeight, fCounted);
+	*height = linkChildren(inner, dir, big, h1, joined, h2, fCounted);
+	return inner;
+}
+
+#pragma mark Persistent trees
+
+// These functions change a tree created with CHTreeOptionsPersistent, recursively rather than with a stack. Each is given the link to the
+// root of a subtree, and replaces the root with a copy, through CHBinaryTreeSharedNodeUnshare(), before changing it, so a change copies the
+// nodes on its path that other trees share, and a rotation also copies a sibling whose balance it changes. Subtree counts are kept up to
+// date on the way back up, before each rotation, since no path is recounted afterwards.
+
+// Returns YES if the subtree grew taller.
+static BOOL sharedAdd(CHBinaryTreeSharedEdit *edit, CHBinaryTreeNode **link, id anObject) {
+	CHBinaryTreeNode *node = *link;
+	if (node == edit->pSentinel) {
+		node = CHBinaryTreeNodePoolAlloc(edit->pPool, [anObject retain]);
+		node->left = node->right = edit->pSentinel;
+		*link = node;
+		edit->fChanged = true;
+		return YES;
+	}
+	NSComparisonResult comparison = CHSearchTreeCompare(edit->pComparator, node->object, anObject);
+	node = *link = CHBinaryTreeSharedNodeUnshare(edit->pPool, node, edit->pSentinel);
+	if (comparison == NSOrderedSame) {
+		[anObject retain];
+		[node->object release];
+		node->object = anObject;
+		return NO;
+	}
+	u_int32_t dir = (comparison == NSOrderedAscending); // R on YES
+	BOOL grew = sharedAdd(edit, &node->link[dir], anObject);
+	if (edit->fChanged && edit->fCounted)
+		CHBinaryTreeNodeCount(node)++;
+	if (!grew)
+		return NO;
+	int32_t bal = dir ? +1 : -1;
+	node->balance += bal;
+	if (node->balance != 2 * bal)
+		return (node->balance != 0);
+	// The child that grew is on the path, as is its inner child if that is what grew, so both have already been copied.
+	if (node->link[dir]->balance == bal) {
+		node->balance = node->link[dir]->balance = 0;
+		*link = singleRotation(node, !dir, edit->fCounted);
+	} else {
+		adjustBalance(node, dir, bal);
+		*link = doubleRotation(node, !dir, edit->fCounted);
+	}
+	return NO;
+}
+
+// Rebalances the subtree at *link after its dir side has lost a node, and has become shorter if shrank is YES. Returns YES if the whole subtree
+// became shorter.
+static BOOL sharedRebalanceRemoved(CHBinaryTreeSharedEdit *edit, CHBinaryTreeNode **link, u_int32_t dir, BOOL shrank) {
+	CHBinaryTreeNode *node = *link, *sibling;
+	int32_t bal = dir ? +1 : -1;
+	if (edit->fCounted)
+		CHBinaryTreeNodeCount(node)--;
+	if (!shrank)
+		return NO;
+	node->balance -= bal;
+	if (node->balance != -2 * bal)
+		return (node->balance == 0);
+	sibling = node->link[!dir] = CHBinaryTreeSharedNodeUnshare(edit->pPool, node->link[!dir], edit->pSentinel);
+	if (sibling->balance == -bal) {
+		node->balance = sibling->balance = 0;
+		*link = singleRotation(node, dir, edit->fCounted);
+		return YES;
+	}
+	if (sibling->balance == bal) {
+		sibling->link[dir] = CHBinaryTreeSharedNodeUnshare(edit->pPool, sibling->link[dir], edit->pSentinel);
+		adjustBalance(node, !dir, -bal);
+		*link = doubleRotation(node, dir, edit->fCounted);
+		return YES;
+	}
+	node->balance = -bal;
+	sibling->balance = bal;
+	*link = singleRotation(node, dir, edit->fCounted);
+	return NO;
+}
+
+// Replaces a node that has at most one child with that child. The node itself need not be copied, since it is only dropped.
+static void sharedUnlink(CHBinaryTreeSharedEdit *edit, CHBinaryTreeNode **link) {
+	CHBinaryTreeNode *node = *link, *child = node->link[node->left == edit->pSentinel];
+	CHBinaryTreeSharedNodeRetain(child, edit->pSentinel);
+	*link = child;
+	CHBinaryTreeSharedNodeRelease(node, edit->pSentinel);
+	edit->fChanged = true;
+}
+
+// Removes the first node of a subtree, setting *first to its object, retained. Returns YES if the subtree became shorter.
+static BOOL sharedRemoveFirst(CHBinaryTreeSharedEdit *edit, CHBinaryTreeNode **link, id *first) {
+	CHBinaryTreeNode *node = *link;
+	if (node->left == edit->pSentinel) {
+		*first = [node->object retain];
+		sharedUnlink(edit, link);
+		return YES;
+	}
+	node = *link = CHBinaryTreeSharedNodeUnshare(edit->pPool, node, edit->pSentinel);
+	return sharedRebalanceRemoved(edit, link, 0, sharedRemoveFirst(edit, &node->left, first));
+}
+
+// Returns YES if the subtree became shorter. A node with two children takes its successor's object, and the successor is removed instead.
+static BOOL sharedRemove(CHBinaryTreeSharedEdit *edit, CHBinaryTreeNode **link, id anObject) {
+	CHBinaryTreeNode *node = *link;
+	if (node == edit->pSentinel)
+		return NO;
+	NSComparisonResult comparison = CHSearchTreeCompare(edit->pComparator, node->object, anObject);
+	if (comparison == NSOrderedSame && (node->left == edit->pSentinel || node->right == edit->pSentinel)) {
+		sharedUnlink(edit, link);
+		return YES;
+	}
+	node = *link = CHBinaryTreeSharedNodeUnshare(edit->pPool, node, edit->pSentinel);
+	u_int32_t dir;
+	BOOL shrank;
+	if (comparison == NSOrderedSame) {
+		id successor;
+		dir = 1;
+		shrank = sharedRemoveFirst(edit, &node->right, &successor);
+		[node->object release];
+		node->object = successor;
+	} else {
+		dir = (comparison == NSOrderedAscending); // R on YES
+		shrank = sharedRemove(edit, &node->link[dir], anObject);
+	}
+	if (!edit->fChanged)
+		return NO;
+	return sharedRebalanceRemoved(edit, link, dir, shrank);
+}
+
 @implementation CHAVLTree
 
 // NOTE: The header and sentinel nodes are initialized to balance 0 by default.
 
++ (BOOL) supportsPersistence {
+	return YES;
+}
+
++ (BOOL) supportsHintedInsertion {
+	return YES;
+}
+
 - (void) addObject:(id)anObject {
 	if (anObject == nil)
 		CHNilArgumentException([self class], _cmd);
 	++mutations;
+	if (m_fuiOptions & CHTreeOptionsPersistent) {
+		CHBinaryTreeSharedEdit edit = {&m_sNodePool, sentinel, &m_sComparator, (m_fuiOptions & CHTreeOptionsOrderStatistics) != 0, false};
+		sharedAdd(&edit, &header->right, anObject);
+		if (edit.fChanged)
+			++count;
+		return;
+	}
+	// An object ordered after the last object is appended by following the right spine, with one comparison.
+	if ([self addObject:anObject fromPath:NULL size:0 position:1 appendOnly:YES cursor:nil])
+		return;
 	
 	CHBinaryTreeNode *parent = NULL, *save = NULL, *current = header;
+	bool fCounted = (m_fuiOptions & CHTreeOptionsOrderStatistics) != 0;
 	CHBinaryTreeStack_DECLARE();
 	CHBinaryTreeStack_INIT();
 	
 	sentinel->object = anObject; // Assure that we find a spot to insert
 	NSComparisonResult comparison;
-	while ((comparison = [current->object compare:anObject])) {
+	while ((comparison = CHSearchTreeCompare(&m_sComparator, current->object, anObject))) {
 		CHBinaryTreeStack_PUSH(current);
 		if (current == header)
 			save = current->right;
@@ -86,14 +289,14 @@ static inline void adjustBalance(CHBinaryTreeNode *root, u_int32_t dir, int32_t
 		// No need to rebalance up the path since we didn't modify the structure
 		goto done;
 	} else {
-		current = CHCreateBinaryTreeNodeWithObject(anObject);
+		current = CHBinaryTreeNodePoolAlloc(&m_sNodePool, anObject);
 		current->left   = sentinel;
 		current->right  = sentinel;
 		++count;
 		// Link from parent as the proper child, based on last comparison
 		parent = CHBinaryTreeStack_POP();
 		NSAssert((id) parent != nil, @"Illegal state, parent should never be nil!");
-		comparison = [parent->object compare:anObject];
+		comparison = CHSearchTreeCompare(&m_sComparator, parent->object, anObject);
 		parent->link[comparison == NSOrderedAscending] = current; // R if YES
 	}
 	
@@ -116,10 +319,10 @@ static inline void adjustBalance(CHBinaryTreeNode *root, u_int32_t dir, int32_t
 				int32_t bal = (isRightChild) ? +1 : -1;
 				if (node->balance == bal) {
 					parent->balance = node->balance = 0;
-					parent = singleRotation(parent, !isRightChild);
+					parent = singleRotation(parent, !isRightChild, fCounted);
 				} else { // node->balance == -bal
 					adjustBalance(parent, isRightChild, bal);
-					parent = doubleRotation(parent, !isRightChild);
+					parent = doubleRotation(parent, !isRightChild, fCounted);
 				}
 			}
 			keepBalancing = NO;
@@ -129,9 +332,11 @@ static inline void adjustBalance(CHBinaryTreeNode *root, u_int32_t dir, int32_t
 		parent = CHBinaryTreeStack_POP();
 		NSAssert((id) parent != nil, @"Illegal state, parent should never be nil!");
 		// Link from parent as the proper child, based on last comparison
-		comparison = [parent->object compare:current->object];
+		comparison = CHSearchTreeCompare(&m_sComparator, parent->object, current->object);
 		parent->link[comparison == NSOrderedAscending] = current; // R if YES
 	}
+	if (fCounted)
+		CHBinaryTreeNodeCountPath(header, sentinel, &m_sComparator, 0, false, anObject);
 done:
 	CHBinaryTreeStack_FREE(stack);
 }
@@ -140,15 +345,27 @@ done:
 	if (count == 0 || anObject == nil)
 		return;
 	++mutations;
+	if (m_fuiOptions & CHTreeOptionsPersistent) {
+		// Nothing is copied unless the object is found. It is released last, as below, rather than with its node.
+		id removedObject = [[self member:anObject] retain];
+		if (removedObject == nil)
+			return;
+		CHBinaryTreeSharedEdit edit = {&m_sNodePool, sentinel, &m_sComparator, (m_fuiOptions & CHTreeOptionsOrderStatistics) != 0, false};
+		sharedRemove(&edit, &header->right, anObject);
+		--count;
+		[removedObject release];
+		return;
+	}
 
 	CHBinaryTreeNode *parent, *current = header;
+	bool fCounted = (m_fuiOptions & CHTreeOptionsOrderStatistics) != 0;
 	CHBinaryTreeStack_DECLARE();
 	CHBinaryTreeStack_INIT();
 
 	sentinel->object = anObject; // Assure that we stop at a leaf if not found.
 	NSComparisonResult comparison;
 	// Search down the node for the tree and save the path
-	while ((comparison = [current->object compare:anObject])) {
+	while ((comparison = CHSearchTreeCompare(&m_sComparator, current->object, anObject))) {
 		CHBinaryTreeStack_PUSH(current);
 		current = current->link[comparison == NSOrderedAscending]; // R on YES
 	}
@@ -157,7 +374,8 @@ done:
 		goto done;
 	}
 	
-	[current->object release]; // Object must be released in any case
+	// Object must be released in any case, but not until the counts are fixed
+	id removedObject = current->object, unlinkedObject = removedObject;
 	--count;
 	CHBinaryTreeNode *replacement;
 	BOOL isRightChild;
@@ -168,7 +386,7 @@ done:
 		NSAssert((id) parent != nil, @"Illegal state, parent should never be nil!");
 		isRightChild = (parent->right == current);
 		parent->link[isRightChild] = replacement;
-		free(current);
+		CHBinaryTreeNodePoolFree(&m_sNodePool, current);
 	} else {
 		// Two child case -- replace with minimum object in right subtree
 		CHBinaryTreeStack_PUSH(current); // Need to start here when rebalancing
@@ -178,11 +396,11 @@ done:
 			replacement = replacement->left;
 		}
 		// Grab object from replacement node, steal its right child, deallocate
-		current->object = replacement->object;
+		current->object = unlinkedObject = replacement->object;
 		parent = CHBinaryTreeStack_POP();
 		isRightChild = (parent->right == replacement);
 		parent->link[isRightChild] = replacement->right;
-		free(replacement);
+		CHBinaryTreeNodePoolFree(&m_sNodePool, replacement);
 	}
 	
 	// Trace back up the search path, rebalancing as we go until we're done
@@ -199,19 +417,19 @@ done:
 			int32_t bal = (isRightChild) ? +1 : -1;
 			if (node->balance == -bal) {
 				parent->balance = node->balance = 0;
-				parent = singleRotation(parent, isRightChild);
+				parent = singleRotation(parent, isRightChild, fCounted);
 			}
 			else if (node->balance == bal) {
 				adjustBalance(parent, !isRightChild, -bal);
-				parent = doubleRotation(parent, isRightChild);
+				parent = doubleRotation(parent, isRightChild, fCounted);
 			}
 			else { // node->balance == 0
 				parent->balance = -bal;
 				node->balance = bal;
-				parent = singleRotation(parent, isRightChild);
+				parent = singleRotation(parent, isRightChild, fCounted);
 				done = YES;
 			}
-			comparison = [CHBinaryTreeStack_TOP->object compare:parent->object];
+			comparison = CHSearchTreeCompare(&m_sComparator, CHBinaryTreeStack_TOP->object, parent->object);
 			CHBinaryTreeStack_TOP->link[comparison == NSOrderedAscending] = parent;
 		}
 		else if (parent->balance != 0)
@@ -221,10 +439,102 @@ done:
 		parent = CHBinaryTreeStack_POP();
 		isRightChild = (parent->right == current);
 	}
+	if (fCounted)
+		CHBinaryTreeNodeCountPath(header, sentinel, &m_sComparator, 0, false, unlinkedObject);
+	[removedObject release];
 done:
 	CHBinaryTreeStack_FREE(stack);
 }
 
+// Walks back up the path from the new leaf, updating balance factors until a subtree is no higher than it was, and makes at most one
+// single or double rotation. A rotation takes the rotated node off the path, and a double rotation puts the middle node of the three in
+// its place, followed by whichever of the other two now holds the rest of the path.
+- (NSUInteger) rebalancePath:(CHBinaryTreeNode**)path size:(NSUInteger)pathSize {
+	bool fCounted = (m_fuiOptions & CHTreeOptionsOrderStatistics) != 0;
+	NSUInteger index = pathSize - 1; // The node whose subtree has grown
+	while (index > 1) {
+		CHBinaryTreeNode *parent = path[index - 1], *child = path[index];
+		u_int32_t dir = (parent->right == child);
+		parent->balance += dir ? +1 : -1;
+		if (parent->balance == 0)
+			break;
+		if (abs(parent->balance) == 1) {
+			--index;
+			continue;
+		}
+		// The dir subtree is two higher than its sibling: rotate, which restores the height the subtree had before the insertion.
+		int32_t bal = dir ? +1 : -1;
+		CHBinaryTreeNode *ancestor = path[index - 2];
+		u_int32_t side = (ancestor->right == parent);
+		if (child->balance == bal) {
+			parent->balance = child->balance = 0;
+			ancestor->link[side] = singleRotation(parent, !dir, fCounted);
+			memmove(&path[index - 1], &path[index], (pathSize - index) * kCHPointerSize);
+			--pathSize;
+		} else { // child->balance == -bal
+			CHBinaryTreeNode *grandchild = path[index + 1];
+			adjustBalance(parent, dir, bal);
+			ancestor->link[side] = doubleRotation(parent, !dir, fCounted);
+			path[index - 1] = grandchild;
+			if (index + 2 < pathSize) {
+				path[index] = (child->link[!dir] == path[index + 2]) ? child : parent;
+				memmove(&path[index + 1], &path[index + 2], (pathSize - index - 2) * kCHPointerSize);
+				--pathSize;
+			} else
+				pathSize = index;
+		}
+		break;
+	}
+	return pathSize;
+}
+
+// The balance factor of a built node follows directly from its subtree heights.
+- (void) setBalanceForBuiltNode:(CHBinaryTreeNode*)node
+                     leftHeight:(NSUInteger)leftHeight
+                    rightHeight:(NSUInteger)rightHeight
+                          depth:(NSUInteger)depth
+                     treeHeight:(NSUInteger)treeHeight
+{
+	(void) depth;
+	(void) treeHeight;
+	node->balance = (int32_t) rightHeight - (int32_t) leftHeight;
+}
+
+// The rank of an AVL subtree is its height, which is found by following the higher child of each node.
+- (NSInteger) rankOfSubtree:(CHBinaryTreeNode*)node {
+	NSInteger height = 0;
+	while (node != sentinel) {
+		++height;
+		node = node->link[node->balance > 0];
+	}
+	return height;
+}
+
+- (NSInteger) rankOfNode:(CHBinaryTreeNode*)node
+                   child:(int)dir
+                    rank:(NSInteger)childRank
+             siblingRank:(NSInteger*)siblingRank
+{
+	*siblingRank = dir ? childRank - node->balance : childRank + node->balance;
+	return ((childRank > *siblingRank) ? childRank : *siblingRank) + 1;
+}
+
+- (CHBinaryTreeNode*) joinSubtree:(CHBinaryTreeNode*)left
+                             rank:(NSInteger)leftRank
+                         withNode:(CHBinaryTreeNode*)node
+                          subtree:(CHBinaryTreeNode*)right
+                             rank:(NSInteger)rightRank
+                       resultRank:(NSInteger*)rank
+{
+	bool fCounted = (m_fuiOptions & CHTreeOptionsOrderStatistics) != 0;
+	if (leftRank > rightRank + 1)
+		return joinSpine(left, leftRank, node, right, rightRank, 1, rank, fCounted);
+	if (rightRank > leftRank + 1)
+		return joinSpine(right, rightRank, node, left, leftRank, 0, rank, fCounted);
+	*rank = linkChildren(node, 1, left, leftRank, right, rightRank, fCounted);
+	return node;
+}
+
 - (NSString*) debugDescriptionForNode:(CHBinaryTreeNode*)node {
 	return [NSString stringWithFormat:@"[%2d]\t\"%@\"",
 			node->balance, node->object];
@@ -68,6 +68,61 @@ typedef struct CHBinaryTreeNode {
 } CHBinaryTreeNode;
 // NOTE: If the compiler issues "Declaration does not declare anthing" warnings for this struct, change the C Language Dialect in your Xcode build settings to GNU99; anonymous structs and unions are not properly supported by the C99 standard.
 
+/**
+ The signature of the implementation (IMP) of a @c -compare: style method, such as @c -compare: or the @c -compare1:, @c -compare2: ... methods used by nested levels of multi-level trees. Calling the implementation directly avoids a full message send for every comparison made while descending a tree.
+ */
+typedef NSComparisonResult (*CHCompareIMP) (id a_poTarget, SEL a_pSelCompare, id a_poArgument);
+
+/** The number of (receiver class, nesting level) pairs for which a tree caches the resolved comparison implementation. */
+#define kCHCompareCacheSize		4
+
+struct CHCompareCacheEntry;					/* Private. Declared in CHAbstractBinarySearchTree_Internal.h */
+
+/**
+ The signature of a C function that orders two objects in a search tree, as passed to \link CHAbstractBinarySearchTree#initWithCompareFunction:context: -initWithCompareFunction:context:\endlink. The function is passed the context pointer given when the tree was initialised, and must return the same result as <code>[a_poTarget compare: a_poArgument]</code> would for a total ordering of the objects.
+ */
+typedef NSComparisonResult (*CHCompareFunction) (id a_poTarget, id a_poArgument, void * a_pvContext);
+
+/**
+ Indicates how a search tree orders its objects. Recorded in keyed archives. Only trees ordered by @c -compare: can be archived, since a comparator block or function cannot be restored from an archive.
+ */
+typedef enum {
+	CHComparatorKindSelector	= 0,	///< Objects are ordered by @c -compare:, or by @c -compare<n>: at nesting level n of a multi-level tree.
+	CHComparatorKindBlock		= 1,	///< Objects are ordered by an @c NSComparator block.
+	CHComparatorKindFunction	= 2		///< Objects are ordered by a CHCompareFunction and its context.
+} CHComparatorKind;
+
+/**
+ The comparison state of a search tree. The tree classes compare objects through CHSearchTreeCompare() and CHSearchTreeCompareObjects(), declared in CHAbstractBinarySearchTree_Internal.h, which call either @a pfnCompare directly or the cached @c -compare: implementation.
+ */
+typedef struct CHSearchTreeComparator {
+	CHCompareFunction				pfnCompare;		///< The comparison function, or @c NULL to use the @c -compare: selectors.
+	void *							pvContext;		///< The context passed to @a pfnCompare. For a block comparator, this is the (copied) block.
+	CHComparatorKind				eKind;			///< How the tree orders its objects.
+	id								poHeaderObject;	///< The header object, which always compares as @c NSOrderedAscending when it is the target.
+	struct CHCompareCacheEntry *	apCache [kCHCompareCacheSize];	///< Comparison selector and IMP, resolved once per (class, nesting level) and then called directly.
+} CHSearchTreeComparator;
+
+struct CHBinaryTreeNodeSlab;				/* Private. Declared in CHAbstractBinarySearchTree_Internal.h */
+struct CHBinaryTreeNodeArena;				/* Private. Declared in CHAbstractBinarySearchTree_Internal.h */
+
+/**
+ A per-tree allocator for CHBinaryTreeNode structs. Nodes are carved from large slabs rather than being allocated one at a time, and nodes that are removed from the tree are kept on an intrusive free list, linked through their @a right field, for reuse. Emptying or destroying the tree returns whole slabs at once. The slabs are owned by an arena, which is shared by trees that have exchanged nodes by splitting or joining, and which is freed with the last of them. The allocator is not thread-safe; like the rest of the tree, it relies on the caller to serialise mutations.
+ */
+typedef struct CHBinaryTreeNodePool {
+	CHBinaryTreeNode *				pNodeFree;		///< The most recently freed node, or @c NULL if there are none to reuse.
+	char *							pbNext;			///< The next unused node in the newest slab.
+	char *							pbEnd;			///< The end of the newest slab.
+	struct CHBinaryTreeNodeArena *	pArena;			///< The arena that owns the slabs, and the sentinel node of the tree.
+	size_t							cbNode;			///< The size of each node. Zero until the first slab is allocated.
+	NSUInteger						cNodesSlab;		///< The number of nodes in the next slab to be allocated.
+	NSUInteger						cNodesCapacity;	///< The initial capacity requested by the caller, or zero for the default.
+	bool							fSharedNodes;	///< Nodes are allocated one at a time and reference counted, so that copies of the tree can share them. Set for trees created with CHTreeOptionsPersistent.
+} CHBinaryTreeNodePool;
+
+@class CHBinarySearchTreeCursor;
+@class CHFrozenSortedSet;
+
 @protocol CHAbstractBinarySearchTreeP				/* Declares the primitive methods in CHAbstractBinarySearchTree that must be implemented in derived classes */
 
 - (unsigned int)		GetOptions;
@@ -106,13 +161,107 @@ typedef struct CHBinaryTreeNode {
 		NSUInteger			count;			// The number of objects currently in the tree.
 		unsigned long		mutations; 		// Tracks mutations for NSFastEnumeration.
 		unsigned int		m_fuiOptions;	/* CJEC, 1-Jul-13: Options == 0 behaves like original code. One or more of CHTreeOptions */
+		CHSearchTreeComparator	m_sComparator;	/* How objects are ordered: by -compare: through a cached IMP, by an NSComparator block or by a C function */
+		CHBinaryTreeNodePool	m_sNodePool;	/* Slab allocator for the tree's nodes, except the header and sentinel */
 }
 
 + (SEL)					SelCompare: (unsigned int) a_uiNestingLevel;	/* CJEC, 22-Jul-13: Depending on the nesting level, return the appropriate comparison selector */
-+ (NSInvocation *)		InvocationCompare: (id) a_po nestingLevel: (unsigned int) a_uiNestingLevel;	/* CJEC, 8-Jul-13: Support multi-level trees. Provide a different comparison method for each nesting level */
-- (NSComparisonResult)	Compare: (NSInvocation *) a_poInvocationCompare target: (id) a_poTarget argument: (id) a_poArgument;	/* CJEC, 10-Jul-13: Support multi-level trees. Provide a comparison method using the comparison invocation */
++ (NSInvocation *)		InvocationCompare: (id) a_po nestingLevel: (unsigned int) a_uiNestingLevel;	/* CJEC, 8-Jul-13: Support multi-level trees. Provide a different comparison method for each nesting level. Note: No longer used by the tree classes, which call the cached comparison IMP instead. Retained for compatibility */
+- (NSComparisonResult)	Compare: (NSInvocation *) a_poInvocationCompare target: (id) a_poTarget argument: (id) a_poArgument;	/* CJEC, 10-Jul-13: Support multi-level trees. Provide a comparison method using the comparison invocation. Note: No longer used by the tree classes. Retained for compatibility */
+- (NSComparisonResult)	compareObject: (id) a_poTarget toObject: (id) a_poArgument nestingLevel: (unsigned int) a_uiNestingLevel;	/* Compare two objects at a nesting level using the tree's cached comparison IMP. Multi-level sub-collections are compared using any of their objects */
+- (CHComparatorKind)		comparatorKind;	/* Whether the tree orders its objects with -compare:, a block or a C function */
 - (id)					newLeafCollection: (id) a_po nestingLevel: (unsigned int) a_uiNestingLevel returnsIsMultiLevel: (bool *) a_pfMultiLevel;	/* CJEC, 19-Jul-13: Support multiple objects all ordered NSOrderedSame at the same leaf. Note: Conforms to Foundation's naming conventions. The caller MUST release */
 
+/**
+ Initialize a search tree with enough preallocated node storage for a given number of objects. The first slab of nodes is sized to hold @a a_cCapacity objects, so that building a tree of a known size makes a single allocation for its nodes.
+
+ @param a_cCapacity The number of objects the tree is expected to hold. Zero selects the default slab size.
+ @return An initialized search tree that contains no objects.
+ */
+- (id)					initWithCapacity: (NSUInteger) a_cCapacity;
+
+/**
+ Initialize a search tree with the given options and enough preallocated node storage for a given number of objects.
+
+ @param a_fuiOptions One or more of CHTreeOptions.
+ @param a_cCapacity The number of objects the tree is expected to hold. Zero selects the default slab size.
+ @return An initialized search tree that contains no objects.
+ */
+- (id)					initWithTreeOptions: (unsigned int) a_fuiOptions capacity: (NSUInteger) a_cCapacity;
+
+#if defined (__BLOCKS__)
+/**
+ Initialize a search tree that orders its objects with a comparator block rather than @c -compare:.
+
+ @param a_pfnComparator The block used to compare objects. It is copied by the receiver.
+ @return An initialized search tree that contains no objects.
+
+ @throw NSInvalidArgumentException if @a a_pfnComparator is @c nil.
+ */
+- (id)					initWithComparator: (NSComparator) a_pfnComparator;
+
+/**
+ Initialize a search tree with the given options and capacity that orders its objects with a comparator block rather than @c -compare:.
+
+ @param a_fuiOptions One or more of CHTreeOptions.
+ @param a_cCapacity The number of objects the tree is expected to hold. Zero selects the default slab size.
+ @param a_pfnComparator The block used to compare objects. It is copied by the receiver.
+ @return An initialized search tree that contains no objects.
+
+ @throw NSInvalidArgumentException if @a a_pfnComparator is @c nil.
+ */
+- (id)					initWithTreeOptions: (unsigned int) a_fuiOptions capacity: (NSUInteger) a_cCapacity comparator: (NSComparator) a_pfnComparator;
+#endif	/* defined (__BLOCKS__) */
+
+/**
+ Initialize a search tree that orders its objects with a C function rather than @c -compare:. Calling a function avoids an Objective-C message send for every comparison, which helps when the objects' ordering is cheap to compute.
+
+ @param a_pfnCompare The function used to compare objects.
+ @param a_pvContext An arbitrary pointer passed to every call of @a a_pfnCompare. Not retained.
+ @return An initialized search tree that contains no objects.
+
+ @throw NSInvalidArgumentException if @a a_pfnCompare is @c NULL.
+ */
+- (id)					initWithCompareFunction: (CHCompareFunction) a_pfnCompare context: (void *) a_pvContext;
+
+/**
+ Initialize a search tree with the given options and capacity that orders its objects with a C function rather than @c -compare:.
+
+ @param a_fuiOptions One or more of CHTreeOptions.
+ @param a_cCapacity The number of objects the tree is expected to hold. Zero selects the default slab size.
+ @param a_pfnCompare The function used to compare objects.
+ @param a_pvContext An arbitrary pointer passed to every call of @a a_pfnCompare. Not retained.
+ @return An initialized search tree that contains no objects.
+
+ @throw NSInvalidArgumentException if @a a_pfnCompare is @c NULL.
+ */
+- (id)					initWithTreeOptions: (unsigned int) a_fuiOptions capacity: (NSUInteger) a_cCapacity compareFunction: (CHCompareFunction) a_pfnCompare context: (void *) a_pvContext;
+
+#if defined (__BLOCKS__)
+/**
+ Executes a given block using each object in the tree, in ascending order.
+
+ @param a_pfnBlock The block to apply to each object. It is passed the object, its index in ascending order, and a reference to a Boolean which the block may set to @c YES to stop the enumeration.
+
+ @throw NSInvalidArgumentException if @a a_pfnBlock is @c nil.
+ @throw NSGenericException if the block modifies the receiver.
+ */
+- (void)				enumerateObjectsUsingBlock: (void (^) (id obj, NSUInteger idx, BOOL * stop)) a_pfnBlock;
+
+/**
+ Executes a given block using each object in the tree, with the given options. The objects of multi-level trees are those their enumerators return, and are passed from an array of them taken first.
+
+ With @c NSEnumerationConcurrent, and when libdispatch is available, the top of the tree is divided into subtrees, which workers on a global dispatch queue enumerate at the same time, as many workers as \link CHBinarySearchTree#parallelWorkerCount +parallelWorkerCount\endlink allows. Each worker has its own autorelease pool. Objects are then passed in no particular order, although each is passed its index in ascending order, and @c NSEnumerationReverse is ignored. Without CHTreeOptionsOrderStatistics, the workers first count the objects of their subtrees, to find those indexes. The block must be safe to call from several threads at once, must not raise an exception, and must not modify the tree; setting its stop flag stops each worker before its next object.
+
+ @param a_fuiOptions A mask of NSEnumerationOptions.
+ @param a_pfnBlock The block to apply to each object. It is passed the object, its index in ascending order, and a reference to a Boolean which the block may set to @c YES to stop the enumeration.
+
+ @throw NSInvalidArgumentException if @a a_pfnBlock is @c nil.
+ @throw NSGenericException if the block modifies the receiver.
+ */
+- (void)				enumerateObjectsWithOptions: (NSEnumerationOptions) a_fuiOptions usingBlock: (void (^) (id obj, NSUInteger idx, BOOL * stop)) a_pfnBlock;
+#endif	/* defined (__BLOCKS__) */
+
 @end
 
 /**
@@ -134,12 +283,301 @@ typedef struct CHBinaryTreeNode {
  @b CHTreeOptionsMultiLeaves = 0x02. CJEC, 19-Jul-13: Support NSMutableSet leaves, allowing multiple items with NSOrderedSame in the parent tree
 
  Both option flags can be used together as the class library will not use CHTreeOptionsMultiLevel if there is no appropriate comparison method
+
+ @b CHTreeOptionsOrderStatistics = 0x04. Every node also records the number of nodes in its subtree, which all the balanced subclasses maintain through every insertion, removal and rotation. This costs one extra word per node, and makes \link #objectAtIndex: -objectAtIndex:\endlink, \link #indexOfObject: -indexOfObject:\endlink and \link #countOfObjectsFromObject:toObject: -countOfObjectsFromObject:toObject:\endlink take O(log n) time rather than O(n).
+
+ @b CHTreeOptionsPersistent = 0x08. The tree is persistent: its nodes are reference counted, and shared with every copy of it, so \link NSObject-p#copy -copy\endlink takes O(1) time and memory. A change to the tree or to any copy first copies the nodes on the path it changes that are still shared, and leaves every other tree that shares them as it was, so a copy is a snapshot that stays valid however the tree changes afterwards. Each change allocates O(log n) nodes while copies are outstanding, and nodes are allocated one at a time rather than from slabs. A snapshot may be read on one thread while the tree it was copied from, or another copy, is used on another, since the nodes they share are never changed; any one tree must still be used by one thread at a time. Only CHAVLTree and CHRedBlackTree support the option, which cannot be combined with CHTreeOptionsMultiLevel or CHTreeOptionsMultiLeaves, and their trees do not support \link #splitAtObject: -splitAtObject:\endlink or \link #joinWithTree: -joinWithTree:\endlink.
 */
  
 @interface CHBinarySearchTree : CHAbstractBinarySearchTree <CHAbstractBinarySearchTreeP>	/* CJEC, 12-Feb-15: Separated CHAbstractBinarySearchTree into a genuine abstract base class and CHBinaryTree, the abstract implementation class for all binary search trees */
 	{
 	}
 
+/**
+ Initialize a search tree with the objects in a sorted array, building a perfectly balanced tree in O(n) time rather than inserting the objects one at a time in O(n log n) time. Each subclass's balancing information (such as the red-black color, AVL balance factor, AA level or treap priority) is set as the tree is built, so the tree is immediately valid and later insertions and removals rebalance it as usual.
+ 
+ The order of the objects is checked with one comparison per object. If @a anArray is not in strictly ascending order, as determined by @c -compare: or the receiver's comparator, the objects are added one at a time, exactly as for \link #initWithArray: -initWithArray:\endlink.
+ 
+ @param anArray An array of objects, ideally in strictly ascending order.
+ @return An initialized search tree that contains the objects in @a anArray.
+ 
+ @see addObjectsFromArray:
+ */
+- (id) initWithSortedArray:(NSArray*)anArray;
+
+/**
+ Sets the grain size of parallel bulk operations, which is the fewest objects worth handing to a worker. When it is not zero and libdispatch is available, \link #initWithArray: -initWithArray:\endlink, \link #addObjectsFromArray: -addObjectsFromArray:\endlink into an empty tree, \link #initWithSortedArray: -initWithSortedArray:\endlink and the merges of \link #unionWithSortedSet: -unionWithSortedSet:\endlink and the other set operations divide any work on at least twice this many objects between workers on a global dispatch queue. Unsorted input is sorted by the workers, then built into a balanced tree, rather than being added one object at a time. Subtrees of the balanced tree are built by the workers, then joined under the nodes at the top.
+ 
+ The setting applies to every binary search tree class. The default is zero, which disables parallel bulk operations, since the objects are then compared on several threads at once: @c -compare: and any comparator block or function must be thread safe and must not raise an exception. Trees with CHTreeOptionsMultiLevel or CHTreeOptionsMultiLeaves always add unsorted objects one at a time.
+ 
+ @param grainSize The fewest objects handed to a worker, or zero to disable parallel bulk operations.
+ 
+ @see setParallelWorkerCount:
+ */
++ (void) setParallelGrainSize:(NSUInteger)grainSize;
+
+/**
+ Returns the grain size of parallel bulk operations.
+ 
+ @return The fewest objects handed to a worker, or zero if parallel bulk operations are disabled.
+ 
+ @see setParallelGrainSize:
+ */
++ (NSUInteger) parallelGrainSize;
+
+/**
+ Sets the most workers a parallel bulk operation runs at once. The setting applies to every binary search tree class.
+ 
+ @param workerCount The most workers to run at once, or zero (the default) for one for each active processor. With one worker, bulk operations take the same approach on the calling thread, which is a baseline for measuring how they scale.
+ 
+ @see setParallelGrainSize:
+ */
++ (void) setParallelWorkerCount:(NSUInteger)workerCount;
+
+/**
+ Returns the most workers a parallel bulk operation runs at once.
+ 
+ @return The most workers to run at once, or zero for one for each active processor.
+ 
+ @see setParallelWorkerCount:
+ */
++ (NSUInteger) parallelWorkerCount;
+
+/**
+ Returns the object at a given position in the ascending order of the receiver's objects. In a multi-level tree, positions count the objects in the outermost tree, any of which may be a sub-collection.
+ 
+ @param index The position of the object to return, counting from 0 for the first object.
+ @return The object at @a index.
+ 
+ @throw NSRangeException if @a index is greater than or equal to the number of objects in the receiver.
+ 
+ @attention Takes O(log n) time if the receiver was initialized with CHTreeOptionsOrderStatistics, otherwise O(n).
+ 
+ @see indexOfObject:
+ */
+- (id) objectAtIndex:(NSUInteger)index;
+
+/**
+ Returns the position of an object in the ascending order of the receiver's objects.
+ 
+ @param anObject The object to search for in the receiver.
+ @return The index of the object that compares as @c NSOrderedSame to @a anObject, or @c NSNotFound if there is none or @a anObject is @c nil.
+ 
+ @attention Takes O(log n) time if the receiver was initialized with CHTreeOptionsOrderStatistics, otherwise O(n).
+ 
+ @see objectAtIndex:
+ */
+- (NSUInteger) indexOfObject:(id)anObject;
+
+/**
+ Returns the number of objects that \link CHSortedSet#subsetFromObject:toObject: -subsetFromObject:toObject:\endlink would return for the same endpoints, without creating the subset. If @a start is ordered before or the same as @a end, these are the objects between the endpoints, inclusive. If @a start is ordered after @a end, these are the objects that are not between the endpoints: those after or the same as @a start, plus those before or the same as @a end. A @c nil endpoint is unbounded.
+ 
+ @param start The low endpoint, or @c nil for the first object.
+ @param end The high endpoint, or @c nil for the last object.
+ @return The number of objects in the range.
+ 
+ @attention Takes O(log n) time if the receiver was initialized with CHTreeOptionsOrderStatistics, otherwise O(n).
+ */
+- (NSUInteger) countOfObjectsFromObject:(id)start toObject:(id)end;
+
+/**
+ Returns the last object in the receiver that is ordered before or the same as a given object.
+ 
+ @param anObject The object to search for.
+ @return The greatest object that is not ordered after @a anObject, or @c nil if there is none or @a anObject is @c nil.
+ 
+ @attention Takes O(log n) time, and allocates nothing.
+ 
+ @see ceilingObject:
+ */
+- (id) floorObject:(id)anObject;
+
+/**
+ Returns the first object in the receiver that is ordered after or the same as a given object.
+ 
+ @param anObject The object to search for.
+ @return The least object that is not ordered before @a anObject, or @c nil if there is none or @a anObject is @c nil.
+ 
+ @attention Takes O(log n) time, and allocates nothing.
+ 
+ @see floorObject:
+ */
+- (id) ceilingObject:(id)anObject;
+
+/**
+ Returns the objects in the receiver that are the same as each of a given array of objects, found together rather than by sending \link #member: -member:\endlink for each.
+ 
+ @param objects The objects to search for. If they are in ascending order, all of them are found in one descent of the tree, which parts them at each node it visits into those ordered before and after the node: finding k objects takes O(k log(n/k)) comparisons rather than O(k log n), and each node is visited at most once. Otherwise each is found by its own descent, with several descents interleaved so that fetching the nodes of one overlaps with the others.
+ @return An array of the same count as @a objects, holding at each index the object in the receiver that is the same as the object at that index of @a objects, or @c NSNull if there is none.
+ 
+ @attention A multi-level tree finds each object with \link #member: -member:\endlink.
+ 
+ @see containsObjects:
+ */
+- (NSArray*) membersForObjects:(NSArray*)objects;
+
+/**
+ Determines if the receiver contains every one of a given array of objects, found together as for \link #membersForObjects: -membersForObjects:\endlink.
+ 
+ @param objects The objects to search for, which are best given in ascending order.
+ @return @c YES if the receiver contains an object that is the same as each object in @a objects, or if @a objects is empty, otherwise @c NO. The search stops at the first object not found.
+ 
+ @see membersForObjects:
+ */
+- (BOOL) containsObjects:(NSArray*)objects;
+
+/**
+ Returns a cursor positioned at the first object in the receiver that is ordered after or the same as a given object: the \link #ceilingObject: -ceilingObject:\endlink of @a anObject.
+ 
+ @param anObject The object to seek, or @c nil to position the cursor at the first object in the receiver.
+ @return A cursor positioned at the first object which is not ordered before @a anObject. If there is none, the cursor is positioned after the last object, and its @c -object is @c nil.
+ 
+ @attention Seeking takes O(log n) time.
+ 
+ @see cursorAfterObject:
+ */
+- (CHBinarySearchTreeCursor*) cursorAtObject:(id)anObject;
+
+/**
+ Returns a cursor positioned at the first object in the receiver that is ordered after a given object. Sending @c -previous to the cursor moves it to the \link #floorObject: -floorObject:\endlink of @a anObject.
+ 
+ @param anObject The object to seek, or @c nil to position the cursor at the first object in the receiver.
+ @return A cursor positioned at the first object which is ordered after @a anObject. If there is none, the cursor is positioned after the last object, and its @c -object is @c nil.
+ 
+ @attention Seeking takes O(log n) time.
+ 
+ @see cursorAtObject:
+ */
+- (CHBinarySearchTreeCursor*) cursorAfterObject:(id)anObject;
+
+/**
+ Adds an object to the receiver, searching for its place from the position of a cursor rather than from the root, and moves the cursor to it. The search climbs from the cursor's object only as far as the nearest ancestor between which and the cursor's object @a anObject lies, then descends from there, so an object added next to the cursor takes O(1) comparisons however large the tree is. Passing the same cursor to each call, which is then positioned at the object added last, adds objects that arrive in ascending or nearly ascending order, such as timestamps, with amortized O(1) comparisons each.
+ 
+ @param anObject The object to add to the receiver. If the receiver already contains an object that is the same, it is replaced, as for \link #addObject: -addObject:\endlink.
+ @param hint A cursor over the receiver from \link #cursorAtObject: -cursorAtObject:\endlink or \link #cursorAfterObject: -cursorAfterObject:\endlink, or @c nil to add the object as \link #addObject: -addObject:\endlink does. A cursor positioned after the last object, as one created for an empty tree is, starts from the last object, and one positioned before the first object starts from the first.
+ 
+ @throw NSInvalidArgumentException if @a anObject is @c nil, or if @a hint is a cursor over another tree.
+ @throw NSGenericException if the receiver has been modified since @a hint was positioned, other than by this method.
+ 
+ @attention CHAVLTree and CHRedBlackTree rebalance bottom up from the added node without further comparisons. Other classes, and trees created with CHTreeOptionsPersistent, add the object with \link #addObject: -addObject:\endlink and then search for it to position the cursor. An object far from the cursor takes up to about twice as many comparisons as \link #addObject: -addObject:\endlink, so a hint only helps when objects arrive near each other. CHAVLTree and CHRedBlackTree also add an object ordered after the last object by following the right spine of the tree, with a single comparison, without a hint.
+ 
+ @see cursorAtObject:
+ */
+- (void) addObject:(id)anObject hint:(CHBinarySearchTreeCursor*)hint;
+
+/**
+ Moves every object that is ordered after or the same as a given object into a new tree, leaving the objects ordered before it in the receiver. The nodes holding the objects are relinked rather than copied, so the objects are neither retained nor released, and the two trees are rebalanced as they are cut apart.
+ 
+ @param anObject The object at which to split the receiver.
+ @return A new tree of the same class, options and ordering as the receiver, which holds the objects of the receiver that are not ordered before @a anObject.
+ 
+ @throw NSInvalidArgumentException if @a anObject is @c nil.
+ @throw NSInternalInconsistencyException if the receiver does not support splitting. CHAVLTree, CHRedBlackTree, CHTreap and CHUnbalancedTree do, unless they were created with CHTreeOptionsPersistent.
+ 
+ @attention Takes O(log n) time for the self-balancing trees, and time proportional to the depth of @a anObject for CHUnbalancedTree. Without CHTreeOptionsOrderStatistics, counting the objects of the smaller of the two trees also takes time proportional to their number. The two trees share their node allocator and sentinel node until both have been deallocated, so they must not be used concurrently from different threads, even only to read them.
+ 
+ @see joinWithTree:
+ */
+- (id) splitAtObject:(id)anObject;
+
+/**
+ Moves every object of another tree, all of which must be ordered after every object in the receiver, into the receiver, leaving the other tree empty. The nodes holding the objects are relinked rather than copied, so the objects are neither retained nor released.
+ 
+ @param otherTree A tree of the same class and options as the receiver, whose first object is ordered after the last object of the receiver.
+ 
+ @throw NSInvalidArgumentException if @a otherTree is @c nil, is the receiver, is of a different class or has different options than the receiver, or holds an object that is not ordered after every object in the receiver.
+ @throw NSInternalInconsistencyException if the receiver does not support joining. CHAVLTree, CHRedBlackTree, CHTreap and CHUnbalancedTree do, unless they were created with CHTreeOptionsPersistent.
+ 
+ @attention Takes O(log n) time for the self-balancing trees if the two trees already share a sentinel node, as trees split from one another do. Otherwise, the leaves of the nodes of @a otherTree are first relinked to the sentinel node of the receiver, which takes O(m) time for the m objects in @a otherTree. The same sharing as for \link #splitAtObject: -splitAtObject:\endlink applies afterwards.
+ 
+ @see splitAtObject:
+ */
+- (void) joinWithTree:(CHBinarySearchTree*)otherTree;
+
+/**
+ Adds to the receiver each object in another sorted set that is not already in the receiver. Where both hold an object, the receiver keeps its own.
+ 
+ @param otherSortedSet The sorted set of objects to add, whose enumeration should be in the receiver's order.
+ 
+ @throw NSInvalidArgumentException if @a otherSortedSet is @c nil.
+ 
+ @attention The objects of both sets are merged in O(n+m) time, and the receiver is rebuilt in its final, balanced shape. When @a otherSortedSet is small enough that adding its objects one at a time takes less time, they are added one at a time. If @a otherSortedSet does not enumerate its objects in the receiver's order, which costs one comparison per object to check, or the receiver has CHTreeOptionsMultiLevel or CHTreeOptionsMultiLeaves, its objects are always added one at a time.
+ 
+ @see setByUnioningWithSortedSet:
+ */
+- (void) unionWithSortedSet:(id<CHSortedSet>)otherSortedSet;
+
+/**
+ Removes from the receiver each object that is not also in another sorted set.
+ 
+ @param otherSortedSet The sorted set of objects to keep, whose enumeration should be in the receiver's order.
+ 
+ @throw NSInvalidArgumentException if @a otherSortedSet is @c nil.
+ 
+ @attention Takes O(n+m) time to merge the two sets and rebuild the receiver. When either set is small enough, the objects of the smaller one are instead looked up in the other, in O(log n) time each.
+ 
+ @see setByIntersectingWithSortedSet:
+ */
+- (void) intersectWithSortedSet:(id<CHSortedSet>)otherSortedSet;
+
+/**
+ Removes from the receiver each object that is also in another sorted set.
+ 
+ @param otherSortedSet The sorted set of objects to remove, whose enumeration should be in the receiver's order.
+ 
+ @throw NSInvalidArgumentException if @a otherSortedSet is @c nil.
+ 
+ @attention Takes O(n+m) time to merge the two sets and rebuild the receiver, or O(m log n) time when @a otherSortedSet is small enough that removing its objects one at a time takes less time, or does not enumerate its objects in the receiver's order.
+ 
+ @see setByMinusingSortedSet:
+ */
+- (void) minusSortedSet:(id<CHSortedSet>)otherSortedSet;
+
+/**
+ Returns a new tree with the objects of both the receiver and another sorted set. The receiver is unchanged.
+ 
+ @param otherSortedSet The sorted set of objects to add, whose enumeration should be in the receiver's order.
+ @return A new tree of the receiver's class, options and ordering.
+ 
+ @throw NSInvalidArgumentException if @a otherSortedSet is @c nil.
+ 
+ @see unionWithSortedSet:
+ */
+- (id) setByUnioningWithSortedSet:(id<CHSortedSet>)otherSortedSet;
+
+/**
+ Returns a new tree with the objects of the receiver that are also in another sorted set. The receiver is unchanged.
+ 
+ @param otherSortedSet The sorted set of objects to keep, whose enumeration should be in the receiver's order.
+ @return A new tree of the receiver's class, options and ordering.
+ 
+ @throw NSInvalidArgumentException if @a otherSortedSet is @c nil.
+ 
+ @see intersectWithSortedSet:
+ */
+- (id) setByIntersectingWithSortedSet:(id<CHSortedSet>)otherSortedSet;
+
+/**
+ Returns a new tree with the objects of the receiver that are not in another sorted set. The receiver is unchanged.
+ 
+ @param otherSortedSet The sorted set of objects to leave out, whose enumeration should be in the receiver's order.
+ @return A new tree of the receiver's class, options and ordering.
+ 
+ @throw NSInvalidArgumentException if @a otherSortedSet is @c nil.
+ 
+ @see minusSortedSet:
+ */
+- (id) setByMinusingSortedSet:(id<CHSortedSet>)otherSortedSet;
+
+/**
+ Returns an immutable copy of the receiver, laid out for fast searching. Once a tree has been built and will only be searched from then on, freezing it trades the ability to modify it for searches that touch far fewer cache lines. The receiver is unchanged, and may still be modified without affecting the frozen set.
+ 
+ @return A frozen sorted set with the objects of the receiver, in the same order.
+ 
+ @see CHFrozenSortedSet
+ */
+- (CHFrozenSortedSet*) freeze;
+
 /**
  Produces a representation of the receiver that can be useful for debugging.
  
@@ -166,3 +604,58 @@ typedef struct CHBinaryTreeNode {
 - (NSString*) dotGraphString;
 
 @end
+
+/** The number of nodes on the path to its object that a cursor holds before it must allocate memory. A balanced tree of any size that fits in memory needs fewer. */
+#define kCHBinaryTreeCursorPathInlineSize	64
+
+/**
+ A cursor over the objects of a CHBinarySearchTree, in ascending order, created by \link CHBinarySearchTree#cursorAtObject: -cursorAtObject:\endlink or \link CHBinarySearchTree#cursorAfterObject: -cursorAfterObject:\endlink. Unlike an NSEnumerator, a cursor can move in either direction from where it was created.
+ 
+ A cursor is positioned at an object, before the first object or after the last object. It holds the path from the root of the tree to its object, so @c -next and @c -previous take amortized O(1) time, and O(log n) at worst.
+ 
+ A cursor retains its tree. As for the tree's enumerators, if the tree is modified, the cursor becomes invalid and will raise a mutation exception if it is used again, unless it was modified by \link CHBinarySearchTree#addObject:hint: -addObject:hint:\endlink with the cursor as its hint, which moves the cursor to the object added. In a multi-level tree, the cursor moves over the objects of the outermost tree, any of which may be a sub-collection.
+ */
+@interface CHBinarySearchTreeCursor : NSObject
+{
+	@private
+		__strong CHBinarySearchTree *	searchTree;		// The tree being traversed.
+		CHBinaryTreeNode *				headerNode;		// Header node in the tree.
+		CHBinaryTreeNode *				sentinelNode;	// Sentinel node in the tree.
+		unsigned long					mutationCount;	// Stores the collection's initial mutation.
+		unsigned long *					mutationPtr;	// Pointer for checking changes in mutation.
+		int								position;		// -1 before the first object, 0 at an object, 1 after the last object.
+		// The path from the root to the cursor's object, which is at the top of the stack.
+		CHBinaryTreeNode *				stackInline [kCHBinaryTreeCursorPathInlineSize];
+		__strong CHBinaryTreeNode **	stack;
+		NSUInteger						stackCapacity;
+		NSUInteger						stackSize;
+}
+
+/**
+ Returns the object at which the receiver is positioned.
+ 
+ @return The object at which the receiver is positioned, or @c nil if it is before the first object or after the last object.
+ 
+ @throw NSGenericException if the tree has been modified since the receiver was created.
+ */
+- (id) object;
+
+/**
+ Moves the receiver to the next object in ascending order. A cursor that is before the first object moves to the first object.
+ 
+ @return The object at which the receiver is now positioned, or @c nil if it has moved after the last object.
+ 
+ @throw NSGenericException if the tree has been modified since the receiver was created.
+ */
+- (id) next;
+
+/**
+ Moves the receiver to the previous object in ascending order. A cursor that is after the last object moves to the last object.
+ 
+ @return The object at which the receiver is now positioned, or @c nil if it has moved before the first object.
+ 
+ @throw NSGenericException if the tree has been modified since the receiver was created.
+ */
+- (id) previous;
+
+@end
@@ -19,6 +19,7 @@
 
 // Definitions of extern variables from CHAbstractBinarySearchTree_Internal.h
 size_t kCHBinaryTreeNodeSize = sizeof(CHBinaryTreeNode);
+size_t kCHBinaryTreeCountedNodeSize = sizeof(CHBinaryTreeCountedNode);
 
 /**
  A dummy object that resides in the header node for a tree. Using a header node can simplify insertion logic by eliminating the need to check whether the root is null. The actual root of the tree is generally stored as the right child of the header node. In order to always proceed to the actual root node when traversing down the tree, instances of this class always return @c NSOrderedAscending when called as the receiver of the @c -compare: method.
@@ -85,6 +86,114 @@ static CHSearchTreeHeaderObject *headerObject = nil;
 
 #pragma mark -
 
+#define kCHCompareSelectorTableSize		8	/* Selectors remembered for nesting levels 0 to 7. Deeper levels are looked up each time */
+
+static SEL	s_apSelCompare [kCHCompareSelectorTableSize];
+
+/* Return the comparison selector for a nesting level. Racing threads store the same registered selector, so the table needs no lock
+*/
+SEL	CHCompareSelectorForNestingLevel (unsigned int a_uiNestingLevel)
+	{
+	SEL		pSelCompare;
+	char	szSelCompare [32];
+
+	if (a_uiNestingLevel < kCHCompareSelectorTableSize)
+		{
+		pSelCompare = __atomic_load_n (&s_apSelCompare [a_uiNestingLevel], __ATOMIC_ACQUIRE);
+		if (pSelCompare != NULL)
+			return pSelCompare;
+		}
+	if (a_uiNestingLevel == 0)		/* Note: Using compare: rather than compare0: also supports non-multi-level collections */
+		pSelCompare = @selector (compare:);
+	else
+		{
+		snprintf (szSelCompare, sizeof (szSelCompare), "compare%u:", a_uiNestingLevel);
+		pSelCompare = sel_registerName (szSelCompare);
+		}
+	if (a_uiNestingLevel < kCHCompareSelectorTableSize)
+		__atomic_store_n (&s_apSelCompare [a_uiNestingLevel], pSelCompare, __ATOMIC_RELEASE);
+	return pSelCompare;
+	}
+
+/* Resolve the comparison IMP for a class at a nesting level, and try to publish it in the first free cache slot.
+	Entries are never changed once published, so if another thread publishes first, just try the next slot
+*/
+CHCompareCacheEntry *	CHCompareCacheResolve (struct CHCompareCacheEntry ** a_apCache, Class a_pClass, unsigned int a_uiNestingLevel, CHCompareCacheEntry * a_pEntryScratch)
+	{
+	CHCompareCacheEntry *	pEntryNew;
+	CHCompareCacheEntry *	pEntryExisting;
+	SEL						pSelCompare;
+	unsigned int			ui;
+
+	if (a_pClass == [CHSearchTreeHeaderObject class])	/* The header object only implements compare:, which it uses at every nesting level */
+		pSelCompare = @selector (compare:);
+	else
+		pSelCompare = CHCompareSelectorForNestingLevel (a_uiNestingLevel);
+	a_pEntryScratch -> pClass = a_pClass;
+	a_pEntryScratch -> uiNestingLevel = a_uiNestingLevel;
+	a_pEntryScratch -> fIsCollection = class_respondsToSelector (a_pClass, @selector (anyObject));
+	a_pEntryScratch -> pSelCompare = pSelCompare;
+	a_pEntryScratch -> pfnCompare = (CHCompareIMP) class_getMethodImplementation (a_pClass, pSelCompare);
+
+	pEntryNew = NULL;
+	for (ui = 0; ui < kCHCompareCacheSize; ui ++)
+		{
+		pEntryExisting = __atomic_load_n (&a_apCache [ui], __ATOMIC_ACQUIRE);
+		if (pEntryExisting == NULL)
+			{
+			if (pEntryNew == NULL)
+				{
+				pEntryNew = malloc (sizeof (CHCompareCacheEntry));
+				if (pEntryNew == NULL)			/* Out of memory. Just use the uncached entry */
+					return a_pEntryScratch;
+				*pEntryNew = *a_pEntryScratch;
+				}
+			if (__atomic_compare_exchange_n (&a_apCache [ui], &pEntryExisting, pEntryNew, false, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+				return pEntryNew;
+			}									/* Note: On failure, pEntryExisting is now the entry another thread published */
+		if ((pEntryExisting -> pClass == a_pClass) && (pEntryExisting -> uiNestingLevel == a_uiNestingLevel))
+			{
+			free (pEntryNew);
+			return pEntryExisting;
+			}
+		}
+	free (pEntryNew);							/* The cache is full. Use the uncached entry */
+	return a_pEntryScratch;
+	}
+
+void	CHCompareCacheFree (struct CHCompareCacheEntry ** a_apCache)
+	{
+	unsigned int	ui;
+
+	for (ui = 0; ui < kCHCompareCacheSize; ui ++)
+		{
+		free (a_apCache [ui]);
+		a_apCache [ui] = NULL;
+		}
+	}
+
+void	CHSearchTreeComparatorCopy (CHSearchTreeComparator * a_pComparatorTo, const CHSearchTreeComparator * a_pComparatorFrom)
+	{
+	NSCAssert (a_pComparatorTo -> eKind == CHComparatorKindSelector, @"Comparator already set");
+	a_pComparatorTo -> pfnCompare = a_pComparatorFrom -> pfnCompare;
+	a_pComparatorTo -> eKind = a_pComparatorFrom -> eKind;
+	if (a_pComparatorFrom -> eKind == CHComparatorKindBlock)
+		a_pComparatorTo -> pvContext = [(id) a_pComparatorFrom -> pvContext retain];
+	else
+		a_pComparatorTo -> pvContext = a_pComparatorFrom -> pvContext;
+	}
+
+#if defined (__BLOCKS__)
+/* Adapt an NSComparator block to a CHCompareFunction. The context is the block
+*/
+static NSComparisonResult	CHCompareUsingComparator (id a_poTarget, id a_poArgument, void * a_pvContext)
+	{
+	return ((NSComparator) a_pvContext) (a_poTarget, a_poArgument);
+	}
+#endif	/* defined (__BLOCKS__) */
+
+#pragma mark -
+
 /**
  An NSEnumerator for traversing any CHAbstractBinarySearchTree subclass in a specified order.
  
@@ -94,7 +203,7 @@ static CHSearchTreeHeaderObject *headerObject = nil;
  <li>Iterative algorithms are usually faster since they reduce overhead from function calls.</li>
  </ol>
  
- Traversal state is stored in either a stack or queue using dynamically-allocated C structs and @c \#define pseudo-functions to increase performance and reduce the required memory footprint.
+ Traversal state is stored in either a stack or queue using C arrays and @c \#define pseudo-functions to increase performance and reduce the required memory footprint. The stack starts in a fixed-size buffer within the enumerator, so enumerating a balanced tree does not allocate it on the heap.
  
  Enumerators encapsulate their own state, and more than one enumerator may be active at once. However, if a collection is modified, any existing enumerators for that collection become invalid and will raise a mutation exception if any further objects are requested from it.
  */
@@ -187,7 +296,7 @@ static CHSearchTreeHeaderObject *headerObject = nil;
 			current = root;
 		}
 	}
-	sentinel->object = nil;
+	CHBinaryTreeSentinelClear(sentinel);
 	sentinelNode = sentinel;
 	mutationCount = *mutations;
 	mutationPtr = mutations;
@@ -199,8 +308,8 @@ static CHSearchTreeHeaderObject *headerObject = nil;
 - (void) dealloc {
 	[m_poaoEnumerators release];
 	[searchTree release];
-	free(stack);
-	free(queue);
+	CHBinaryTreeStack_FREE(stack);
+	CHBinaryTreeQueue_FREE(queue);
 	[super dealloc];
 }
 
@@ -369,234 +478,357 @@ static CHSearchTreeHeaderObject *headerObject = nil;
 
 #pragma mark -
 
-CHBinaryTreeNode* CHCreateBinaryTreeNodeWithObject(id anObject) {
-	CHBinaryTreeNode *node;
-	// NSScannedOption tells the garbage collector to scan object and children.
-	node = NSAllocateCollectable(kCHBinaryTreeNodeSize, NSScannedOption);
-	node->object = anObject;
-	node->balance = 0; // Affects balancing info for any subclass (anon. union)
-	return node;
-}
+// Private methods of CHBinarySearchTree used by its range views.
+@interface CHBinarySearchTree ()
 
-@implementation CHAbstractBinarySearchTree
+- (NSUInteger) countOfObjectsBeforeObject:(id)anObject inclusive:(bool)inclusive;
+- (id) newTreeWithSortedObjects:(id*)objects count:(NSUInteger)objectCount;
 
-/* CJEC, 19-Jul-13:  Default class used with CHTreeOptionsMultiLeaves collections
-*/
-+ (Class)			GetClassCollection
-	{
-	return [NSMutableSet class];
-	}
+@end
 
-/* CJEC, 12-Feb-15: Read-only accessor to the options flags
+/* The bounds of a range of a binary search tree. A nil bound is unbounded
 */
-- (unsigned int)	GetOptions
+typedef struct CHBinaryTreeRange
 	{
-	CHUnsupportedOperationException ([self class], _cmd);
-	return 0;
-	}
+	CHBinaryTreeNode *			pHeader;		/* The tree's header, whose right link is the current root */
+	CHBinaryTreeNode *			pSentinel;
+	CHSearchTreeComparator *	pComparator;
+	id							poLow;
+	id							poHigh;
+	bool						fExcludeLow;
+	bool						fExcludeHigh;
+	} CHBinaryTreeRange;
 
-/* CJEC, 22-Jul-13: Depending on the nesting level, return the appropriate comparison selector
-*/
-+ (SEL)		SelCompare: (unsigned int) a_uiNestingLevel
+static inline bool	CHBinaryTreeRangeAfterLow (const CHBinaryTreeRange * a_pRange, id a_po)
 	{
-	SEL		pSelCompare;
-	
-	if (a_uiNestingLevel == 0)		/* Generate the particular object comparison's selector name from the nesting level, and create an NSInvocation to invoke it */
-		pSelCompare = NSSelectorFromString (@"compare:");	/* Note: Using compare: rather than compare0: also supports non-multi-level collections */
-	else
-		pSelCompare = NSSelectorFromString ([NSString stringWithFormat: @"compare%u:", a_uiNestingLevel]);
-	return pSelCompare;
+	NSComparisonResult	eComparisonResult;
+
+	if (a_pRange -> poLow == nil)
+		return true;
+	eComparisonResult = CHSearchTreeCompare (a_pRange -> pComparator, a_po, a_pRange -> poLow);
+	return (eComparisonResult == NSOrderedDescending) || ((eComparisonResult == NSOrderedSame) && !a_pRange -> fExcludeLow);
 	}
 
-/* CJEC, 8-Jul-13: Create an NSInvocation for comparing objects based on the nesting level.
-					Nesting level 0 uses compare:
-					Nesting level 1 uses compare1:
-					Nesting level 2 uses compare2: and so on
-*/
-+ (NSInvocation *)	InvocationCompare: (id) a_po nestingLevel: (unsigned int) a_uiNestingLevel
+static inline bool	CHBinaryTreeRangeBeforeHigh (const CHBinaryTreeRange * a_pRange, id a_po)
 	{
-	SEL					pSelCompare;
-	NSInvocation *		poInvocationCompare;
-	NSMethodSignature *	poMethodSignatureCompare;
+	NSComparisonResult	eComparisonResult;
 
-	pSelCompare = [self SelCompare: a_uiNestingLevel];
-	poMethodSignatureCompare = [[a_po class] instanceMethodSignatureForSelector: pSelCompare];
-	poInvocationCompare = [NSInvocation invocationWithMethodSignature: poMethodSignatureCompare];
-	[poInvocationCompare setSelector: pSelCompare];
-	return poInvocationCompare;
+	if (a_pRange -> poHigh == nil)
+		return true;
+	eComparisonResult = CHSearchTreeCompare (a_pRange -> pComparator, a_po, a_pRange -> poHigh);
+	return (eComparisonResult == NSOrderedAscending) || ((eComparisonResult == NSOrderedSame) && !a_pRange -> fExcludeHigh);
 	}
 
-/* CJEC, 10-Jul-13: Provide a comparison method using the comparison invocation
+/* Whether a_po has not yet passed the bound at which an enumeration in the given direction starts, or ends
 */
-- (NSComparisonResult)	Compare: (NSInvocation *) a_poInvocationCompare target: (id) a_poTarget argument: (id) a_poArgument
+static inline bool	CHBinaryTreeRangeWithinStart (const CHBinaryTreeRange * a_pRange, bool a_fDescending, id a_po)
 	{
-	NSComparisonResult	eComparisonResult;
-	id					poTarget;
-	SEL					pSelAnyObject;
-
-	if (a_poArgument != nil)
-		[a_poInvocationCompare setArgument: &a_poArgument atIndex: 2];	/* Note: Skip past hidden target (index 0) and selector (index 1) arguments for our first argument. Arguments are not retained without [poInvocationCompare retainArguments] */
-	poTarget = a_poTarget;
-	if ([self GetOptions] & CHTreeOptionsMultiLevel)	/* Multi-level collections allowed? */
-		{
-		pSelAnyObject = @selector (anyObject);	/* Identify a leaf object as fast as possible */
-		while ([poTarget respondsToSelector: pSelAnyObject])
-			{
-			poTarget = [poTarget anyObject];	/* All objects in the subcollections should compare the same way at a particular nesting level so use any of them */
-			NSAssert (poTarget != nil, @"Empty Collection is illegal");
-			}
-		NSAssert (![poTarget respondsToSelector: @selector (count)], @"Collection object does not respond to anyObject but does respond to count");
-		}
-	[a_poInvocationCompare invokeWithTarget: poTarget];	/* Note: Equivalent to eComparisonResult = (NSComparisonResult) [po performSelector: pSelCompare withObject: <Argument>]; but we don't have an object-sized return value so can't actually do this */
-	[a_poInvocationCompare getReturnValue: &eComparisonResult];
-	return eComparisonResult;
+	return a_fDescending ? CHBinaryTreeRangeBeforeHigh (a_pRange, a_po) : CHBinaryTreeRangeAfterLow (a_pRange, a_po);
 	}
 
-/* CJEC, 19-Jul-13: Depending on the object in question and the options flags, support multiple objects
-	all ordered NSOrderedSame at the same leaf. This is either a collection of the same type as this one
-	or a mutable (and hence unordered) set
+static inline bool	CHBinaryTreeRangeWithinEnd (const CHBinaryTreeRange * a_pRange, bool a_fDescending, id a_po)
+	{
+	return a_fDescending ? CHBinaryTreeRangeAfterLow (a_pRange, a_po) : CHBinaryTreeRangeBeforeHigh (a_pRange, a_po);
+	}
 
-	Note: Conforms to Foundation's naming conventions. The caller MUST release
+/* The first (or, if a_fDescending, the last) node in the range, or NULL if the range is empty. O(log n)
 */
-- (id)	newLeafCollection: (id) a_po nestingLevel: (unsigned int) a_uiNestingLevel returnsIsMultiLevel: (bool *) a_pfMultiLevel
+static CHBinaryTreeNode *	CHBinaryTreeRangeEndNode (const CHBinaryTreeRange * a_pRange, bool a_fDescending)
 	{
-	unsigned int	fuiOptions;
-	SEL				pSelCompare;
-	id				poNew;
+	CHBinaryTreeNode *	pNode;
+	CHBinaryTreeNode *	pNodeCandidate;
 
-	fuiOptions = [self GetOptions];
-	poNew = nil;													/* Default is no sub-collection */
-	*a_pfMultiLevel = false;										/* Default is not multi-level collection */
-	if (fuiOptions & CHTreeOptionsMultiLevel)						/* If multi-level trees are supported */
+	pNodeCandidate = NULL;
+	pNode = a_pRange -> pHeader -> right;
+	while (pNode != a_pRange -> pSentinel)
 		{
-		pSelCompare = [[self class] SelCompare: a_uiNestingLevel];
-		if ([a_po respondsToSelector: pSelCompare])					/* If the object responds to the appropriate comparison method */
+		if (CHBinaryTreeRangeWithinStart (a_pRange, a_fDescending, pNode -> object))
 			{
-			poNew = [[[self class] alloc] initWithTreeOptions: fuiOptions];
-			*a_pfMultiLevel = true;
+			pNodeCandidate = pNode;
+			pNode = pNode -> link [a_fDescending];		/* Look for an earlier node that is also within the range */
 			}
+		else
+			pNode = pNode -> link [!a_fDescending];
 		}
-	if ((poNew == nil) && (fuiOptions & CHTreeOptionsMultiLeaves))	/* Haven't already got a collection, and multiple leaves are supported? */
-		poNew = [[[[self class] GetClassCollection] alloc] init];
-	return poNew;
+	if ((pNodeCandidate != NULL) && !CHBinaryTreeRangeWithinEnd (a_pRange, a_fDescending, pNodeCandidate -> object))
+		pNodeCandidate = NULL;
+	return pNodeCandidate;
 	}
 
-// This is the designated initializer for CHAbstractBinarySearchTree, CHBinarySearchTree and all its derived classes
-// CJEC, 1-Jul-13: New designated intialiser specifies options from CHTreeOptions
-- (id) initWithTreeOptions: (unsigned int) a_fuiOptions {
-	if ((self = [super init]) == nil)
-		{
-		[self release];						/* CJEC, 12-Feb-15: Avoid memory leak when initialisation fails */
-		self = nil;
-		return self;
-		}
-	(void) a_fuiOptions;					/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning. CJEC, 12-Feb-15: TODO: Complete the conversion to a class cluster */
-	return self;
+// Pushes the path to the first node in the range onto the stack, so that popping the stack yields the
+// nodes in order, as for CHBinarySearchTreeEnumerator. Nodes before the range are skipped, together with
+// the subtrees on their far side, so seeking costs O(log n) however far into the tree the range starts.
+// With checkStart false, this pushes the near spine of a subtree, which is how the enumeration advances.
+#define CHBinaryTreeRange_SEEK(range, node, descending, checkStart) { \
+	while (node != (range)->pSentinel) { \
+		if (!(checkStart) || CHBinaryTreeRangeWithinStart(range, descending, node->object)) { \
+			CHBinaryTreeStack_PUSH(node); \
+			node = node->link[descending]; \
+		} else { \
+			node = node->link[!(descending)]; \
+		} \
+	} \
 }
 
-// CJEC, 1-Jul-13: Default initialiser behaves like the original code
-- (id)	init {
-	return [self initWithTreeOptions: 0];
-}
-// Calling [self init] allows child classes to initialize their specific state.
-// (The -init method in any subclass must always call to -[super init] first.)
-- (id) initWithArray:(NSArray*)anArray {
-	if ([self init] == nil) return nil;
-	[self addObjectsFromArray:anArray];
-	return self;
+@class CHBinarySearchTreeRangeView;
+
+/**
+ An NSEnumerator for traversing the objects in a range of a CHBinarySearchTree, in ascending or descending order. It seeks to the start of the range in O(log n), then produces each object on demand, stopping at the end of the range.
+ 
+ As for CHBinarySearchTreeEnumerator, if the tree is modified, the enumerator becomes invalid and will raise a mutation exception if any further objects are requested from it.
+ */
+@interface CHBinarySearchTreeRangeEnumerator : NSEnumerator
+{
+@private
+	__strong CHBinarySearchTreeRangeView *rangeView; // The view being enumerated, which retains its tree.
+	CHBinaryTreeRange range; // The bounds of the view.
+	BOOL descending; // Whether to enumerate from the high end of the range.
+	unsigned long mutationCount; // Stores the collection's initial mutation.
+	unsigned long *mutationPtr; // Pointer for checking changes in mutation.
+	CHBinaryTreeStack_DECLARE();
 }
 
-#pragma mark <NSCoding>
+- (id) initWithRangeView:(CHBinarySearchTreeRangeView*)view
+                   range:(const CHBinaryTreeRange*)aRange
+              descending:(BOOL)isDescending
+         mutationPointer:(unsigned long*)mutations;
 
-// CJEC, 2-Jul-13: TODO: Support multi-level trees
-- (id) initWithCoder:(NSCoder*) a_poCoder
-	{
-	bool			fAllowsKeyCoding;
-	int				fiOptions;
-	NSUInteger		cObjects;
-	NSUInteger		uiCount;
-	id				po;
+@end
 
-	fAllowsKeyCoding = [a_poCoder allowsKeyedCoding];
-	if (fAllowsKeyCoding)
-		{
-		fiOptions = [a_poCoder decodeIntForKey: @"options"];
-		cObjects = [a_poCoder decodeIntegerForKey: @"count"];
-		}
-    else
-		{
-		[a_poCoder decodeValueOfObjCType: @encode (int) at: &fiOptions];
-		[a_poCoder decodeValueOfObjCType: @encode (NSInteger) at: &cObjects];
-		}
-	self = [self initWithTreeOptions: fiOptions];
-	for (uiCount = 0; uiCount < cObjects; uiCount ++)
-		{
-		if (fAllowsKeyCoding)
-			po = [a_poCoder decodeObjectForKey: [[NSNumber numberWithUnsignedInteger: uiCount] stringValue]];
-		else
-			po = [a_poCoder decodeObject];
-		[self addObject: po];
-		}
-	return self;
-	}
+/**
+ A read-only view of the objects in a CHBinarySearchTree which fall between two endpoints, as returned by \link CHSortedSet#subsetFromObject:toObject:options: -subsetFromObject:toObject:options:\endlink for a range in ascending order. The view copies nothing when it is created: it retains the tree and its endpoints, seeks to the start of the range in O(log n) and enumerates lazily. @c -member: and @c -containsObject: check the endpoints, then search the tree. @c -count is O(log n) if the tree was created with @c CHTreeOptionsOrderStatistics, otherwise it counts the objects in the range once.
+ 
+ The view reflects the tree as it was when the view was created. Once the tree is modified, the view becomes invalid and raises a mutation exception from any further use. Methods which would modify the view raise an exception. Sending @c -copy to the view materializes it as a new tree of the same class as the original, containing the objects in the range, which is then independent of the original.
+ */
+@interface CHBinarySearchTreeRangeView : NSObject <CHSortedSet>
+{
+@private
+	__strong CHBinarySearchTree *searchTree; // The tree being viewed.
+	CHBinaryTreeRange range; // The bounds of the view, which are retained.
+	unsigned long mutationCount; // The tree's mutation count when the view was created.
+	unsigned long *mutationPtr; // Pointer for checking changes in mutation.
+	NSUInteger cachedCount; // The number of objects in the range, or NSNotFound until it is counted.
+}
 
-- (void) encodeWithCoder:(NSCoder*) a_poCoder
-	{
-	(void) a_poCoder;					/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
-	CHUnsupportedOperationException ([self class], _cmd);
-	}
+/**
+ Create a view of the objects in a tree which fall between two endpoints.
+ 
+ @param tree The tree being viewed, which is retained by the view.
+ @param aRange The header, sentinel and comparator of the tree, and the endpoints of the view. The endpoints are retained.
+ @param mutations A pointer to the tree's mutation count for invalidation.
+ */
+- (id) initWithTree:(CHBinarySearchTree*)tree
+              range:(const CHBinaryTreeRange*)aRange
+    mutationPointer:(unsigned long*)mutations;
 
-#pragma mark <NSCopying> methods
+@end
 
-- (id) copyWithZone:(NSZone*)zone {
-	id<CHSearchTree> newTree = [[[self class] allocWithZone:zone] initWithTreeOptions: [self GetOptions]];
-	// No point in using fast enumeration here until rdar://6296108 is addressed.
-	NSEnumerator *e = [self objectEnumeratorWithTraversalOrder:CHTraverseLevelOrder options: 0];	/* 18-Jul-13: CJEC: Don't bother enumerating sub-levels. Just copy en masse */
-	id anObject;
-	while ((anObject = [e nextObject])) {
-		[newTree addObject:anObject];
-	}
-	return newTree;
-}
+@implementation CHBinarySearchTreeRangeEnumerator
 
-#pragma mark <NSFastEnumeration>
-- (NSUInteger) countByEnumeratingWithState:(NSFastEnumerationState*)state
-                                   objects:(id*)stackbuf
-                                     count:(NSUInteger)len
+- (id) initWithRangeView:(CHBinarySearchTreeRangeView*)view
+                   range:(const CHBinaryTreeRange*)aRange
+              descending:(BOOL)isDescending
+         mutationPointer:(unsigned long*)mutations
 {
-	(void) state;					/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
-	(void) stackbuf;				/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
-	(void) len;						/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
-	CHUnsupportedOperationException ([self class], _cmd);
-	return 0;
+	if ((self = [super init]) == nil) return nil;
+	rangeView = [view retain];
+	range = *aRange;
+	descending = isDescending;
+	mutationCount = *mutations;
+	mutationPtr = mutations;
+	CHBinaryTreeStack_INIT();
+	CHBinaryTreeNode *current = range.pHeader->right;
+	CHBinaryTreeRange_SEEK(&range, current, descending, true);
+	return self;
 }
 
-#pragma mark Concrete Implementations
-
-- (void) addObjectsFromArray:(NSArray*)anArray {
-	for (id anObject in anArray) {
-		[self addObject:anObject];
-	}
+- (void) dealloc {
+	CHBinaryTreeStack_FREE(stack);
+	[rangeView release];
+	[super dealloc];
 }
 
 - (NSArray*) allObjects {
-	return [self allObjectsWithTraversalOrder:CHTraverseAscending];
+	NSMutableArray *array = [[NSMutableArray alloc] init];
+	id anObject;
+	while ((anObject = [self nextObject]))
+		[array addObject:anObject];
+	return [array autorelease];
 }
 
-/* 18-Jul-13: CJEC: Support multi-level trees */
-- (NSArray*) allObjectsWithTraversalOrder:(CHTraversalOrder)order {
-	return [[self objectEnumeratorWithTraversalOrder:order options: [self GetOptions]] allObjects];
+- (id) nextObject {
+	if (mutationCount != *mutationPtr)
+		CHMutatedCollectionException([self class], _cmd);
+	CHBinaryTreeNode *current = CHBinaryTreeStack_POP();
+	if (current == NULL || !CHBinaryTreeRangeWithinEnd(&range, descending, current->object)) {
+		// Exhausted, so let go of the view, and with it the tree, and any stack on the heap
+		stackSize = 0;
+		CHBinaryTreeStack_FREE(stack);
+		stack = stackInline;
+		mutationPtr = &mutationCount;
+		[rangeView release];
+		rangeView = nil;
+		return nil;
+	}
+	id anObject = current->object;
+	current = current->link[!descending];
+	CHBinaryTreeRange_SEEK(&range, current, descending, false);
+	return anObject;
 }
 
-- (id) anyObject
-	{
-	CHUnsupportedOperationException ([self class], _cmd);
+@end
+
+@implementation CHBinarySearchTreeRangeView
+
+- (id) initWithTree:(CHBinarySearchTree*)tree
+              range:(const CHBinaryTreeRange*)aRange
+    mutationPointer:(unsigned long*)mutations
+{
+	if ((self = [super init]) == nil) return nil;
+	searchTree = [tree retain];
+	range = *aRange;
+	[range.poLow retain];
+	[range.poHigh retain];
+	mutationCount = *mutations;
+	mutationPtr = mutations;
+	cachedCount = NSNotFound;
+	return self;
+}
+
+// A view is only created by its tree.
+- (id) init {
+	[self release];
+	CHUnsupportedOperationException([CHBinarySearchTreeRangeView class], _cmd);
+	return nil;
+}
+
+- (id) initWithArray:(NSArray*)anArray {
+	(void) anArray;
+	[self release];
+	CHUnsupportedOperationException([CHBinarySearchTreeRangeView class], _cmd);
 	return nil;
+}
+
+- (void) dealloc {
+	[range.poLow release];
+	[range.poHigh release];
+	[searchTree release];
+	[super dealloc];
+}
+
+#define CHRangeView_CHECK_MUTATIONS() { \
+	if (mutationCount != *mutationPtr) \
+		CHMutatedCollectionException([self class], _cmd); \
+}
+
+#pragma mark <NSCoding>
+
+// A view is archived as the tree it materializes into.
+- (Class) classForCoder {
+	return [searchTree class];
+}
+
+- (id) initWithCoder:(NSCoder*)decoder {
+	(void) decoder;
+	[self release];
+	CHUnsupportedOperationException([CHBinarySearchTreeRangeView class], _cmd);
+	return nil;
+}
+
+- (void) encodeWithCoder:(NSCoder*)encoder {
+	[[[self copy] autorelease] encodeWithCoder:encoder];
+}
+
+#pragma mark <NSCopying>
+
+// Materializes the view: the objects are already sorted, so the new tree is built directly in its balanced shape.
+- (id) copyWithZone:(NSZone*)zone {
+	(void) zone;
+	CHRangeView_CHECK_MUTATIONS();
+	NSUInteger objectCount = [self count];
+	id *objects = (objectCount == 0) ? NULL : malloc(kCHPointerSize * objectCount);
+	if (objectCount != 0 && objects == NULL)
+		[NSException raise:NSMallocException format:@"Not enough memory to copy %lu objects", (unsigned long) objectCount];
+	NSUInteger index = 0;
+	for (id anObject in self)
+		objects[index++] = anObject;
+	id copy = [searchTree newTreeWithSortedObjects:objects count:objectCount];
+	free(objects);
+	return copy;
+}
+
+#pragma mark <NSFastEnumeration>
+
+// Each batch seeks past the last object of the previous batch, so no state needs to be freed if the caller
+// stops early: state->state is 0 before the first batch, 1 after the first and 2 once the range is exhausted.
+- (NSUInteger) countByEnumeratingWithState:(NSFastEnumerationState*)state
+                                   objects:(id*)stackbuf
+                                     count:(NSUInteger)len
+{
+	CHRangeView_CHECK_MUTATIONS();
+	if (state->state == 2)
+		return 0;
+	CHBinaryTreeRange batchRange = range;
+	if (state->state == 0) {
+		state->mutationsPtr = mutationPtr;
+	} else {
+		batchRange.poLow = (id) state->extra[0];
+		batchRange.fExcludeLow = true;
+	}
+	state->itemsPtr = stackbuf;
+	
+	NSUInteger batchCount = 0;
+	CHBinaryTreeNode *current = range.pHeader->right;
+	CHBinaryTreeStack_DECLARE();
+	CHBinaryTreeStack_INIT();
+	CHBinaryTreeRange_SEEK(&batchRange, current, false, true);
+	while (batchCount < len && (current = CHBinaryTreeStack_POP()) != NULL) {
+		if (!CHBinaryTreeRangeBeforeHigh(&range, current->object)) {
+			stackSize = 0;
+			break;
+		}
+		stackbuf[batchCount++] = current->object;
+		current = current->right;
+		CHBinaryTreeRange_SEEK(&batchRange, current, false, false);
 	}
+	if (batchCount == 0 || (stackSize == 0 && batchCount < len)) {
+		state->state = 2;
+	} else {
+		state->state = 1;
+		state->extra[0] = (uintptr_t) stackbuf[batchCount - 1];
+	}
+	CHBinaryTreeStack_FREE(stack);
+	return batchCount;
+}
+
+#pragma mark Querying Contents
+
+- (NSArray*) allObjects {
+	return [[self objectEnumerator] allObjects];
+}
+
+- (id) anyObject {
+	return [self firstObject];
+}
 
 - (NSUInteger) count {
-	CHUnsupportedOperationException ([self class], _cmd);
-	return 0;
+	CHRangeView_CHECK_MUTATIONS();
+	if (cachedCount == NSNotFound) {
+		if ([searchTree GetOptions] & CHTreeOptionsOrderStatistics) {
+			NSUInteger through = (range.poHigh == nil) ? [searchTree count]
+				: [searchTree countOfObjectsBeforeObject:range.poHigh inclusive:!range.fExcludeHigh];
+			NSUInteger before = (range.poLow == nil) ? 0
+				: [searchTree countOfObjectsBeforeObject:range.poLow inclusive:range.fExcludeLow];
+			cachedCount = (through > before) ? through - before : 0;
+		} else {
+			cachedCount = 0;
+			for (id anObject in self) {
+				(void) anObject;
+				cachedCount++;
+			}
+		}
+	}
+	return cachedCount;
 }
 
 - (BOOL) containsObject:(id)anObject {
@@ -604,8 +836,9 @@ CHBinaryTreeNode* CHCreateBinaryTreeNodeWithObject(id anObject) {
 }
 
 - (id) firstObject {
-	CHUnsupportedOperationException ([self class], _cmd);
-	return nil;
+	CHRangeView_CHECK_MUTATIONS();
+	CHBinaryTreeNode *node = CHBinaryTreeRangeEndNode(&range, false);
+	return (node == NULL) ? nil : node->object;
 }
 
 - (NSUInteger) hash {
@@ -619,182 +852,3082 @@ CHBinaryTreeNode* CHCreateBinaryTreeNodeWithObject(id anObject) {
 		return NO;
 }
 
-- (BOOL) isEqualToSearchTree:(id<CHSearchTree>)otherTree {
-	return collectionsAreEqual(self, otherTree);
-}
-
 - (BOOL) isEqualToSortedSet:(id<CHSortedSet>)otherSortedSet {
 	return collectionsAreEqual(self, otherSortedSet);
 }
 
 - (id) lastObject {
-	CHUnsupportedOperationException ([self class], _cmd);
-	return nil;
+	CHRangeView_CHECK_MUTATIONS();
+	CHBinaryTreeNode *node = CHBinaryTreeRangeEndNode(&range, true);
+	return (node == NULL) ? nil : node->object;
 }
 
-- (id)	member: (id) a_po nestingLevel: (unsigned int) a_uiNestingLevel options: (unsigned int) a_fuiOptions
-	{
-	(void) a_po;					/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
-	(void) a_uiNestingLevel;		/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
-	(void) a_fuiOptions;			/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
-	CHUnsupportedOperationException ([self class], _cmd);
-	return nil;
-	}
-		
-/* CJEC, 2-Jul-13: Support multi-level collections */
 - (id) member:(id)anObject {
-	return [self member: anObject nestingLevel: 0 options: [self GetOptions]];
+	CHRangeView_CHECK_MUTATIONS();
+	if (anObject == nil || !CHBinaryTreeRangeAfterLow(&range, anObject) || !CHBinaryTreeRangeBeforeHigh(&range, anObject))
+		return nil;
+	return [searchTree member:anObject];
 }
 
-/* CJEC, 18-Jul-13: Support multi-level collections */
 - (NSEnumerator*) objectEnumerator {
-	return [self objectEnumeratorWithTraversalOrder:CHTraverseAscending options: [self GetOptions]];
+	CHRangeView_CHECK_MUTATIONS();
+	return [[[CHBinarySearchTreeRangeEnumerator alloc] initWithRangeView:self
+	                                                               range:&range
+	                                                          descending:NO
+	                                                     mutationPointer:mutationPtr] autorelease];
 }
 
-- (NSEnumerator*) objectEnumeratorWithTraversalOrder:(CHTraversalOrder)order options: (unsigned int) a_fuiOptions {
-	(void) order;					/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
-	(void) a_fuiOptions;			/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
-	CHUnsupportedOperationException ([self class], _cmd);
-	return nil;
+- (NSEnumerator*) reverseObjectEnumerator {
+	CHRangeView_CHECK_MUTATIONS();
+	return [[[CHBinarySearchTreeRangeEnumerator alloc] initWithRangeView:self
+	                                                               range:&range
+	                                                          descending:YES
+	                                                     mutationPointer:mutationPtr] autorelease];
+}
+
+- (NSSet*) set {
+	return [NSSet setWithArray:[self allObjects]];
+}
+
+// A range within the view is another view of the tree, bounded by the tighter of each pair of endpoints.
+// Any other subset is taken from a materialized copy of the view.
+- (id<CHSortedSet>) subsetFromObject:(id)start
+                            toObject:(id)end
+                             options:(CHSubsetConstructionOptions)options
+{
+	CHRangeView_CHECK_MUTATIONS();
+	if (start != nil && end != nil && CHSearchTreeCompare(range.pComparator, start, end) == NSOrderedDescending)
+		return [[[self copy] autorelease] subsetFromObject:start toObject:end options:options];
+	CHBinaryTreeRange subrange = range;
+	NSComparisonResult comparison;
+	if (start != nil) {
+		comparison = (range.poLow == nil) ? NSOrderedDescending : CHSearchTreeCompare(range.pComparator, start, range.poLow);
+		if (comparison == NSOrderedDescending) {
+			subrange.poLow = start;
+			subrange.fExcludeLow = (options & CHSubsetExcludeLowEndpoint) != 0;
+		} else if (comparison == NSOrderedSame) {
+			subrange.fExcludeLow = range.fExcludeLow || (options & CHSubsetExcludeLowEndpoint) != 0;
+		}
+	}
+	if (end != nil) {
+		comparison = (range.poHigh == nil) ? NSOrderedAscending : CHSearchTreeCompare(range.pComparator, end, range.poHigh);
+		if (comparison == NSOrderedAscending) {
+			subrange.poHigh = end;
+			subrange.fExcludeHigh = (options & CHSubsetExcludeHighEndpoint) != 0;
+		} else if (comparison == NSOrderedSame) {
+			subrange.fExcludeHigh = range.fExcludeHigh || (options & CHSubsetExcludeHighEndpoint) != 0;
+		}
+	}
+	return [[[CHBinarySearchTreeRangeView alloc] initWithTree:searchTree
+	                                                    range:&subrange
+	                                          mutationPointer:mutationPtr] autorelease];
+}
+
+- (NSString*) description {
+	return [[self allObjects] description];
+}
+
+#pragma mark Modifying Contents
+
+- (void) addObject:(id)anObject {
+	(void) anObject;
+	CHUnsupportedOperationException([self class], _cmd);
+}
+
+- (void) addObjectsFromArray:(NSArray*)anArray {
+	(void) anArray;
+	CHUnsupportedOperationException([self class], _cmd);
 }
 
 - (void) removeAllObjects {
-	CHUnsupportedOperationException ([self class], _cmd);
+	CHUnsupportedOperationException([self class], _cmd);
 }
 
-// Incurs an extra search cost, but we don't know how the child class removes...
 - (void) removeFirstObject {
-	[self removeObject:[self firstObject]];
+	CHUnsupportedOperationException([self class], _cmd);
 }
 
-// Incurs an extra search cost, but we don't know how the child class removes...
 - (void) removeLastObject {
-	[self removeObject:[self lastObject]];
+	CHUnsupportedOperationException([self class], _cmd);
 }
 
-/* CJEC, 18-Jul-13: Support multi-level collections */
-- (NSEnumerator*) reverseObjectEnumerator {
-	return [self objectEnumeratorWithTraversalOrder:CHTraverseDescending options: [self GetOptions]];
+- (void) removeObject:(id)anObject {
+	(void) anObject;
+	CHUnsupportedOperationException([self class], _cmd);
 }
 
-/* CJEC, 18-Jul-13: Support multi-level collections */
-- (NSSet*) set {
-	NSMutableSet *set = [NSMutableSet new];
-	NSEnumerator *e = [self objectEnumeratorWithTraversalOrder:CHTraversePreOrder options: [self GetOptions]];
-	id anObject;
-	while ((anObject = [e nextObject])) {
-		[set addObject:anObject];
+@end
+
+#pragma mark -
+
+@interface CHBinarySearchTreeCursor ()
+
+// Positions the cursor at the first object ordered after (or, unless isAfter, the same as) anObject.
+- (id) initWithTree:(CHBinarySearchTree*)tree
+             header:(CHBinaryTreeNode*)header
+           sentinel:(CHBinaryTreeNode*)sentinel
+         comparator:(CHSearchTreeComparator*)comparator
+         multiLevel:(bool)isMultiLevel
+    mutationPointer:(unsigned long*)mutations
+             object:(id)anObject
+              after:(BOOL)isAfter;
+
+// Moves to the successor (direction 1) or predecessor (direction 0) of the cursor's object.
+- (id) moveInDirection:(int)direction;
+
+// Returns the path from the root to the cursor's object, setting *size to its number of nodes and *cursorPosition to the cursor's position, or NULL if the cursor is over another tree.
+- (CHBinaryTreeNode**) pathInTree:(CHBinarySearchTree*)tree size:(NSUInteger*)size position:(int*)cursorPosition;
+
+// Positions the cursor at the last node of a path of size nodes from the root, or after the last object if size is 0, and makes the cursor valid for the tree as it now is.
+- (void) setPath:(CHBinaryTreeNode**)path size:(NSUInteger)size;
+
+@end
+
+@implementation CHBinarySearchTreeCursor
+
+- (id) initWithTree:(CHBinarySearchTree*)tree
+             header:(CHBinaryTreeNode*)header
+           sentinel:(CHBinaryTreeNode*)sentinel
+         comparator:(CHSearchTreeComparator*)comparator
+         multiLevel:(bool)isMultiLevel
+    mutationPointer:(unsigned long*)mutations
+             object:(id)anObject
+              after:(BOOL)isAfter
+{
+	if ((self = [super init]) == nil) return nil;
+	searchTree = [tree retain];
+	headerNode = header;
+	sentinelNode = sentinel;
+	mutationCount = *mutations;
+	mutationPtr = mutations;
+	stack = stackInline;
+	stackCapacity = kCHBinaryTreeCursorPathInlineSize;
+	stackSize = 0;
+	
+	// Push the whole search path, remembering how deep the last node that qualified was, then cut the path back to it.
+	NSUInteger foundSize = 0;
+	CHBinaryTreeNode *current = header->right;
+	while (current != sentinel) {
+		CHBinaryTreeStack_PUSH(current);
+		NSComparisonResult comparison = (anObject == nil) ? NSOrderedDescending
+			: CHSearchTreeCompareObjects(comparator, 0, isMultiLevel, current->object, anObject);
+		if (comparison == NSOrderedDescending || (comparison == NSOrderedSame && !isAfter)) {
+			foundSize = stackSize;
+			current = current->left;
+		} else {
+			current = current->right;
+		}
+	}
+	stackSize = foundSize;
+	position = (stackSize > 0) ? 0 : 1;
+	return self;
+}
+
+- (void) dealloc {
+	CHBinaryTreeStack_FREE(stack);
+	[searchTree release];
+	[super dealloc];
+}
+
+- (id) object {
+	if (mutationCount != *mutationPtr)
+		CHMutatedCollectionException([self class], _cmd);
+	return (position == 0) ? CHBinaryTreeStack_TOP->object : nil;
+}
+
+- (id) moveInDirection:(int)direction {
+	CHBinaryTreeNode *current;
+	if (position == 0) {
+		current = CHBinaryTreeStack_TOP->link[direction];
+		if (current != sentinelNode) {
+			// The next object is the nearest one in the subtree on that side.
+			while (current != sentinelNode) {
+				CHBinaryTreeStack_PUSH(current);
+				current = current->link[!direction];
+			}
+			return CHBinaryTreeStack_TOP->object;
+		}
+		// Otherwise climb until we come up from the near side of an ancestor, which is the next object.
+		CHBinaryTreeNode *child;
+		do {
+			child = CHBinaryTreeStack_POP();
+			current = CHBinaryTreeStack_TOP;
+		} while (current != NULL && current->link[direction] == child);
+		if (current != NULL)
+			return current->object;
+		position = (direction == 1) ? 1 : -1;
+		return nil;
+	}
+	if (position == (direction == 1 ? 1 : -1))
+		return nil; // Already past that end
+	// From the other end, the next object is the first or last in the tree.
+	current = headerNode->right;
+	while (current != sentinelNode) {
+		CHBinaryTreeStack_PUSH(current);
+		current = current->link[!direction];
+	}
+	if (stackSize == 0)
+		return nil;
+	position = 0;
+	return CHBinaryTreeStack_TOP->object;
+}
+
+- (id) next {
+	if (mutationCount != *mutationPtr)
+		CHMutatedCollectionException([self class], _cmd);
+	return [self moveInDirection:1];
+}
+
+- (id) previous {
+	if (mutationCount != *mutationPtr)
+		CHMutatedCollectionException([self class], _cmd);
+	return [self moveInDirection:0];
+}
+
+- (CHBinaryTreeNode**) pathInTree:(CHBinarySearchTree*)tree size:(NSUInteger*)size position:(int*)cursorPosition {
+	if (tree != searchTree)
+		return NULL;
+	if (mutationCount != *mutationPtr)
+		CHMutatedCollectionException([self class], _cmd);
+	*size = stackSize;
+	*cursorPosition = position;
+	return stack;
+}
+
+- (void) setPath:(CHBinaryTreeNode**)path size:(NSUInteger)size {
+	stackSize = 0;
+	for (NSUInteger index = 0; index < size; index++)
+		CHBinaryTreeStack_PUSH(path[index]);
+	position = (size > 0) ? 0 : 1;
+	mutationCount = *mutationPtr;
+}
+
+@end
+
+#pragma mark -
+
+CHBinaryTreeNode* CHCreateBinaryTreeNodeWithObject(id anObject) {
+	CHBinaryTreeNode *node;
+	// NSScannedOption tells the garbage collector to scan object and children.
+	node = NSAllocateCollectable(kCHBinaryTreeCountedNodeSize, NSScannedOption);
+	node->object = anObject;
+	node->balance = 0; // Affects balancing info for any subclass (anon. union)
+	CHBinaryTreeNodeCount(node) = 0; // The sentinel counts as an empty subtree
+	return node;
+}
+
+/* Start a new slab, sized from the caller's capacity for the first slab and then doubling up to a maximum, and return its first node
+*/
+CHBinaryTreeNode *	CHBinaryTreeNodePoolGrow (CHBinaryTreeNodePool * a_pPool)
+	{
+	CHBinaryTreeNodeSlab *	pSlab;
+	CHBinaryTreeNodeArena *	pArena;
+	NSUInteger				cNodes;
+	char *					pbFirst;
+
+	if (a_pPool -> cbNode == 0)
+		a_pPool -> cbNode = kCHBinaryTreeNodeSize;
+	cNodes = a_pPool -> cNodesSlab;
+	if (cNodes == 0)
+		cNodes = (a_pPool -> cNodesCapacity != 0) ? a_pPool -> cNodesCapacity : kCHBinaryTreeNodeSlabDefault;
+	// NSScannedOption tells the garbage collector to scan objects and children in the slab's nodes.
+	pSlab = NSAllocateCollectable (sizeof (CHBinaryTreeNodeSlab) + cNodes * a_pPool -> cbNode, NSScannedOption);
+	if (pSlab == NULL)
+		[NSException raise: NSMallocException format: @"Unable to allocate %lu binary tree nodes", (unsigned long) cNodes];
+	memset (pSlab + 1, 0, cNodes * a_pPool -> cbNode);	/* Unused nodes have nil objects, even in slabs another pool carves from */
+	pArena = CHBinaryTreeNodeArenaRoot (a_pPool -> pArena);
+	pSlab -> pSlabNext = pArena -> pSlabs;
+	pSlab -> cNodes = cNodes;
+	pArena -> pSlabs = pSlab;
+	pbFirst = (char *) (pSlab + 1);
+	a_pPool -> pbNext = pbFirst + a_pPool -> cbNode;
+	a_pPool -> pbEnd = pbFirst + cNodes * a_pPool -> cbNode;
+	a_pPool -> cNodesSlab = (cNodes < kCHBinaryTreeNodeSlabMaximum / 2) ? cNodes * 2 : kCHBinaryTreeNodeSlabMaximum;
+	return (CHBinaryTreeNode *) pbFirst;
+	}
+
+/* The reference count precedes the node, which is the size of a node of the pool
+*/
+CHBinaryTreeNode *	CHBinaryTreeSharedNodeAlloc (CHBinaryTreeNodePool * a_pPool, id a_poObject)
+	{
+	NSUInteger *		pcReferences;
+	CHBinaryTreeNode *	pNode;
+
+	// NSScannedOption tells the garbage collector to scan the object and children of the node.
+	pcReferences = NSAllocateCollectable (sizeof (NSUInteger) + a_pPool -> cbNode, NSScannedOption);
+	if (pcReferences == NULL)
+		[NSException raise: NSMallocException format: @"Unable to allocate a binary tree node"];
+	*pcReferences = 1;
+	pNode = (CHBinaryTreeNode *) (pcReferences + 1);
+	pNode -> object = a_poObject;
+	pNode -> balance = 0;	// Affects balancing info for any subclass (anon. union)
+	if (a_pPool -> cbNode != kCHBinaryTreeNodeSize)	/* A counted node, for order statistics */
+		CHBinaryTreeNodeCount (pNode) = 1;
+	return pNode;
+	}
+
+/* Freeing a node drops its references to its children, so whole subtrees that no other tree shares are freed, without recursion
+*/
+void	CHBinaryTreeSharedNodeRelease (CHBinaryTreeNode * a_pNode, CHBinaryTreeNode * a_pSentinel)
+	{
+	CHBinaryTreeNode *	pNode;
+	CHBinaryTreeStack_DECLARE();
+	CHBinaryTreeStack_INIT();
+
+	if (a_pNode != a_pSentinel)
+		CHBinaryTreeStack_PUSH(a_pNode);
+	while ((pNode = CHBinaryTreeStack_POP()) != NULL)
+		{
+		if (__atomic_sub_fetch (&CHBinaryTreeNodeReferences (pNode), 1, __ATOMIC_ACQ_REL) != 0)
+			continue;
+		if (pNode -> left != a_pSentinel)
+			CHBinaryTreeStack_PUSH(pNode -> left);
+		if (pNode -> right != a_pSentinel)
+			CHBinaryTreeStack_PUSH(pNode -> right);
+		[pNode -> object release];
+		free (&CHBinaryTreeNodeReferences (pNode));
+		}
+	CHBinaryTreeStack_FREE(stack);
+	}
+
+/* A count of one cannot rise while the caller holds that reference, since the node is reachable only through it, so the node is the caller's to change
+*/
+CHBinaryTreeNode *	CHBinaryTreeSharedNodeUnshare (CHBinaryTreeNodePool * a_pPool, CHBinaryTreeNode * a_pNode, CHBinaryTreeNode * a_pSentinel)
+	{
+	CHBinaryTreeNode *	pNode;
+
+	if (__atomic_load_n (&CHBinaryTreeNodeReferences (a_pNode), __ATOMIC_ACQUIRE) == 1)
+		return a_pNode;
+	pNode = CHBinaryTreeSharedNodeAlloc (a_pPool, nil);
+	memcpy (pNode, a_pNode, a_pPool -> cbNode);
+	[pNode -> object retain];
+	CHBinaryTreeSharedNodeRetain (pNode -> left, a_pSentinel);
+	CHBinaryTreeSharedNodeRetain (pNode -> right, a_pSentinel);
+	CHBinaryTreeSharedNodeRelease (a_pNode, a_pSentinel);
+	return pNode;
+	}
+
+/* Release the objects in the nodes in use, then free all the slabs. Free and unused nodes have nil objects, and the pool's own slab is only used up
+	to pbNext. When other trees share the arena, some of the nodes in its slabs are theirs, so the tree is walked instead
+*/
+void	CHBinaryTreeNodePoolRemoveAll (CHBinaryTreeNodePool * a_pPool, CHBinaryTreeNode * a_pRoot, CHBinaryTreeNode * a_pSentinel, bool a_fReleaseObjects)
+	{
+	CHBinaryTreeNodeArena *	pArena;
+	CHBinaryTreeNodeSlab *	pSlab;
+	CHBinaryTreeNodeSlab *	pSlabNext;
+	CHBinaryTreeNode *		pNode;
+	char *					pb;
+	char *					pbEnd;
+	id						po;
+
+	if (a_pPool -> fSharedNodes)			/* The nodes are freed, and their objects released, with the last tree that uses them */
+		{
+		CHBinaryTreeSharedNodeRelease (a_pRoot, a_pSentinel);
+		return;
+		}
+	pArena = a_pPool -> pArena;
+	if ((pArena -> pArenaMergedInto != NULL) || (pArena -> cReferences != 1))
+		{
+		CHBinaryTreeStack_DECLARE();
+		CHBinaryTreeStack_INIT();
+		if (a_pRoot != a_pSentinel)
+			CHBinaryTreeStack_PUSH(a_pRoot);
+		while ((pNode = CHBinaryTreeStack_POP()) != NULL)
+			{
+			if (pNode -> left != a_pSentinel)
+				CHBinaryTreeStack_PUSH(pNode -> left);
+			if (pNode -> right != a_pSentinel)
+				CHBinaryTreeStack_PUSH(pNode -> right);
+			if (a_fReleaseObjects)
+				[pNode -> object release];
+			CHBinaryTreeNodePoolFree (a_pPool, pNode);
+			}
+		CHBinaryTreeStack_FREE(stack);
+		return;
+		}
+	for (pSlab = pArena -> pSlabs; pSlab != NULL; pSlab = pSlabNext)
+		{
+		pSlabNext = pSlab -> pSlabNext;
+		if (a_fReleaseObjects)
+			{
+			pb = (char *) (pSlab + 1);
+			pbEnd = pb + pSlab -> cNodes * a_pPool -> cbNode;
+			if ((a_pPool -> pbNext >= pb) && (a_pPool -> pbNext <= pbEnd))
+				pbEnd = a_pPool -> pbNext;
+			for ( ; pb < pbEnd; pb += a_pPool -> cbNode)
+				{
+				po = ((CHBinaryTreeNode *) pb) -> object;
+				if (po != nil)
+					[po release];
+				}
+			}
+		free (pSlab);
+		}
+	pArena -> pSlabs = NULL;
+	a_pPool -> pNodeFree = NULL;
+	a_pPool -> pbNext = NULL;
+	a_pPool -> pbEnd = NULL;
+	a_pPool -> cNodesSlab = 0;				/* The next slab is sized from the caller's capacity again */
+	}
+
+CHBinaryTreeNode *	CHBinaryTreeNodePoolCreateArena (CHBinaryTreeNodePool * a_pPool)
+	{
+	CHBinaryTreeNodeArena *	pArena;
+
+	// NSScannedOption tells the garbage collector to scan the slabs linked from the arena.
+	pArena = NSAllocateCollectable (sizeof (CHBinaryTreeNodeArena), NSScannedOption);
+	if (pArena == NULL)
+		return NULL;
+	pArena -> pArenaMergedInto = NULL;
+	pArena -> cReferences = 1;
+	pArena -> pSlabs = NULL;
+	pArena -> pSentinel = CHCreateBinaryTreeNodeWithObject (nil);
+	if (pArena -> pSentinel == NULL)
+		{
+		free (pArena);
+		return NULL;
+		}
+	pArena -> pSentinel -> right = pArena -> pSentinel;
+	pArena -> pSentinel -> left = pArena -> pSentinel;
+	a_pPool -> pArena = pArena;
+	return pArena -> pSentinel;
+	}
+
+/* Drop a reference, and when it was the last, free the arena and drop the reference it holds on the arena it forwards to, if any
+*/
+void	CHBinaryTreeNodePoolRelease (CHBinaryTreeNodePool * a_pPool)
+	{
+	CHBinaryTreeNodeArena *	pArena;
+	CHBinaryTreeNodeArena *	pArenaNext;
+	CHBinaryTreeNodeSlab *	pSlab;
+	CHBinaryTreeNodeSlab *	pSlabNext;
+
+	for (pArena = a_pPool -> pArena; (pArena != NULL) && (__atomic_sub_fetch (&pArena -> cReferences, 1, __ATOMIC_ACQ_REL) == 0); pArena = pArenaNext)
+		{
+		pArenaNext = pArena -> pArenaMergedInto;
+		for (pSlab = pArena -> pSlabs; pSlab != NULL; pSlab = pSlabNext)
+			{
+			pSlabNext = pSlab -> pSlabNext;
+			free (pSlab);
+			}
+		free (pArena -> pSentinel);
+		free (pArena);
+		}
+	a_pPool -> pArena = NULL;
+	a_pPool -> pNodeFree = NULL;
+	a_pPool -> pbNext = NULL;
+	a_pPool -> pbEnd = NULL;
+	}
+
+CHBinaryTreeNode *	CHBinaryTreeNodePoolShare (CHBinaryTreeNodePool * a_pPool, CHBinaryTreeNodePool * a_pPoolFrom)
+	{
+	CHBinaryTreeNodePoolRelease (a_pPool);
+	a_pPool -> pArena = a_pPoolFrom -> pArena;
+	__atomic_add_fetch (&a_pPool -> pArena -> cReferences, 1, __ATOMIC_RELAXED);
+	return a_pPool -> pArena -> pSentinel;
+	}
+
+void	CHBinaryTreeNodePoolMerge (CHBinaryTreeNodePool * a_pPool, CHBinaryTreeNodePool * a_pPoolFrom)
+	{
+	CHBinaryTreeNodeArena *	pArena;
+	CHBinaryTreeNodeArena *	pArenaFrom;
+	CHBinaryTreeNodeSlab *	pSlab;
+
+	pArena = CHBinaryTreeNodeArenaRoot (a_pPool -> pArena);
+	pArenaFrom = CHBinaryTreeNodeArenaRoot (a_pPoolFrom -> pArena);
+	if (pArena == pArenaFrom)
+		return;
+	if (pArenaFrom -> pSlabs != NULL)
+		{
+		for (pSlab = pArenaFrom -> pSlabs; pSlab -> pSlabNext != NULL; pSlab = pSlab -> pSlabNext)
+			;
+		pSlab -> pSlabNext = pArena -> pSlabs;
+		pArena -> pSlabs = pArenaFrom -> pSlabs;
+		pArenaFrom -> pSlabs = NULL;
+		}
+	pArenaFrom -> pArenaMergedInto = pArena;
+	pArena -> cReferences ++;
+	}
+
+CHBinaryTreeNode**	CHBinaryTreeStackGrow(CHBinaryTreeNode **stack, NSUInteger *stackCapacity, CHBinaryTreeNode **stackInline)
+	{
+	CHBinaryTreeNode **	stackNew;
+
+	if (stack == stackInline)			/* Leaving the fixed-size buffer, so copy its contents */
+		{
+		stackNew = malloc(kCHPointerSize * *stackCapacity * 2);
+		if (stackNew != NULL)
+			memcpy(stackNew, stack, kCHPointerSize * *stackCapacity);
+		}
+	else
+		stackNew = realloc(stack, kCHPointerSize * *stackCapacity * 2);
+	if (stackNew == NULL)
+		[NSException raise: NSMallocException format: @"Unable to grow binary tree stack beyond %lu nodes", (unsigned long) *stackCapacity];
+	*stackCapacity *= 2;
+	return stackNew;
+	}
+
+void	CHBinaryTreeNodePoolReserve (CHBinaryTreeNodePool * a_pPool, NSUInteger a_cNodes)
+	{
+	if (a_cNodes > a_pPool -> cNodesSlab)
+		a_pPool -> cNodesSlab = a_cNodes;
+	}
+
+void	CHBinaryTreeNodeCountPath (CHBinaryTreeNode * a_pHeader, CHBinaryTreeNode * a_pSentinel, CHSearchTreeComparator * a_pComparator, unsigned int a_uiNestingLevel, bool a_fMultiLevel, id a_poKey)
+	{
+	CHBinaryTreeNode *	pNode;
+	CHBinaryTreeStack_DECLARE();
+	CHBinaryTreeStack_INIT();
+
+	pNode = a_pHeader -> right;
+	while (pNode != a_pSentinel)
+		{
+		CHBinaryTreeStack_PUSH(pNode);
+		pNode = pNode -> link [CHSearchTreeCompareObjects (a_pComparator, a_uiNestingLevel, a_fMultiLevel, pNode -> object, a_poKey) != NSOrderedDescending];	/* R on YES, and on a match */
+		}
+	while ((pNode = CHBinaryTreeStack_POP()) != NULL)
+		CHBinaryTreeNodeCount (pNode) = CHBinaryTreeNodeCount (pNode -> left) + CHBinaryTreeNodeCount (pNode -> right) + 1;
+	CHBinaryTreeStack_FREE(stack);
+	}
+
+/* The signature of -setBalanceForBuiltNode:leftHeight:rightHeight:depth:treeHeight:, called directly for every node placed by a balanced build
+*/
+typedef void (*CHBuiltNodeIMP) (id a_poTree, SEL a_sel, CHBinaryTreeNode * a_pNode, NSUInteger a_uiLeftHeight, NSUInteger a_uiRightHeight, NSUInteger a_uiDepth, NSUInteger a_uiTreeHeight);
+
+typedef struct CHBinaryTreeBuild {
+	id *					apo;			/* The objects to place, in ascending order */
+	CHBinaryTreeNodePool *	pPool;
+	CHBinaryTreeNode *		pSentinel;
+	NSUInteger				uiTreeHeight;	/* The height of the finished tree, for a tree of n objects floor (log2 (n)) + 1 */
+	id						poTree;
+	SEL						selBuilt;
+	CHBuiltNodeIMP			pfnBuilt;
+	bool					fCounted;		/* Set subtree counts, for CHTreeOptionsOrderStatistics */
+	CHBinaryTreeNode **		apNode;			/* For a parallel build, a node for each object taken from the pool in advance, otherwise NULL */
+} CHBinaryTreeBuild;
+
+/* The height of a perfectly balanced tree of a_cObjects objects, floor (log2 (n)) + 1, or 0 when empty
+*/
+static inline NSUInteger	CHBinaryTreeBuildHeight (NSUInteger a_cObjects)
+	{
+	NSUInteger	uiHeight;
+
+	for (uiHeight = 0; a_cObjects != 0; a_cObjects >>= 1)
+		uiHeight ++;
+	return uiHeight;
+	}
+
+/* Link the objects [a_uiLow, a_uiHigh) as a perfectly balanced subtree and return its height. When the halves differ in size, the right half gets the extra object,
+	so that every leaf is on one of the last two levels and a node with a single child always has a right child. The subclass's balancing information is set
+	after both children have been built, when both of their heights are known. The recursion is only as deep as the finished tree is high
+*/
+static NSUInteger	CHBinaryTreeBuildSubtree (CHBinaryTreeBuild * a_pBuild, NSUInteger a_uiLow, NSUInteger a_uiHigh, NSUInteger a_uiDepth, CHBinaryTreeNode ** a_ppLink)
+	{
+	CHBinaryTreeNode *	pNode;
+	NSUInteger			uiMiddle;
+	NSUInteger			uiLeftHeight;
+	NSUInteger			uiRightHeight;
+
+	if (a_uiLow >= a_uiHigh)
+		{
+		*a_ppLink = a_pBuild -> pSentinel;
+		return 0;
+		}
+	uiMiddle = a_uiLow + (a_uiHigh - a_uiLow - 1) / 2;
+	if (a_pBuild -> apNode == NULL)
+		pNode = CHBinaryTreeNodePoolAlloc (a_pBuild -> pPool, [a_pBuild -> apo [uiMiddle] retain]);
+	else
+		{
+		pNode = a_pBuild -> apNode [uiMiddle];
+		[pNode -> object retain];
+		}
+	*a_ppLink = pNode;
+	uiLeftHeight = CHBinaryTreeBuildSubtree (a_pBuild, a_uiLow, uiMiddle, a_uiDepth + 1, &pNode -> left);
+	uiRightHeight = CHBinaryTreeBuildSubtree (a_pBuild, uiMiddle + 1, a_uiHigh, a_uiDepth + 1, &pNode -> right);
+	a_pBuild -> pfnBuilt (a_pBuild -> poTree, a_pBuild -> selBuilt, pNode, uiLeftHeight, uiRightHeight, a_uiDepth, a_pBuild -> uiTreeHeight);
+	if (a_pBuild -> fCounted)
+		CHBinaryTreeNodeCount (pNode) = a_uiHigh - a_uiLow;
+	return MAX (uiLeftHeight, uiRightHeight) + 1;
+	}
+
+/* Copy one node of a tree into a_pPool, with its links, balancing information and subtree count unchanged. The object is retained, except that a sub-collection
+	of a multi-level tree is copied, so that changes made through either tree are not seen by the other
+*/
+static inline CHBinaryTreeNode *	CHBinaryTreeCloneNode (CHBinaryTreeNodePool * a_pPool, CHBinaryTreeNode * a_pNode, bool a_fSubcollections, NSZone * a_pZone)
+	{
+	CHBinaryTreeNode *	pNode;
+	id					po;
+
+	po = a_pNode -> object;
+	if (!a_fSubcollections)
+		po = [po retain];
+	else
+		if ([po conformsToProtocol: @protocol (CHMultiLevelTreeP)])
+			po = [po copyWithZone: a_pZone];				/* A sub-tree, which is cloned in the same way */
+		else
+			if ([po respondsToSelector: @selector (addObject:)] && [po respondsToSelector: @selector (mutableCopyWithZone:)])
+				po = [po mutableCopyWithZone: a_pZone];	/* Multiple leaves */
+			else
+				po = [po retain];
+	pNode = CHBinaryTreeNodePoolAlloc (a_pPool, po);
+	pNode -> left = a_pNode -> left;
+	pNode -> right = a_pNode -> right;
+	pNode -> balance = a_pNode -> balance;					/* Whichever of balance, color, level or priority the subclass uses */
+	if (a_pPool -> cbNode != kCHBinaryTreeNodeSize)
+		CHBinaryTreeNodeCount (pNode) = CHBinaryTreeNodeCount (a_pNode);
+	return pNode;
+	}
+
+/* Copy the subtree at a_pRoot into a_pPool in one pass, keeping its shape, so that no object is compared and nothing is rebalanced. Each copy starts with the links
+	of its original, which are replaced in turn by links to the copies of the original's children, so the stack holds only copies and is no deeper than the tree
+*/
+static CHBinaryTreeNode *	CHBinaryTreeCloneSubtree (CHBinaryTreeNodePool * a_pPool, CHBinaryTreeNode * a_pRoot, CHBinaryTreeNode * a_pSentinelFrom, CHBinaryTreeNode * a_pSentinel,
+														  bool a_fSubcollections, NSZone * a_pZone)
+	{
+	CHBinaryTreeNode *	pRoot;
+	CHBinaryTreeNode *	pNode;
+	CHBinaryTreeNode *	pChild;
+	int					iLink;
+	CHBinaryTreeStack_DECLARE();
+
+	if (a_pRoot == a_pSentinelFrom)
+		return a_pSentinel;
+	CHBinaryTreeStack_INIT();
+	pRoot = CHBinaryTreeCloneNode (a_pPool, a_pRoot, a_fSubcollections, a_pZone);
+	CHBinaryTreeStack_PUSH(pRoot);
+	while ((pNode = CHBinaryTreeStack_POP()) != NULL)
+		{
+		for (iLink = 1; iLink >= 0; iLink --)				/* The left child is pushed last, so its subtree is copied first */
+			{
+			pChild = pNode -> link [iLink];
+			if (pChild == a_pSentinelFrom)
+				pNode -> link [iLink] = a_pSentinel;
+			else
+				{
+				pChild = CHBinaryTreeCloneNode (a_pPool, pChild, a_fSubcollections, a_pZone);
+				pNode -> link [iLink] = pChild;
+				CHBinaryTreeStack_PUSH(pChild);
+				}
+			}
+		}
+	CHBinaryTreeStack_FREE(stack);
+	return pRoot;
+	}
+
+#pragma mark Parallel bulk operations
+
+#define kCHParallelTasksPerWorker	4	/* Tasks handed out for each worker, so that a worker that finishes early can take another */
+
+static NSUInteger	s_cParallelGrainSize = 0;		/* Zero disables parallel bulk operations */
+
+/* How a bulk operation is divided between workers
+*/
+typedef struct CHBinaryTreeParallelism {
+	NSUInteger	cGrain;			/* The fewest objects worth handing to a worker */
+	NSUInteger	cWorkers;		/* The most workers running at once */
+} CHBinaryTreeParallelism;
+
+/* True if a bulk operation on a_cObjects objects should be divided between workers, which needs libdispatch, a grain size and at least two grains
+	of objects. With a single worker, the same work is done on the calling thread
+*/
+static bool	CHBinaryTreeParallelismGet (NSUInteger a_cObjects, CHBinaryTreeParallelism * a_pParallelism)
+	{
+#if CHUsingDispatch
+	a_pParallelism -> cGrain = __atomic_load_n (&s_cParallelGrainSize, __ATOMIC_RELAXED);
+	a_pParallelism -> cWorkers = CHParallelWorkerLimit ();
+	return (a_pParallelism -> cGrain != 0) && (a_cObjects / 2 >= a_pParallelism -> cGrain);
+#else
+	(void) a_cObjects;
+	a_pParallelism -> cGrain = 0;
+	a_pParallelism -> cWorkers = 1;
+	return false;
+#endif	/* CHUsingDispatch */
+	}
+
+/* Merge two arrays in ascending order into a_apoOut, keeping all of their objects. Where the arrays hold objects that are the same, those from a_apoLeft come first
+*/
+static NSUInteger	CHBinaryTreeMergeObjects (CHSearchTreeComparator * a_pComparator, bool a_fMultiLevel, id * a_apoLeft, NSUInteger a_cLeft, id * a_apoRight, NSUInteger a_cRight, id * a_apoOut)
+	{
+	NSUInteger	uiLeft;
+	NSUInteger	uiRight;
+	NSUInteger	cOut;
+
+	uiLeft = 0;
+	uiRight = 0;
+	cOut = 0;
+	while ((uiLeft < a_cLeft) && (uiRight < a_cRight))
+		{
+		if (CHSearchTreeCompareObjects (a_pComparator, 0, a_fMultiLevel, a_apoRight [uiRight], a_apoLeft [uiLeft]) == NSOrderedAscending)
+			a_apoOut [cOut ++] = a_apoRight [uiRight ++];
+		else
+			a_apoOut [cOut ++] = a_apoLeft [uiLeft ++];
+		}
+	while (uiLeft < a_cLeft)
+		a_apoOut [cOut ++] = a_apoLeft [uiLeft ++];
+	while (uiRight < a_cRight)
+		a_apoOut [cOut ++] = a_apoRight [uiRight ++];
+	return cOut;
+	}
+
+#define kCHSortInsertionRun		16	/* Runs of this many objects are sorted by insertion before merging */
+
+/* Sort a_cObjects objects into ascending order, keeping objects that are the same in their original order. a_apoScratch must have room for as many objects.
+	Short runs are sorted by insertion, then merged in pairs, back and forth between the two arrays
+*/
+void	CHBinaryTreeSortObjects (CHSearchTreeComparator * a_pComparator, bool a_fMultiLevel, id * a_apo, NSUInteger a_cObjects, id * a_apoScratch)
+	{
+	id *		apoFrom;
+	id *		apoTo;
+	id *		apoSwap;
+	id			po;
+	NSUInteger	cWidth;
+	NSUInteger	uiLow;
+	NSUInteger	uiMiddle;
+	NSUInteger	uiHigh;
+	NSUInteger	ui;
+	NSUInteger	uj;
+
+	for (uiLow = 0; uiLow < a_cObjects; uiLow += kCHSortInsertionRun)
+		{
+		uiHigh = MIN (uiLow + kCHSortInsertionRun, a_cObjects);
+		for (ui = uiLow + 1; ui < uiHigh; ui ++)
+			{
+			po = a_apo [ui];
+			for (uj = ui; (uj > uiLow) && (CHSearchTreeCompareObjects (a_pComparator, 0, a_fMultiLevel, po, a_apo [uj - 1]) == NSOrderedAscending); uj --)
+				a_apo [uj] = a_apo [uj - 1];
+			a_apo [uj] = po;
+			}
+		}
+	apoFrom = a_apo;
+	apoTo = a_apoScratch;
+	for (cWidth = kCHSortInsertionRun; cWidth < a_cObjects; cWidth *= 2)
+		{
+		for (uiLow = 0; uiLow < a_cObjects; uiLow += 2 * cWidth)
+			{
+			uiMiddle = MIN (uiLow + cWidth, a_cObjects);
+			uiHigh = MIN (uiLow + 2 * cWidth, a_cObjects);
+			CHBinaryTreeMergeObjects (a_pComparator, a_fMultiLevel, apoFrom + uiLow, uiMiddle - uiLow, apoFrom + uiMiddle, uiHigh - uiMiddle, apoTo + uiLow);
+			}
+		apoSwap = apoFrom;
+		apoFrom = apoTo;
+		apoTo = apoSwap;
+		}
+	if (apoFrom != a_apo)
+		memcpy (a_apo, apoFrom, a_cObjects * kCHPointerSize);
+	}
+
+id *	CHSearchTreeCopySortedObjects (CHSearchTreeComparator * a_pComparator, NSArray * a_poArray, bool a_fCheckSorted, NSUInteger * a_pcObjects)
+	{
+	id *		apo;
+	id *		apoScratch;
+	NSUInteger	cObjects;
+	NSUInteger	cUnique;
+	NSUInteger	ui;
+
+	cObjects = [a_poArray count];
+	apo = malloc (kCHPointerSize * (cObjects + 1));
+	if (apo == NULL)
+		[NSException raise: NSMallocException format: @"Unable to allocate %lu objects", (unsigned long) cObjects];
+	[a_poArray getObjects: apo range: NSMakeRange (0, cObjects)];
+	ui = 1;
+	if (a_fCheckSorted)
+		{
+		while ((ui < cObjects) && (CHSearchTreeCompare (a_pComparator, apo [ui - 1], apo [ui]) == NSOrderedAscending))
+			ui ++;
+		}
+	cUnique = cObjects;
+	if (ui < cObjects)
+		{
+		apoScratch = malloc (kCHPointerSize * cObjects);
+		if (apoScratch == NULL)
+			{
+			free (apo);
+			[NSException raise: NSMallocException format: @"Unable to allocate %lu objects", (unsigned long) cObjects];
+			}
+		CHBinaryTreeSortObjects (a_pComparator, false, apo, cObjects, apoScratch);
+		free (apoScratch);
+		cUnique = 0;
+		for (ui = 0; ui < cObjects; ui ++)
+			{
+			if ((ui + 1 == cObjects) || (CHSearchTreeCompare (a_pComparator, apo [ui], apo [ui + 1]) != NSOrderedSame))
+				apo [cUnique ++] = apo [ui];
+			}
+		}
+	*a_pcObjects = cUnique;
+	return apo;
+	}
+
+void	CHSortedSetEncodeObjects (NSCoder * a_poCoder, id a_poReceiver, SEL a_selMethod, const CHSearchTreeComparator * a_pComparator, NSArray * a_poObjects)
+	{
+	int	iComparatorKind;
+
+	iComparatorKind = a_pComparator -> eKind;
+	if (iComparatorKind != CHComparatorKindSelector)
+		CHUnsupportedOperationException ([a_poReceiver class], a_selMethod);
+	if ([a_poCoder allowsKeyedCoding])
+		{
+		[a_poCoder encodeInt: iComparatorKind forKey: @"comparatorKind"];
+		[a_poCoder encodeObject: a_poObjects forKey: @"objects"];
+		}
+	else
+		[a_poCoder encodeObject: a_poObjects];
+	}
+
+NSArray *	CHSortedSetDecodeObjects (NSCoder * a_poCoder, id a_poReceiver, SEL a_selMethod)
+	{
+	int			iComparatorKind;
+	NSArray *	poObjects;
+	Class		pClass;
+
+	if ([a_poCoder allowsKeyedCoding])
+		{
+		iComparatorKind = [a_poCoder decodeIntForKey: @"comparatorKind"];
+		poObjects = [a_poCoder decodeObjectForKey: @"objects"];
+		}
+	else
+		{
+		iComparatorKind = CHComparatorKindSelector;		/* Note: Only keyed archives record the comparator kind */
+		poObjects = [a_poCoder decodeObject];
+		}
+	if (iComparatorKind != CHComparatorKindSelector)
+		{
+		pClass = [a_poReceiver class];
+		[a_poReceiver release];
+		CHInvalidArgumentException (pClass, a_selMethod, @"Collection was archived with a comparator block or function, which cannot be decoded");
+		}
+	return poObjects;
+	}
+
+NSUInteger	CHSubsetRuns (id a_poStart, id a_poEnd, bool a_fDescending, CHSubsetConstructionOptions a_fuiOptions, CHSubsetRun a_asRuns [2])
+	{
+	BOOL	fExcludeLow;
+	BOOL	fExcludeHigh;
+
+	fExcludeLow = (a_fuiOptions & CHSubsetExcludeLowEndpoint) != 0;
+	fExcludeHigh = (a_fuiOptions & CHSubsetExcludeHighEndpoint) != 0;
+	if ((a_poStart == nil) || (a_poEnd == nil) || !a_fDescending)
+		{
+		a_asRuns [0].poStart = a_poStart;
+		a_asRuns [0].fExcludeStart = fExcludeLow;
+		a_asRuns [0].poEnd = a_poEnd;
+		a_asRuns [0].fExcludeEnd = fExcludeHigh;
+		return 1;
+		}
+	a_asRuns [0].poStart = nil;
+	a_asRuns [0].fExcludeStart = NO;
+	a_asRuns [0].poEnd = a_poEnd;
+	a_asRuns [0].fExcludeEnd = fExcludeHigh;
+	a_asRuns [1].poStart = a_poStart;
+	a_asRuns [1].fExcludeStart = fExcludeLow;
+	a_asRuns [1].poEnd = nil;
+	a_asRuns [1].fExcludeEnd = NO;
+	return 2;
+	}
+
+#if CHUsingDispatch
+/* Run a_cTasks tasks on at most a_cWorkers workers from a global concurrent queue, each worker taking every a_cWorkers'th task, and wait for them all.
+	Each worker has its own autorelease pool, since the comparison methods it calls may autorelease
+*/
+static void	CHBinaryTreeParallelApply (NSUInteger a_cTasks, NSUInteger a_cWorkers, void (^a_pfnTask) (NSUInteger a_uiTask))
+	{
+	NSUInteger	ui;
+
+	if (a_cWorkers > a_cTasks)
+		a_cWorkers = a_cTasks;
+	if (a_cWorkers <= 1)
+		{
+		for (ui = 0; ui < a_cTasks; ui ++)
+			a_pfnTask (ui);
+		return;
+		}
+	dispatch_apply (a_cWorkers, dispatch_get_global_queue (DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t a_uiWorker)
+		{
+		NSAutoreleasePool *	poPool;
+		NSUInteger			uiTask;
+
+		poPool = [[NSAutoreleasePool alloc] init];
+		for (uiTask = a_uiWorker; uiTask < a_cTasks; uiTask += a_cWorkers)
+			a_pfnTask (uiTask);
+		[poPool release];
+		});
+	}
+
+/* The number of tasks to divide a_cObjects objects into: enough to keep every worker busy, but none smaller than a grain
+*/
+static inline NSUInteger	CHBinaryTreeParallelTaskCount (NSUInteger a_cObjects, const CHBinaryTreeParallelism * a_pParallelism)
+	{
+	NSUInteger	cTasks;
+
+	cTasks = a_cObjects / a_pParallelism -> cGrain;
+	if (cTasks > a_pParallelism -> cWorkers * kCHParallelTasksPerWorker)
+		cTasks = a_pParallelism -> cWorkers * kCHParallelTasksPerWorker;
+	return (cTasks != 0) ? cTasks : 1;
+	}
+
+/* A range of objects to build into a subtree [uiLow, uiHigh), at a depth, and the link to set to its root. Also a node placed above such subtrees, with the range of objects below it
+*/
+typedef struct CHBinaryTreeBuildPart {
+	NSUInteger			uiLow;
+	NSUInteger			uiHigh;
+	NSUInteger			uiDepth;
+	CHBinaryTreeNode **	ppLink;
+} CHBinaryTreeBuildPart;
+
+/* Place the nodes of the top of a balanced tree, down to subtrees of at most a_cGrain objects. Each of those subtrees is recorded in a_asSubtrees, to be built
+	by a worker, and each node placed is recorded in a_asNodes, in post-order, to be finished once its children have been built
+*/
+static void	CHBinaryTreeBuildSplit (CHBinaryTreeBuild * a_pBuild, NSUInteger a_uiLow, NSUInteger a_uiHigh, NSUInteger a_uiDepth, CHBinaryTreeNode ** a_ppLink, NSUInteger a_cGrain,
+									CHBinaryTreeBuildPart * a_asSubtrees, NSUInteger * a_pcSubtrees, CHBinaryTreeBuildPart * a_asNodes, NSUInteger * a_pcNodes)
+	{
+	CHBinaryTreeBuildPart *	pPart;
+	CHBinaryTreeNode *		pNode;
+	NSUInteger				uiMiddle;
+
+	if (a_uiHigh - a_uiLow <= a_cGrain)
+		pPart = &a_asSubtrees [(*a_pcSubtrees) ++];
+	else
+		{
+		uiMiddle = a_uiLow + (a_uiHigh - a_uiLow - 1) / 2;
+		pNode = a_pBuild -> apNode [uiMiddle];
+		[pNode -> object retain];
+		*a_ppLink = pNode;
+		CHBinaryTreeBuildSplit (a_pBuild, a_uiLow, uiMiddle, a_uiDepth + 1, &pNode -> left, a_cGrain, a_asSubtrees, a_pcSubtrees, a_asNodes, a_pcNodes);
+		CHBinaryTreeBuildSplit (a_pBuild, uiMiddle + 1, a_uiHigh, a_uiDepth + 1, &pNode -> right, a_cGrain, a_asSubtrees, a_pcSubtrees, a_asNodes, a_pcNodes);
+		pPart = &a_asNodes [(*a_pcNodes) ++];
+		}
+	pPart -> uiLow = a_uiLow;
+	pPart -> uiHigh = a_uiHigh;
+	pPart -> uiDepth = a_uiDepth;
+	pPart -> ppLink = a_ppLink;
+	}
+
+/* Link a_cObjects objects as a perfectly balanced tree, exactly as CHBinaryTreeBuildSubtree() does, with the subtrees below the top built by workers. The node
+	pool is not thread safe, so every node is taken from it first. The nodes at the top are finished last, bottom up, since a subclass may look at the children
+	of a node to set its balancing information. Returns false, having done nothing, if out of memory
+*/
+static bool	CHBinaryTreeBuildParallel (CHBinaryTreeBuild * a_pBuild, NSUInteger a_cObjects, const CHBinaryTreeParallelism * a_pParallelism, CHBinaryTreeNode ** a_ppLink)
+	{
+	CHBinaryTreeBuildPart *	asParts;
+	CHBinaryTreeBuildPart *	pPart;
+	CHBinaryTreeNode *		pNode;
+	NSUInteger				cGrain;
+	NSUInteger				cPartsMax;
+	NSUInteger				cSubtrees;
+	NSUInteger				cNodes;
+	NSUInteger				ui;
+
+	cGrain = a_cObjects / CHBinaryTreeParallelTaskCount (a_cObjects, a_pParallelism);
+	cPartsMax = 3 * (a_cObjects / cGrain) + 2;		/* The top nodes each have more than a grain of objects below them, so there are fewer than three for each grain */
+	a_pBuild -> apNode = malloc (a_cObjects * sizeof (CHBinaryTreeNode *));
+	asParts = malloc (2 * cPartsMax * sizeof (CHBinaryTreeBuildPart));
+	if ((a_pBuild -> apNode == NULL) || (asParts == NULL))
+		{
+		free (a_pBuild -> apNode);
+		free (asParts);
+		a_pBuild -> apNode = NULL;
+		return false;
+		}
+	for (ui = 0; ui < a_cObjects; ui ++)
+		a_pBuild -> apNode [ui] = CHBinaryTreeNodePoolAlloc (a_pBuild -> pPool, a_pBuild -> apo [ui]);	/* Retained when placed */
+	cSubtrees = 0;
+	cNodes = 0;
+	CHBinaryTreeBuildSplit (a_pBuild, 0, a_cObjects, 0, a_ppLink, cGrain, asParts, &cSubtrees, asParts + cPartsMax, &cNodes);
+	CHBinaryTreeParallelApply (cSubtrees, a_pParallelism -> cWorkers, ^(NSUInteger a_uiPart)
+		{
+		CHBinaryTreeBuildPart *	pSubtree;
+
+		pSubtree = &asParts [a_uiPart];
+		CHBinaryTreeBuildSubtree (a_pBuild, pSubtree -> uiLow, pSubtree -> uiHigh, pSubtree -> uiDepth, pSubtree -> ppLink);
+		});
+	for (pPart = asParts + cPartsMax; cNodes != 0; pPart ++, cNodes --)
+		{
+		pNode = *pPart -> ppLink;
+		ui = pPart -> uiLow + (pPart -> uiHigh - pPart -> uiLow - 1) / 2;
+		a_pBuild -> pfnBuilt (a_pBuild -> poTree, a_pBuild -> selBuilt, pNode, CHBinaryTreeBuildHeight (ui - pPart -> uiLow), CHBinaryTreeBuildHeight (pPart -> uiHigh - ui - 1),
+							  pPart -> uiDepth, a_pBuild -> uiTreeHeight);
+		if (a_pBuild -> fCounted)
+			CHBinaryTreeNodeCount (pNode) = pPart -> uiHigh - pPart -> uiLow;
+		}
+	free (asParts);
+	free (a_pBuild -> apNode);
+	a_pBuild -> apNode = NULL;
+	return true;
+	}
+
+/* The index of the first of a_cObjects objects in ascending order that is not ordered before a_po
+*/
+static NSUInteger	CHBinaryTreeLowerBound (CHSearchTreeComparator * a_pComparator, bool a_fMultiLevel, id * a_apo, NSUInteger a_cObjects, id a_po)
+	{
+	NSUInteger	uiLow;
+	NSUInteger	uiHigh;
+	NSUInteger	uiMiddle;
+
+	uiLow = 0;
+	uiHigh = a_cObjects;
+	while (uiLow < uiHigh)
+		{
+		uiMiddle = uiLow + (uiHigh - uiLow) / 2;
+		if (CHSearchTreeCompareObjects (a_pComparator, 0, a_fMultiLevel, a_apo [uiMiddle], a_po) == NSOrderedAscending)
+			uiLow = uiMiddle + 1;
+		else
+			uiHigh = uiMiddle;
+		}
+	return uiLow;
+	}
+
+/* Merges part of each of two arrays in ascending order into a_apoOut, and returns the number of objects written
+*/
+typedef NSUInteger (^CHBinaryTreeMergeBlock) (id * a_apoLeft, NSUInteger a_cLeft, id * a_apoRight, NSUInteger a_cRight, id * a_apoOut);
+
+/* Merge two arrays in ascending order into a_apoOut, which must have room for both, in segments merged by workers, and return the number of objects written.
+	Each segment starts at an object taken from the longer array, and both arrays are split before their first object not ordered before it, so objects that
+	are the same are always merged by the same worker. Each segment is written where it would start if nothing were left out, then the segments are closed up
+*/
+static NSUInteger	CHBinaryTreeMergeParallel (CHSearchTreeComparator * a_pComparator, bool a_fMultiLevel, id * a_apoLeft, NSUInteger a_cLeft, id * a_apoRight, NSUInteger a_cRight,
+											   id * a_apoOut, const CHBinaryTreeParallelism * a_pParallelism, CHBinaryTreeMergeBlock a_pfnMerge)
+	{
+	NSUInteger *	auiBounds;		/* For each segment, where it starts in the left array, where it starts in the right array and how many objects it wrote */
+	NSUInteger		cSegments;
+	NSUInteger		uiSegment;
+	NSUInteger		cOut;
+	id				poPivot;
+
+	cSegments = CHBinaryTreeParallelTaskCount (a_cLeft + a_cRight, a_pParallelism);
+	auiBounds = (cSegments > 1) ? malloc ((cSegments + 1) * 3 * sizeof (NSUInteger)) : NULL;
+	if (auiBounds == NULL)
+		return a_pfnMerge (a_apoLeft, a_cLeft, a_apoRight, a_cRight, a_apoOut);
+	auiBounds [0] = 0;
+	auiBounds [1] = 0;
+	for (uiSegment = 1; uiSegment < cSegments; uiSegment ++)
+		{
+		if (a_cLeft >= a_cRight)
+			poPivot = a_apoLeft [a_cLeft * uiSegment / cSegments];
+		else
+			poPivot = a_apoRight [a_cRight * uiSegment / cSegments];
+		auiBounds [uiSegment * 3] = CHBinaryTreeLowerBound (a_pComparator, a_fMultiLevel, a_apoLeft, a_cLeft, poPivot);
+		auiBounds [uiSegment * 3 + 1] = CHBinaryTreeLowerBound (a_pComparator, a_fMultiLevel, a_apoRight, a_cRight, poPivot);
+		}
+	auiBounds [cSegments * 3] = a_cLeft;
+	auiBounds [cSegments * 3 + 1] = a_cRight;
+	CHBinaryTreeParallelApply (cSegments, a_pParallelism -> cWorkers, ^(NSUInteger a_uiSegment)
+		{
+		NSUInteger *	puiBounds;
+
+		puiBounds = &auiBounds [a_uiSegment * 3];
+		puiBounds [2] = a_pfnMerge (a_apoLeft + puiBounds [0], puiBounds [3] - puiBounds [0], a_apoRight + puiBounds [1], puiBounds [4] - puiBounds [1],
+									a_apoOut + puiBounds [0] + puiBounds [1]);
+		});
+	cOut = 0;
+	for (uiSegment = 0; uiSegment < cSegments; uiSegment ++)
+		{
+		memmove (a_apoOut + cOut, a_apoOut + auiBounds [uiSegment * 3] + auiBounds [uiSegment * 3 + 1], auiBounds [uiSegment * 3 + 2] * kCHPointerSize);
+		cOut += auiBounds [uiSegment * 3 + 2];
+		}
+	free (auiBounds);
+	return cOut;
+	}
+
+/* Sort a_cObjects objects into strictly ascending order, and return how many are left. Workers sort runs of the array, which are then merged in pairs,
+	each merge also divided between workers. Of objects that are the same, only the last is kept, as if each had been added in turn. a_apoScratch must have room
+	for as many objects
+*/
+static NSUInteger	CHBinaryTreeSortParallel (CHSearchTreeComparator * a_pComparator, bool a_fMultiLevel, id * a_apo, NSUInteger a_cObjects, id * a_apoScratch,
+											  const CHBinaryTreeParallelism * a_pParallelism)
+	{
+	id *			apoFrom;
+	id *			apoTo;
+	id *			apoSwap;
+	NSUInteger		cRuns;
+	NSUInteger		cRun;
+	NSUInteger		cOut;
+	NSUInteger		cWidth;
+	NSUInteger		uiLow;
+	NSUInteger		uiMiddle;
+	NSUInteger		uiHigh;
+
+	cRuns = CHBinaryTreeParallelTaskCount (a_cObjects, a_pParallelism);
+	cRun = (a_cObjects + cRuns - 1) / cRuns;
+	CHBinaryTreeParallelApply (cRuns, a_pParallelism -> cWorkers, ^(NSUInteger a_uiRun)
+		{
+		NSUInteger	uiRunLow;
+
+		uiRunLow = a_uiRun * cRun;
+		if (uiRunLow < a_cObjects)
+			CHBinaryTreeSortObjects (a_pComparator, a_fMultiLevel, a_apo + uiRunLow, MIN (cRun, a_cObjects - uiRunLow), a_apoScratch + uiRunLow);
+		});
+	apoFrom = a_apo;
+	apoTo = a_apoScratch;
+	for (cWidth = cRun; cWidth < a_cObjects; cWidth *= 2)
+		{
+		for (uiLow = 0; uiLow < a_cObjects; uiLow += 2 * cWidth)
+			{
+			uiMiddle = MIN (uiLow + cWidth, a_cObjects);
+			uiHigh = MIN (uiLow + 2 * cWidth, a_cObjects);
+			CHBinaryTreeMergeParallel (a_pComparator, a_fMultiLevel, apoFrom + uiLow, uiMiddle - uiLow, apoFrom + uiMiddle, uiHigh - uiMiddle, apoTo + uiLow, a_pParallelism,
+									   ^NSUInteger (id * a_apoLeft, NSUInteger a_cLeft, id * a_apoRight, NSUInteger a_cRight, id * a_apoOut)
+				{
+				return CHBinaryTreeMergeObjects (a_pComparator, a_fMultiLevel, a_apoLeft, a_cLeft, a_apoRight, a_cRight, a_apoOut);
+				});
+			}
+		apoSwap = apoFrom;
+		apoFrom = apoTo;
+		apoTo = apoSwap;
+		}
+	/* Drop all but the last of each run of objects that are the same. The runs are never split between workers */
+	cOut = CHBinaryTreeMergeParallel (a_pComparator, a_fMultiLevel, apoFrom, a_cObjects, NULL, 0, apoTo, a_pParallelism,
+									  ^NSUInteger (id * a_apoLeft, NSUInteger a_cLeft, id * a_apoRight, NSUInteger a_cRight, id * a_apoOut)
+		{
+		NSUInteger	ui;
+		NSUInteger	cOut;
+
+		(void) a_apoRight;
+		(void) a_cRight;
+		cOut = 0;
+		for (ui = 0; ui < a_cLeft; ui ++)
+			if ((ui + 1 == a_cLeft) || (CHSearchTreeCompareObjects (a_pComparator, 0, a_fMultiLevel, a_apoLeft [ui], a_apoLeft [ui + 1]) != NSOrderedSame))
+				a_apoOut [cOut ++] = a_apoLeft [ui];
+		return cOut;
+		});
+	if (apoTo != a_apo)
+		memcpy (a_apo, apoTo, cOut * kCHPointerSize);
+	return cOut;
+	}
+#endif	/* CHUsingDispatch */
+
+#pragma mark Block enumeration
+
+#if defined (__BLOCKS__)
+typedef void (^CHBinaryTreeEnumerationBlock) (id a_po, NSUInteger a_uiIndex, BOOL * a_pfStop);
+
+/* Pass the objects of the subtree under a_pRoot to a_pfnBlock in ascending order, or in descending order if a_fReverse, numbering them from *a_puiIndex up, or down
+	if a_fReverse. Stops as soon as the block sets *a_pfStop or changes *a_pulMutations from a_ulMutations, if a_pulMutations is not NULL, and before any object once
+	*a_pfStopAll is set, if a_pfStopAll is not NULL; a_pfStopAll is set whenever the block stops, so that it can be shared by workers. Returns false if it stopped early
+*/
+static bool	CHBinaryTreeEnumerateSubtree (CHBinaryTreeNode * a_pRoot, CHBinaryTreeNode * a_pSentinel, bool a_fReverse, NSUInteger * a_puiIndex, CHBinaryTreeEnumerationBlock a_pfnBlock,
+										  const unsigned long * a_pulMutations, unsigned long a_ulMutations, BOOL * a_pfStop, BOOL * a_pfStopAll)
+	{
+	CHBinaryTreeNode *	pNode;
+	int					iFirst;
+	bool				fContinue;
+	CHBinaryTreeStack_DECLARE ();
+
+	CHBinaryTreeStack_INIT ();
+	iFirst = a_fReverse ? 1 : 0;
+	fContinue = true;
+	pNode = a_pRoot;
+	while (fContinue && ((pNode != a_pSentinel) || (stackSize > 0)))
+		{
+		if (pNode != a_pSentinel)
+			{
+			CHBinaryTreeStack_PUSH (pNode);
+			pNode = pNode -> link [iFirst];
+			}
+		else if ((a_pfStopAll != NULL) && __atomic_load_n (a_pfStopAll, __ATOMIC_RELAXED))
+			fContinue = false;
+		else
+			{
+			pNode = CHBinaryTreeStack_POP ();
+			a_pfnBlock (pNode -> object, *a_puiIndex, a_pfStop);
+			if (a_fReverse)
+				(*a_puiIndex) --;
+			else
+				(*a_puiIndex) ++;
+			if (*a_pfStop)
+				{
+				if (a_pfStopAll != NULL)
+					__atomic_store_n (a_pfStopAll, YES, __ATOMIC_RELAXED);
+				fContinue = false;
+				}
+			else if ((a_pulMutations != NULL) && (*a_pulMutations != a_ulMutations))
+				fContinue = false;						/* The nodes may have gone */
+			else
+				pNode = pNode -> link [1 - iFirst];
+			}
+		}
+	CHBinaryTreeStack_FREE (stack);
+	return fContinue;
+	}
+
+#if CHUsingDispatch
+/* A subtree enumerated by one worker, and the node above it that follows it in ascending order
+*/
+typedef struct CHBinaryTreeEnumerationTask {
+	CHBinaryTreeNode *	pRoot;			/* The subtree, or the sentinel if the task is only the node above */
+	CHBinaryTreeNode *	pAfter;			/* The node above, or NULL */
+	NSUInteger			uiIndex;		/* The index of the first object of the task, once the tasks before it have been counted */
+} CHBinaryTreeEnumerationTask;
+
+/* Divide the tree under a_pNode into the subtrees a_uiDepth levels down, recorded in ascending order in a_asTasks, which needs room for 2^(a_uiDepth + 1) tasks. Each
+	node above them is added to the task before it
+*/
+static void	CHBinaryTreeEnumerationSplit (CHBinaryTreeNode * a_pNode, CHBinaryTreeNode * a_pSentinel, NSUInteger a_uiDepth, CHBinaryTreeEnumerationTask * a_asTasks, NSUInteger * a_pcTasks)
+	{
+	CHBinaryTreeEnumerationTask *	pTask;
+
+	if (a_pNode == a_pSentinel)
+		return;
+	if (a_uiDepth == 0)
+		{
+		pTask = &a_asTasks [(*a_pcTasks) ++];
+		pTask -> pRoot = a_pNode;
+		pTask -> pAfter = NULL;
+		return;
+		}
+	CHBinaryTreeEnumerationSplit (a_pNode -> left, a_pSentinel, a_uiDepth - 1, a_asTasks, a_pcTasks);
+	if ((*a_pcTasks > 0) && (a_asTasks [*a_pcTasks - 1].pAfter == NULL))
+		a_asTasks [*a_pcTasks - 1].pAfter = a_pNode;
+	else
+		{
+		pTask = &a_asTasks [(*a_pcTasks) ++];
+		pTask -> pRoot = a_pSentinel;
+		pTask -> pAfter = a_pNode;
+		}
+	CHBinaryTreeEnumerationSplit (a_pNode -> right, a_pSentinel, a_uiDepth - 1, a_asTasks, a_pcTasks);
+	}
+
+/* The number of nodes in the subtree under a_pRoot, for trees without subtree counts
+*/
+static NSUInteger	CHBinaryTreeCountSubtree (CHBinaryTreeNode * a_pRoot, CHBinaryTreeNode * a_pSentinel)
+	{
+	CHBinaryTreeNode *	pNode;
+	NSUInteger			cNodes;
+	CHBinaryTreeStack_DECLARE ();
+
+	if (a_pRoot == a_pSentinel)
+		return 0;
+	CHBinaryTreeStack_INIT ();
+	CHBinaryTreeStack_PUSH (a_pRoot);
+	cNodes = 0;
+	while ((pNode = CHBinaryTreeStack_POP ()) != NULL)
+		{
+		cNodes ++;
+		if (pNode -> left != a_pSentinel)
+			CHBinaryTreeStack_PUSH (pNode -> left);
+		if (pNode -> right != a_pSentinel)
+			CHBinaryTreeStack_PUSH (pNode -> right);
+		}
+	CHBinaryTreeStack_FREE (stack);
+	return cNodes;
+	}
+
+/* Pass the a_cObjects objects of the tree under a_pRoot to a_pfnBlock on workers from a global concurrent queue, a task for each of the subtrees some levels down,
+	enough to give every worker several. The index of the first object of each task is the sum of the sizes of the tasks before it, which come from the subtree
+	counts if a_fCounted, and otherwise from a first pass in which the workers count their subtrees. Returns false, having done nothing, if there is only one
+	worker or object, or if out of memory
+*/
+static bool	CHBinaryTreeEnumerateParallel (CHBinaryTreeNode * a_pRoot, CHBinaryTreeNode * a_pSentinel, NSUInteger a_cObjects, bool a_fCounted, CHBinaryTreeEnumerationBlock a_pfnBlock)
+	{
+	CHBinaryTreeParallelism			sParallelism;
+	CHBinaryTreeEnumerationTask *	asTasks;
+	BOOL							fStopAll;
+	BOOL *							pfStopAll;
+	NSUInteger						cTasks;
+	NSUInteger						cObjects;
+	NSUInteger						uiDepth;
+	NSUInteger						uiIndex;
+	NSUInteger						ui;
+
+	CHBinaryTreeParallelismGet (a_cObjects, &sParallelism);
+	if ((sParallelism.cWorkers <= 1) || (a_cObjects < 2))
+		return false;
+	for (uiDepth = 0; ((NSUInteger) 1 << uiDepth) < MIN (a_cObjects, sParallelism.cWorkers * kCHParallelTasksPerWorker); uiDepth ++)
+		;
+	asTasks = malloc (((NSUInteger) 2 << uiDepth) * sizeof (CHBinaryTreeEnumerationTask));
+	if (asTasks == NULL)
+		return false;
+	cTasks = 0;
+	CHBinaryTreeEnumerationSplit (a_pRoot, a_pSentinel, uiDepth, asTasks, &cTasks);
+	if (!a_fCounted)
+		CHBinaryTreeParallelApply (cTasks, sParallelism.cWorkers, ^(NSUInteger a_uiTask)
+			{
+			asTasks [a_uiTask].uiIndex = CHBinaryTreeCountSubtree (asTasks [a_uiTask].pRoot, a_pSentinel);
+			});
+	uiIndex = 0;
+	for (ui = 0; ui < cTasks; ui ++)
+		{
+		cObjects = a_fCounted ? CHBinaryTreeNodeCount (asTasks [ui].pRoot) : asTasks [ui].uiIndex;		/* The sentinel counts as an empty subtree */
+		asTasks [ui].uiIndex = uiIndex;
+		uiIndex += cObjects + ((asTasks [ui].pAfter != NULL) ? 1 : 0);
+		}
+	fStopAll = NO;
+	pfStopAll = &fStopAll;
+	CHBinaryTreeParallelApply (cTasks, sParallelism.cWorkers, ^(NSUInteger a_uiTask)
+		{
+		CHBinaryTreeEnumerationTask *	pTask;
+		NSUInteger						uiNext;
+		BOOL							fStop;
+
+		pTask = &asTasks [a_uiTask];
+		uiNext = pTask -> uiIndex;
+		fStop = NO;
+		if (CHBinaryTreeEnumerateSubtree (pTask -> pRoot, a_pSentinel, false, &uiNext, a_pfnBlock, NULL, 0, &fStop, pfStopAll) &&
+			(pTask -> pAfter != NULL) && !__atomic_load_n (pfStopAll, __ATOMIC_RELAXED))
+			{
+			a_pfnBlock (pTask -> pAfter -> object, uiNext, &fStop);
+			if (fStop)
+				__atomic_store_n (pfStopAll, YES, __ATOMIC_RELAXED);
+			}
+		});
+	free (asTasks);
+	return true;
+	}
+#endif	/* CHUsingDispatch */
+#endif	/* defined (__BLOCKS__) */
+
+@implementation CHAbstractBinarySearchTree
+
+/* CJEC, 19-Jul-13:  Default class used with CHTreeOptionsMultiLeaves collections
+*/
++ (Class)			GetClassCollection
+	{
+	return [NSMutableSet class];
+	}
+
+/* CJEC, 12-Feb-15: Read-only accessor to the options flags
+*/
+- (unsigned int)	GetOptions
+	{
+	CHUnsupportedOperationException ([self class], _cmd);
+	return 0;
+	}
+
+/* CJEC, 22-Jul-13: Depending on the nesting level, return the appropriate comparison selector
+*/
++ (SEL)		SelCompare: (unsigned int) a_uiNestingLevel
+	{
+	return CHCompareSelectorForNestingLevel (a_uiNestingLevel);
+	}
+
+/* CJEC, 8-Jul-13: Create an NSInvocation for comparing objects based on the nesting level.
+					Nesting level 0 uses compare:
+					Nesting level 1 uses compare1:
+					Nesting level 2 uses compare2: and so on
+*/
++ (NSInvocation *)	InvocationCompare: (id) a_po nestingLevel: (unsigned int) a_uiNestingLevel
+	{
+	SEL					pSelCompare;
+	NSInvocation *		poInvocationCompare;
+	NSMethodSignature *	poMethodSignatureCompare;
+
+	pSelCompare = [self SelCompare: a_uiNestingLevel];
+	poMethodSignatureCompare = [[a_po class] instanceMethodSignatureForSelector: pSelCompare];
+	poInvocationCompare = [NSInvocation invocationWithMethodSignature: poMethodSignatureCompare];
+	[poInvocationCompare setSelector: pSelCompare];
+	return poInvocationCompare;
+	}
+
+/* CJEC, 10-Jul-13: Provide a comparison method using the comparison invocation
+*/
+- (NSComparisonResult)	Compare: (NSInvocation *) a_poInvocationCompare target: (id) a_poTarget argument: (id) a_poArgument
+	{
+	NSComparisonResult	eComparisonResult;
+	id					poTarget;
+	SEL					pSelAnyObject;
+
+	if (a_poArgument != nil)
+		[a_poInvocationCompare setArgument: &a_poArgument atIndex: 2];	/* Note: Skip past hidden target (index 0) and selector (index 1) arguments for our first argument. Arguments are not retained without [poInvocationCompare retainArguments] */
+	poTarget = a_poTarget;
+	if ([self GetOptions] & CHTreeOptionsMultiLevel)	/* Multi-level collections allowed? */
+		{
+		pSelAnyObject = @selector (anyObject);	/* Identify a leaf object as fast as possible */
+		while ([poTarget respondsToSelector: pSelAnyObject])
+			{
+			poTarget = [poTarget anyObject];	/* All objects in the subcollections should compare the same way at a particular nesting level so use any of them */
+			NSAssert (poTarget != nil, @"Empty Collection is illegal");
+			}
+		NSAssert (![poTarget respondsToSelector: @selector (count)], @"Collection object does not respond to anyObject but does respond to count");
+		}
+	[a_poInvocationCompare invokeWithTarget: poTarget];	/* Note: Equivalent to eComparisonResult = (NSComparisonResult) [po performSelector: pSelCompare withObject: <Argument>]; but we don't have an object-sized return value so can't actually do this */
+	[a_poInvocationCompare getReturnValue: &eComparisonResult];
+	return eComparisonResult;
+	}
+
+/* Compare two objects using the cached comparison IMP for the target's class and the nesting level
+*/
+- (NSComparisonResult)	compareObject: (id) a_poTarget toObject: (id) a_poArgument nestingLevel: (unsigned int) a_uiNestingLevel
+	{
+	return CHSearchTreeCompareObjects (&m_sComparator, a_uiNestingLevel, (m_fuiOptions & CHTreeOptionsMultiLevel) != 0, a_poTarget, a_poArgument);
+	}
+
+- (CHComparatorKind)	comparatorKind
+	{
+	return m_sComparator.eKind;
+	}
+
+/* CJEC, 19-Jul-13: Depending on the object in question and the options flags, support multiple objects
+	all ordered NSOrderedSame at the same leaf. This is either a collection of the same type as this one
+	or a mutable (and hence unordered) set
+
+	Note: Conforms to Foundation's naming conventions. The caller MUST release
+*/
+- (id)	newLeafCollection: (id) a_po nestingLevel: (unsigned int) a_uiNestingLevel returnsIsMultiLevel: (bool *) a_pfMultiLevel
+	{
+	unsigned int	fuiOptions;
+	SEL				pSelCompare;
+	id				poNew;
+
+	fuiOptions = [self GetOptions];
+	poNew = nil;													/* Default is no sub-collection */
+	*a_pfMultiLevel = false;										/* Default is not multi-level collection */
+	if (fuiOptions & CHTreeOptionsMultiLevel)						/* If multi-level trees are supported */
+		{
+		pSelCompare = [[self class] SelCompare: a_uiNestingLevel];
+		if ([a_po respondsToSelector: pSelCompare])					/* If the object responds to the appropriate comparison method */
+			{
+			poNew = [[[self class] alloc] initWithTreeOptions: fuiOptions];
+			*a_pfMultiLevel = true;
+			}
+		}
+	if ((poNew == nil) && (fuiOptions & CHTreeOptionsMultiLeaves))	/* Haven't already got a collection, and multiple leaves are supported? */
+		poNew = [[[[self class] GetClassCollection] alloc] init];
+	return poNew;
+	}
+
+// This is the designated initializer for CHAbstractBinarySearchTree, CHBinarySearchTree and all its derived classes
+// CJEC, 1-Jul-13: New designated intialiser specifies options from CHTreeOptions
+- (id) initWithTreeOptions: (unsigned int) a_fuiOptions {
+	if ((self = [super init]) == nil)
+		{
+		[self release];						/* CJEC, 12-Feb-15: Avoid memory leak when initialisation fails */
+		self = nil;
+		return self;
+		}
+	(void) a_fuiOptions;					/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning. CJEC, 12-Feb-15: TODO: Complete the conversion to a class cluster */
+	m_sComparator.poHeaderObject = [CHSearchTreeHeaderObject object];	/* Objects are ordered by -compare: until a comparator function or block is set */
+	return self;
+}
+
+- (id)	initWithCapacity: (NSUInteger) a_cCapacity
+	{
+	return [self initWithTreeOptions: 0 capacity: a_cCapacity];
+	}
+
+- (id)	initWithTreeOptions: (unsigned int) a_fuiOptions capacity: (NSUInteger) a_cCapacity
+	{
+	self = [self initWithTreeOptions: a_fuiOptions];
+	if (self != nil)
+		m_sNodePool.cNodesCapacity = a_cCapacity;
+	return self;
+	}
+
+#if defined (__BLOCKS__)
+- (id)	initWithComparator: (NSComparator) a_pfnComparator
+	{
+	return [self initWithTreeOptions: 0 capacity: 0 comparator: a_pfnComparator];
+	}
+
+- (id)	initWithTreeOptions: (unsigned int) a_fuiOptions capacity: (NSUInteger) a_cCapacity comparator: (NSComparator) a_pfnComparator
+	{
+	Class	pClass;
+
+	if (a_pfnComparator == nil)
+		{
+		pClass = [self class];
+		[self release];						/* Avoid a memory leak when initialisation fails */
+		CHNilArgumentException (pClass, _cmd);
+		}
+	self = [self initWithTreeOptions: a_fuiOptions capacity: a_cCapacity];
+	if (self != nil)
+		{
+		m_sComparator.pvContext = [a_pfnComparator copy];	/* Note: Copy a stack-based block to the heap */
+		m_sComparator.pfnCompare = CHCompareUsingComparator;
+		m_sComparator.eKind = CHComparatorKindBlock;
+		}
+	return self;
+	}
+#endif	/* defined (__BLOCKS__) */
+
+- (id)	initWithCompareFunction: (CHCompareFunction) a_pfnCompare context: (void *) a_pvContext
+	{
+	return [self initWithTreeOptions: 0 capacity: 0 compareFunction: a_pfnCompare context: a_pvContext];
+	}
+
+- (id)	initWithTreeOptions: (unsigned int) a_fuiOptions capacity: (NSUInteger) a_cCapacity compareFunction: (CHCompareFunction) a_pfnCompare context: (void *) a_pvContext
+	{
+	Class	pClass;
+
+	if (a_pfnCompare == NULL)
+		{
+		pClass = [self class];
+		[self release];						/* Avoid a memory leak when initialisation fails */
+		CHNilArgumentException (pClass, _cmd);
+		}
+	self = [self initWithTreeOptions: a_fuiOptions capacity: a_cCapacity];
+	if (self != nil)
+		{
+		m_sComparator.pvContext = a_pvContext;
+		m_sComparator.pfnCompare = a_pfnCompare;
+		m_sComparator.eKind = CHComparatorKindFunction;
+		}
+	return self;
+	}
+
+- (void) dealloc {
+	if (m_sComparator.eKind == CHComparatorKindBlock)
+		[(id) m_sComparator.pvContext release];
+	CHCompareCacheFree (m_sComparator.apCache);
+	[super dealloc];
+}
+
+// CJEC, 1-Jul-13: Default initialiser behaves like the original code
+- (id)	init {
+	return [self initWithTreeOptions: 0];
+}
+// Calling [self init] allows child classes to initialize their specific state.
+// (The -init method in any subclass must always call to -[super init] first.)
+- (id) initWithArray:(NSArray*)anArray {
+	if ([self init] == nil) return nil;
+	CHBinaryTreeNodePoolReserve(&m_sNodePool, [anArray count]);
+	[self addObjectsFromArray:anArray];
+	return self;
+}
+
+#pragma mark <NSCoding>
+
+// CJEC, 2-Jul-13: TODO: Support multi-level trees
+- (id) initWithCoder:(NSCoder*) a_poCoder
+	{
+	bool			fAllowsKeyCoding;
+	int				fiOptions;
+	int				iComparatorKind;
+	Class			pClass;
+	NSUInteger		cObjects;
+	NSUInteger		uiCount;
+	id				po;
+
+	fAllowsKeyCoding = [a_poCoder allowsKeyedCoding];
+	if (fAllowsKeyCoding)
+		{
+		fiOptions = [a_poCoder decodeIntForKey: @"options"];
+		cObjects = [a_poCoder decodeIntegerForKey: @"count"];
+		iComparatorKind = [a_poCoder decodeIntForKey: @"comparatorKind"];	/* Note: Archives made before comparators were supported decode as 0, CHComparatorKindSelector */
+		}
+    else
+		{
+		[a_poCoder decodeValueOfObjCType: @encode (int) at: &fiOptions];
+		[a_poCoder decodeValueOfObjCType: @encode (NSInteger) at: &cObjects];
+		iComparatorKind = CHComparatorKindSelector;		/* Note: Only keyed archives record the comparator kind, so that the non-keyed format is unchanged */
+		}
+	if (iComparatorKind != CHComparatorKindSelector)	/* A comparator block or function cannot be archived, so the objects' ordering cannot be restored */
+		{
+		pClass = [self class];
+		[self release];						/* Avoid a memory leak when initialisation fails */
+		CHInvalidArgumentException (pClass, _cmd, @"Tree was archived with a comparator block or function, which cannot be decoded");
+		}
+	self = [self initWithTreeOptions: fiOptions];
+	for (uiCount = 0; uiCount < cObjects; uiCount ++)
+		{
+		if (fAllowsKeyCoding)
+			po = [a_poCoder decodeObjectForKey: [[NSNumber numberWithUnsignedInteger: uiCount] stringValue]];
+		else
+			po = [a_poCoder decodeObject];
+		[self addObject: po];
+		}
+	return self;
+	}
+
+- (void) encodeWithCoder:(NSCoder*) a_poCoder
+	{
+	(void) a_poCoder;					/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
+	CHUnsupportedOperationException ([self class], _cmd);
+	}
+
+#pragma mark <NSCopying> methods
+
+- (id) copyWithZone:(NSZone*)zone {
+	CHAbstractBinarySearchTree *newTree = [[[self class] allocWithZone:zone] initWithTreeOptions: [self GetOptions]];
+	CHSearchTreeComparatorCopy(&newTree->m_sComparator, &m_sComparator);
+	if (m_fuiOptions & CHTreeOptionsPersistent) {
+		// The copy takes the receiver's arena and sentinel, and a reference to its root, so every node is shared until one of them changes it.
+		newTree->sentinel = CHBinaryTreeNodePoolShare(&newTree->m_sNodePool, &m_sNodePool);
+		newTree->header->left = newTree->sentinel;
+		CHBinaryTreeSharedNodeRetain(header->right, sentinel);
+		newTree->header->right = header->right;
+		newTree->count = count;
+		return newTree;
+	}
+	// The copy has the same shape and balancing information as the receiver, so it is built node for node rather than by adding and rebalancing each object.
+	CHBinaryTreeNodePoolReserve(&newTree->m_sNodePool, count);
+	newTree->header->right = CHBinaryTreeCloneSubtree(&newTree->m_sNodePool, header->right, sentinel, newTree->sentinel,
+	                                                  (m_fuiOptions & (CHTreeOptionsMultiLevel | CHTreeOptionsMultiLeaves)) != 0, zone);
+	newTree->count = count;
+	return newTree;
+}
+
+#pragma mark <NSFastEnumeration>
+- (NSUInteger) countByEnumeratingWithState:(NSFastEnumerationState*)state
+                                   objects:(id*)stackbuf
+                                     count:(NSUInteger)len
+{
+	(void) state;					/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
+	(void) stackbuf;				/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
+	(void) len;						/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
+	CHUnsupportedOperationException ([self class], _cmd);
+	return 0;
+}
+
+#pragma mark Concrete Implementations
+
+- (void) addObjectsFromArray:(NSArray*)anArray {
+	for (id anObject in anArray) {
+		[self addObject:anObject];
+	}
+}
+
+- (NSArray*) allObjects {
+	return [self allObjectsWithTraversalOrder:CHTraverseAscending];
+}
+
+/* 18-Jul-13: CJEC: Support multi-level trees */
+- (NSArray*) allObjectsWithTraversalOrder:(CHTraversalOrder)order {
+	return [[self objectEnumeratorWithTraversalOrder:order options: [self GetOptions]] allObjects];
+}
+
+- (id) anyObject
+	{
+	CHUnsupportedOperationException ([self class], _cmd);
+	return nil;
+	}
+
+- (NSUInteger) count {
+	CHUnsupportedOperationException ([self class], _cmd);
+	return 0;
+}
+
+- (BOOL) containsObject:(id)anObject {
+	return ([self member:anObject] != nil);
+}
+
+#if defined (__BLOCKS__)
+- (void)	enumerateObjectsUsingBlock: (void (^) (id obj, NSUInteger idx, BOOL * stop)) a_pfnBlock
+	{
+	[self enumerateObjectsWithOptions: 0 usingBlock: a_pfnBlock];
+	}
+
+/* Only the subclasses know how their objects are stored, so an array of them is taken first, which also expands the sub-collections of multi-level trees
+*/
+- (void)	enumerateObjectsWithOptions: (NSEnumerationOptions) a_fuiOptions usingBlock: (void (^) (id obj, NSUInteger idx, BOOL * stop)) a_pfnBlock
+	{
+	if (a_pfnBlock == nil)
+		CHNilArgumentException ([self class], _cmd);
+	[[self allObjects] enumerateObjectsWithOptions: a_fuiOptions usingBlock: a_pfnBlock];
+	}
+#endif	/* defined (__BLOCKS__) */
+
+- (id) firstObject {
+	CHUnsupportedOperationException ([self class], _cmd);
+	return nil;
+}
+
+- (NSUInteger) hash {
+	return hashOfCountAndObjects([self count], [self firstObject], [self lastObject]);
+}
+
+- (BOOL) isEqual:(id)otherObject {
+	if ([otherObject conformsToProtocol:@protocol(CHSortedSet)])
+		return [self isEqualToSortedSet:otherObject];
+	else
+		return NO;
+}
+
+- (BOOL) isEqualToSearchTree:(id<CHSearchTree>)otherTree {
+	return collectionsAreEqual(self, otherTree);
+}
+
+- (BOOL) isEqualToSortedSet:(id<CHSortedSet>)otherSortedSet {
+	return collectionsAreEqual(self, otherSortedSet);
+}
+
+- (id) lastObject {
+	CHUnsupportedOperationException ([self class], _cmd);
+	return nil;
+}
+
+- (id)	member: (id) a_po nestingLevel: (unsigned int) a_uiNestingLevel options: (unsigned int) a_fuiOptions
+	{
+	(void) a_po;					/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
+	(void) a_uiNestingLevel;		/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
+	(void) a_fuiOptions;			/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
+	CHUnsupportedOperationException ([self class], _cmd);
+	return nil;
+	}
+		
+/* CJEC, 2-Jul-13: Support multi-level collections */
+- (id) member:(id)anObject {
+	return [self member: anObject nestingLevel: 0 options: [self GetOptions]];
+}
+
+/* CJEC, 18-Jul-13: Support multi-level collections */
+- (NSEnumerator*) objectEnumerator {
+	return [self objectEnumeratorWithTraversalOrder:CHTraverseAscending options: [self GetOptions]];
+}
+
+- (NSEnumerator*) objectEnumeratorWithTraversalOrder:(CHTraversalOrder)order options: (unsigned int) a_fuiOptions {
+	(void) order;					/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
+	(void) a_fuiOptions;			/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
+	CHUnsupportedOperationException ([self class], _cmd);
+	return nil;
+}
+
+- (void) removeAllObjects {
+	CHUnsupportedOperationException ([self class], _cmd);
+}
+
+// Incurs an extra search cost, but we don't know how the child class removes...
+- (void) removeFirstObject {
+	[self removeObject:[self firstObject]];
+}
+
+// Incurs an extra search cost, but we don't know how the child class removes...
+- (void) removeLastObject {
+	[self removeObject:[self lastObject]];
+}
+
+/* CJEC, 18-Jul-13: Support multi-level collections */
+- (NSEnumerator*) reverseObjectEnumerator {
+	return [self objectEnumeratorWithTraversalOrder:CHTraverseDescending options: [self GetOptions]];
+}
+
+/* CJEC, 18-Jul-13: Support multi-level collections */
+- (NSSet*) set {
+	NSMutableSet *set = [NSMutableSet new];
+	NSEnumerator *e = [self objectEnumeratorWithTraversalOrder:CHTraversePreOrder options: [self GetOptions]];
+	id anObject;
+	while ((anObject = [e nextObject])) {
+		[set addObject:anObject];
+	}
+	return [set autorelease];
+}
+
+- (id <CHSortedSet>)	subsetFromObject: (id) a_poStart toObject: (id) a_poEnd options: (CHSubsetConstructionOptions) a_fuiSubsetConstructionOptions nestingLevel: (unsigned int) a_uiNestingLevel
+	{
+	(void) a_poStart;				/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
+	(void) a_poEnd;					/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
+	(void) a_fuiSubsetConstructionOptions;	/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
+	(void) a_uiNestingLevel;		/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
+	CHUnsupportedOperationException ([self class], _cmd);
+	return nil;
+	}
+
+// CJEC, 2-Jul-13: Support multi-level trees */
+/*
+ \copydoc CHSortedSet::subsetFromObject:toObject:
+ 
+ \see     CHSortedSet#subsetFromObject:toObject:
+ 
+ \link    CHSortedSet#subsetFromObject:toObject: \endlink
+ 
+ \attention For a range in ascending order, CHBinarySearchTree returns a live, read-only view of the receiver, which seeks to the start of the range in O(log n) and enumerates lazily, and which is invalidated by any change to the receiver. Sending @c -copy to the view builds a balanced tree of the objects in the range. Other subsets, and any subset of a multi-level tree, are new trees built by adding objects one at a time.
+ */
+- (id<CHSortedSet>) subsetFromObject:(id)start
+                            toObject:(id)end
+                             options:(CHSubsetConstructionOptions)options
+{
+	return [self subsetFromObject: start toObject: end options: options nestingLevel: 0];
+}
+
+- (NSString*) debugDescriptionForNode:(CHBinaryTreeNode*)node {
+	return [NSString stringWithFormat:@"\"%@\"", node->object];
+}
+
+- (NSString*) dotGraphStringForNode:(CHBinaryTreeNode*)node {
+	return [NSString stringWithFormat:@"  \"%@\";\n", node->object];
+}
+
+- (void) setBalanceForBuiltNode:(CHBinaryTreeNode*)node
+                     leftHeight:(NSUInteger)leftHeight
+                    rightHeight:(NSUInteger)rightHeight
+                          depth:(NSUInteger)depth
+                     treeHeight:(NSUInteger)treeHeight
+{
+	(void) node;
+	(void) leftHeight;
+	(void) rightHeight;
+	(void) depth;
+	(void) treeHeight;
+}
+
+- (NSInteger) rankOfSubtree:(CHBinaryTreeNode*)node {
+	(void) node;
+	CHUnsupportedOperationException([self class], _cmd);
+	return 0;
+}
+
+- (NSInteger) rankOfNode:(CHBinaryTreeNode*)node
+                   child:(int)dir
+                    rank:(NSInteger)childRank
+             siblingRank:(NSInteger*)siblingRank
+{
+	(void) node;
+	(void) dir;
+	(void) childRank;
+	(void) siblingRank;
+	CHUnsupportedOperationException([self class], _cmd);
+	return 0;
+}
+
+- (CHBinaryTreeNode*) joinSubtree:(CHBinaryTreeNode*)left
+                             rank:(NSInteger)leftRank
+                         withNode:(CHBinaryTreeNode*)node
+                          subtree:(CHBinaryTreeNode*)right
+                             rank:(NSInteger)rightRank
+                       resultRank:(NSInteger*)rank
+{
+	(void) left;
+	(void) leftRank;
+	(void) node;
+	(void) right;
+	(void) rightRank;
+	(void) rank;
+	CHUnsupportedOperationException([self class], _cmd);
+	return NULL;
+}
+
++ (BOOL) supportsPersistence {
+	return NO;
+}
+
+- (NSUInteger) rebalancePath:(CHBinaryTreeNode**)path size:(NSUInteger)pathSize {
+	(void) path;
+	(void) pathSize;
+	CHUnsupportedOperationException([self class], _cmd);
+	return 0;
+}
+
++ (BOOL) supportsHintedInsertion {
+	return NO;
+}
+
+/* CJEC, 8-Jul-13: Support multi-level trees */
+- (void) addObject:(id) a_po nestingLevel: (unsigned int) a_uiNestingLevel
+	{
+	(void) a_po;						/* CJEC, 8-Jul-13: Avoid unused parameter compiler warning */
+	(void) a_uiNestingLevel;			/* CJEC, 8-Jul-13: Avoid unused parameter compiler warning */
+	CHUnsupportedOperationException ([self class], _cmd);
+	}
+
+/* CJEC, 8-Jul-13: Support multi-level trees */
+- (void) addObject:(id)anObject {
+	return [self addObject: anObject nestingLevel: 0];
+}
+
+/* CJEC, 8-Jul-13: Support multi-level trees */
+- (void) removeObject: (id) a_po nestingLevel: (unsigned int) a_uiNestingLevel
+	{
+	(void) a_po;						/* CJEC, 8-Jul-13: Avoid unused parameter compiler warning */
+	(void) a_uiNestingLevel;			/* CJEC, 8-Jul-13: Avoid unused parameter compiler warning */
+	CHUnsupportedOperationException ([self class], _cmd);
+	}
+
+/* CJEC, 8-Jul-13: Support multi-level trees */
+- (void) removeObject:(id)element {
+	[self removeObject: element nestingLevel: 0];
+}
+
+@end
+
+struct CHMultiLevelFrame;
+static void	CHMultiLevelFramesFree (struct CHMultiLevelFrame * a_pFrames);
+
+/* Owns the frames of a multi-level fast enumeration. It is autoreleased and recorded in the enumeration state, so its frames are freed when the
+	caller's autorelease pool is drained, whether or not the loop ran to the end
+*/
+@interface CHMultiLevelFrameOwner : NSObject
+{
+	@public
+	struct CHMultiLevelFrame *	pFrames;		/* The frame for the first nesting level, and those inside it kept for reuse */
+	struct CHMultiLevelFrame *	pFrame;			/* The frame of the innermost sub-collection being enumerated, or NULL at the top level */
+}
+@end
+
+@implementation CHMultiLevelFrameOwner
+
+- (void) dealloc
+	{
+	CHMultiLevelFramesFree (pFrames);
+	[super dealloc];
+	}
+
+@end
+
+@implementation CHBinarySearchTree
+
+- (void) dealloc {
+	[self removeAllObjects];
+	CHBinaryTreeNodePoolRelease(&m_sNodePool); // Frees the slabs and the sentinel, unless another tree still shares them
+	free(header);
+	[super dealloc];
+}
+
+// This is the designated initializer for CHBinarySearchTree, CHBinarySearchTree and all its derived classes
+// Only to be called from concrete child classes to initialize shared variables.
+// CJEC, 1-Jul-13: New designated intialiser specifies options from CHTreeOptions
+- (id) initWithTreeOptions: (unsigned int) a_fuiOptions {
+	bool	fOK;
+	Class	pClass;
+	
+	// Sub-collections are changed in place, so they cannot be shared by the copies of a persistent tree.
+	if ((a_fuiOptions & CHTreeOptionsPersistent) &&
+	    (![[self class] supportsPersistence] || (a_fuiOptions & (CHTreeOptionsMultiLevel | CHTreeOptionsMultiLeaves))))
+		{
+		pClass = [self class];
+		[self release];
+		CHInvalidArgumentException (pClass, _cmd, @"CHTreeOptionsPersistent is only supported by CHAVLTree and CHRedBlackTree, without multi-level options.");
+		}
+	self = [super initWithTreeOptions: a_fuiOptions];
+	fOK = (self != nil);
+	if (fOK)
+		{
+		m_fuiOptions = a_fuiOptions;
+		count = 0;
+		mutations = 0;
+		sentinel = CHBinaryTreeNodePoolCreateArena (&m_sNodePool);
+		header = CHCreateBinaryTreeNodeWithObject ([CHSearchTreeHeaderObject object]);
+		header -> right = sentinel;
+		header -> left = sentinel;
+		if (a_fuiOptions & CHTreeOptionsOrderStatistics)
+			m_sNodePool.cbNode = kCHBinaryTreeCountedNodeSize;	/* Every node carries a subtree count */
+		if (a_fuiOptions & CHTreeOptionsPersistent)
+			{
+			m_sNodePool.fSharedNodes = true;
+			if (m_sNodePool.cbNode == 0)
+				m_sNodePool.cbNode = kCHBinaryTreeNodeSize;
+			}
+		fOK = ((id) sentinel != nil) && ((id) header != nil);	/* CJEC, 13-Feb-15: Add checks to ensure successful initialisation */
+		}
+	if (!fOK)
+		{
+		[self release];						/* CJEC, 12-Feb-15: Avoid memory leak when initialisation fails */
+		self = nil;
+		}
+	return self;
+}
+
+/* CJEC, 12-Feb-15: Read-only accessor to the options flags
+*/
+- (unsigned int)	GetOptions
+	{
+	return m_fuiOptions;
+	}
+
+- (id) initWithSortedArray:(NSArray*)anArray {
+	if ((self = [self init]) == nil) return nil;
+	CHBinaryTreeNodePoolReserve(&m_sNodePool, [anArray count]);
+	[self addObjectsFromArray:anArray];
+	return self;
+}
+
+/* Link a_cObjects objects, which must be in strictly ascending order, into the empty receiver as a perfectly balanced tree in O(n)
+*/
+- (void)	buildBalancedTreeFromObjects: (id *) a_apo count: (NSUInteger) a_cObjects
+	{
+	CHBinaryTreeBuild		sBuild;
+	CHBinaryTreeParallelism	sParallelism;
+	bool					fBuilt;
+
+	NSAssert(count == 0, @"Illegal state, a balanced build needs an empty tree!");
+	++mutations;
+	sBuild.apo = a_apo;
+	sBuild.pPool = &m_sNodePool;
+	sBuild.pSentinel = sentinel;
+	sBuild.uiTreeHeight = CHBinaryTreeBuildHeight (a_cObjects);
+	sBuild.poTree = self;
+	sBuild.selBuilt = @selector (setBalanceForBuiltNode:leftHeight:rightHeight:depth:treeHeight:);
+	sBuild.pfnBuilt = (CHBuiltNodeIMP) [self methodForSelector: sBuild.selBuilt];
+	sBuild.fCounted = (m_fuiOptions & CHTreeOptionsOrderStatistics) != 0;
+	sBuild.apNode = NULL;
+	CHBinaryTreeNodePoolReserve(&m_sNodePool, a_cObjects);
+	fBuilt = false;
+#if CHUsingDispatch
+	if (CHBinaryTreeParallelismGet (a_cObjects, &sParallelism))
+		fBuilt = CHBinaryTreeBuildParallel (&sBuild, a_cObjects, &sParallelism, &header -> right);
+#else
+	(void) sParallelism;
+#endif	/* CHUsingDispatch */
+	if (!fBuilt)
+		CHBinaryTreeBuildSubtree (&sBuild, 0, a_cObjects, 0, &header -> right);
+	count = a_cObjects;
+	}
+
+/* When the receiver is empty and the array is in strictly ascending order, the tree is built directly in its final, balanced shape, rather than by
+	rebalancing after each insertion. Checking the order costs one comparison per object. When the array is not in order but parallel bulk operations are
+	enabled, workers sort it and the tree is built from the result. Otherwise, the objects are added one at a time
+*/
+- (void)	addObjectsFromArray: (NSArray *) a_poArray
+	{
+	CHBinaryTreeParallelism	sParallelism;
+	NSUInteger				cObjects;
+	NSUInteger				ui;
+	id *					apo;
+	id *					apoScratch;
+
+	cObjects = [a_poArray count];
+	apo = NULL;
+	if ((count == 0) && (cObjects > 1))
+		apo = malloc (cObjects * kCHPointerSize);
+	if (apo == NULL)						/* Not empty, too few objects to matter or out of memory */
+		[super addObjectsFromArray: a_poArray];
+	else
+		{
+		[a_poArray getObjects: apo range: NSMakeRange (0, cObjects)];
+		for (ui = 1; ui < cObjects; ui ++)
+			if (CHSearchTreeCompare (&m_sComparator, apo [ui - 1], apo [ui]) != NSOrderedAscending)
+				break;
+		apoScratch = NULL;
+#if CHUsingDispatch
+		if ((ui != cObjects) && ((m_fuiOptions & (CHTreeOptionsMultiLevel | CHTreeOptionsMultiLeaves)) == 0) && CHBinaryTreeParallelismGet (cObjects, &sParallelism))
+			apoScratch = malloc (cObjects * kCHPointerSize);	/* Equal objects replace each other, rather than being collected at a leaf */
+		if (apoScratch != NULL)
+			{
+			cObjects = CHBinaryTreeSortParallel (&m_sComparator, false, apo, cObjects, apoScratch, &sParallelism);
+			ui = cObjects;
+			free (apoScratch);
+			}
+#else
+		(void) sParallelism;
+		(void) apoScratch;
+#endif	/* CHUsingDispatch */
+		if (ui == cObjects)
+			[self buildBalancedTreeFromObjects: apo count: cObjects];
+		else
+			{
+			for (ui = 0; ui < cObjects; ui ++)
+				[self addObject: apo [ui]];
+			}
+		free (apo);
+		}
+	}
+
+/* A new tree of the receiver's class, options and ordering, containing a_cObjects objects which must be in strictly ascending order. The caller MUST release
+*/
+- (id)	newTreeWithSortedObjects: (id *) a_apo count: (NSUInteger) a_cObjects
+	{
+	CHBinarySearchTree *	poTree;
+
+	poTree = [[[self class] alloc] initWithTreeOptions: m_fuiOptions];
+	CHSearchTreeComparatorCopy (&poTree -> m_sComparator, &m_sComparator);
+	if (a_cObjects != 0)
+		[poTree buildBalancedTreeFromObjects: a_apo count: a_cObjects];
+	return poTree;
+	}
+
+#pragma mark Parallel bulk operations
+
++ (void) setParallelGrainSize:(NSUInteger)grainSize {
+	__atomic_store_n(&s_cParallelGrainSize, grainSize, __ATOMIC_RELAXED);
+}
+
++ (NSUInteger) parallelGrainSize {
+	return __atomic_load_n(&s_cParallelGrainSize, __ATOMIC_RELAXED);
+}
+
++ (void) setParallelWorkerCount:(NSUInteger)workerCount {
+	CHSetParallelWorkerCount(workerCount);
+}
+
++ (NSUInteger) parallelWorkerCount {
+	return CHParallelWorkerCount();
+}
+
+#pragma mark Order statistics
+
+/* The number of objects ordered before a_po, or before or the same as a_po if a_fInclusive. O(log n) with CHTreeOptionsOrderStatistics, otherwise O(n)
+*/
+- (NSUInteger)	countOfObjectsBeforeObject: (id) a_po inclusive: (bool) a_fInclusive
+	{
+	CHBinaryTreeNode *		pNode;
+	NSEnumerator *			poEnumerator;
+	id						po;
+	NSUInteger				cObjects;
+	NSComparisonResult		eComparisonResult;
+	bool					fMultiLevel;
+
+	fMultiLevel = (m_fuiOptions & CHTreeOptionsMultiLevel) != 0;
+	cObjects = 0;
+	if (m_fuiOptions & CHTreeOptionsOrderStatistics)
+		{
+		pNode = header -> right;
+		while (pNode != sentinel)
+			{
+			eComparisonResult = CHSearchTreeCompareObjects (&m_sComparator, 0, fMultiLevel, pNode -> object, a_po);
+			if ((eComparisonResult == NSOrderedAscending) || (a_fInclusive && (eComparisonResult == NSOrderedSame)))
+				{
+				cObjects += CHBinaryTreeNodeCount (pNode -> left) + 1;	/* The node and everything to its left are before a_po */
+				pNode = pNode -> right;
+				}
+			else
+				pNode = pNode -> left;
+			}
+		}
+	else
+		{
+		poEnumerator = [self objectEnumeratorWithTraversalOrder: CHTraverseAscending options: 0];	/* Don't enumerate to leaf level */
+		while ((po = [poEnumerator nextObject]) != nil)
+			{
+			eComparisonResult = CHSearchTreeCompareObjects (&m_sComparator, 0, fMultiLevel, po, a_po);
+			if ((eComparisonResult == NSOrderedDescending) || (!a_fInclusive && (eComparisonResult == NSOrderedSame)))
+				break;
+			cObjects ++;
+			}
+		}
+	return cObjects;
+	}
+
+- (id) objectAtIndex:(NSUInteger)index {
+	if (index >= count)
+		CHIndexOutOfRangeException([self class], _cmd, index, count);
+	if (!(m_fuiOptions & CHTreeOptionsOrderStatistics)) {
+		NSEnumerator *e = [self objectEnumeratorWithTraversalOrder:CHTraverseAscending options:0];
+		while (index-- > 0)
+			[e nextObject];
+		return [e nextObject];
+	}
+	// Select by subtree counts, skipping the left subtree and the node when going right
+	CHBinaryTreeNode *current = header->right;
+	NSUInteger leftCount;
+	while (index != (leftCount = CHBinaryTreeNodeCount(current->left))) {
+		if (index < leftCount) {
+			current = current->left;
+		} else {
+			index -= leftCount + 1;
+			current = current->right;
+		}
+	}
+	return current->object;
+}
+
+- (NSUInteger) indexOfObject:(id)anObject {
+	if (anObject == nil || count == 0)
+		return NSNotFound;
+	bool fMultiLevel = (m_fuiOptions & CHTreeOptionsMultiLevel) != 0;
+	NSComparisonResult comparison;
+	NSUInteger index = 0;
+	if (!(m_fuiOptions & CHTreeOptionsOrderStatistics)) {
+		NSEnumerator *e = [self objectEnumeratorWithTraversalOrder:CHTraverseAscending options:0];
+		id object;
+		while ((object = [e nextObject])) {
+			comparison = CHSearchTreeCompareObjects(&m_sComparator, 0, fMultiLevel, object, anObject);
+			if (comparison == NSOrderedSame)
+				return index;
+			if (comparison == NSOrderedDescending)
+				break;
+			index++;
+		}
+		return NSNotFound;
+	}
+	CHBinaryTreeNode *current = header->right;
+	while (current != sentinel) {
+		comparison = CHSearchTreeCompareObjects(&m_sComparator, 0, fMultiLevel, current->object, anObject);
+		if (comparison == NSOrderedSame)
+			return index + CHBinaryTreeNodeCount(current->left);
+		if (comparison == NSOrderedAscending) {
+			index += CHBinaryTreeNodeCount(current->left) + 1;
+			current = current->right;
+		} else {
+			current = current->left;
+		}
+	}
+	return NSNotFound;
+}
+
+- (NSUInteger) countOfObjectsFromObject:(id)start toObject:(id)end {
+	if (count == 0)
+		return 0;
+	NSUInteger before = (start == nil) ? 0 : [self countOfObjectsBeforeObject:start inclusive:NO];
+	NSUInteger through = (end == nil) ? count : [self countOfObjectsBeforeObject:end inclusive:YES];
+	if (start != nil && end != nil &&
+	    CHSearchTreeCompareObjects(&m_sComparator, 0, (m_fuiOptions & CHTreeOptionsMultiLevel) != 0, start, end) == NSOrderedDescending)
+	{
+		// As for -subsetFromObject:toObject:, count the objects outside the range
+		return (count - before) + through;
+	}
+	return (through > before) ? through - before : 0;
+}
+
+#pragma mark Seeking
+
+- (id) floorObject:(id)anObject {
+	if (anObject == nil)
+		return nil;
+	bool fMultiLevel = (m_fuiOptions & CHTreeOptionsMultiLevel) != 0;
+	CHBinaryTreeNode *current = header->right, *found = NULL;
+	while (current != sentinel) {
+		NSComparisonResult comparison = CHSearchTreeCompareObjects(&m_sComparator, 0, fMultiLevel, current->object, anObject);
+		if (comparison == NSOrderedSame)
+			return current->object;
+		if (comparison == NSOrderedAscending) {
+			found = current;
+			current = current->right;
+		} else {
+			current = current->left;
+		}
+	}
+	return (found == NULL) ? nil : found->object;
+}
+
+- (id) ceilingObject:(id)anObject {
+	if (anObject == nil)
+		return nil;
+	bool fMultiLevel = (m_fuiOptions & CHTreeOptionsMultiLevel) != 0;
+	CHBinaryTreeNode *current = header->right, *found = NULL;
+	while (current != sentinel) {
+		NSComparisonResult comparison = CHSearchTreeCompareObjects(&m_sComparator, 0, fMultiLevel, current->object, anObject);
+		if (comparison == NSOrderedSame)
+			return current->object;
+		if (comparison == NSOrderedDescending) {
+			found = current;
+			current = current->left;
+		} else {
+			current = current->right;
+		}
+	}
+	return (found == NULL) ? nil : found->object;
+}
+
+- (CHBinarySearchTreeCursor*) cursorAtObject:(id)anObject {
+	return [[[CHBinarySearchTreeCursor alloc] initWithTree:self
+	                                                header:header
+	                                              sentinel:sentinel
+	                                            comparator:&m_sComparator
+	                                            multiLevel:(m_fuiOptions & CHTreeOptionsMultiLevel) != 0
+	                                       mutationPointer:&mutations
+	                                                object:anObject
+	                                                 after:NO] autorelease];
+}
+
+- (CHBinarySearchTreeCursor*) cursorAfterObject:(id)anObject {
+	return [[[CHBinarySearchTreeCursor alloc] initWithTree:self
+	                                                header:header
+	                                              sentinel:sentinel
+	                                            comparator:&m_sComparator
+	                                            multiLevel:(m_fuiOptions & CHTreeOptionsMultiLevel) != 0
+	                                       mutationPointer:&mutations
+	                                                object:anObject
+	                                                 after:YES] autorelease];
+}
+
+- (void) addObject:(id)anObject hint:(CHBinarySearchTreeCursor*)hint {
+	if (anObject == nil)
+		CHNilArgumentException([self class], _cmd);
+	if (hint == nil) {
+		[self addObject:anObject];
+		return;
+	}
+	NSUInteger hintSize;
+	int hintPosition;
+	CHBinaryTreeNode **hintPath = [hint pathInTree:self size:&hintSize position:&hintPosition];
+	if (hintPath == NULL)
+		CHInvalidArgumentException([self class], _cmd, @"The hint is a cursor over another tree.");
+	if ([[self class] supportsHintedInsertion] && (m_fuiOptions & CHTreeOptionsPersistent) == 0) {
+		++mutations;
+		[self addObject:anObject fromPath:hintPath size:hintSize position:hintPosition appendOnly:NO cursor:hint];
+		return;
+	}
+	
+	// Add the object as usual, then search for it to position the hint.
+	[self addObject:anObject];
+	bool isMultiLevel = (m_fuiOptions & CHTreeOptionsMultiLevel) != 0;
+	CHBinaryTreeStack_DECLARE();
+	CHBinaryTreeStack_INIT();
+	CHBinaryTreeNode *current = header->right;
+	NSComparisonResult comparison;
+	while (current != sentinel) {
+		CHBinaryTreeStack_PUSH(current);
+		comparison = CHSearchTreeCompareObjects(&m_sComparator, 0, isMultiLevel, current->object, anObject);
+		if (comparison == NSOrderedSame)
+			break;
+		current = current->link[comparison == NSOrderedAscending]; // R on YES
+	}
+	[hint setPath:stack size:(current != sentinel) ? stackSize : 0];
+	CHBinaryTreeStack_FREE(stack);
+}
+
+- (BOOL) addObject:(id)anObject
+          fromPath:(CHBinaryTreeNode**)path
+              size:(NSUInteger)pathSize
+          position:(int)position
+        appendOnly:(BOOL)appendOnly
+            cursor:(CHBinarySearchTreeCursor*)cursor
+{
+	CHBinaryTreeNode *current, *parent, *match = NULL;
+	NSComparisonResult comparison;
+	NSUInteger index, climbed;
+	u_int32_t dir = 1;
+	CHBinaryTreeStack_DECLARE();
+	CHBinaryTreeStack_INIT();
+	
+	// The search starts from the header and the path to the hint, or the spine on its side if the hint is past either end.
+	CHBinaryTreeStack_PUSH(header);
+	if (position == 0) {
+		for (index = 0; index < pathSize; index++)
+			CHBinaryTreeStack_PUSH(path[index]);
+	} else {
+		for (current = header->right; current != sentinel; current = current->link[position > 0])
+			CHBinaryTreeStack_PUSH(current);
+	}
+	
+	// Climb while anObject is also beyond the next ancestor on its side of the hint. Ancestors on the other side are passed without
+	// comparing, since the hint, and so anObject, is already beyond them. The object belongs in the dir subtree of the last node passed.
+	climbed = stackSize - 1;
+	if (climbed > 0) {
+		comparison = CHSearchTreeCompare(&m_sComparator, stack[climbed]->object, anObject);
+		if (comparison == NSOrderedSame)
+			match = stack[climbed];
+		else {
+			dir = (comparison == NSOrderedAscending); // R on YES
+			if (appendOnly && !dir) {
+				CHBinaryTreeStack_FREE(stack);
+				return NO;
+			}
+			for (index = climbed; index > 1; index--) {
+				if (stack[index - 1]->link[dir] == stack[index])
+					continue;
+				comparison = CHSearchTreeCompare(&m_sComparator, stack[index - 1]->object, anObject);
+				if (comparison == NSOrderedSame) {
+					climbed = index - 1;
+					match = stack[climbed];
+					break;
+				}
+				if ((comparison == NSOrderedAscending) != dir)
+					break;
+				climbed = index - 1;
+			}
+		}
+	}
+	stackSize = climbed + 1;
+	
+	// Descend from there as -addObject: would from the root.
+	parent = stack[climbed];
+	if (match == NULL) {
+		current = parent->link[dir];
+		while (current != sentinel) {
+			comparison = CHSearchTreeCompare(&m_sComparator, current->object, anObject);
+			CHBinaryTreeStack_PUSH(current);
+			if (comparison == NSOrderedSame) {
+				match = current;
+				break;
+			}
+			parent = current;
+			dir = (comparison == NSOrderedAscending); // R on YES
+			current = current->link[dir];
+		}
+	}
+	
+	[anObject retain]; // Must retain whether replacing value or adding new node
+	if (match != NULL) {
+		[match->object release];
+		match->object = anObject;
+	} else {
+		current = CHBinaryTreeNodePoolAlloc(&m_sNodePool, anObject);
+		current->left = sentinel;
+		current->right = sentinel;
+		parent->link[dir] = current;
+		CHBinaryTreeStack_PUSH(current);
+		++count;
+		stackSize = [self rebalancePath:stack size:stackSize];
+		// Every node whose subtree gained the new node is now on the path to it.
+		if (m_fuiOptions & CHTreeOptionsOrderStatistics) {
+			for (index = stackSize - 1; index > 0; index--)
+				CHBinaryTreeNodeCount(stack[index]) = CHBinaryTreeNodeCount(stack[index]->left) + CHBinaryTreeNodeCount(stack[index]->right) + 1;
+		}
+	}
+	[cursor setPath:stack + 1 size:stackSize - 1];
+	CHBinaryTreeStack_FREE(stack);
+	return YES;
+}
+
+#pragma mark Batched lookup
+
+#define kCHBatchedLookupLanes	8	/* Descents interleaved by CHBinaryTreeFindInterleaved(), enough to keep several cache misses in flight */
+
+/* A range of probes [uiLow, uiHigh) still to be found in the subtree under pNode
+*/
+typedef struct CHBinaryTreeProbeRange {
+	CHBinaryTreeNode *	pNode;
+	NSUInteger			uiLow;
+	NSUInteger			uiHigh;
+} CHBinaryTreeProbeRange;
+
+/* Find a_cProbes probes, in ascending order, in the tree under a_pRoot in one descent. At each node, a binary search of the node's range of probes divides them into those
+	ordered before the node, which go on to its left subtree, those the same as it, and those ordered after it, which go on to its right subtree. Only the nodes on the
+	paths to the probes are visited, each comparing with O(log k) probes, which is O(k log(n/k)) comparisons in all. Sets a_apoFound [i] to the tree's object that is the
+	same as a_apoProbes [i], or nil, and *a_pfAllFound to whether every probe was found. If a_fStopAtMissing, stops at the first probe not found, leaving the others unset.
+	Returns false, leaving the results unset, if out of memory
+*/
+static bool	CHBinaryTreeFindSorted (CHSearchTreeComparator * a_pComparator, CHBinaryTreeNode * a_pRoot, CHBinaryTreeNode * a_pSentinel, id * a_apoProbes, NSUInteger a_cProbes,
+									id * a_apoFound, bool a_fStopAtMissing, bool * a_pfAllFound)
+	{
+	CHBinaryTreeProbeRange		asRangesInline [kCHBinaryTreeStackInlineSize];
+	CHBinaryTreeProbeRange *	asRanges;
+	CHBinaryTreeProbeRange *	asGrown;
+	CHBinaryTreeProbeRange		sRange;
+	NSUInteger					cCapacity;
+	NSUInteger					cRanges;
+	NSUInteger					uiLow;
+	NSUInteger					uiHigh;
+	NSUInteger					uiMiddle;
+	NSUInteger					ui;
+
+	asRanges = asRangesInline;
+	cCapacity = kCHBinaryTreeStackInlineSize;
+	asRanges [0].pNode = a_pRoot;
+	asRanges [0].uiLow = 0;
+	asRanges [0].uiHigh = a_cProbes;
+	cRanges = 1;
+	*a_pfAllFound = true;
+	while (cRanges > 0)
+		{
+		sRange = asRanges [-- cRanges];
+		if (sRange.pNode == a_pSentinel)
+			{
+			for (ui = sRange.uiLow; ui < sRange.uiHigh; ui ++)
+				a_apoFound [ui] = nil;
+			*a_pfAllFound = false;
+			if (a_fStopAtMissing)
+				break;
+			continue;
+			}
+		uiLow = sRange.uiLow;						/* Find the first probe not ordered before the node */
+		uiHigh = sRange.uiHigh;
+		while (uiLow < uiHigh)
+			{
+			uiMiddle = uiLow + (uiHigh - uiLow) / 2;
+			if (CHSearchTreeCompare (a_pComparator, sRange.pNode -> object, a_apoProbes [uiMiddle]) == NSOrderedDescending)
+				uiLow = uiMiddle + 1;
+			else
+				uiHigh = uiMiddle;
+			}
+		for (ui = uiLow; (ui < sRange.uiHigh) && (CHSearchTreeCompare (a_pComparator, sRange.pNode -> object, a_apoProbes [ui]) == NSOrderedSame); ui ++)
+			a_apoFound [ui] = sRange.pNode -> object;
+		if (cRanges + 2 > cCapacity)
+			{
+			if (asRanges == asRangesInline)
+				{
+				asGrown = malloc (2 * cCapacity * sizeof (CHBinaryTreeProbeRange));
+				if (asGrown != NULL)
+					memcpy (asGrown, asRanges, cRanges * sizeof (CHBinaryTreeProbeRange));
+				}
+			else
+				asGrown = realloc (asRanges, 2 * cCapacity * sizeof (CHBinaryTreeProbeRange));
+			if (asGrown == NULL)
+				{
+				if (asRanges != asRangesInline)
+					free (asRanges);
+				return false;
+				}
+			asRanges = asGrown;
+			cCapacity *= 2;
+			}
+		if (ui < sRange.uiHigh)						/* The right subtree is searched after the left, so that the probes are found in ascending order */
+			{
+			asRanges [cRanges].pNode = sRange.pNode -> right;
+			asRanges [cRanges].uiLow = ui;
+			asRanges [cRanges].uiHigh = sRange.uiHigh;
+			cRanges ++;
+			}
+		if (sRange.uiLow < uiLow)
+			{
+			asRanges [cRanges].pNode = sRange.pNode -> left;
+			asRanges [cRanges].uiLow = sRange.uiLow;
+			asRanges [cRanges].uiHigh = uiLow;
+			cRanges ++;
+			}
+		}
+	if (asRanges != asRangesInline)
+		free (asRanges);
+	return true;
+	}
+
+/* Find a_cProbes probes, in any order, in the tree under a_pRoot, each by its own descent, with kCHBatchedLookupLanes descents interleaved. A step of a descent that moves
+	to a node prefetches the node; its next step loads the node's object and prefetches that; and the step after compares the object. The other lanes take a step
+	in between, so that the cache misses of several descents overlap rather than following one another. Sets a_apoFound as CHBinaryTreeFindSorted() does, and
+	returns whether every probe was found. If a_fStopAtMissing, stops at the first probe not found
+*/
+static bool	CHBinaryTreeFindInterleaved (CHSearchTreeComparator * a_pComparator, CHBinaryTreeNode * a_pRoot, CHBinaryTreeNode * a_pSentinel, id * a_apoProbes, NSUInteger a_cProbes,
+										 id * a_apoFound, bool a_fStopAtMissing)
+	{
+	CHBinaryTreeNode *	apNode [kCHBatchedLookupLanes];		/* The node each lane is at, or NULL once the lane has no more probes */
+	id					apoObject [kCHBatchedLookupLanes];	/* The object of the lane's node once it has been loaded, otherwise nil */
+	NSUInteger			auiProbe [kCHBatchedLookupLanes];
+	CHBinaryTreeNode *	pNode;
+	NSComparisonResult	eComparison;
+	NSUInteger			uiNext;
+	NSUInteger			cLanes;
+	NSUInteger			cActive;
+	NSUInteger			uiLane;
+	bool				fAllFound;
+
+	for (cLanes = 0; (cLanes < kCHBatchedLookupLanes) && (cLanes < a_cProbes); cLanes ++)
+		{
+		apNode [cLanes] = a_pRoot;
+		apoObject [cLanes] = nil;
+		auiProbe [cLanes] = cLanes;
+		}
+	uiNext = cLanes;
+	cActive = cLanes;
+	fAllFound = true;
+	while (cActive > 0)
+		{
+		for (uiLane = 0; uiLane < cLanes; uiLane ++)
+			{
+			pNode = apNode [uiLane];
+			if (pNode == NULL)
+				continue;
+			if (pNode == a_pSentinel)
+				{
+				a_apoFound [auiProbe [uiLane]] = nil;
+				fAllFound = false;
+				if (a_fStopAtMissing)
+					return false;
+				}
+			else if (apoObject [uiLane] == nil)
+				{
+				apoObject [uiLane] = pNode -> object;
+				__builtin_prefetch ((void *) apoObject [uiLane]);
+				continue;
+				}
+			else
+				{
+				eComparison = CHSearchTreeCompare (a_pComparator, apoObject [uiLane], a_apoProbes [auiProbe [uiLane]]);
+				if (eComparison != NSOrderedSame)
+					{
+					pNode = pNode -> link [eComparison == NSOrderedAscending];	/* R on YES */
+					__builtin_prefetch (pNode);
+					apNode [uiLane] = pNode;
+					apoObject [uiLane] = nil;
+					continue;
+					}
+				a_apoFound [auiProbe [uiLane]] = apoObject [uiLane];
+				}
+			if (uiNext < a_cProbes)							/* The lane's probe is resolved, so start the next one */
+				{
+				apNode [uiLane] = a_pRoot;
+				apoObject [uiLane] = nil;
+				auiProbe [uiLane] = uiNext ++;
+				}
+			else
+				{
+				apNode [uiLane] = NULL;
+				cActive --;
+				}
+			}
+		}
+	return fAllFound;
+	}
+
+/* Probes in ascending order share one descent. Others are found by interleaved descents, rather than being sorted first, since sorting them takes O(k log k) comparisons,
+	as many as sharing the descent saves unless there are about as many probes as objects. Multi-level trees send -member: for each probe, which searches their
+	sub-collections. Returns whether every probe was found
+*/
+- (bool)	findObjects: (NSArray *) a_poProbes found: (id *) a_apoFound stopAtMissing: (bool) a_fStopAtMissing
+	{
+	id *		apoProbes;
+	NSUInteger	cProbes;
+	NSUInteger	ui;
+	bool		fAllFound;
+
+	cProbes = [a_poProbes count];
+	apoProbes = NULL;
+	if (((m_fuiOptions & CHTreeOptionsMultiLevel) == 0) && (cProbes > 1))
+		apoProbes = malloc (cProbes * kCHPointerSize);
+	if (apoProbes == NULL)						/* Multi-level, too few probes to matter or out of memory */
+		{
+		fAllFound = true;
+		for (ui = 0; ui < cProbes; ui ++)
+			{
+			a_apoFound [ui] = [self member: [a_poProbes objectAtIndex: ui]];
+			if (a_apoFound [ui] == nil)
+				{
+				fAllFound = false;
+				if (a_fStopAtMissing)
+					break;
+				}
+			}
+		return fAllFound;
+		}
+	[a_poProbes getObjects: apoProbes range: NSMakeRange (0, cProbes)];
+	for (ui = 1; ui < cProbes; ui ++)
+		if (CHSearchTreeCompare (&m_sComparator, apoProbes [ui - 1], apoProbes [ui]) == NSOrderedDescending)
+			break;
+	if ((ui < cProbes) || !CHBinaryTreeFindSorted (&m_sComparator, header -> right, sentinel, apoProbes, cProbes, a_apoFound, a_fStopAtMissing, &fAllFound))
+		fAllFound = CHBinaryTreeFindInterleaved (&m_sComparator, header -> right, sentinel, apoProbes, cProbes, a_apoFound, a_fStopAtMissing);
+	free (apoProbes);
+	return fAllFound;
+	}
+
+- (NSArray*) membersForObjects:(NSArray*)objects {
+	NSUInteger probeCount = [objects count];
+	if (probeCount == 0)
+		return [NSArray array];
+	id *found = malloc(kCHPointerSize * probeCount);
+	if (found == NULL)
+		[NSException raise:NSMallocException format:@"Unable to allocate %lu objects", (unsigned long) probeCount];
+	[self findObjects:objects found:found stopAtMissing:false];
+	id null = [NSNull null];
+	for (NSUInteger index = 0; index < probeCount; index++) {
+		if (found[index] == nil)
+			found[index] = null;
+	}
+	NSArray *members = [NSArray arrayWithObjects:found count:probeCount];
+	free(found);
+	return members;
+}
+
+- (BOOL) containsObjects:(NSArray*)objects {
+	NSUInteger probeCount = [objects count];
+	if (probeCount == 0)
+		return YES;
+	id *found = malloc(kCHPointerSize * probeCount);
+	if (found == NULL)
+		[NSException raise:NSMallocException format:@"Unable to allocate %lu objects", (unsigned long) probeCount];
+	bool contained = [self findObjects:objects found:found stopAtMissing:true];
+	free(found);
+	return contained;
+}
+
+#pragma mark Splitting and joining
+
+/* Count the nodes of whichever of two trees is smaller, walking both in step, so that it takes time proportional to the smaller tree. Returns the
+	count, and sets *a_piSmaller to the index of the tree it counts
+*/
+static NSUInteger	CHBinaryTreeCountSmaller (CHBinaryTreeNode * a_apRoot [2], CHBinaryTreeNode * a_pSentinel, int * a_piSmaller)
+	{
+	CHBinaryTreeNode *	appStackInline [2] [kCHBinaryTreeStackInlineSize];
+	CHBinaryTreeNode **	appStack [2];
+	NSUInteger			acCapacity [2];
+	NSUInteger			acSize [2];
+	NSUInteger			acNodes [2];
+	CHBinaryTreeNode *	pNode;
+	int					i;
+
+	for (i = 0; i < 2; i ++)
+		{
+		appStack [i] = appStackInline [i];
+		acCapacity [i] = kCHBinaryTreeStackInlineSize;
+		acSize [i] = 0;
+		acNodes [i] = 0;
+		if (a_apRoot [i] != a_pSentinel)
+			appStack [i] [acSize [i] ++] = a_apRoot [i];
+		}
+	for (i = 0; acSize [i] != 0; i = !i)		/* The first tree to run out of nodes has been counted */
+		{
+		pNode = appStack [i] [-- acSize [i]];
+		acNodes [i] ++;
+		if (acSize [i] + 2 > acCapacity [i])
+			appStack [i] = CHBinaryTreeStackGrow (appStack [i], &acCapacity [i], appStackInline [i]);
+		if (pNode -> left != a_pSentinel)
+			appStack [i] [acSize [i] ++] = pNode -> left;
+		if (pNode -> right != a_pSentinel)
+			appStack [i] [acSize [i] ++] = pNode -> right;
+		}
+	*a_piSmaller = i;
+	if (appStack [0] != appStackInline [0])
+		free (appStack [0]);
+	if (appStack [1] != appStackInline [1])
+		free (appStack [1]);
+	return acNodes [i];
+	}
+
+// Splitting follows the path to anObject, then works back up it: each node on the path is joined, with its subtree on the far side of the
+// path, to the part of the tree already split off on that side. Each join takes time proportional to the difference in rank of the subtrees
+// it joins, and these sum to O(log n) over the path, as do the ranks, which are derived on the way up from the rank of the sentinel.
+- (id) splitAtObject:(id)anObject {
+	if (anObject == nil)
+		CHNilArgumentException([self class], _cmd);
+	if (m_fuiOptions & CHTreeOptionsPersistent) // Relinking would change nodes that copies of the receiver share
+		CHUnsupportedOperationException([self class], _cmd);
+	CHBinarySearchTree *newTree = [[[[self class] alloc] initWithTreeOptions:m_fuiOptions] autorelease];
+	CHSearchTreeComparatorCopy(&newTree->m_sComparator, &m_sComparator);
+	// The new tree takes over nodes from the receiver, so it takes the receiver's arena and sentinel in place of its own.
+	newTree->sentinel = CHBinaryTreeNodePoolShare(&newTree->m_sNodePool, &m_sNodePool);
+	newTree->header->right = newTree->sentinel;
+	newTree->header->left = newTree->sentinel;
+	if (count == 0)
+		return newTree;
+	++mutations;
+	
+	bool fMultiLevel = (m_fuiOptions & CHTreeOptionsMultiLevel) != 0;
+	int dir = 0;
+	CHBinaryTreeNode *current = header->right;
+	CHBinaryTreeStack_DECLARE();
+	CHBinaryTreeStack_INIT();
+	while (current != sentinel) {
+		CHBinaryTreeStack_PUSH(current);
+		dir = (CHSearchTreeCompareObjects(&m_sComparator, 0, fMultiLevel, current->object, anObject) == NSOrderedAscending); // R on YES
+		current = current->link[dir];
+	}
+	CHBinaryTreeNode *halves[2] = {sentinel, sentinel}, *child = NULL;
+	NSInteger halfRanks[2] = {0, 0}, rank = 0, siblingRank;
+	while ((current = CHBinaryTreeStack_POP()) != NULL) {
+		if (child != NULL)
+			dir = (current->right == child); // Still the original link, though child itself has been joined
+		rank = [self rankOfNode:current child:dir rank:rank siblingRank:&siblingRank];
+		if (dir) // current and its left subtree are ordered before anObject
+			halves[0] = [self joinSubtree:current->left rank:siblingRank withNode:current subtree:halves[0] rank:halfRanks[0] resultRank:&halfRanks[0]];
+		else
+			halves[1] = [self joinSubtree:halves[1] rank:halfRanks[1] withNode:current subtree:current->right rank:siblingRank resultRank:&halfRanks[1]];
+		child = current;
+	}
+	CHBinaryTreeStack_FREE(stack);
+	
+	NSUInteger newCount;
+	if (m_fuiOptions & CHTreeOptionsOrderStatistics)
+		newCount = CHBinaryTreeNodeCount(halves[1]);
+	else {
+		int smaller;
+		newCount = CHBinaryTreeCountSmaller(halves, sentinel, &smaller);
+		if (smaller == 0)
+			newCount = count - newCount;
+	}
+	header->right = halves[0];
+	newTree->header->right = halves[1];
+	newTree->count = newCount;
+	count -= newCount;
+	return newTree;
+}
+
+- (void) joinWithTree:(CHBinarySearchTree*)otherTree {
+	if (otherTree == nil)
+		CHNilArgumentException([self class], _cmd);
+	if (otherTree == self || [otherTree class] != [self class] || otherTree->m_fuiOptions != m_fuiOptions)
+		CHInvalidArgumentException([self class], _cmd, @"Can only join another tree of the same class and options.");
+	if (m_fuiOptions & CHTreeOptionsPersistent)
+		CHUnsupportedOperationException([self class], _cmd);
+	if (otherTree->count == 0)
+		return;
+	
+	CHBinaryTreeNode *current, *first = otherTree->header->right;
+	while (first->left != otherTree->sentinel)
+		first = first->left;
+	if (count != 0) {
+		bool fMultiLevel = (m_fuiOptions & CHTreeOptionsMultiLevel) != 0;
+		current = header->right;
+		while (current->right != sentinel)
+			current = current->right;
+		if (CHSearchTreeCompareObjects(&m_sComparator, 0, fMultiLevel, current->object, first->object) != NSOrderedAscending)
+			CHInvalidArgumentException([self class], _cmd, @"The objects of the joined tree must be ordered after those of the receiver.");
+	}
+	++mutations;
+	++otherTree->mutations;
+	
+	CHBinaryTreeNode *right = otherTree->header->right;
+	CHBinaryTreeStack_DECLARE();
+	CHBinaryTreeStack_INIT();
+	if (otherTree->sentinel != sentinel) {
+		// The nodes of a tree with another sentinel must be relinked to the receiver's, one at a time.
+		CHBinaryTreeStack_PUSH(right);
+		while ((current = CHBinaryTreeStack_POP()) != NULL) {
+			if (current->left == otherTree->sentinel)
+				current->left = sentinel;
+			else
+				CHBinaryTreeStack_PUSH(current->left);
+			if (current->right == otherTree->sentinel)
+				current->right = sentinel;
+			else
+				CHBinaryTreeStack_PUSH(current->right);
+		}
+		CHBinaryTreeNodePoolMerge(&m_sNodePool, &otherTree->m_sNodePool);
+	}
+	otherTree->header->right = otherTree->sentinel;
+	
+	if (count == 0)
+		header->right = right;
+	else {
+		// Detach the first node of the other tree, by splitting it off the rest as -splitAtObject: would, then join the receiver to the rest through it.
+		current = right;
+		while (current != first) {
+			CHBinaryTreeStack_PUSH(current);
+			current = current->left;
+		}
+		NSInteger siblingRank, rank = [self rankOfNode:first child:0 rank:0 siblingRank:&siblingRank];
+		NSInteger restRank = siblingRank;
+		CHBinaryTreeNode *rest = first->right;
+		while ((current = CHBinaryTreeStack_POP()) != NULL) {
+			rank = [self rankOfNode:current child:0 rank:rank siblingRank:&siblingRank];
+			rest = [self joinSubtree:rest rank:restRank withNode:current subtree:current->right rank:siblingRank resultRank:&restRank];
+		}
+		header->right = [self joinSubtree:header->right
+		                             rank:[self rankOfSubtree:header->right]
+		                         withNode:first
+		                          subtree:rest
+		                             rank:restRank
+		                       resultRank:&rank];
+	}
+	CHBinaryTreeStack_FREE(stack);
+	count += otherTree->count;
+	otherTree->count = 0;
+}
+
+#pragma mark Set algebra
+
+typedef enum {
+	CHSetOperationUnion,
+	CHSetOperationIntersect,
+	CHSetOperationMinus
+} CHSetOperation;
+
+/* Copy the objects of a tree into a_apo, in ascending order
+*/
+static void	CHBinaryTreeGetObjects (CHBinaryTreeNode * a_pRoot, CHBinaryTreeNode * a_pSentinel, id * a_apo)
+	{
+	CHBinaryTreeNode *	pNode;
+	NSUInteger			ui;
+	CHBinaryTreeStack_DECLARE();
+	CHBinaryTreeStack_INIT();
+
+	ui = 0;
+	pNode = a_pRoot;
+	while ((pNode != a_pSentinel) || (stackSize != 0))
+		{
+		if (pNode != a_pSentinel)
+			{
+			CHBinaryTreeStack_PUSH(pNode);
+			pNode = pNode -> left;
+			}
+		else
+			{
+			pNode = CHBinaryTreeStack_POP();
+			a_apo [ui ++] = pNode -> object;
+			pNode = pNode -> right;
+			}
+		}
+	CHBinaryTreeStack_FREE(stack);
 	}
-	return [set autorelease];
-}
 
-- (id <CHSortedSet>)	subsetFromObject: (id) a_poStart toObject: (id) a_poEnd options: (CHSubsetConstructionOptions) a_fuiSubsetConstructionOptions nestingLevel: (unsigned int) a_uiNestingLevel
+/* Merge two strictly ascending arrays into a_apoOut, which must have room for both, keeping the objects that belong in the result of the operation,
+	and return the number kept. Where both arrays hold an object, the one from a_apoMine is kept
+*/
+static NSUInteger	CHSetOperationMerge (CHSetOperation a_eOperation, CHSearchTreeComparator * a_pComparator, bool a_fMultiLevel,
+									 id * a_apoMine, NSUInteger a_cMine, id * a_apoOther, NSUInteger a_cOther, id * a_apoOut)
 	{
-	(void) a_poStart;				/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
-	(void) a_poEnd;					/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
-	(void) a_fuiSubsetConstructionOptions;	/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
-	(void) a_uiNestingLevel;		/* CJEC, 12-Feb-15: Avoid unused parameter compiler warning */
-	CHUnsupportedOperationException ([self class], _cmd);
-	return nil;
+	NSUInteger			uiMine;
+	NSUInteger			uiOther;
+	NSUInteger			cOut;
+	NSComparisonResult	eComparisonResult;
+
+	uiMine = 0;
+	uiOther = 0;
+	cOut = 0;
+	while ((uiMine < a_cMine) && (uiOther < a_cOther))
+		{
+		eComparisonResult = CHSearchTreeCompareObjects (a_pComparator, 0, a_fMultiLevel, a_apoMine [uiMine], a_apoOther [uiOther]);
+		if (eComparisonResult == NSOrderedAscending)
+			{
+			if (a_eOperation != CHSetOperationIntersect)
+				a_apoOut [cOut ++] = a_apoMine [uiMine];
+			uiMine ++;
+			}
+		else
+			if (eComparisonResult == NSOrderedDescending)
+				{
+				if (a_eOperation == CHSetOperationUnion)
+					a_apoOut [cOut ++] = a_apoOther [uiOther];
+				uiOther ++;
+				}
+			else
+				{
+				if (a_eOperation != CHSetOperationMinus)
+					a_apoOut [cOut ++] = a_apoMine [uiMine];
+				uiMine ++;
+				uiOther ++;
+				}
+		}
+	if (a_eOperation != CHSetOperationIntersect)
+		while (uiMine < a_cMine)
+			a_apoOut [cOut ++] = a_apoMine [uiMine ++];
+	if (a_eOperation == CHSetOperationUnion)
+		while (uiOther < a_cOther)
+			a_apoOut [cOut ++] = a_apoOther [uiOther ++];
+	return cOut;
 	}
 
-// CJEC, 2-Jul-13: Support multi-level trees */
-/*
- \copydoc CHSortedSet::subsetFromObject:toObject:
- 
- \see     CHSortedSet#subsetFromObject:toObject:
- 
- \link    CHSortedSet#subsetFromObject:toObject: \endlink
- 
- \attention This implementation tests objects for membership in the subset according to their sorted order. This worst-case input causes more work for self-balancing trees, and subsets of unbalanced trees will always degenerate to linked lists.
- */
-- (id<CHSortedSet>) subsetFromObject:(id)start
-                            toObject:(id)end
-                             options:(CHSubsetConstructionOptions)options
-{
-	return [self subsetFromObject: start toObject: end options: options nestingLevel: 0];
-}
+/* True if a_cSmall objects are so few that O(log n) work for each of them beats O(n) work to merge them with a_cLarge objects
+*/
+static inline bool	CHSetOperationIsTiny (NSUInteger a_cSmall, NSUInteger a_cLarge)
+	{
+	NSUInteger	cLog;
 
-- (NSString*) debugDescriptionForNode:(CHBinaryTreeNode*)node {
-	return [NSString stringWithFormat:@"\"%@\"", node->object];
-}
+	for (cLog = 1; (a_cLarge >> cLog) != 0; cLog ++)
+		;
+	return a_cSmall * cLog < a_cLarge;
+	}
 
-- (NSString*) dotGraphStringForNode:(CHBinaryTreeNode*)node {
-	return [NSString stringWithFormat:@"  \"%@\";\n", node->object];
+// Swap the nodes of two trees of the same class and options, with the sentinels and node pools that go with them. The headers stay put,
+// since enumerators and range views hold them, and each tree counts a mutation.
+- (void) exchangeContentsWithTree:(CHBinarySearchTree*)otherTree {
+	CHBinaryTreeNode *root = header->right, *otherSentinel = otherTree->sentinel;
+	CHBinaryTreeNodePool pool = m_sNodePool;
+	NSUInteger otherCount = otherTree->count;
+	header->right = otherTree->header->right;
+	header->left = otherSentinel;
+	otherTree->header->right = root;
+	otherTree->header->left = sentinel;
+	otherTree->sentinel = sentinel;
+	sentinel = otherSentinel;
+	m_sNodePool = otherTree->m_sNodePool;
+	otherTree->m_sNodePool = pool;
+	otherTree->count = count;
+	count = otherCount;
+	++mutations;
+	++otherTree->mutations;
 }
 
-/* CJEC, 8-Jul-13: Support multi-level trees */
-- (void) addObject:(id) a_po nestingLevel: (unsigned int) a_uiNestingLevel
-	{
-	(void) a_po;						/* CJEC, 8-Jul-13: Avoid unused parameter compiler warning */
-	(void) a_uiNestingLevel;			/* CJEC, 8-Jul-13: Avoid unused parameter compiler warning */
-	CHUnsupportedOperationException ([self class], _cmd);
+// Returns a new tree holding the result of the operation, which the caller must release, or nil if the operation was done in place. One
+// comparison per object checks that the other set is in the receiver's order, so that the two can be merged. If it is not, each of its objects
+// is added, removed or looked up one at a time, as it also is when it is so small that doing so beats a merge. The nodes of multi-level and
+// multi-leaf trees hold sub-collections rather than objects, so those trees always take the one at a time path.
+- (id) newTreeBySetOperation:(CHSetOperation)operation withSortedSet:(id<CHSortedSet>)otherSet inPlace:(BOOL)inPlace {
+	if (otherSet == nil)
+		CHNilArgumentException([self class], _cmd);
+	bool fMultiLevel = (m_fuiOptions & CHTreeOptionsMultiLevel) != 0;
+	bool fSubCollections = (m_fuiOptions & (CHTreeOptionsMultiLevel | CHTreeOptionsMultiLeaves)) != 0;
+	NSUInteger otherCount = [otherSet count], resultCount, index;
+	CHBinarySearchTree *result;
+	id *mine, *other, *merged;
+	
+	if (otherSet == (id) self) {
+		if (operation != CHSetOperationMinus)
+			return inPlace ? nil : [self copy];
+		return [self newTreeWithSortedObjects:NULL count:0];
 	}
-
-/* CJEC, 8-Jul-13: Support multi-level trees */
-- (void) addObject:(id)anObject {
-	return [self addObject: anObject nestingLevel: 0];
+	if (operation == CHSetOperationIntersect && !fSubCollections && CHSetOperationIsTiny(count, otherCount)) {
+		mine = malloc(kCHPointerSize * (count + 1));
+		if (mine == NULL)
+			[NSException raise:NSMallocException format:@"Unable to allocate %lu objects", (unsigned long) count];
+		CHBinaryTreeGetObjects(header->right, sentinel, mine);
+		resultCount = 0;
+		for (index = 0; index < count; index++)
+			if ([otherSet member:mine[index]] != nil)
+				mine[resultCount++] = mine[index];
+		result = [self newTreeWithSortedObjects:mine count:resultCount];
+		free(mine);
+		return result;
+	}
+	
+	// The other set's objects are copied before the receiver changes, since the other set may be a view of the receiver.
+	other = malloc(kCHPointerSize * (otherCount + 1));
+	if (other == NULL)
+		[NSException raise:NSMallocException format:@"Unable to allocate %lu objects", (unsigned long) otherCount];
+	BOOL sorted = !fSubCollections;
+	index = 0;
+	for (id anObject in otherSet) {
+		if (index == otherCount) {
+			free(other);
+			CHMutatedCollectionException([self class], _cmd);
+		}
+		if (index != 0 && sorted)
+			sorted = (CHSearchTreeCompareObjects(&m_sComparator, 0, fMultiLevel, other[index - 1], anObject) == NSOrderedAscending);
+		other[index++] = anObject;
+	}
+	otherCount = index;
+	if (!sorted || (inPlace && operation != CHSetOperationIntersect && CHSetOperationIsTiny(otherCount, count))) {
+		if (operation == CHSetOperationIntersect) {
+			result = [self newTreeWithSortedObjects:NULL count:0];
+			if (fSubCollections) {
+				// The receiver's own objects are kept, as when merging, since its members are sub-collections
+				for (id anObject in self)
+					if ([otherSet member:anObject] != nil)
+						[result addObject:anObject];
+			} else {
+				for (index = 0; index < otherCount; index++) {
+					id anObject = [self member:other[index]];
+					if (anObject != nil)
+						[result addObject:anObject];
+				}
+			}
+		} else {
+			result = inPlace ? self : [self copy];
+			for (index = 0; index < otherCount; index++) {
+				if (operation == CHSetOperationUnion)
+					[result addObject:other[index]];
+				else
+					[result removeObject:other[index]];
+			}
+		}
+		free(other);
+		return (result == self) ? nil : result;
+	}
+	if (operation == CHSetOperationIntersect && CHSetOperationIsTiny(otherCount, count)) {
+		resultCount = 0;
+		for (index = 0; index < otherCount; index++)
+			if ((other[resultCount] = [self member:other[index]]) != nil)
+				resultCount++;
+		result = [self newTreeWithSortedObjects:other count:resultCount];
+		free(other);
+		return result;
+	}
+	
+	mine = malloc(kCHPointerSize * (count + 1));
+	merged = malloc(kCHPointerSize * (count + otherCount + 1));
+	if (mine == NULL || merged == NULL) {
+		free(mine);
+		free(merged);
+		free(other);
+		[NSException raise:NSMallocException format:@"Unable to allocate %lu objects", (unsigned long) (count + otherCount)];
+	}
+	CHBinaryTreeGetObjects(header->right, sentinel, mine);
+#if CHUsingDispatch
+	CHBinaryTreeParallelism parallelism;
+	if (CHBinaryTreeParallelismGet(count + otherCount, &parallelism)) {
+		CHSearchTreeComparator *comparator = &m_sComparator;
+		resultCount = CHBinaryTreeMergeParallel(comparator, fMultiLevel, mine, count, other, otherCount, merged, &parallelism,
+			^NSUInteger (id *mineSegment, NSUInteger mineCount, id *otherSegment, NSUInteger otherSegmentCount, id *out) {
+				return CHSetOperationMerge(operation, comparator, fMultiLevel, mineSegment, mineCount, otherSegment, otherSegmentCount, out);
+			});
+	} else
+#endif	/* CHUsingDispatch */
+		resultCount = CHSetOperationMerge(operation, &m_sComparator, fMultiLevel, mine, count, other, otherCount, merged);
+	free(mine);
+	free(other);
+	result = [self newTreeWithSortedObjects:merged count:resultCount];
+	free(merged);
+	return result;
 }
 
-/* CJEC, 8-Jul-13: Support multi-level trees */
-- (void) removeObject: (id) a_po nestingLevel: (unsigned int) a_uiNestingLevel
-	{
-	(void) a_po;						/* CJEC, 8-Jul-13: Avoid unused parameter compiler warning */
-	(void) a_uiNestingLevel;			/* CJEC, 8-Jul-13: Avoid unused parameter compiler warning */
-	CHUnsupportedOperationException ([self class], _cmd);
+// An in-place result is swapped in, and the receiver's old nodes are freed with the temporary tree that takes them.
+- (void) applySetOperation:(CHSetOperation)operation withSortedSet:(id<CHSortedSet>)otherSet {
+	CHBinarySearchTree *result = [self newTreeBySetOperation:operation withSortedSet:otherSet inPlace:YES];
+	if (result != nil) {
+		[self exchangeContentsWithTree:result];
+		[result release];
 	}
+}
 
-/* CJEC, 8-Jul-13: Support multi-level trees */
-- (void) removeObject:(id)element {
-	[self removeObject: element nestingLevel: 0];
+- (void) unionWithSortedSet:(id<CHSortedSet>)otherSortedSet {
+	[self applySetOperation:CHSetOperationUnion withSortedSet:otherSortedSet];
 }
 
-@end
+- (void) intersectWithSortedSet:(id<CHSortedSet>)otherSortedSet {
+	[self applySetOperation:CHSetOperationIntersect withSortedSet:otherSortedSet];
+}
 
-@implementation CHBinarySearchTree
+- (void) minusSortedSet:(id<CHSortedSet>)otherSortedSet {
+	[self applySetOperation:CHSetOperationMinus withSortedSet:otherSortedSet];
+}
 
-- (void) dealloc {
-	[self removeAllObjects];
-	free(header);
-	free(sentinel);
-	[super dealloc];
+- (id) setByUnioningWithSortedSet:(id<CHSortedSet>)otherSortedSet {
+	return [[self newTreeBySetOperation:CHSetOperationUnion withSortedSet:otherSortedSet inPlace:NO] autorelease];
 }
 
-// This is the designated initializer for CHBinarySearchTree, CHBinarySearchTree and all its derived classes
-// Only to be called from concrete child classes to initialize shared variables.
-// CJEC, 1-Jul-13: New designated intialiser specifies options from CHTreeOptions
-- (id) initWithTreeOptions: (unsigned int) a_fuiOptions {
-	bool	fOK;
-	
-	self = [super initWithTreeOptions: a_fuiOptions];
-	fOK = (self != nil);
-	if (fOK)
-		{
-		m_fuiOptions = a_fuiOptions;
-		count = 0;
-		mutations = 0;
-		sentinel = CHCreateBinaryTreeNodeWithObject (nil);
-		sentinel -> right = sentinel;
-		sentinel -> left = sentinel;
-		header = CHCreateBinaryTreeNodeWithObject ([CHSearchTreeHeaderObject object]);
-		header -> right = sentinel;
-		header -> left = sentinel;
-		fOK = ((id) sentinel != nil) && ((id) header != nil);	/* CJEC, 13-Feb-15: Add checks to ensure successful initialisation */
-		}
-	if (!fOK)
-		{
-		[self release];						/* CJEC, 12-Feb-15: Avoid memory leak when initialisation fails */
-		self = nil;
-		}
-	return self;
+- (id) setByIntersectingWithSortedSet:(id<CHSortedSet>)otherSortedSet {
+	return [[self newTreeBySetOperation:CHSetOperationIntersect withSortedSet:otherSortedSet inPlace:NO] autorelease];
 }
 
-/* CJEC, 12-Feb-15: Read-only accessor to the options flags
-*/
-- (unsigned int)	GetOptions
-	{
-	return m_fuiOptions;
-	}
+- (id) setByMinusingSortedSet:(id<CHSortedSet>)otherSortedSet {
+	return [[self newTreeBySetOperation:CHSetOperationMinus withSortedSet:otherSortedSet inPlace:NO] autorelease];
+}
+
+#pragma mark Freezing
+
+- (CHFrozenSortedSet*) freeze {
+	id *objects = malloc(kCHPointerSize * (count + 1));
+	if (objects == NULL)
+		[NSException raise:NSMallocException format:@"Unable to allocate %lu objects", (unsigned long) count];
+	CHBinaryTreeGetObjects(header->right, sentinel, objects);
+	CHFrozenSortedSet *frozen = [[CHFrozenSortedSet alloc] initWithSortedObjects:objects count:count comparator:&m_sComparator options:m_fuiOptions];
+	free(objects);
+	return [frozen autorelease];
+}
 
 #pragma mark <NSCoding>
 
@@ -803,6 +3936,7 @@ CHBinaryTreeNode* CHCreateBinaryTreeNodeWithObject(id anObject) {
 	{
 	bool			fAllowsKeyCoding;
 	int				fiOptions;
+	int				iComparatorKind;
 	NSEnumerator *	poEnumerator;
 	id				po;
 	NSUInteger		uiCount;
@@ -811,10 +3945,14 @@ CHBinaryTreeNode* CHCreateBinaryTreeNodeWithObject(id anObject) {
 	fAllowsKeyCoding = [a_poCoder allowsKeyedCoding];
 	fiOptions = m_fuiOptions;
 	cObjects = count;
+	iComparatorKind = m_sComparator.eKind;
+	if (iComparatorKind != CHComparatorKindSelector)	/* A comparator block or function cannot be archived, so the tree could not be decoded */
+		CHUnsupportedOperationException ([self class], _cmd);
 	if (fAllowsKeyCoding)
 		{
 		[a_poCoder encodeInt: fiOptions forKey: @"options"];
 		[a_poCoder encodeInteger: cObjects forKey: @"count"];
+		[a_poCoder encodeInt: iComparatorKind forKey: @"comparatorKind"];
 		}
     else 
 		{
@@ -839,6 +3977,179 @@ CHBinaryTreeNode* CHCreateBinaryTreeNodeWithObject(id anObject) {
 #pragma mark <NSCopying> methods
 
 #pragma mark <NSFastEnumeration>
+
+// Between calls, the next node to enumerate is kept as the directions taken from the root to reach it, one bit for each level, so that no stack needs
+// to be saved, and nothing needs to be freed if the caller stops early. A path too long for the bits is found again by searching for the node's object.
+// The mutation count when the enumeration started is kept in extra[2], since a caller calling directly may not check mutationsPtr between calls.
+#define kCHFastEnumerationPathWords		2		/* extra [0] and extra [1] */
+#define kCHFastEnumerationPathBits		(kCHFastEnumerationPathWords * sizeof (unsigned long) * CHAR_BIT)
+#define kCHFastEnumerationBitsPerWord	(sizeof (unsigned long) * CHAR_BIT)
+
+enum {
+	kCHFastEnumerationStart = 0,		/* The first call */
+	kCHFastEnumerationDone,				/* Every object has been enumerated */
+	kCHFastEnumerationResumePath,		/* extra [4] is the depth of the next node, and extra [0] and extra [1] the path to it */
+	kCHFastEnumerationResumeObject		/* extra [0] is the object of the next node, which the tree retains */
+};
+
+// Replaces the path on the stack, from the root to a node, with the path to the node's in-order successor, or empties the stack if it has none.
+// Over a whole enumeration, each link is followed once down and once up, so each step is O(1) amortized.
+#define CHBinaryTreePath_NEXT(sentinel) { \
+	CHBinaryTreeNode *pathNode = CHBinaryTreeStack_TOP; \
+	if (pathNode->right != (sentinel)) { \
+		pathNode = pathNode->right; \
+		CHBinaryTreeStack_PUSH(pathNode); \
+		while (pathNode->left != (sentinel)) { \
+			pathNode = pathNode->left; \
+			CHBinaryTreeStack_PUSH(pathNode); \
+		} \
+	} else { \
+		do { \
+			pathNode = CHBinaryTreeStack_POP(); \
+		} while (stackSize > 0 && CHBinaryTreeStack_TOP->right == pathNode); \
+	} \
+}
+
+// With CHTreeOptionsMultiLevel, the objects of a sub-collection, and of any sub-collections within it, are enumerated in place of the sub-collection.
+// Each nesting level has a frame, allocated when the enumeration first reaches that level and then reused by every later sub-collection at that level.
+// There is no call to say that the caller has stopped early, so the frames belong to an autoreleased CHMultiLevelFrameOwner recorded in extra[3],
+// and a loop that breaks out part way through a sub-collection leaks nothing.
+#define kCHMultiLevelFrameBufferSize	16
+
+typedef struct CHMultiLevelFrame {
+	struct CHMultiLevelFrame *	pOuter;			/* The frame of the enclosing sub-collection, or NULL at the first nesting level */
+	struct CHMultiLevelFrame *	pInner;			/* A frame kept for the next nesting level, or NULL */
+	id							poCollection;	/* The sub-collection being enumerated, which is retained by the collection that contains it */
+	CHBinaryTreeNode *			pSentinel;		/* For a sub-tree, its sentinel, and otherwise NULL */
+	CHBinaryTreeNode **			apNode;			/* For a sub-tree, the path from its root to its next node */
+	NSUInteger					cNodes;
+	NSUInteger					cNodesCapacity;
+	NSFastEnumerationState		sState;			/* For any other sub-collection, its own fast enumeration */
+	unsigned long				ulMutations;	/* The sub-collection's mutation count when it was first asked for objects */
+	bool						fStarted;		/* Set once the sub-collection has been asked for objects, and ulMutations is valid */
+	NSUInteger					uiItem;			/* The next of the cItems objects at sState.itemsPtr */
+	NSUInteger					cItems;
+	id							apoBuffer [kCHMultiLevelFrameBufferSize];
+} CHMultiLevelFrame;
+
+/* Push the near spine of a sub-tree onto its frame's path
+*/
+static void	CHMultiLevelFramePushLeft (CHMultiLevelFrame * a_pFrame, CHBinaryTreeNode * a_pNode)
+	{
+	while (a_pNode != a_pFrame -> pSentinel)
+		{
+		if (a_pFrame -> cNodes == a_pFrame -> cNodesCapacity)
+			{
+			a_pFrame -> cNodesCapacity = (a_pFrame -> cNodesCapacity == 0) ? kCHBinaryTreeStackInlineSize : a_pFrame -> cNodesCapacity * 2;
+			a_pFrame -> apNode = realloc (a_pFrame -> apNode, kCHPointerSize * a_pFrame -> cNodesCapacity);
+			}
+		a_pFrame -> apNode [a_pFrame -> cNodes ++] = a_pNode;
+		a_pNode = a_pNode -> left;
+		}
+	}
+
+/* Take the frame for the next nesting level inside a_pFrame, or for the first nesting level if a_pFrame is NULL, and start it enumerating a_poCollection.
+	A sub-tree is walked node by node, from a_pRoot to a_pSentinel; any other sub-collection is enumerated through its own NSFastEnumeration.
+	*a_ppFrames is the frame for the first nesting level, created when first needed
+*/
+static CHMultiLevelFrame *	CHMultiLevelFramePush (CHMultiLevelFrame ** a_ppFrames, CHMultiLevelFrame * a_pFrame, id a_poCollection, CHBinaryTreeNode * a_pRoot, CHBinaryTreeNode * a_pSentinel)
+	{
+	CHMultiLevelFrame *	pFrame;
+
+	pFrame = (a_pFrame == NULL) ? *a_ppFrames : a_pFrame -> pInner;
+	if (pFrame == NULL)
+		{
+		pFrame = calloc (1, sizeof (CHMultiLevelFrame));
+		pFrame -> pOuter = a_pFrame;
+		if (a_pFrame == NULL)
+			*a_ppFrames = pFrame;
+		else
+			a_pFrame -> pInner = pFrame;
+		}
+	pFrame -> poCollection = a_poCollection;
+	pFrame -> pSentinel = a_pSentinel;
+	pFrame -> cNodes = 0;
+	pFrame -> uiItem = 0;
+	pFrame -> cItems = 0;
+	pFrame -> fStarted = false;
+	memset (&pFrame -> sState, 0, sizeof (NSFastEnumerationState));
+	if (a_pSentinel != NULL)
+		CHMultiLevelFramePushLeft (pFrame, a_pRoot);
+	return pFrame;
+	}
+
+/* Return the next object of a frame's sub-collection, or nil once it has no more
+*/
+static id	CHMultiLevelFrameNext (CHMultiLevelFrame * a_pFrame)
+	{
+	CHBinaryTreeNode *	pNode;
+	id					po;
+
+	if (a_pFrame -> pSentinel != NULL)		/* A sub-tree, whose successor is found in the same way as for the tree itself */
+		{
+		if (a_pFrame -> cNodes == 0)
+			return nil;
+		pNode = a_pFrame -> apNode [a_pFrame -> cNodes - 1];
+		po = pNode -> object;
+		if (pNode -> right != a_pFrame -> pSentinel)
+			CHMultiLevelFramePushLeft (a_pFrame, pNode -> right);
+		else
+			{
+			do
+				pNode = a_pFrame -> apNode [-- a_pFrame -> cNodes];
+			while ((a_pFrame -> cNodes > 0) && (a_pFrame -> apNode [a_pFrame -> cNodes - 1] -> right == pNode));
+			}
+		return po;
+		}
+	if (a_pFrame -> uiItem == a_pFrame -> cItems)
+		{
+		a_pFrame -> cItems = [a_pFrame -> poCollection countByEnumeratingWithState: &a_pFrame -> sState objects: a_pFrame -> apoBuffer count: kCHMultiLevelFrameBufferSize];
+		a_pFrame -> uiItem = 0;
+		if (a_pFrame -> cItems == 0)
+			return nil;
+		if (!a_pFrame -> fStarted)
+			{
+			a_pFrame -> ulMutations = *a_pFrame -> sState.mutationsPtr;
+			a_pFrame -> fStarted = true;
+			}
+		else
+			if (*a_pFrame -> sState.mutationsPtr != a_pFrame -> ulMutations)
+				CHMutatedCollectionException ([a_pFrame -> poCollection class], @selector (countByEnumeratingWithState:objects:count:));
+		}
+	return a_pFrame -> sState.itemsPtr [a_pFrame -> uiItem ++];
+	}
+
+/* Free the frames for every nesting level
+*/
+static void	CHMultiLevelFramesFree (CHMultiLevelFrame * a_pFrames)
+	{
+	CHMultiLevelFrame *	pFrame;
+
+	while (a_pFrames != NULL)
+		{
+		pFrame = a_pFrames;
+		a_pFrames = pFrame -> pInner;
+		free (pFrame -> apNode);
+		free (pFrame);
+		}
+	}
+
+/* Whether an object of a multi-level tree is a sub-collection to be enumerated in its place. a_ppClassLeaf remembers the last class found not to be one,
+	so that a run of plain objects costs one class comparison each
+*/
+static inline bool	CHMultiLevelIsCollection (id a_po, Class * a_ppClassLeaf)
+	{
+	Class	pClass;
+
+	pClass = object_getClass (a_po);
+	if (pClass == *a_ppClassLeaf)
+		return false;
+	if ([a_po respondsToSelector: @selector (count)])
+		return true;
+	*a_ppClassLeaf = pClass;
+	return false;
+	}
+
 // CJEC, 5-Jul-13: Support multi-level trees
 // CJEC, 5-Jul-13: Note: Beware temporary objects inside -[NSFastEnumeration countByEnumeratingWithState: objects: count:]. See http://www.mikeash.com/pyblog/friday-qa-2010-04-16-implementing-fast-enumeration.html
 - (NSUInteger) countByEnumeratingWithState:(NSFastEnumerationState*)state
@@ -846,122 +4157,130 @@ CHBinaryTreeNode* CHCreateBinaryTreeNodeWithObject(id anObject) {
                                      count:(NSUInteger)len
 {
 	NSUInteger			batchCount = 0;
+	NSUInteger			uiDepth;
+	NSUInteger			ui;
 	id					po;
 	CHBinaryTreeNode *	current;
+	NSComparisonResult	eComparisonResult;
+	bool				fAdvance;
+	bool				fMultiLevel;
+	CHMultiLevelFrameOwner *	pOwner;		/* Created when the enumeration first reaches a sub-collection */
+	CHMultiLevelFrame *	pFrame;				/* The frame of the innermost sub-collection being enumerated, or NULL at the top level */
+	Class				pClassLeaf;
 	CHBinaryTreeStack_DECLARE();
 	
-	// For the first call, start at leftmost node, otherwise the last saved node
-	if (state->state == 0) {
-		state->itemsPtr = stackbuf;
+	if (state->state == kCHFastEnumerationDone)
+		return 0;
+	// The saved path or object is only meaningful in the tree it was taken from
+	if (state->state != kCHFastEnumerationStart && state->extra[2] != mutations)
+		CHMutatedCollectionException([self class], _cmd);
+	// Rebuild the path to the next node on the stack, which lasts only for this call
+	fMultiLevel = (m_fuiOptions & CHTreeOptionsMultiLevel) != 0;
+	CHBinaryTreeStack_INIT();
+	current = header->right;
+	if (state->state == kCHFastEnumerationStart) {
 		state->mutationsPtr = &mutations;
-		current = header ->right;
-		CHBinaryTreeStack_INIT();
+		state->extra[2] = mutations;
+		state->extra[3] = 0;
+		while (current != sentinel) {
+			CHBinaryTreeStack_PUSH(current);
+			current = current->left;
+		}
 	}
-	else if (state->state == 1) {
-		stack = (CHBinaryTreeNode * *) state -> extra [0];
-		CHBinaryTreeStack_FREE (stack);	/* CJEC, 5-Jul-13: Put all clean-up code in the termination call */
-		if ((id) state -> extra [3] != nil)
-			[(id) state -> extra [3] release];	/* CJEC, 5-Jul-13: Release the object enumerator, if there is one */
-		return 0;		
+	else if (state->state == kCHFastEnumerationResumePath) {
+		uiDepth = (NSUInteger) state->extra[4];
+		for (ui = 0; current != sentinel; ui++) {
+			CHBinaryTreeStack_PUSH(current);
+			if (ui == uiDepth)
+				break;
+			current = current->link[(state->extra[ui / kCHFastEnumerationBitsPerWord] >> (ui % kCHFastEnumerationBitsPerWord)) & 1];
+		}
 	}
 	else {
-		current = (CHBinaryTreeNode*) state->state;
-		stack = (CHBinaryTreeNode**) state->extra[0];
-		stackCapacity = (NSUInteger) state->extra[1];
-		stackSize = (NSUInteger) state->extra[2];
-	}
-	NSAssert((id) current != nil, @"Illegal state, current should never be nil!");
-	if ((id) state -> extra [3] != nil)		/* CJEC, 5-Jul-13: Already enumerating a sub-collection? */
-		{
-		NSLog (@"Current node %p. Trying to finish object enumeration", current);
-		do									/* CJEC, 5-Jul-13: TODO: Use state -> extra [4] to protect against a mutation of state -> extra [3] */
-			{
-			if (batchCount < len)			/* Use the object enumerator to squeeze as many objects into the limit as possible */
-				{
-				po = [(id) state -> extra [3] nextObject];
-				stackbuf [batchCount] = po;
-				batchCount ++;
-				}
-			}
-		while ((po != nil) && (batchCount < len));
-		if (po != nil)						/* Not finished the enumeration? */
-			return batchCount;				/* Can't advance through the tree yet */
-		else
-			{
-			NSLog (@"Current node %p. Finished object enumeration", current);
-			[(id) state -> extra [3] release];	/* Release the object enumerator */
-			state -> extra [3] = (uintptr_t) nil;	/* Mark it deleted so we know we're not in object enumeration mode */
-			current = current -> right;		/* Advance to point to the next object, and continue through the tree */
-			}
-		}
-	// Accumulate objects from the tree until we reach all nodes or the maximum
-	while ( (current != sentinel || stackSize > 0) && batchCount < len) {
+		po = (id) state->extra[0];
 		while (current != sentinel) {
 			CHBinaryTreeStack_PUSH(current);
-			current = current->left;
+			if ((eComparisonResult = CHSearchTreeCompareObjects(&m_sComparator, 0, fMultiLevel, current->object, po)) == NSOrderedSame)
+				break;
+			current = current->link[eComparisonResult == NSOrderedAscending]; // R on YES
 		}
-		current = CHBinaryTreeStack_POP(); // Save top node for return value
-		NSAssert((id) current != nil, @"Illegal state, current should never be nil!");
-		if (m_fuiOptions & CHTreeOptionsMultiLevel)	/* CJEC, 5-Jul-13: Support multi-level collections */
-			{
-			if (![current -> object respondsToSelector: @selector (count)])	
-				{							/* CJEC, 5-Jul-13: Not a collection object, use original code */
-				stackbuf [batchCount] = current -> object;
-				batchCount ++;
-				current = current -> right;	/* Advance to point to the next object, next time we come round */
-				}
-			else
-				{
-				NSUInteger	cObjects;
-				
-				cObjects = [current -> object count];
-				if (cObjects + batchCount < len)	/* Ensure that the sub-collection(s)' objects can fit in the stack, if so use fast enumeration which is almost always quicker and has mutation protection */
-					{
-					for (po in current -> object)	/* (Fast) enumerate sub-collection. Note: Assume that it supports fast enumeration */
-						{
-						stackbuf [batchCount] = po;
-						batchCount ++;
-						}
-					current = current -> right;	/* Advance to point to the next object, next time we come round */
-					}
-				else						/* If the sub-collection count won't fit, we can't use fast enumeration on it */
-					{
-					NSLog (@"Current node %p. Could not fit %lu sub-objects in %lu limit with with fast enumeration. Using object enumeration", current, (unsigned long) cObjects, (unsigned long) len);
-					NSAssert ((id) state -> extra [3] != nil, @"Already using an object enumerator?");	/* Note: Assume sub-collection supports objectEnumerator */
-					state -> extra [3] = (uintptr_t) ((id __strong) [[current -> object objectEnumerator] retain]);	/* Note: Retain it so we don't get messed up by autorelease pools */
-					do						/* CJEC, 5-Jul-13: TODO: Use state -> extra [4] to protect against a mutation of state -> extra [3] */
-						{
-						if (batchCount < len)	/* Use the object enumerator to squeeze as many objects into the limit as possible */
-							{
-							po = [(id) state -> extra [3] nextObject];
-							stackbuf [batchCount] = po;
-							batchCount ++;
-							}
-						}
-					while ((po != nil) && (batchCount < len));
-					NSAssert (po != nil, @"Reached end of enumeration, but didn't use fast enumeration");
-					break;					/* If the sub-collection count did not fit, don't advance the current pointer, and stop looping */
-					}
-				}
+	}
+	if (state->state != kCHFastEnumerationStart && current == sentinel) {
+		// The path or object no longer leads to a node, so the tree was changed without counting a mutation
+		CHBinaryTreeStack_FREE(stack);
+		CHMutatedCollectionException([self class], _cmd);
+	}
+	state->itemsPtr = stackbuf;
+	
+	// A sub-collection left part way through by the last call is continued from its frames, and the node that holds it is on top of the stack
+	pOwner = (CHMultiLevelFrameOwner *) state->extra[3];
+	pFrame = (pOwner != nil) ? pOwner->pFrame : NULL;
+	pClassLeaf = Nil;
+	fAdvance = false;
+	
+	// Accumulate objects from the tree, and from within its sub-collections, until we reach all nodes or the maximum
+	while (stackSize > 0) {
+		if (fAdvance) {
+			CHBinaryTreePath_NEXT(sentinel);
+			fAdvance = false;
+			continue;
+		}
+		if (batchCount == len)
+			break;
+		if (pFrame != NULL) {
+			po = CHMultiLevelFrameNext(pFrame);
+			if (po == nil) {
+				pFrame = pFrame->pOuter;
+				fAdvance = (pFrame == NULL);	// Finished the node's sub-collection
+			}
+			else if (CHMultiLevelIsCollection(po, &pClassLeaf)) {
+				if ([po isKindOfClass:[CHBinarySearchTree class]])
+					pFrame = CHMultiLevelFramePush(&pOwner->pFrames, pFrame, po, ((CHBinarySearchTree *) po)->header->right, ((CHBinarySearchTree *) po)->sentinel);
+				else
+					pFrame = CHMultiLevelFramePush(&pOwner->pFrames, pFrame, po, NULL, NULL);
 			}
-		else								/* CJEC, 5-Jul-13: Multi-level collections not enabled, use original code */
-			{								
-			stackbuf [batchCount] = current -> object;
-			batchCount ++;
-			current = current -> right;
+			else
+				stackbuf[batchCount++] = po;
+			continue;
+		}
+		po = CHBinaryTreeStack_TOP->object;
+		if (fMultiLevel && CHMultiLevelIsCollection(po, &pClassLeaf)) {
+			if (pOwner == nil) {
+				pOwner = [[[CHMultiLevelFrameOwner alloc] init] autorelease];
+				state->extra[3] = (uintptr_t) pOwner;
 			}
+			if ([po isKindOfClass:[CHBinarySearchTree class]])
+				pFrame = CHMultiLevelFramePush(&pOwner->pFrames, NULL, po, ((CHBinarySearchTree *) po)->header->right, ((CHBinarySearchTree *) po)->sentinel);
+			else
+				pFrame = CHMultiLevelFramePush(&pOwner->pFrames, NULL, po, NULL, NULL);
+		}
+		else {
+			stackbuf[batchCount++] = po;
+			fAdvance = true;
+		}
 	}
 	
-	if (current == sentinel && stackSize == 0) {
-		state->extra[0] = (uintptr_t) stack;
-		state->state = 1; // used as a termination flag
+	// Remember which sub-collection, if any, is part way through
+	if (pOwner != nil)
+		pOwner->pFrame = pFrame;
+	
+	// Save the path to the next node, or mark the enumeration finished
+	if (stackSize == 0)
+		state->state = kCHFastEnumerationDone;
+	else if (stackSize - 1 <= kCHFastEnumerationPathBits) {
+		for (ui = 0; ui < kCHFastEnumerationPathWords; ui++)
+			state->extra[ui] = 0;
+		for (ui = 0; ui + 1 < stackSize; ui++)
+			if (stack[ui + 1] == stack[ui]->right)
+				state->extra[ui / kCHFastEnumerationBitsPerWord] |= 1UL << (ui % kCHFastEnumerationBitsPerWord);
+		state->extra[4] = (uintptr_t) (stackSize - 1);
+		state->state = kCHFastEnumerationResumePath;
 	}
 	else {
-		state->state    = (uintptr_t) current;
-		state->extra[0] = (uintptr_t) stack;
-		state->extra[1] = (uintptr_t) stackCapacity;
-		state->extra[2] = (uintptr_t) stackSize;
+		state->extra[0] = (uintptr_t) CHBinaryTreeStack_TOP->object;
+		state->state = kCHFastEnumerationResumeObject;
 	}
+	CHBinaryTreeStack_FREE(stack);
 	return batchCount;
 }
 
@@ -997,9 +4316,45 @@ CHBinaryTreeNode* CHCreateBinaryTreeNodeWithObject(id anObject) {
 	return count;
 }
 
+#if defined (__BLOCKS__)
+/* Walks the nodes directly, or hands subtrees to workers. Multi-level trees enumerate an array of their objects, as the abstract class does, since their
+	sub-collections are expanded in place
+*/
+- (void)	enumerateObjectsWithOptions: (NSEnumerationOptions) a_fuiOptions usingBlock: (void (^) (id obj, NSUInteger idx, BOOL * stop)) a_pfnBlock
+	{
+	unsigned long	ulMutations;
+	NSUInteger		uiIndex;
+	BOOL			fStop;
+	bool			fReverse;
+
+	if (a_pfnBlock == nil)
+		CHNilArgumentException ([self class], _cmd);
+	if (m_fuiOptions & (CHTreeOptionsMultiLevel | CHTreeOptionsMultiLeaves))
+		{
+		[super enumerateObjectsWithOptions: a_fuiOptions usingBlock: a_pfnBlock];
+		return;
+		}
+	ulMutations = mutations;
+#if CHUsingDispatch
+	if ((a_fuiOptions & NSEnumerationConcurrent) &&
+		CHBinaryTreeEnumerateParallel (header -> right, sentinel, count, (m_fuiOptions & CHTreeOptionsOrderStatistics) != 0, a_pfnBlock))
+		{
+		if (mutations != ulMutations)
+			CHMutatedCollectionException ([self class], _cmd);
+		return;
+		}
+#endif	/* CHUsingDispatch */
+	fReverse = (a_fuiOptions & NSEnumerationReverse) != 0;
+	uiIndex = fReverse ? count - 1 : 0;
+	fStop = NO;
+	if (!CHBinaryTreeEnumerateSubtree (header -> right, sentinel, fReverse, &uiIndex, a_pfnBlock, &mutations, ulMutations, &fStop, NULL) && (mutations != ulMutations))
+		CHMutatedCollectionException ([self class], _cmd);
+	}
+#endif	/* defined (__BLOCKS__) */
+
 // CJEC, 1-Jul-13: Support multi-level trees */
 - (id) firstObject {
-	sentinel ->object = nil;
+	CHBinaryTreeSentinelClear(sentinel);
 	CHBinaryTreeNode *current = header ->right;
 	while (current->left != sentinel)
 		current = current->left;
@@ -1022,7 +4377,7 @@ CHBinaryTreeNode* CHCreateBinaryTreeNodeWithObject(id anObject) {
 
 // CJEC, 1-Jul-13: Support multi-level trees */
 - (id) lastObject {
-	sentinel ->object = nil;
+	CHBinaryTreeSentinelClear(sentinel);
 	CHBinaryTreeNode *current = header ->right;
 	while (current->right != sentinel)
 		current = current->right;
@@ -1047,20 +4402,29 @@ CHBinaryTreeNode* CHCreateBinaryTreeNodeWithObject(id anObject) {
 - (id)	member: (id) a_po nestingLevel: (unsigned int) a_uiNestingLevel options: (unsigned int) a_fuiOptions
 	{
 	CHBinaryTreeNode *	pBinaryTreeNodeCurrent;
-	NSInvocation *		poInvocationCompare;
 	NSComparisonResult	eComparisonResult;
+	bool				fMultiLevel;
 	
 	if (a_po == nil)
 		return nil;
 
-	sentinel -> object = a_po; // Make sure the target value is always "found"
 	pBinaryTreeNodeCurrent = header -> right;
-	poInvocationCompare = [[self class] InvocationCompare: a_po nestingLevel: a_uiNestingLevel];	/* Note: Technically, we should use the other object as we're sending the compare*: method to it. But compare*: must be symmetric so we use the argument because we already have it */
-	eComparisonResult = [self Compare: poInvocationCompare target: pBinaryTreeNodeCurrent -> object argument: a_po];
-	while (eComparisonResult != NSOrderedSame)
+	fMultiLevel = (m_fuiOptions & CHTreeOptionsMultiLevel) != 0;
+	if (m_fuiOptions & CHTreeOptionsPersistent)	/* The sentinel is shared with copies of the tree, which other threads may be searching */
+		{
+		while ((pBinaryTreeNodeCurrent != sentinel) &&
+		       ((eComparisonResult = CHSearchTreeCompareObjects (&m_sComparator, a_uiNestingLevel, fMultiLevel, pBinaryTreeNodeCurrent -> object, a_po)) != NSOrderedSame))
+			pBinaryTreeNodeCurrent = pBinaryTreeNodeCurrent -> link [eComparisonResult == NSOrderedAscending]; // R on YES
+		}
+	else
 		{
-		pBinaryTreeNodeCurrent = pBinaryTreeNodeCurrent -> link [eComparisonResult == NSOrderedAscending]; // R on YES
-		eComparisonResult = [self Compare: poInvocationCompare target: pBinaryTreeNodeCurrent -> object argument: nil];	/* Note: Argument hasn't changed so don't need to set it */
+		sentinel -> object = a_po; // Make sure the target value is always "found"
+		eComparisonResult = CHSearchTreeCompareObjects (&m_sComparator, a_uiNestingLevel, fMultiLevel, pBinaryTreeNodeCurrent -> object, a_po);
+		while (eComparisonResult != NSOrderedSame)
+			{
+			pBinaryTreeNodeCurrent = pBinaryTreeNodeCurrent -> link [eComparisonResult == NSOrderedAscending]; // R on YES
+			eComparisonResult = CHSearchTreeCompareObjects (&m_sComparator, a_uiNestingLevel, fMultiLevel, pBinaryTreeNodeCurrent -> object, a_po);
+			}
 		}
 	if (pBinaryTreeNodeCurrent == sentinel)
 		return nil;
@@ -1097,24 +4461,11 @@ CHBinaryTreeNode* CHCreateBinaryTreeNodeWithObject(id anObject) {
 	++mutations;
 	count = 0;
 	
-	// Remove each node from the tree and release the object it points to.
-	// Use pre-order (depth-first) traversal for simplicity and performance.
-	CHBinaryTreeStack_DECLARE();
-	CHBinaryTreeStack_INIT();
-	CHBinaryTreeStack_PUSH(header->right);
-	
-	CHBinaryTreeNode *current;
-	while ((current = CHBinaryTreeStack_POP())) {
-		if (current->right != sentinel)
-			CHBinaryTreeStack_PUSH(current->right);
-		if (current->left != sentinel)
-			CHBinaryTreeStack_PUSH(current->left);
-		[current->object release];
-		free(current);
-	}
-	free(stack); // declared in CHBinaryTreeStack_DECLARE() macro
+	// Release the object in each node, then return whole slabs of nodes at once.
+	// Scanning the slabs in address order needs no stack and touches memory sequentially.
+	CHBinaryTreeNodePoolRemoveAll(&m_sNodePool, header->right, sentinel, true);
 	header->right = sentinel; // With GC, this is sufficient to unroot the tree.
-	sentinel->object = nil; // Make sure we don't accidentally retain an object.
+	CHBinaryTreeSentinelClear(sentinel); // Make sure we don't accidentally retain an object.
 }
 
 /* CJEC, 2-Jul-13: Support multi-level collections by using a different compare*: method for each nesting level */
@@ -1123,26 +4474,40 @@ CHBinaryTreeNode* CHCreateBinaryTreeNodeWithObject(id anObject) {
 	NSEnumerator *		poEnumerator;
 	id					po;
 	id <CHSortedSet>	poSortedSetSubset;
-	NSInvocation *		poInvocationCompare;
 	NSComparisonResult	eComparisonResult;
+	bool				fMultiLevel;
+	CHBinaryTreeRange	sRange;
 	
 	// If both parameters are nil, return a copy containing all the objects.
 	if (a_poStart == nil && a_poEnd == nil)
 		return [[self copy] autorelease];
+	fMultiLevel = (m_fuiOptions & CHTreeOptionsMultiLevel) != 0;
+	if (!fMultiLevel && (a_uiNestingLevel == 0) &&
+		((a_poStart == nil) || (a_poEnd == nil) || (CHSearchTreeCompare (&m_sComparator, a_poStart, a_poEnd) != NSOrderedDescending)))
+		{							/* A range in ascending order is returned as a live, read-only view of the receiver, rather than by copying its objects */
+		sRange.pHeader = header;
+		sRange.pSentinel = sentinel;
+		sRange.pComparator = &m_sComparator;
+		sRange.poLow = a_poStart;
+		sRange.poHigh = a_poEnd;
+		sRange.fExcludeLow = (a_fuiSubsetConstructionOptions & CHSubsetExcludeLowEndpoint) != 0;
+		sRange.fExcludeHigh = (a_fuiSubsetConstructionOptions & CHSubsetExcludeHighEndpoint) != 0;
+		return [[[CHBinarySearchTreeRangeView alloc] initWithTree: self range: &sRange mutationPointer: &mutations] autorelease];
+		}
 	poSortedSetSubset = [[[[self class] alloc] initWithTreeOptions: m_fuiOptions] autorelease];	/* CJEC, 5-Jul-13: FIXME: This could be more efficient. We should avoid allocating the subset unless we're going to use it, and we won't if the arguments' ordering is NSOrderedSame */
+	CHSearchTreeComparatorCopy (&((CHAbstractBinarySearchTree *) poSortedSetSubset) -> m_sComparator, &m_sComparator);	/* The subset orders its objects the same way */
 	if (count == 0)
 		return poSortedSetSubset;
-	poInvocationCompare = [[self class] InvocationCompare: ((a_poStart != nil) ? a_poStart : a_poEnd) nestingLevel: a_uiNestingLevel];	/* Note: Technically, we should use the other object as we're sending the compare*: method to it. But compare*: must be symmetric so we use the (non-nil) argument because we already have it */
 	if (a_poStart == nil)			// Start from the first object and add until we pass the end parameter.
 		{
 		poEnumerator = [self objectEnumeratorWithTraversalOrder: CHTraverseAscending options: 0];	/* Don't enumerate to leaf level */
 		po = [poEnumerator nextObject];
-		eComparisonResult = [self Compare: poInvocationCompare target: po argument: a_poEnd];
+		eComparisonResult = CHSearchTreeCompareObjects (&m_sComparator, a_uiNestingLevel, fMultiLevel, po, a_poEnd);
 		while ((po != nil) && (eComparisonResult != NSOrderedDescending))
 			{
 			[poSortedSetSubset addObject: po];
 			po = [poEnumerator nextObject];
-			eComparisonResult = [self Compare: poInvocationCompare target: po argument: nil];	/* Note: Argument hasn't changed so don't need to set it */
+			eComparisonResult = CHSearchTreeCompareObjects (&m_sComparator, a_uiNestingLevel, fMultiLevel, po, a_poEnd);
 			}
 		}
 	else
@@ -1150,17 +4515,17 @@ CHBinaryTreeNode* CHCreateBinaryTreeNodeWithObject(id anObject) {
 			{
 			poEnumerator = [self objectEnumeratorWithTraversalOrder: CHTraverseDescending options: 0];	/* Don't enumerate to leaf level */
 			po = [poEnumerator nextObject];
-			eComparisonResult = [self Compare: poInvocationCompare target: po argument: a_poStart];
+			eComparisonResult = CHSearchTreeCompareObjects (&m_sComparator, a_uiNestingLevel, fMultiLevel, po, a_poStart);
 			while ((po != nil) && (eComparisonResult != NSOrderedAscending))
 				{
 				[poSortedSetSubset addObject: po];
 				po = [poEnumerator nextObject];
-				eComparisonResult = [self Compare: poInvocationCompare target: po argument: nil];	/* Note: Argument hasn't changed so don't need to set it */
+				eComparisonResult = CHSearchTreeCompareObjects (&m_sComparator, a_uiNestingLevel, fMultiLevel, po, a_poStart);
 				}
 			}
 		else						/* We have non-nil start and end arguments. First, determine their ordering */
 			{
-			eComparisonResult = [self Compare: poInvocationCompare target: a_poStart argument: a_poEnd];
+			eComparisonResult = CHSearchTreeCompareObjects (&m_sComparator, a_uiNestingLevel, fMultiLevel, a_poStart, a_poEnd);
 			if (eComparisonResult == NSOrderedSame)
 				{
 				if (a_fuiSubsetConstructionOptions & CHSubsetForceSingleLevel)	/* Not traversing through the levels? */
@@ -1176,18 +4541,17 @@ CHBinaryTreeNode* CHCreateBinaryTreeNodeWithObject(id anObject) {
 					{
 					poEnumerator = [self objectEnumeratorWithTraversalOrder: CHTraverseAscending options: 0];	/* Don't enumerate to leaf level */
 					po = [poEnumerator nextObject];
-					eComparisonResult = [self Compare: poInvocationCompare target: po argument: a_poStart];
+					eComparisonResult = CHSearchTreeCompareObjects (&m_sComparator, a_uiNestingLevel, fMultiLevel, po, a_poStart);
 					while ((po != nil) && (eComparisonResult == NSOrderedAscending))
 						{
 						po = [poEnumerator nextObject];
-						eComparisonResult = [self Compare: poInvocationCompare target: po argument: nil];	/* Note: Argument hasn't changed so don't need to set it */
+						eComparisonResult = CHSearchTreeCompareObjects (&m_sComparator, a_uiNestingLevel, fMultiLevel, po, a_poStart);
 						}
-					[poInvocationCompare setArgument: &a_poEnd atIndex: 2];	/* Note: Skip past hidden target (index 0) and selector (index 1) arguments for our first argument. Arguments are not retained without [poInvocationCompare retainArguments] */
 					do
 						{
 						[poSortedSetSubset addObject: po];
 						po = [poEnumerator nextObject];
-						eComparisonResult = [self Compare: poInvocationCompare target: po argument: nil];	/* Note: Argument hasn't changed so don't need to set it */
+						eComparisonResult = CHSearchTreeCompareObjects (&m_sComparator, a_uiNestingLevel, fMultiLevel, po, a_poEnd);
 						}
 					while ((po != nil) && (eComparisonResult != NSOrderedDescending));
 					}
@@ -1195,21 +4559,21 @@ CHBinaryTreeNode* CHCreateBinaryTreeNodeWithObject(id anObject) {
 					{
 					poEnumerator = [self objectEnumeratorWithTraversalOrder: CHTraverseDescending options: 0];	/* Don't enumerate to leaf level */
 					po = [poEnumerator nextObject];
-					eComparisonResult = [self Compare: poInvocationCompare target: po argument: a_poStart];
+					eComparisonResult = CHSearchTreeCompareObjects (&m_sComparator, a_uiNestingLevel, fMultiLevel, po, a_poStart);
 					while ((po != nil) && (eComparisonResult != NSOrderedAscending))
 						{
 						[poSortedSetSubset addObject: po];
 						po = [poEnumerator nextObject];
-						eComparisonResult = [self Compare: poInvocationCompare target: po argument: nil];	/* Note: Argument hasn't changed so don't need to set it */
+						eComparisonResult = CHSearchTreeCompareObjects (&m_sComparator, a_uiNestingLevel, fMultiLevel, po, a_poStart);
 						}
 					poEnumerator = [self objectEnumeratorWithTraversalOrder: CHTraverseAscending options: 0];	/* Don't enumerate to leaf level */
 					po = [poEnumerator nextObject];
-					eComparisonResult = [self Compare: poInvocationCompare target: po argument: a_poEnd];
+					eComparisonResult = CHSearchTreeCompareObjects (&m_sComparator, a_uiNestingLevel, fMultiLevel, po, a_poEnd);
 					while ((po != nil) && (eComparisonResult != NSOrderedDescending))
 						{
 						[poSortedSetSubset addObject: po];
 						po = [poEnumerator nextObject];
-						eComparisonResult = [self Compare: poInvocationCompare target: po argument: nil];	/* Note: Argument hasn't changed so don't need to set it */
+						eComparisonResult = CHSearchTreeCompareObjects (&m_sComparator, a_uiNestingLevel, fMultiLevel, po, a_poEnd);
 						}
 					}
 			}
@@ -1234,7 +4598,7 @@ CHBinaryTreeNode* CHCreateBinaryTreeNodeWithObject(id anObject) {
 	CHBinaryTreeStack_DECLARE();
 	CHBinaryTreeStack_INIT();
 	
-	sentinel ->object = nil;
+	CHBinaryTreeSentinelClear(sentinel);
 	if (header ->right != sentinel)
 		CHBinaryTreeStack_PUSH(header ->right);	
 	while ((current = CHBinaryTreeStack_POP())) {
@@ -1262,7 +4626,7 @@ CHBinaryTreeNode* CHCreateBinaryTreeNodeWithObject(id anObject) {
 	} else {
 		NSString *leftChild, *rightChild;
 		NSUInteger sentinelCount = 0;
-		sentinel ->object = nil;
+		CHBinaryTreeSentinelClear(sentinel);
 		
 		CHBinaryTreeNode *current;
 		CHBinaryTreeStack_DECLARE();
@@ -15,6 +15,8 @@
  */
 
 #import "CHAbstractBinarySearchTree.h"
+#import "CHFrozenSortedSet.h"
+#import <objc/runtime.h>
 
 /**
  @file CHAbstractBinarySearchTree_Internal.h
@@ -35,12 +37,69 @@
 // This method determines the appearance of nodes in the graph produced by -dotGraphString, and may be overriden by subclasses. The default implementation creates an oval containing the value returned by -description for the object in the node.
 - (NSString*) dotGraphStringForNode:(CHBinaryTreeNode*)node;
 
+// This method sets the algorithm-specific field of each node placed by a balanced build from sorted input (see -initWithSortedArray:), and must be overridden by self-balancing subclasses. It is called after both children of the node have been built, with the heights of its left and right subtrees, its depth below the root (which is at depth 0) and the height of the whole tree. Every leaf of a built tree is on one of its last two levels, and a node with a single child always has a right child. During a parallel build, it is called on several threads at once for nodes in different subtrees, so it must only change the node it is given. The default implementation does nothing.
+- (void) setBalanceForBuiltNode:(CHBinaryTreeNode*)node
+                     leftHeight:(NSUInteger)leftHeight
+                    rightHeight:(NSUInteger)rightHeight
+                          depth:(NSUInteger)depth
+                     treeHeight:(NSUInteger)treeHeight;
+
+// These methods are used by -splitAtObject: and -joinWithTree:, and must be overridden by subclasses that support them. The default implementations raise CHUnsupportedOperationException. A rank is whatever measure of a subtree's height the subclass needs to join subtrees in time proportional to the difference in their ranks: the height for CHAVLTree, the black height for CHRedBlackTree, and zero for trees that need none. The sentinel has rank zero.
+
+// Returns the rank of the subtree rooted at node, in time proportional to its height.
+- (NSInteger) rankOfSubtree:(CHBinaryTreeNode*)node;
+
+// Returns the rank of node, given the rank of its child in direction dir, and sets *siblingRank to the rank of its other child. Must be called before the node is relinked.
+- (NSInteger) rankOfNode:(CHBinaryTreeNode*)node
+                   child:(int)dir
+                    rank:(NSInteger)childRank
+             siblingRank:(NSInteger*)siblingRank;
+
+// Links the subtrees rooted at left and right as the children of node, whose object is ordered after every object in left and before every object in right, rebalancing as needed. Returns the root of the joined tree and sets *rank to its rank. Subtree counts must be kept up to date if the tree was created with CHTreeOptionsOrderStatistics.
+- (CHBinaryTreeNode*) joinSubtree:(CHBinaryTreeNode*)left
+                             rank:(NSInteger)leftRank
+                         withNode:(CHBinaryTreeNode*)node
+                          subtree:(CHBinaryTreeNode*)right
+                             rank:(NSInteger)rightRank
+                       resultRank:(NSInteger*)rank;
+
+// Returns whether the class supports CHTreeOptionsPersistent, which needs insertion and removal algorithms that copy the shared nodes on their path rather than change them. The default implementation returns NO.
++ (BOOL) supportsPersistence;
+
+// Restores the balance of the tree after a node has been linked as a leaf at the end of path, the pathSize nodes from the header down to it, and returns the number of nodes on the path from the header to the same node once any rotations have been made, having updated path to match. The links on the path are followed by pointer, so no objects are compared. Subtree counts must be kept valid across rotations with CHBinaryTreeNodeCountRotation(), and the nodes on the returned path are recounted afterwards. Must be overridden by subclasses whose +supportsHintedInsertion returns YES; the default implementation raises CHUnsupportedOperationException.
+- (NSUInteger) rebalancePath:(CHBinaryTreeNode**)path size:(NSUInteger)pathSize;
+
+// Returns whether the class implements -rebalancePath:size:, which -addObject:hint: needs to link a node where it found its place from the hint. The default implementation returns NO.
++ (BOOL) supportsHintedInsertion;
+
+@end
+
+@interface CHBinarySearchTree ()
+
+// Adds anObject by a finger search from the end of path, the pathSize nodes from the root to a cursor's object or, if position is -1 or 1, from the first or last object. Climbs only as far as the nearest ancestor on the far side of anObject, descends from there, links a new node and sends -rebalancePath:size:. If appendOnly, returns NO, having changed nothing, unless anObject is ordered after or the same as the last object. Positions cursor, unless nil, at anObject. Does not count the mutation.
+- (BOOL) addObject:(id)anObject
+          fromPath:(CHBinaryTreeNode**)path
+              size:(NSUInteger)pathSize
+          position:(int)position
+        appendOnly:(BOOL)appendOnly
+            cursor:(CHBinarySearchTreeCursor*)cursor;
+
+@end
+
+@interface CHFrozenSortedSet ()
+
+// Initializes a frozen set with objectCount objects in strictly ascending order, which are retained, and the ordering and options of a tree. A NULL comparator orders objects by -compare:.
+- (id) initWithSortedObjects:(id*)sortedObjects
+                       count:(NSUInteger)objectCount
+                  comparator:(const CHSearchTreeComparator*)comparator
+                     options:(unsigned int)options;
+
 @end
 
 #pragma mark -
 
 /**
- Convenience function for allocating a new CHBinaryTreeNode. This centralizes the allocation so all subclasses can be sure they're allocating nodes correctly. Explicitly sets the "extra" field used by self-balancing trees to zero.
+ Convenience function for allocating a new CHBinaryTreeNode. This centralizes the allocation so all subclasses can be sure they're allocating nodes correctly. Explicitly sets the "extra" field used by self-balancing trees to zero. Used for the header and sentinel nodes, which are allocated with room for a subtree count (of zero), so that they can serve trees with or without CHTreeOptionsOrderStatistics.
  
  @param anObject The object to be stored in the @a object field of the struct; may be @c nil.
  @return An struct allocated with @c malloc().
@@ -50,31 +109,398 @@ HIDDEN CHBinaryTreeNode* CHCreateBinaryTreeNodeWithObject(id anObject);
 // These are used by subclasses; marked as HIDDEN to reduce external visibility.
 extern HIDDEN size_t kCHBinaryTreeNodeSize;
 
+#pragma mark Order statistics
+
+/**
+ The node of a tree created with CHTreeOptionsOrderStatistics. The subtree count follows the plain node, so that trees without the option do not pay for it, and code that only handles CHBinaryTreeNode works unchanged.
+ */
+typedef struct CHBinaryTreeCountedNode {
+	CHBinaryTreeNode	sNode;
+	NSUInteger			cNodes;			///< The number of nodes in the subtree rooted at this node. Zero for the sentinel.
+} CHBinaryTreeCountedNode;
+
+extern HIDDEN size_t kCHBinaryTreeCountedNodeSize;
+
+/** The number of nodes in the subtree rooted at @a node, which must have been allocated as a CHBinaryTreeCountedNode. */
+#define CHBinaryTreeNodeCount(node)		(((CHBinaryTreeCountedNode *) (node)) -> cNodes)
+
+/**
+ Keeps subtree counts valid across a rotation that has just moved @a a_pNodeUp into the place of @a a_pNodeDown, which is now its child. The promoted node covers exactly the objects its predecessor covered, so it takes over that count, and the demoted node is recounted from its new children. Every rotation in a tree with CHTreeOptionsOrderStatistics must call this, in the order the rotations are made.
+ 
+ Counts that are stale when a rotation is made (because a node has been linked or unlinked below, but its ancestors have not yet been recounted) stay on the ancestors of the changed position through any number of rotations, and are then corrected by CHBinaryTreeNodeCountPath().
+ */
+static inline void CHBinaryTreeNodeCountRotation (bool a_fCounted, CHBinaryTreeNode * a_pNodeDown, CHBinaryTreeNode * a_pNodeUp)
+	{
+	if (a_fCounted)
+		{
+		CHBinaryTreeNodeCount (a_pNodeUp) = CHBinaryTreeNodeCount (a_pNodeDown);
+		CHBinaryTreeNodeCount (a_pNodeDown) = CHBinaryTreeNodeCount (a_pNodeDown -> left) + CHBinaryTreeNodeCount (a_pNodeDown -> right) + 1;
+		}
+	}
+
+/**
+ Recounts, bottom up, every node on the path from the root to the sentinel found by searching for @a a_poKey, going right when a node's object matches it. Called once after a node has been linked or unlinked and the tree has been rebalanced. After an insertion, @a a_poKey is the inserted object. After a removal, it is the object of the node that was unlinked, which may have been moved into the node that held the removed object, and must not yet have been released.
+ */
+HIDDEN void CHBinaryTreeNodeCountPath (CHBinaryTreeNode * a_pHeader, CHBinaryTreeNode * a_pSentinel, CHSearchTreeComparator * a_pComparator, unsigned int a_uiNestingLevel, bool a_fMultiLevel, id a_poKey);
+
+#pragma mark Node allocation
+
+#define kCHBinaryTreeNodeSlabDefault	64		/* Nodes in the first slab when no capacity is given */
+#define kCHBinaryTreeNodeSlabMaximum	4096	/* Slabs double in size up to this many nodes */
+
+/**
+ The header of a slab of nodes. The nodes follow the header in the same allocation.
+ */
+typedef struct CHBinaryTreeNodeSlab {
+	struct CHBinaryTreeNodeSlab *	pSlabNext;		///< The next older slab, or @c NULL.
+	NSUInteger						cNodes;			///< The number of nodes in this slab.
+	/* The nodes follow, suitably aligned */
+} CHBinaryTreeNodeSlab;
+
+/**
+ Owns the slabs of one or more node pools, and the sentinel node that the leaves of their trees link to. A tree split from another shares its arena, so that nodes can move between the two trees without being reallocated, as do the copies of a persistent tree, which share their nodes. When trees with different arenas are joined, the slabs of one arena are moved into the other, and the emptied arena forwards to it. The arena is reference counted by the pools that use it and the arenas that forward to it.
+ */
+typedef struct CHBinaryTreeNodeArena {
+	struct CHBinaryTreeNodeArena *	pArenaMergedInto;	///< The arena that took over this arena's slabs, or @c NULL.
+	NSUInteger						cReferences;		///< The number of pools using this arena, plus the number of arenas forwarding to it. Changed atomically, since copies of a persistent tree may be released on different threads.
+	CHBinaryTreeNodeSlab *			pSlabs;				///< The newest slab, which links to the older slabs. Always @c NULL once the arena forwards.
+	CHBinaryTreeNode *				pSentinel;			///< The sentinel shared by the trees whose pools use this arena.
+} CHBinaryTreeNodeArena;
+
+/** Follows the forwarding of an arena to the arena that now owns its slabs. */
+static inline CHBinaryTreeNodeArena * CHBinaryTreeNodeArenaRoot (CHBinaryTreeNodeArena * a_pArena)
+	{
+	while (a_pArena -> pArenaMergedInto != NULL)
+		a_pArena = a_pArena -> pArenaMergedInto;
+	return a_pArena;
+	}
+
+/**
+ Creates the arena of a new pool, and returns its sentinel node, or @c NULL if memory could not be allocated.
+ */
+HIDDEN CHBinaryTreeNode * CHBinaryTreeNodePoolCreateArena (CHBinaryTreeNodePool * a_pPool);
+
+/**
+ Releases a pool's reference to its arena, freeing the arena, its slabs and its sentinel if no other pool or arena uses it. The tree must already be empty.
+ */
+HIDDEN void CHBinaryTreeNodePoolRelease (CHBinaryTreeNodePool * a_pPool);
+
+/**
+ Makes the empty pool @a a_pPool use the arena of @a a_pPoolFrom, releasing its own, so that nodes of either pool can be linked into the tree of the other. Returns the shared sentinel node, which the tree of @a a_pPool must use from then on.
+ */
+HIDDEN CHBinaryTreeNode * CHBinaryTreeNodePoolShare (CHBinaryTreeNodePool * a_pPool, CHBinaryTreeNodePool * a_pPoolFrom);
+
+/**
+ Moves the slabs of the arena of @a a_pPoolFrom into the arena of @a a_pPool, unless they are already the same, so that nodes allocated by @a a_pPoolFrom can be linked into the tree of @a a_pPool. Both pools remain usable. Takes time proportional to the number of slabs moved. The caller must relink the moved nodes' leaves to the sentinel of @a a_pPool.
+ */
+HIDDEN void CHBinaryTreeNodePoolMerge (CHBinaryTreeNodePool * a_pPool, CHBinaryTreeNodePool * a_pPoolFrom);
+
+/**
+ Allocates a new slab and returns its first node. Called only when the free list and the newest slab are both exhausted.
+ */
+HIDDEN CHBinaryTreeNode * CHBinaryTreeNodePoolGrow (CHBinaryTreeNodePool * a_pPool);
+
+/**
+ Frees every node of the tree rooted at @a a_pRoot, first releasing their objects if @a a_fReleaseObjects is true. When no other tree shares the pool's arena, every slab is freed at once, which takes time proportional to the number of slabs, plus the number of nodes if their objects are released. Otherwise, the nodes are walked and returned to the pool's free list. The pool remains usable afterwards. For a pool of shared nodes, the tree's reference to its root is dropped instead, and the objects are always released with the last reference to their nodes.
+ */
+HIDDEN void CHBinaryTreeNodePoolRemoveAll (CHBinaryTreeNodePool * a_pPool, CHBinaryTreeNode * a_pRoot, CHBinaryTreeNode * a_pSentinel, bool a_fReleaseObjects);
+
+/**
+ Sizes the next slab of a pool to hold at least @a a_cNodes nodes.
+ */
+HIDDEN void CHBinaryTreeNodePoolReserve (CHBinaryTreeNodePool * a_pPool, NSUInteger a_cNodes);
+
+#pragma mark Shared nodes
+
+/** The reference count of a node of a tree created with CHTreeOptionsPersistent, which precedes the node in the same allocation. It counts the links to the node from other nodes and from the headers of trees, and is changed atomically, since trees that share the node may be released on different threads. */
+#define CHBinaryTreeNodeReferences(node)	(((NSUInteger *) (node)) [-1])
+
+/**
+ The state of one change to a tree created with CHTreeOptionsPersistent, passed down the recursive functions that make it. Each node on the path of the change is copied first if another tree also links to it, then relinked in place of the original before the path goes further, so the tree is consistent at every step.
+ */
+typedef struct CHBinaryTreeSharedEdit {
+	CHBinaryTreeNodePool *		pPool;			///< The pool of the tree, which allocates new nodes and copies of shared nodes.
+	CHBinaryTreeNode *			pSentinel;		///< The sentinel of the tree.
+	CHSearchTreeComparator *	pComparator;	///< How the objects of the tree are ordered.
+	bool						fCounted;		///< The nodes carry subtree counts, for CHTreeOptionsOrderStatistics.
+	bool						fChanged;		///< Set once a node has been added or removed.
+} CHBinaryTreeSharedEdit;
+
+/**
+ Allocates a node with a reference count of one, for a pool with @a fSharedNodes set.
+ */
+HIDDEN CHBinaryTreeNode * CHBinaryTreeSharedNodeAlloc (CHBinaryTreeNodePool * a_pPool, id a_poObject);
+
+/**
+ Drops a reference to a shared node. A node whose count reaches zero releases its object and is freed, and drops its references to its children in turn.
+ */
+HIDDEN void CHBinaryTreeSharedNodeRelease (CHBinaryTreeNode * a_pNode, CHBinaryTreeNode * a_pSentinel);
+
+/**
+ Returns a node that the caller may change: @a a_pNode itself if the caller holds its only reference, otherwise a copy, which takes over the caller's reference and holds its own on the object and children of the original. The caller must link the result in place of @a a_pNode.
+ */
+HIDDEN CHBinaryTreeNode * CHBinaryTreeSharedNodeUnshare (CHBinaryTreeNodePool * a_pPool, CHBinaryTreeNode * a_pNode, CHBinaryTreeNode * a_pSentinel);
+
+static inline void CHBinaryTreeSharedNodeRetain (CHBinaryTreeNode * a_pNode, CHBinaryTreeNode * a_pSentinel)
+	{
+	if (a_pNode != a_pSentinel)				/* The sentinel belongs to the arena, and is not counted */
+		__atomic_add_fetch (&CHBinaryTreeNodeReferences (a_pNode), 1, __ATOMIC_RELAXED);
+	}
+
+/**
+ Clears the object that a search may have left in a sentinel. The sentinel of persistent trees may be read by copies on other threads, and never holds an object, so it is not written.
+ */
+static inline void CHBinaryTreeSentinelClear (CHBinaryTreeNode * a_pSentinel)
+	{
+	if (a_pSentinel -> object != nil)
+		a_pSentinel -> object = nil;
+	}
+
+/**
+ Allocates a node from a tree's pool, reusing a freed node if there is one. Explicitly sets the "extra" field used by self-balancing trees to zero.
+
+ @param a_pPool The node pool of the tree.
+ @param a_poObject The object to be stored in the @a object field of the node. Must not be @c nil, which marks free nodes.
+ */
+static inline CHBinaryTreeNode * CHBinaryTreeNodePoolAlloc (CHBinaryTreeNodePool * a_pPool, id a_poObject)
+	{
+	CHBinaryTreeNode *	pNode;
+
+	if (a_pPool -> fSharedNodes)
+		return CHBinaryTreeSharedNodeAlloc (a_pPool, a_poObject);
+	pNode = a_pPool -> pNodeFree;
+	if (pNode != NULL)
+		a_pPool -> pNodeFree = pNode -> right;
+	else
+		if (a_pPool -> pbNext < a_pPool -> pbEnd)
+			{
+			pNode = (CHBinaryTreeNode *) a_pPool -> pbNext;
+			a_pPool -> pbNext += a_pPool -> cbNode;
+			}
+		else
+			pNode = CHBinaryTreeNodePoolGrow (a_pPool);
+	pNode -> object = a_poObject;
+	pNode -> balance = 0;	// Affects balancing info for any subclass (anon. union)
+	if (a_pPool -> cbNode != kCHBinaryTreeNodeSize)	/* A counted node, for order statistics */
+		CHBinaryTreeNodeCount (pNode) = 1;
+	return pNode;
+	}
+
+/**
+ Returns a node to a tree's pool for reuse. The caller must already have released the node's object.
+ */
+static inline void CHBinaryTreeNodePoolFree (CHBinaryTreeNodePool * a_pPool, CHBinaryTreeNode * a_pNode)
+	{
+	a_pNode -> object = nil;	/* Marks the node as free for CHBinaryTreeNodePoolRemoveAll() */
+	a_pNode -> left = NULL;
+	a_pNode -> right = a_pPool -> pNodeFree;
+	a_pPool -> pNodeFree = a_pNode;
+	}
+
+#pragma mark Comparison
+
+/**
+ A comparison implementation resolved for one receiver class at one nesting level. Entries are created on a cache miss, fully initialised, then published into a free slot of the owning tree's cache with an atomic compare-and-swap. They are never modified afterwards and are freed only when the tree is deallocated, so concurrent readers can use them without locking.
+ */
+typedef struct CHCompareCacheEntry {
+	Class			pClass;				///< The class of the receiver of the comparison message.
+	unsigned int	uiNestingLevel;		///< The nesting level for which the entry was resolved.
+	bool			fIsCollection;		///< Instances respond to @c -anyObject, and so are multi-level sub-collections.
+	SEL				pSelCompare;		///< @c compare: at nesting level 0, otherwise @c compare<n>: for nesting level n.
+	CHCompareIMP	pfnCompare;			///< The implementation of @a pSelCompare for @a pClass.
+} CHCompareCacheEntry;
+
+/**
+ Returns the comparison selector for a nesting level: @c compare: at level 0, @c compare1: at level 1 and so on. Selectors for the shallower levels are looked up once and remembered.
+ */
+HIDDEN SEL CHCompareSelectorForNestingLevel (unsigned int a_uiNestingLevel);
+
+/**
+ Resolves the comparison implementation for a class at a nesting level, and publishes it in the cache if a slot is free. If the cache is full, the entry is resolved into @a a_pEntryScratch, which is returned instead. Called only on a cache miss.
+ */
+HIDDEN CHCompareCacheEntry * CHCompareCacheResolve (struct CHCompareCacheEntry ** a_apCache, Class a_pClass, unsigned int a_uiNestingLevel, CHCompareCacheEntry * a_pEntryScratch);
+
+/**
+ Releases all the entries in a comparison cache. Only to be called when no other thread can be using the cache.
+ */
+HIDDEN void CHCompareCacheFree (struct CHCompareCacheEntry ** a_apCache);
+
+static inline CHCompareCacheEntry * CHCompareCacheLookup (struct CHCompareCacheEntry ** a_apCache, Class a_pClass, unsigned int a_uiNestingLevel, CHCompareCacheEntry * a_pEntryScratch)
+	{
+	CHCompareCacheEntry *	pEntry;
+	unsigned int			ui;
+
+	for (ui = 0; ui < kCHCompareCacheSize; ui ++)
+		{
+		pEntry = __atomic_load_n (&a_apCache [ui], __ATOMIC_ACQUIRE);
+		if (pEntry == NULL)				/* Slots are filled in order, so there is no match in any later slot either */
+			break;
+		if ((pEntry -> pClass == a_pClass) && (pEntry -> uiNestingLevel == a_uiNestingLevel))
+			return pEntry;
+		}
+	return CHCompareCacheResolve (a_apCache, a_pClass, a_uiNestingLevel, a_pEntryScratch);
+	}
+
+/**
+ Compares two objects using the cached comparison implementation for the target's class. This has the same semantics as -[CHAbstractBinarySearchTree Compare:target:argument:] but, once the cache is warm, costs only a few pointer comparisons plus a direct function call.
+
+ @param a_apCache The comparison cache of the tree.
+ @param a_uiNestingLevel The nesting level, which selects @c compare: or @c compare<n>:.
+ @param a_fMultiLevel Whether multi-level sub-collections may appear as targets. If so, a sub-collection is compared using any of its objects, since all objects in a sub-collection compare the same way at this nesting level.
+ @param a_poTarget The receiver of the comparison message. May be the tree's header object, which always compares as @c NSOrderedAscending.
+ @param a_poArgument The argument of the comparison message.
+ */
+static inline NSComparisonResult CHCompareObjects (struct CHCompareCacheEntry ** a_apCache, unsigned int a_uiNestingLevel, bool a_fMultiLevel, id a_poTarget, id a_poArgument)
+	{
+	CHCompareCacheEntry		sEntryScratch;
+	CHCompareCacheEntry *	pEntry;
+
+	if (a_poTarget == nil)				/* As for a message sent to nil, such as past the end of an enumeration */
+		return NSOrderedSame;
+	pEntry = CHCompareCacheLookup (a_apCache, object_getClass (a_poTarget), a_uiNestingLevel, &sEntryScratch);
+	if (a_fMultiLevel)
+		{
+		while (pEntry -> fIsCollection)
+			{
+			a_poTarget = [a_poTarget anyObject];
+			NSCAssert (a_poTarget != nil, @"Empty Collection is illegal");
+			pEntry = CHCompareCacheLookup (a_apCache, object_getClass (a_poTarget), a_uiNestingLevel, &sEntryScratch);
+			}
+		}
+	return pEntry -> pfnCompare (a_poTarget, pEntry -> pSelCompare, a_poArgument);
+	}
+
+/**
+ Compares two objects using a tree's comparator. With a comparator function or block, this is a single indirect call at the tree's own nesting level. Nested levels of multi-level trees always use the @c -compare<n>: selectors, as do trees with no comparator function.
+
+ @param a_pComparator The comparator of the tree.
+ @param a_uiNestingLevel The nesting level, which selects @c compare: or @c compare<n>: when there is no comparator function.
+ @param a_fMultiLevel Whether multi-level sub-collections may appear as targets.
+ @param a_poTarget The object stored in the tree. May be the tree's header object, which always compares as @c NSOrderedAscending.
+ @param a_poArgument The object being searched for, inserted or removed.
+ */
+static inline NSComparisonResult CHSearchTreeCompareObjects (CHSearchTreeComparator * a_pComparator, unsigned int a_uiNestingLevel, bool a_fMultiLevel, id a_poTarget, id a_poArgument)
+	{
+	CHCompareCacheEntry		sEntryScratch;
+
+	if ((a_pComparator -> pfnCompare == NULL) || (a_uiNestingLevel != 0))
+		return CHCompareObjects (a_pComparator -> apCache, a_uiNestingLevel, a_fMultiLevel, a_poTarget, a_poArgument);
+	if (a_poTarget == a_pComparator -> poHeaderObject)
+		return NSOrderedAscending;
+	if (a_poTarget == nil)
+		return NSOrderedSame;
+	if (a_fMultiLevel)
+		{
+		while (CHCompareCacheLookup (a_pComparator -> apCache, object_getClass (a_poTarget), 0, &sEntryScratch) -> fIsCollection)
+			{
+			a_poTarget = [a_poTarget anyObject];	/* All objects in a sub-collection compare the same way, so use any of them */
+			NSCAssert (a_poTarget != nil, @"Empty Collection is illegal");
+			}
+		}
+	return a_pComparator -> pfnCompare (a_poTarget, a_poArgument, a_pComparator -> pvContext);
+	}
+
+/**
+ Compares two objects at nesting level 0 of a tree which does not support multi-level sub-collections. Equivalent to <code>[a_poTarget compare: a_poArgument]</code>, except that it uses the tree's comparator function or block, if any.
+ */
+static inline NSComparisonResult CHSearchTreeCompare (CHSearchTreeComparator * a_pComparator, id a_poTarget, id a_poArgument)
+	{
+	return CHSearchTreeCompareObjects (a_pComparator, 0, false, a_poTarget, a_poArgument);
+	}
+
+/**
+ Makes @a a_pComparatorTo order objects the same way as @a a_pComparatorFrom, retaining a comparator block if necessary. @a a_pComparatorTo must belong to a tree that contains no objects.
+ */
+HIDDEN void CHSearchTreeComparatorCopy (CHSearchTreeComparator * a_pComparatorTo, const CHSearchTreeComparator * a_pComparatorFrom);
+
+/**
+ Sorts @a a_cObjects objects into ascending order by a merge sort, which keeps objects that are the same in their original order. @a a_apoScratch must have room for as many objects.
+ */
+HIDDEN void CHBinaryTreeSortObjects (CHSearchTreeComparator * a_pComparator, bool a_fMultiLevel, id * a_apo, NSUInteger a_cObjects, id * a_apoScratch);
+
+/**
+ Copies the objects of @a a_poArray into a @c malloc()ed buffer, with room for one more, in strictly ascending order, for a sorted set to load in bulk. Unless they are already in strictly ascending order, which is checked only if @a a_fCheckSorted, they are sorted with CHBinaryTreeSortObjects(). The sort keeps objects that are the same in their original order, so keeping the last of each run keeps the last one added, just as adding them one at a time would.
+
+ @return The buffer, which the caller must free. @a *a_pcObjects is set to the number of objects in it.
+ @throw NSMallocException if the buffer cannot be allocated.
+ */
+HIDDEN id * CHSearchTreeCopySortedObjects (CHSearchTreeComparator * a_pComparator, NSArray * a_poArray, bool a_fCheckSorted, NSUInteger * a_pcObjects);
+
+/**
+ Archives the objects of a sorted set, in ascending order. Keyed archives also record the kind of its comparator. A comparator block or function cannot be archived, so an exception is raised for @a a_poReceiver, the object being archived, if the set is ordered by one.
+
+ @throw NSInternalInconsistencyException if the set is ordered by a comparator block or function.
+ */
+HIDDEN void CHSortedSetEncodeObjects (NSCoder * a_poCoder, id a_poReceiver, SEL a_selMethod, const CHSearchTreeComparator * a_pComparator, NSArray * a_poObjects);
+
+/**
+ Unarchives the objects archived by CHSortedSetEncodeObjects(). If the sorted set was ordered by a comparator block or function, its ordering cannot be restored, so @a a_poReceiver, the object being initialized, is released and an exception is raised.
+
+ @throw NSInvalidArgumentException if the objects were archived with a comparator block or function.
+ */
+HIDDEN NSArray * CHSortedSetDecodeObjects (NSCoder * a_poCoder, id a_poReceiver, SEL a_selMethod);
+
+/**
+ A run of objects, in ascending order, that a sorted set collects to build a subset: from @a poStart, or the first object if @c nil, to @a poEnd, or the last object if @c nil.
+ */
+typedef struct CHSubsetRun {
+	id		poStart;
+	id		poEnd;
+	BOOL	fExcludeStart;		///< Whether an object that is the same as @a poStart is left out.
+	BOOL	fExcludeEnd;		///< Whether an object that is the same as @a poEnd is left out.
+} CHSubsetRun;
+
+/**
+ Divides the range of \link CHSortedSet#subsetFromObject:toObject:options: -subsetFromObject:toObject:options:\endlink into the runs of objects that a sorted set collects, in order, to build the subset in ascending order. A range in ascending order is a single run. A range in descending order holds the objects up to @a a_poEnd, then those from @a a_poStart, which are still in ascending order, so it is two runs.
+
+ @param a_fDescending Whether @a a_poStart is ordered after @a a_poEnd. Ignored unless both are given.
+ @return The number of runs in @a a_asRuns, 1 or 2.
+ */
+HIDDEN NSUInteger CHSubsetRuns (id a_poStart, id a_poEnd, bool a_fDescending, CHSubsetConstructionOptions a_fuiOptions, CHSubsetRun a_asRuns [2]);
+
 #pragma mark Stack macros
 
+// The path from the root to any node of a balanced tree is short: at most about 2 log2(n) nodes for a
+// red-black or AA tree, and 1.44 log2(n) for an AVL tree. So the stack starts in a fixed-size buffer,
+// declared alongside it (on the C stack for a local stack, or in the object for an instance variable),
+// which is large enough for any balanced tree that fits in memory. Only a degenerate unbalanced tree
+// or an extremely unlucky treap grows the stack onto the heap.
+#define kCHBinaryTreeStackInlineSize	96
+
+/**
+ Doubles the capacity of a stack that is full, moving it from its fixed-size buffer to the heap if necessary.
+ */
+HIDDEN CHBinaryTreeNode** CHBinaryTreeStackGrow(CHBinaryTreeNode **stack, NSUInteger *stackCapacity, CHBinaryTreeNode **stackInline);
+
 #define CHBinaryTreeStack_DECLARE() \
+	CHBinaryTreeNode* stackInline[kCHBinaryTreeStackInlineSize]; \
 	__strong CHBinaryTreeNode** stack; \
 	NSUInteger stackCapacity, stackSize
 
 #define CHBinaryTreeStack_INIT() { \
-	stackCapacity = 32; \
-	stack = malloc(kCHBinaryTreeNodeSize * stackCapacity); \
+	stackCapacity = kCHBinaryTreeStackInlineSize; \
+	stack = stackInline; \
+	stackSize = 0; \
+}
+
+// For a stack which must outlive the scope of its fixed-size buffer, such as one saved between calls in an NSFastEnumerationState.
+#define CHBinaryTreeStack_INIT_ON_HEAP() { \
+	stackCapacity = kCHBinaryTreeStackInlineSize; \
+	stack = malloc(kCHPointerSize * stackCapacity); \
 	stackSize = 0; \
 }
 
 #define CHBinaryTreeStack_FREE(stack) { \
-	if (stack != NULL) \
+	if (stack != NULL && stack != stackInline) \
 		free(stack); \
 	stack = NULL; \
 }
 
 // Since this stack starts at 0 and goes to N-1, resizing is pretty simple.
 #define CHBinaryTreeStack_PUSH(node) { \
+	if (stackSize >= stackCapacity) \
+		stack = CHBinaryTreeStackGrow(stack, &stackCapacity, stackInline); \
 	stack[stackSize++] = node; \
-	if (stackSize >= stackCapacity) { \
-		stackCapacity *= 2; \
-		stack = realloc(stack, kCHPointerSize * stackCapacity); \
-	} \
 }
 
 #define CHBinaryTreeStack_TOP \
@@ -0,0 +1,140 @@
+/*
+ CHDataStructures.framework -- CHAbstractPrimitiveSortedSet.h
+
+ Copyright (c) 2008-2010, Quinn Taylor <http://homepage.mac.com/quinntaylor>
+
+ This source code is released under the ISC License. <http://www.opensource.org/licenses/isc-license>
+
+ Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby granted, provided that the above copyright notice and this permission notice appear in all copies.
+
+ The software is  provided "as is", without warranty of any kind, including all implied warranties of merchantability and fitness. In no event shall the authors or copyright holders be liable for any claim, damages, or other liability, whether in an action of contract, tort, or otherwise, arising from, out of, or in connection with the software or the use or other dealings in the software.
+
+	Fixes, additions, extensions, port to GNUstep by Christopher Chandler
+	Copyright © 2013-2015	Christopher James Elphinstone Chandler, Russell Geoffrey Watts. All Rights Reserved.
+	Copyright © 2015-2025	Kinnami Software Corporation. All rights reserved.
+ */
+
+#import "CHSortedSet.h"
+
+/**
+ @file CHAbstractPrimitiveSortedSet.h
+ An abstract CHSortedSet whose keys are stored unboxed in the nodes of an AVL tree.
+ */
+
+/**
+ A node of the AVL tree behind CHAbstractPrimitiveSortedSet. The key is stored in the node itself, rather than in a separately allocated object, and is compared with a single integer comparison. Subclasses map their key type onto @c int64_t so that the integer order is the order of their keys.
+ */
+typedef struct CHPrimitiveTreeNode {
+	int64_t key;                                 ///< The key stored in the node.
+	union {
+		struct {
+			struct CHPrimitiveTreeNode *left;    ///< Link to left child.
+			struct CHPrimitiveTreeNode *right;   ///< Link to right child.
+		};
+		struct CHPrimitiveTreeNode *link[2];     ///< Links to both childen.
+	};
+	int32_t height;                              ///< The height of the subtree rooted at the node. A leaf has height 1.
+} CHPrimitiveTreeNode;
+
+struct CHPrimitiveTreeSlab;					/* Private. Declared in CHAbstractPrimitiveSortedSet.m */
+
+/**
+ The state of the AVL tree behind CHAbstractPrimitiveSortedSet. Nodes are carved from slabs, and removed nodes are kept on a free list, linked through their @a right field, for reuse.
+ */
+typedef struct CHPrimitiveTree {
+	CHPrimitiveTreeNode *			pRoot;			///< The root node, or @c NULL if the tree is empty.
+	NSUInteger						cNodes;			///< The number of keys in the tree.
+	unsigned long					ulMutations;	///< Tracks mutations for NSFastEnumeration and enumerators.
+	CHPrimitiveTreeNode *			pNodeFree;		///< The most recently freed or unused node, or @c NULL if there are none.
+	struct CHPrimitiveTreeSlab *	pSlabs;			///< The newest slab, linked to the older ones.
+	NSUInteger						cNodesSlab;		///< The number of nodes in the next slab to be allocated.
+} CHPrimitiveTree;
+
+/** The greatest height of an AVL tree with fewer than 2<sup>64</sup> nodes, with some to spare. */
+#define kCHPrimitiveTreeHeightMax	96
+
+/** The number of keys fetched at a time by enumerators and bulk conversions. */
+#define kCHPrimitiveKeysBatch		32
+
+/**
+ Adds a key to a tree, unless it is already there.
+
+ @return @c true if the key was added, @c false if it was already in the tree.
+ */
+HIDDEN bool CHPrimitiveTreeAdd (CHPrimitiveTree * a_pTree, int64_t a_iKey);
+
+/**
+ Removes a key from a tree, if it is there.
+
+ @return @c true if the key was removed, @c false if it was not in the tree.
+ */
+HIDDEN bool CHPrimitiveTreeRemove (CHPrimitiveTree * a_pTree, int64_t a_iKey);
+
+/**
+ Removes all the keys from a tree and frees its nodes.
+ */
+HIDDEN void CHPrimitiveTreeRemoveAll (CHPrimitiveTree * a_pTree);
+
+/**
+ Replaces the contents of a tree with a balanced tree of keys in strictly ascending order, in linear time.
+ */
+HIDDEN void CHPrimitiveTreeBuild (CHPrimitiveTree * a_pTree, const int64_t * a_aiKeys, NSUInteger a_cKeys);
+
+/**
+ Copies up to @a a_cKeysMax keys from a tree into @a a_aiKeys, in ascending or descending order. The keys start with the first key, if @a a_fFromStart is @c true, and otherwise with the first key after @a a_iKeyFrom in that order, or at it if @a a_fInclusive is @c true. Enumeration resumes from the last key copied, so it costs O(log n) to start each batch and amortised constant time for each key.
+
+ @return The number of keys copied, which is less than @a a_cKeysMax only when the end of the tree is reached.
+ */
+HIDDEN NSUInteger CHPrimitiveTreeGetKeys (const CHPrimitiveTree * a_pTree, bool a_fFromStart, int64_t a_iKeyFrom, bool a_fInclusive, bool a_fDescending, int64_t * a_aiKeys, NSUInteger a_cKeysMax);
+
+/**
+ Sorts keys into ascending order and removes any duplicates, in place.
+
+ @return The number of distinct keys.
+ */
+HIDDEN NSUInteger CHPrimitiveKeysSortUnique (int64_t * a_aiKeys, NSUInteger a_cKeys);
+
+/**
+ Returns whether a tree contains a key. The descent picks each child by the result of the comparison rather than branching on it.
+ */
+static inline bool CHPrimitiveTreeContains (const CHPrimitiveTree * a_pTree, int64_t a_iKey)
+	{
+	CHPrimitiveTreeNode *	pNode;
+
+	for (pNode = a_pTree -> pRoot; pNode != NULL; pNode = pNode -> link [a_iKey > pNode -> key])
+		if (a_iKey == pNode -> key)
+			return true;
+	return false;
+	}
+
+/**
+ An abstract CHSortedSet of numbers whose keys are stored unboxed, inline in the nodes of an AVL tree, and compared with native integer comparisons rather than by sending @c -compare: to NSNumber objects. Concrete subclasses map their key type onto @c int64_t in a way that preserves its order, and provide primitive methods which never create an object. The methods of the CHSortedSet protocol accept and return NSNumber objects, boxing and unboxing keys as they cross the interface: @c -member: and the enumerators return new NSNumber objects that are equal to the keys, rather than the objects that were added.
+
+ Adding a key that is already in the set leaves the set unchanged. Objects that are not NSNumber objects, or whose values cannot be represented as keys of the set, are rejected by the methods that add objects, and are never found by the methods that search for them.
+
+ Rather than enforcing that this class be abstract, the contract is implied. Subclasses must override @c -getKey:forObject: and @c -objectForKey:.
+ */
+@interface CHAbstractPrimitiveSortedSet : NSObject <CHSortedSet>
+{
+	@protected
+		CHPrimitiveTree		m_sTree;		/* The keys, in an AVL tree of unboxed keys */
+}
+
+/**
+ Converts an object to a key of the set. Must be overridden by subclasses.
+
+ @param key Set to the key for @a anObject, if there is one.
+ @param anObject The object to convert.
+ @return @c YES if @a anObject is a number which can be represented as a key of the set, otherwise @c NO.
+ */
+- (BOOL) getKey:(int64_t*)key forObject:(id)anObject;
+
+/**
+ Converts a key of the set to a new NSNumber object. Must be overridden by subclasses.
+
+ @param key A key of the set.
+ @return An autoreleased NSNumber with the value of @a key.
+ */
+- (id) objectForKey:(int64_t)key;
+
+@end
@@ -0,0 +1,612 @@
+/*
+ CHDataStructures.framework -- CHAbstractPrimitiveSortedSet.m
+
+ Copyright (c) 2008-2010, Quinn Taylor <http://homepage.mac.com/quinntaylor>
+
+ This source code is released under the ISC License. <http://www.opensource.org/licenses/isc-license>
+
+ Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby granted, provided that the above copyright notice and this permission notice appear in all copies.
+
+ The software is  provided "as is", without warranty of any kind, including all implied warranties of merchantability and fitness. In no event shall the authors or copyright holders be liable for any claim, damages, or other liability, whether in an action of contract, tort, or otherwise, arising from, out of, or in connection with the software or the use or other dealings in the software.
+
+	Fixes, additions, extensions, port to GNUstep by Christopher Chandler
+	Copyright © 2013-2015	Christopher James Elphinstone Chandler, Russell Geoffrey Watts. All Rights Reserved.
+	Copyright © 2015-2025	Kinnami Software Corporation. All rights reserved.
+ */
+
+#import "CHAbstractPrimitiveSortedSet.h"
+#import "CHAbstractBinarySearchTree_Internal.h"
+
+#pragma mark AVL tree of unboxed keys
+
+#define kCHPrimitiveTreeSlabMin		64		/* Nodes in the first slab. Each slab is twice the size of the last, up to the maximum */
+#define kCHPrimitiveTreeSlabMax		4096	/* Nodes in the largest slab allocated as the tree grows */
+
+struct CHPrimitiveTreeSlab {
+	struct CHPrimitiveTreeSlab *	pSlabNext;		/* The next older slab */
+	CHPrimitiveTreeNode				asNode [];
+};
+
+/* Allocate a slab of a_cNodes nodes and put them all on the free list
+*/
+static void	CHPrimitiveTreeGrow (CHPrimitiveTree * a_pTree, NSUInteger a_cNodes)
+	{
+	struct CHPrimitiveTreeSlab *	pSlab;
+	NSUInteger						ui;
+
+	pSlab = malloc (sizeof (struct CHPrimitiveTreeSlab) + a_cNodes * sizeof (CHPrimitiveTreeNode));
+	if (pSlab == NULL)
+		[NSException raise:NSMallocException format:@"Unable to allocate %lu nodes", (unsigned long) a_cNodes];
+	pSlab -> pSlabNext = a_pTree -> pSlabs;
+	a_pTree -> pSlabs = pSlab;
+	for (ui = a_cNodes; ui-- > 0; )
+		{
+		pSlab -> asNode [ui].right = a_pTree -> pNodeFree;
+		a_pTree -> pNodeFree = &pSlab -> asNode [ui];
+		}
+	}
+
+static inline CHPrimitiveTreeNode *	CHPrimitiveTreeNodeAlloc (CHPrimitiveTree * a_pTree, int64_t a_iKey)
+	{
+	CHPrimitiveTreeNode *	pNode;
+
+	if (a_pTree -> pNodeFree == NULL)
+		{
+		if (a_pTree -> cNodesSlab < kCHPrimitiveTreeSlabMin)
+			a_pTree -> cNodesSlab = kCHPrimitiveTreeSlabMin;
+		CHPrimitiveTreeGrow (a_pTree, a_pTree -> cNodesSlab);
+		if (a_pTree -> cNodesSlab < kCHPrimitiveTreeSlabMax)
+			a_pTree -> cNodesSlab *= 2;
+		}
+	pNode = a_pTree -> pNodeFree;
+	a_pTree -> pNodeFree = pNode -> right;
+	pNode -> key = a_iKey;
+	pNode -> left = pNode -> right = NULL;
+	pNode -> height = 1;
+	return pNode;
+	}
+
+static inline void	CHPrimitiveTreeNodeFree (CHPrimitiveTree * a_pTree, CHPrimitiveTreeNode * a_pNode)
+	{
+	a_pNode -> right = a_pTree -> pNodeFree;
+	a_pTree -> pNodeFree = a_pNode;
+	}
+
+static inline int32_t	CHPrimitiveTreeHeight (CHPrimitiveTreeNode * a_pNode)
+	{
+	return (a_pNode != NULL) ? a_pNode -> height : 0;
+	}
+
+static inline void	CHPrimitiveTreeUpdateHeight (CHPrimitiveTreeNode * a_pNode)
+	{
+	int32_t		iHeightLeft = CHPrimitiveTreeHeight (a_pNode -> left);
+	int32_t		iHeightRight = CHPrimitiveTreeHeight (a_pNode -> right);
+
+	a_pNode -> height = ((iHeightLeft > iHeightRight) ? iHeightLeft : iHeightRight) + 1;
+	}
+
+/* Rotate the child in direction a_iDir up into a_pNode's place, and return it
+*/
+static inline CHPrimitiveTreeNode *	CHPrimitiveTreeRotate (CHPrimitiveTreeNode * a_pNode, int a_iDir)
+	{
+	CHPrimitiveTreeNode *	pChild = a_pNode -> link [a_iDir];
+
+	a_pNode -> link [a_iDir] = pChild -> link [!a_iDir];
+	pChild -> link [!a_iDir] = a_pNode;
+	CHPrimitiveTreeUpdateHeight (a_pNode);
+	CHPrimitiveTreeUpdateHeight (pChild);
+	return pChild;
+	}
+
+/* Restore the AVL balance of a node whose subtrees differ in height by at most two, and return the root of the subtree
+*/
+static CHPrimitiveTreeNode *	CHPrimitiveTreeRebalance (CHPrimitiveTreeNode * a_pNode)
+	{
+	int32_t		iBalance = CHPrimitiveTreeHeight (a_pNode -> left) - CHPrimitiveTreeHeight (a_pNode -> right);
+	int			iDir;
+
+	if ((iBalance < -1) || (iBalance > 1))
+		{
+		iDir = (iBalance < 0);								/* The taller side */
+		if (CHPrimitiveTreeHeight (a_pNode -> link [iDir] -> link [!iDir]) > CHPrimitiveTreeHeight (a_pNode -> link [iDir] -> link [iDir]))
+			a_pNode -> link [iDir] = CHPrimitiveTreeRotate (a_pNode -> link [iDir], !iDir);
+		return CHPrimitiveTreeRotate (a_pNode, iDir);
+		}
+	CHPrimitiveTreeUpdateHeight (a_pNode);
+	return a_pNode;
+	}
+
+bool	CHPrimitiveTreeAdd (CHPrimitiveTree * a_pTree, int64_t a_iKey)
+	{
+	CHPrimitiveTreeNode **	appLink [kCHPrimitiveTreeHeightMax];
+	CHPrimitiveTreeNode **	ppLink;
+	CHPrimitiveTreeNode *	pNode;
+	int32_t					iHeight;
+	NSUInteger				cPath;
+
+	cPath = 0;
+	for (ppLink = &a_pTree -> pRoot; (pNode = *ppLink) != NULL; ppLink = &pNode -> link [a_iKey > pNode -> key])
+		{
+		if (a_iKey == pNode -> key)
+			return false;
+		appLink [cPath ++] = ppLink;
+		}
+	*ppLink = CHPrimitiveTreeNodeAlloc (a_pTree, a_iKey);
+	a_pTree -> cNodes ++;
+	a_pTree -> ulMutations ++;
+	while (cPath != 0)										/* Rebalance upwards until a subtree's height is unchanged */
+		{
+		ppLink = appLink [-- cPath];
+		iHeight = (*ppLink) -> height;
+		*ppLink = CHPrimitiveTreeRebalance (*ppLink);
+		if ((*ppLink) -> height == iHeight)
+			break;
+		}
+	return true;
+	}
+
+bool	CHPrimitiveTreeRemove (CHPrimitiveTree * a_pTree, int64_t a_iKey)
+	{
+	CHPrimitiveTreeNode **	appLink [kCHPrimitiveTreeHeightMax];
+	CHPrimitiveTreeNode **	ppLink;
+	CHPrimitiveTreeNode *	pNode;
+	CHPrimitiveTreeNode *	pNodeSuccessor;
+	NSUInteger				cPath;
+	NSUInteger				cPathNode;
+
+	cPath = 0;
+	for (ppLink = &a_pTree -> pRoot; (pNode = *ppLink) != NULL; ppLink = &pNode -> link [a_iKey > pNode -> key])
+		{
+		if (a_iKey == pNode -> key)
+			break;
+		appLink [cPath ++] = ppLink;
+		}
+	if (pNode == NULL)
+		return false;
+	if ((pNode -> left != NULL) && (pNode -> right != NULL))
+		{
+		/* Unlink the successor, the leftmost node of the right subtree, and move it into the node's place */
+		cPathNode = cPath;
+		appLink [cPath ++] = ppLink;
+		for (ppLink = &pNode -> right; (*ppLink) -> left != NULL; ppLink = &(*ppLink) -> left)
+			appLink [cPath ++] = ppLink;
+		pNodeSuccessor = *ppLink;
+		*ppLink = pNodeSuccessor -> right;
+		pNodeSuccessor -> left = pNode -> left;
+		pNodeSuccessor -> right = pNode -> right;
+		pNodeSuccessor -> height = pNode -> height;
+		*appLink [cPathNode] = pNodeSuccessor;
+		if (cPathNode + 1 < cPath)							/* The link to the right subtree now belongs to the successor */
+			appLink [cPathNode + 1] = &pNodeSuccessor -> right;
+		}
+	else
+		*ppLink = (pNode -> left != NULL) ? pNode -> left : pNode -> right;
+	CHPrimitiveTreeNodeFree (a_pTree, pNode);
+	a_pTree -> cNodes --;
+	a_pTree -> ulMutations ++;
+	while (cPath != 0)										/* Removal can shorten every subtree on the path, so rebalance all the way up */
+		{
+		ppLink = appLink [-- cPath];
+		*ppLink = CHPrimitiveTreeRebalance (*ppLink);
+		}
+	return true;
+	}
+
+void	CHPrimitiveTreeRemoveAll (CHPrimitiveTree * a_pTree)
+	{
+	struct CHPrimitiveTreeSlab *	pSlab;
+
+	while ((pSlab = a_pTree -> pSlabs) != NULL)
+		{
+		a_pTree -> pSlabs = pSlab -> pSlabNext;
+		free (pSlab);
+		}
+	a_pTree -> pRoot = NULL;
+	a_pTree -> pNodeFree = NULL;
+	a_pTree -> cNodesSlab = 0;
+	if (a_pTree -> cNodes != 0)
+		{
+		a_pTree -> cNodes = 0;
+		a_pTree -> ulMutations ++;
+		}
+	}
+
+static CHPrimitiveTreeNode *	CHPrimitiveTreeBuildSubtree (CHPrimitiveTree * a_pTree, const int64_t * a_aiKeys, NSUInteger a_cKeys)
+	{
+	CHPrimitiveTreeNode *	pNode;
+	NSUInteger				uiMid;
+
+	if (a_cKeys == 0)
+		return NULL;
+	uiMid = a_cKeys / 2;
+	pNode = CHPrimitiveTreeNodeAlloc (a_pTree, a_aiKeys [uiMid]);
+	pNode -> left = CHPrimitiveTreeBuildSubtree (a_pTree, a_aiKeys, uiMid);
+	pNode -> right = CHPrimitiveTreeBuildSubtree (a_pTree, a_aiKeys + uiMid + 1, a_cKeys - uiMid - 1);
+	CHPrimitiveTreeUpdateHeight (pNode);
+	return pNode;
+	}
+
+void	CHPrimitiveTreeBuild (CHPrimitiveTree * a_pTree, const int64_t * a_aiKeys, NSUInteger a_cKeys)
+	{
+	unsigned long	ulMutations = a_pTree -> ulMutations;
+
+	CHPrimitiveTreeRemoveAll (a_pTree);
+	if (a_cKeys != 0)
+		CHPrimitiveTreeGrow (a_pTree, a_cKeys);				/* A single slab for all the nodes */
+	a_pTree -> pRoot = CHPrimitiveTreeBuildSubtree (a_pTree, a_aiKeys, a_cKeys);
+	a_pTree -> cNodes = a_cKeys;
+	a_pTree -> ulMutations = ulMutations + 1;
+	}
+
+/* The nodes still to be visited are kept on a stack: the descent pushes each node that comes at or after the starting point,
+	and then moves away from it, so the top of the stack is always the next node in order
+*/
+NSUInteger	CHPrimitiveTreeGetKeys (const CHPrimitiveTree * a_pTree, bool a_fFromStart, int64_t a_iKeyFrom, bool a_fInclusive, bool a_fDescending, int64_t * a_aiKeys, NSUInteger a_cKeysMax)
+	{
+	CHPrimitiveTreeNode *	apNode [kCHPrimitiveTreeHeightMax];
+	CHPrimitiveTreeNode *	pNode;
+	NSUInteger				cStack;
+	NSUInteger				cKeys;
+	int						iDirBack = a_fDescending;	/* Towards the keys that come earlier in the enumeration */
+	bool					fAfter;
+
+	cStack = 0;
+	for (pNode = a_pTree -> pRoot; pNode != NULL; )
+		{
+		if (a_fFromStart)
+			fAfter = true;
+		else if (pNode -> key == a_iKeyFrom)
+			fAfter = a_fInclusive;
+		else
+			fAfter = a_fDescending ? (pNode -> key < a_iKeyFrom) : (pNode -> key > a_iKeyFrom);
+		if (fAfter)
+			{
+			apNode [cStack ++] = pNode;
+			pNode = pNode -> link [iDirBack];
+			}
+		else
+			pNode = pNode -> link [!iDirBack];
+		}
+	for (cKeys = 0; (cKeys < a_cKeysMax) && (cStack != 0); )
+		{
+		pNode = apNode [-- cStack];
+		a_aiKeys [cKeys ++] = pNode -> key;
+		for (pNode = pNode -> link [!iDirBack]; pNode != NULL; pNode = pNode -> link [iDirBack])
+			apNode [cStack ++] = pNode;
+		}
+	return cKeys;
+	}
+
+static int	CHPrimitiveKeyCompare (const void * a_pv1, const void * a_pv2)
+	{
+	int64_t		iKey1 = *(const int64_t *) a_pv1;
+	int64_t		iKey2 = *(const int64_t *) a_pv2;
+
+	return (iKey1 > iKey2) - (iKey1 < iKey2);
+	}
+
+NSUInteger	CHPrimitiveKeysSortUnique (int64_t * a_aiKeys, NSUInteger a_cKeys)
+	{
+	NSUInteger	ui;
+	NSUInteger	cKeysUnique;
+
+	if (a_cKeys == 0)
+		return 0;
+	qsort (a_aiKeys, a_cKeys, sizeof (int64_t), CHPrimitiveKeyCompare);
+	cKeysUnique = 1;
+	for (ui = 1; ui < a_cKeys; ui ++)
+		if (a_aiKeys [ui] != a_aiKeys [cKeysUnique - 1])
+			a_aiKeys [cKeysUnique ++] = a_aiKeys [ui];
+	return cKeysUnique;
+	}
+
+#pragma mark -
+
+/**
+ An NSEnumerator for CHAbstractPrimitiveSortedSet, which fetches keys from the tree in batches and boxes them one at a time.
+ */
+@interface CHPrimitiveSortedSetEnumerator : CHCollectionEnumerator
+{
+	const CHPrimitiveTree *tree; // The tree of the set.
+	int64_t keys[kCHPrimitiveKeysBatch]; // The current batch of keys.
+	NSUInteger keyCount; // The number of keys in the batch.
+	NSUInteger keyIndex; // The index of the next key in the batch.
+	BOOL reverse; // Whether the enumeration is in descending order.
+}
+
+- (id) initWithSet:(CHAbstractPrimitiveSortedSet*)primitiveSet
+			  tree:(const CHPrimitiveTree*)primitiveTree
+		   reverse:(BOOL)descending;
+
+@end
+
+@implementation CHPrimitiveSortedSetEnumerator
+
+- (id) initWithSet:(CHAbstractPrimitiveSortedSet*)primitiveSet
+			  tree:(const CHPrimitiveTree*)primitiveTree
+		   reverse:(BOOL)descending
+{
+	if ((self = [super initWithCollection:primitiveSet mutations:&primitiveTree->ulMutations]) == nil) return nil;
+	tree = primitiveTree;
+	reverse = descending;
+	keyCount = CHPrimitiveTreeGetKeys(tree, true, 0, false, reverse, keys, kCHPrimitiveKeysBatch);
+	return self;
+}
+
+- (id) nextObjectFromCollection {
+	if (keyIndex == keyCount && keyCount == kCHPrimitiveKeysBatch) {
+		keyCount = CHPrimitiveTreeGetKeys(tree, false, keys[keyCount - 1], false, reverse, keys, kCHPrimitiveKeysBatch);
+		keyIndex = 0;
+	}
+	if (keyIndex == keyCount)
+		return nil;
+	return [(CHAbstractPrimitiveSortedSet*) collection objectForKey:keys[keyIndex++]];
+}
+
+@end
+
+#pragma mark -
+
+@implementation CHAbstractPrimitiveSortedSet
+
+- (void) dealloc {
+	CHPrimitiveTreeRemoveAll(&m_sTree);
+	[super dealloc];
+}
+
+- (id) init {
+	if ((self = [super init]) == nil) return nil;
+	memset(&m_sTree, 0, sizeof(m_sTree));
+	return self;
+}
+
+- (id) initWithArray:(NSArray*)anArray {
+	if ((self = [self init]) == nil) return nil;
+	[self addObjectsFromArray:anArray];
+	return self;
+}
+
+- (BOOL) getKey:(int64_t*)key forObject:(id)anObject {
+	(void) key;
+	(void) anObject;
+	CHUnsupportedOperationException([self class], _cmd);
+	return NO;
+}
+
+- (id) objectForKey:(int64_t)key {
+	(void) key;
+	CHUnsupportedOperationException([self class], _cmd);
+	return nil;
+}
+
+// Returns the key for an object that is to be added, raising an exception if there is none.
+- (int64_t) keyForAddedObject:(id)anObject selector:(SEL)selector {
+	int64_t key = 0;
+	if (anObject == nil)
+		CHNilArgumentException([self class], selector);
+	if (![self getKey:&key forObject:anObject])
+		CHInvalidArgumentException([self class], selector, @"Object is not a number that can be represented in the set");
+	return key;
+}
+
+// Returns a new, empty set of the receiver's class, with the given keys, which must be in strictly ascending order.
+- (id) newSetWithSortedKeys:(const int64_t*)keys count:(NSUInteger)keyCount {
+	CHAbstractPrimitiveSortedSet *newSet = [[[self class] alloc] init];
+	CHPrimitiveTreeBuild(&newSet->m_sTree, keys, keyCount);
+	return newSet;
+}
+
+// Returns every key in ascending order, in a malloc()ed buffer that the caller must free.
+- (int64_t*) copyAllKeys {
+	int64_t *keys = malloc(sizeof(int64_t) * (m_sTree.cNodes + 1));
+	if (keys == NULL)
+		[NSException raise:NSMallocException format:@"Unable to allocate %lu keys", (unsigned long) m_sTree.cNodes];
+	CHPrimitiveTreeGetKeys(&m_sTree, true, 0, false, false, keys, m_sTree.cNodes);
+	return keys;
+}
+
+#pragma mark <NSCoding>
+
+- (id) initWithCoder:(NSCoder*)decoder {
+	if ([decoder allowsKeyedCoding])
+		return [self initWithArray:[decoder decodeObjectForKey:@"objects"]];
+	else
+		return [self initWithArray:[decoder decodeObject]];
+}
+
+- (void) encodeWithCoder:(NSCoder*)encoder {
+	if ([encoder allowsKeyedCoding])
+		[encoder encodeObject:[self allObjects] forKey:@"objects"];
+	else
+		[encoder encodeObject:[self allObjects]];
+}
+
+#pragma mark <NSCopying>
+
+- (id) copyWithZone:(NSZone*)zone {
+	(void) zone;
+	int64_t *keys = [self copyAllKeys];
+	id copy = [self newSetWithSortedKeys:keys count:m_sTree.cNodes];
+	free(keys);
+	return copy;
+}
+
+#pragma mark <NSFastEnumeration>
+
+// The last key returned is kept in extra[0] and extra[1], and each batch resumes after it.
+- (NSUInteger) countByEnumeratingWithState:(NSFastEnumerationState*)state
+                                   objects:(id*)stackbuf
+                                     count:(NSUInteger)len
+{
+	int64_t keys[kCHPrimitiveKeysBatch], lastKey = 0;
+	NSUInteger index, batchCount;
+	if (state->state == 0) {
+		state->mutationsPtr = &m_sTree.ulMutations;
+		batchCount = CHPrimitiveTreeGetKeys(&m_sTree, true, 0, false, false, keys, MIN(len, kCHPrimitiveKeysBatch));
+	} else if (state->state == 1) {
+		memcpy(&lastKey, &state->extra[0], sizeof(lastKey));
+		batchCount = CHPrimitiveTreeGetKeys(&m_sTree, false, lastKey, false, false, keys, MIN(len, kCHPrimitiveKeysBatch));
+	} else
+		return 0;
+	for (index = 0; index < batchCount; index++)
+		stackbuf[index] = [self objectForKey:keys[index]];
+	if (batchCount != 0) {
+		memcpy(&state->extra[0], &keys[batchCount - 1], sizeof(lastKey));
+		state->state = 1;
+	} else
+		state->state = 2;
+	state->itemsPtr = stackbuf;
+	return batchCount;
+}
+
+#pragma mark Querying Contents
+
+- (NSArray*) allObjects {
+	NSMutableArray *array = [NSMutableArray arrayWithCapacity:m_sTree.cNodes];
+	int64_t keys[kCHPrimitiveKeysBatch];
+	NSUInteger index, batchCount = CHPrimitiveTreeGetKeys(&m_sTree, true, 0, false, false, keys, kCHPrimitiveKeysBatch);
+	while (batchCount != 0) {
+		for (index = 0; index < batchCount; index++)
+			[array addObject:[self objectForKey:keys[index]]];
+		if (batchCount < kCHPrimitiveKeysBatch)
+			break;
+		batchCount = CHPrimitiveTreeGetKeys(&m_sTree, false, keys[batchCount - 1], false, false, keys, kCHPrimitiveKeysBatch);
+	}
+	return array;
+}
+
+- (id) anyObject {
+	return (m_sTree.pRoot != NULL) ? [self objectForKey:m_sTree.pRoot->key] : nil;
+}
+
+- (NSUInteger) count {
+	return m_sTree.cNodes;
+}
+
+- (BOOL) containsObject:(id)anObject {
+	int64_t key;
+	return [self getKey:&key forObject:anObject] && CHPrimitiveTreeContains(&m_sTree, key);
+}
+
+- (NSString*) description {
+	return [[self allObjects] description];
+}
+
+- (id) firstObject {
+	int64_t key;
+	return (CHPrimitiveTreeGetKeys(&m_sTree, true, 0, false, false, &key, 1) != 0) ? [self objectForKey:key] : nil;
+}
+
+- (NSUInteger) hash {
+	return hashOfCountAndObjects(m_sTree.cNodes, [self firstObject], [self lastObject]);
+}
+
+- (BOOL) isEqual:(id)otherObject {
+	if ([otherObject conformsToProtocol:@protocol(CHSortedSet)])
+		return [self isEqualToSortedSet:otherObject];
+	else
+		return NO;
+}
+
+- (BOOL) isEqualToSortedSet:(id<CHSortedSet>)otherSortedSet {
+	return collectionsAreEqual(self, otherSortedSet);
+}
+
+- (id) lastObject {
+	int64_t key;
+	return (CHPrimitiveTreeGetKeys(&m_sTree, true, 0, false, true, &key, 1) != 0) ? [self objectForKey:key] : nil;
+}
+
+- (id) member:(id)anObject {
+	int64_t key;
+	if ([self getKey:&key forObject:anObject] && CHPrimitiveTreeContains(&m_sTree, key))
+		return [self objectForKey:key];
+	return nil;
+}
+
+- (NSEnumerator*) objectEnumerator {
+	return [[[CHPrimitiveSortedSetEnumerator alloc] initWithSet:self tree:&m_sTree reverse:NO] autorelease];
+}
+
+- (NSEnumerator*) reverseObjectEnumerator {
+	return [[[CHPrimitiveSortedSetEnumerator alloc] initWithSet:self tree:&m_sTree reverse:YES] autorelease];
+}
+
+- (NSSet*) set {
+	return [NSSet setWithArray:[self allObjects]];
+}
+
+// Copies the keys of a run of a subset into a buffer with room for keyCapacity keys, and returns how many there are.
+- (NSUInteger) getKeys:(int64_t*)keys inRun:(const CHSubsetRun*)run capacity:(NSUInteger)keyCapacity {
+	int64_t startKey = 0, endKey = 0;
+	NSUInteger keyCount;
+
+	if (run->poStart != nil)
+		[self getKey:&startKey forObject:run->poStart];
+	keyCount = CHPrimitiveTreeGetKeys(&m_sTree, run->poStart == nil, startKey, !run->fExcludeStart, false, keys, keyCapacity);
+	if (run->poEnd != nil) {
+		[self getKey:&endKey forObject:run->poEnd];
+		while (keyCount > 0 && (keys[keyCount - 1] > endKey || (run->fExcludeEnd && keys[keyCount - 1] == endKey)))
+			keyCount--;
+	}
+	return keyCount;
+}
+
+// The keys of each run are collected in ascending order, and the subset is built directly from them.
+- (id<CHSortedSet>) subsetFromObject:(id)start
+                            toObject:(id)end
+                             options:(CHSubsetConstructionOptions)options
+{
+	int64_t startKey = 0, endKey = 0, *keys;
+	NSUInteger run, runCount, subsetCount = 0;
+	CHSubsetRun runs[2];
+
+	if (start != nil && ![self getKey:&startKey forObject:start])
+		CHInvalidArgumentException([self class], _cmd, @"Start is not a number that can be represented in the set");
+	if (end != nil && ![self getKey:&endKey forObject:end])
+		CHInvalidArgumentException([self class], _cmd, @"End is not a number that can be represented in the set");
+	keys = malloc(sizeof(int64_t) * (m_sTree.cNodes + 1));
+	if (keys == NULL)
+		[NSException raise:NSMallocException format:@"Unable to allocate %lu keys", (unsigned long) m_sTree.cNodes];
+	runCount = CHSubsetRuns(start, end, start != nil && end != nil && startKey > endKey, options, runs);
+	for (run = 0; run < runCount; run++)
+		subsetCount += [self getKeys:keys + subsetCount inRun:&runs[run] capacity:m_sTree.cNodes - subsetCount];
+	id subset = [self newSetWithSortedKeys:keys count:subsetCount];
+	free(keys);
+	return [subset autorelease];
+}
+
+#pragma mark Modifying Contents
+
+- (void) addObject:(id)anObject {
+	CHPrimitiveTreeAdd(&m_sTree, [self keyForAddedObject:anObject selector:_cmd]);
+}
+
+- (void) addObjectsFromArray:(NSArray*)anArray {
+	for (id anObject in anArray)
+		CHPrimitiveTreeAdd(&m_sTree, [self keyForAddedObject:anObject selector:_cmd]);
+}
+
+- (void) removeAllObjects {
+	CHPrimitiveTreeRemoveAll(&m_sTree);
+}
+
+- (void) removeFirstObject {
+	int64_t key;
+	if (CHPrimitiveTreeGetKeys(&m_sTree, true, 0, false, false, &key, 1) != 0)
+		CHPrimitiveTreeRemove(&m_sTree, key);
+}
+
+- (void) removeLastObject {
+	int64_t key;
+	if (CHPrimitiveTreeGetKeys(&m_sTree, true, 0, false, true, &key, 1) != 0)
+		CHPrimitiveTreeRemove(&m_sTree, key);
+}
+
+- (void) removeObject:(id)anObject {
+	int64_t key;
+	if ([self getKey:&key forObject:anObject])
+		CHPrimitiveTreeRemove(&m_sTree, key);
+}
+
+@end
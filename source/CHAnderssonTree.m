@@ -18,21 +18,23 @@
 #import "CHAbstractBinarySearchTree_Internal.h"
 
 // Remove left horizontal links
-#define skew(node) { \
+#define skew(node,counted) { \
 	if ( node->left->level == node->level && node->level != 0 ) { \
 		CHBinaryTreeNode *save = node->left; \
 		node->left = save->right; \
 		save->right = node; \
+		CHBinaryTreeNodeCountRotation(counted, node, save); \
 		node = save; \
 	} \
 }
 
 // Remove consecutive horizontal links
-#define split(node) { \
+#define split(node,counted) { \
 	if ( node->right->right->level == node->level && node->level != 0 ) { \
 		CHBinaryTreeNode *save = node->right; \
 		node->right = save->left; \
 		save->left = node; \
+		CHBinaryTreeNodeCountRotation(counted, node, save); \
 		node = save; \
 		++(node->level); \
 	} \
@@ -56,13 +58,14 @@
 	sentinel ->object = anObject; // Assure that we find a spot to insert
 
 	NSComparisonResult	comparison;
-	NSInvocation *		poInvocationCompare = [[self class] InvocationCompare: anObject nestingLevel: a_uiNestingLevel];	/* Note: Technically, we should use the other object as we're sending the compare*: method to it. But compare*: must be symmetric so we use the (non-nil) argument because we already have it */
+	bool				fMultiLevelCompare = (m_fuiOptions & CHTreeOptionsMultiLevel) != 0;
+	bool				fCounted = (m_fuiOptions & CHTreeOptionsOrderStatistics) != 0;
 
-	comparison = [self Compare: poInvocationCompare target: current -> object argument: anObject];
+	comparison = CHSearchTreeCompareObjects (&m_sComparator, a_uiNestingLevel, fMultiLevelCompare, current -> object, anObject);
 	while (comparison != NSOrderedSame) {
 		CHBinaryTreeStack_PUSH(current);
 		current = current->link[comparison == NSOrderedAscending]; // R on YES
-		comparison = [self Compare: poInvocationCompare target: current -> object argument: nil];	/* Note: Argument hasn't changed so don't need to set it */
+		comparison = CHSearchTreeCompareObjects (&m_sComparator, a_uiNestingLevel, fMultiLevelCompare, current -> object, anObject);
 	}
 	
 	if (current != sentinel) {
@@ -114,7 +117,7 @@
 		goto done;
 	} else {
 		[anObject retain]; // Must retain whether replacing value or adding new node
-		current = CHCreateBinaryTreeNodeWithObject(anObject);
+		current = CHBinaryTreeNodePoolAlloc(&m_sNodePool, anObject);
 		current->left   = sentinel;
 		current->right  = sentinel;
 		current->level  = 1;
@@ -122,7 +125,7 @@
 		// Link from parent as the proper child, based on last comparison
 		parent = CHBinaryTreeStack_POP();
 		NSAssert((id) parent != nil, @"Illegal state, parent should never be nil!");
-		comparison = [self Compare: poInvocationCompare target: parent -> object argument: nil];	/* Note: Argument hasn't changed so don't need to set it */
+		comparison = CHSearchTreeCompareObjects (&m_sComparator, a_uiNestingLevel, fMultiLevelCompare, parent -> object, anObject);
 		parent->link[comparison == NSOrderedAscending] = current; // R if YES
 	}
 	
@@ -130,13 +133,15 @@
 	BOOL isRightChild;
 	while (parent != NULL) {
 		isRightChild = (parent->right == current);
-		skew(current);
-		split(current);
+		skew(current, fCounted);
+		split(current, fCounted);
 		parent->link[isRightChild] = current;
 		// Move to the next node up the path to the root
 		current = parent;
 		parent = CHBinaryTreeStack_POP();
 	}
+	if (fCounted)
+		CHBinaryTreeNodeCountPath(header, sentinel, &m_sComparator, a_uiNestingLevel, fMultiLevelCompare, anObject);
 done:
 	CHBinaryTreeStack_FREE(stack);
 }
@@ -154,13 +159,14 @@ done:
 	sentinel ->object = anObject; // Assure that we stop at a leaf if not found.
 
 	NSComparisonResult	comparison;
-	NSInvocation *		poInvocationCompare = [[self class] InvocationCompare: anObject nestingLevel: a_uiNestingLevel];	/* Note: Technically, we should use the other object as we're sending the compare*: method to it. But compare*: must be symmetric so we use the (non-nil) argument because we already have it */
+	bool				fMultiLevelCompare = (m_fuiOptions & CHTreeOptionsMultiLevel) != 0;
+	bool				fCounted = (m_fuiOptions & CHTreeOptionsOrderStatistics) != 0;
 
-	comparison = [self Compare: poInvocationCompare target: current -> object argument: anObject];
+	comparison = CHSearchTreeCompareObjects (&m_sComparator, a_uiNestingLevel, fMultiLevelCompare, current -> object, anObject);
 	while (comparison != NSOrderedSame) {
 		CHBinaryTreeStack_PUSH(current);
 		current = current->link[comparison == NSOrderedAscending]; // R on YES
-		comparison = [self Compare: poInvocationCompare target: current -> object argument: nil];	/* Note: Argument hasn't changed so don't need to set it */
+		comparison = CHSearchTreeCompareObjects (&m_sComparator, a_uiNestingLevel, fMultiLevelCompare, current -> object, anObject);
 	}
 
 	// Exit if the specified node was not found in the tree.
@@ -185,7 +191,9 @@ done:
 				}									/* Otherwise, object is not a collection that supports object removal or no more objects in the sub-collection, so fall through to the standard removal code, and rebalance the tree */
 		}
 
-	[current->object release]; // Object must be released in any case
+	// Object must be released in any case, but not until the counts are fixed.
+	// (It may be an emptied sub-collection, so the counts are fixed using anObject.)
+	id removedObject = current->object, unlinkedObject = anObject;
 	--count;
 	if (current->left == sentinel || current->right == sentinel) {
 		// Single/zero child case -- replace node with non-nil child (if exists)
@@ -193,7 +201,7 @@ done:
 		NSAssert((id) parent != nil, @"Illegal state, parent should never be nil!");
 		parent->link[parent->right == current]
 			= current->link[current->left == sentinel];
-		free(current);
+		CHBinaryTreeNodePoolFree(&m_sNodePool, current);
 	} else {
 		// Two child case -- replace with minimum object in right subtree
 		CHBinaryTreeStack_PUSH(current); // Need to start here when rebalancing
@@ -204,9 +212,9 @@ done:
 		}
 		parent = CHBinaryTreeStack_TOP;
 		// Grab object from replacement node, steal its right child, deallocate
-		current->object = replacement->object;
+		current->object = unlinkedObject = replacement->object;
 		parent->link[parent->right == replacement] = replacement->right;
-		free(replacement);
+		CHBinaryTreeNodePoolFree(&m_sNodePool, replacement);
 	}
 	
 	// Walk back up the path and rebalance as we go
@@ -224,18 +232,49 @@ done:
 			if (current->right->level > --(current->level)) {
 				current->right->level = current->level;
 			}
-			skew(current);
-			skew(current->right);
-			skew(current->right->right);
-			split(current);
-			split(current->right);
+			skew(current, fCounted);
+			skew(current->right, fCounted);
+			skew(current->right->right, fCounted);
+			split(current, fCounted);
+			split(current->right, fCounted);
 		}
 		parent->link[isRightChild] = current;
 	}
+	if (fCounted)
+		CHBinaryTreeNodeCountPath(header, sentinel, &m_sComparator, a_uiNestingLevel, fMultiLevelCompare, unlinkedObject);
+	[removedObject release];
 done:
 	CHBinaryTreeStack_FREE(stack);
 }
 
+// A built node with a single child always has a right child, and its left
+// subtree is never higher than its right, so one level above the left child
+// makes every left link vertical and every horizontal link a right link.
+- (void) setBalanceForBuiltNode:(CHBinaryTreeNode*)node
+                     leftHeight:(NSUInteger)leftHeight
+                    rightHeight:(NSUInteger)rightHeight
+                          depth:(NSUInteger)depth
+                     treeHeight:(NSUInteger)treeHeight
+{
+	(void) leftHeight;
+	(void) rightHeight;
+	(void) depth;
+	(void) treeHeight;
+	node->level = node->left->level + 1;
+}
+
+// Joining AA trees by level is not implemented, so neither splitting nor joining is supported.
+- (id) splitAtObject:(id)anObject {
+	(void) anObject;
+	CHUnsupportedOperationException([self class], _cmd);
+	return nil;
+}
+
+- (void) joinWithTree:(CHBinarySearchTree*)otherTree {
+	(void) otherTree;
+	CHUnsupportedOperationException([self class], _cmd);
+}
+
 - (NSString*) debugDescriptionForNode:(CHBinaryTreeNode*)node {
 	return [NSString stringWithFormat:@"[%d]\t\"%@\"", node->level, node->object];
 }
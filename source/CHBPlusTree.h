@@ -0,0 +1,132 @@
+/*
+ CHDataStructures.framework -- CHBPlusTree.h
+
+ Copyright (c) 2008-2010, Quinn Taylor <http://homepage.mac.com/quinntaylor>
+
+ This source code is released under the ISC License. <http://www.opensource.org/licenses/isc-license>
+
+ Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby granted, provided that the above copyright notice and this permission notice appear in all copies.
+
+ The software is  provided "as is", without warranty of any kind, including all implied warranties of merchantability and fitness. In no event shall the authors or copyright holders be liable for any claim, damages, or other liability, whether in an action of contract, tort, or otherwise, arising from, out of, or in connection with the software or the use or other dealings in the software.
+
+	Fixes, additions, extensions, port to GNUstep by Christopher Chandler
+	Copyright © 2013-2015	Christopher James Elphinstone Chandler, Russell Geoffrey Watts. All Rights Reserved.
+	Copyright © 2015-2025	Kinnami Software Corporation. All rights reserved.
+ */
+
+#import "CHSearchTree.h"
+#import "CHAbstractBinarySearchTree.h"
+
+/**
+ @file CHBPlusTree.h
+ A <a href="http://en.wikipedia.org/wiki/B%2B_tree">B+ tree</a> implementation of CHSearchTree, with nodes sized to whole cache lines.
+ */
+
+/**
+ The part common to the leaf and inner nodes of a CHBPlusTree. Every node occupies the same whole number of cache lines, and is aligned to a cache line.
+ */
+typedef struct CHBPlusTreeNode {
+	uint32_t	cKeys;		///< The number of objects in a leaf, or of keys in an inner node, which has one more child than keys.
+	uint32_t	fLeaf;		///< Whether the node is a leaf.
+} CHBPlusTreeNode;
+
+/**
+ A leaf of a CHBPlusTree, which holds the objects themselves, in ascending order. The leaves are linked in order, so that they can be enumerated without returning to the inner nodes.
+ */
+typedef struct CHBPlusTreeLeaf {
+	CHBPlusTreeNode				sNode;			///< The node header.
+	struct CHBPlusTreeLeaf *	pLeafPrev;		///< The previous leaf in order, or @c NULL.
+	struct CHBPlusTreeLeaf *	pLeafNext;		///< The next leaf in order, or @c NULL.
+	id							apoObjects [];	///< The objects, filling the rest of the node.
+} CHBPlusTreeLeaf;
+
+/**
+ An inner node of a CHBPlusTree, which holds its keys followed by the pointers to its children. Every object in child i is ordered at or after key i-1 and before key i. The keys are retained, since they may outlive the objects they were copied from.
+ */
+typedef struct CHBPlusTreeInner {
+	CHBPlusTreeNode		sNode;			///< The node header.
+	id					apoKeys [];		///< The keys, followed by the children once there is room for the greatest number of keys.
+} CHBPlusTreeInner;
+
+struct CHBPlusTreeSlab;						/* Private. Declared in CHBPlusTree.m */
+
+/**
+ The state of a CHBPlusTree. Nodes are carved from slabs, and removed nodes are kept on a free list for reuse.
+ */
+typedef struct CHBPlusTreeStorage {
+	CHBPlusTreeNode *			pRoot;			///< The root node, or @c NULL if the tree is empty.
+	CHBPlusTreeLeaf *			pLeafFirst;		///< The first leaf, or @c NULL if the tree is empty.
+	CHBPlusTreeLeaf *			pLeafLast;		///< The last leaf, or @c NULL if the tree is empty.
+	NSUInteger					cObjects;		///< The number of objects in the tree.
+	unsigned long				ulMutations;	///< Tracks mutations for NSFastEnumeration and enumerators.
+	NSUInteger					cHeight;		///< The number of levels of nodes: zero when the tree is empty, one when the root is a leaf.
+	uint32_t					cLeafMax;		///< The greatest number of objects in a leaf.
+	uint32_t					cInnerMax;		///< The greatest number of keys in an inner node.
+	size_t						cbNode;			///< The size of each node, a whole number of cache lines.
+	void *						pvNodeFree;		///< The most recently freed node, or @c NULL if there are none to reuse.
+	struct CHBPlusTreeSlab *	pSlabs;			///< The newest slab, linked to the older ones.
+	NSUInteger					cNodesSlab;		///< The number of nodes in the next slab to be allocated.
+	CHSearchTreeComparator		sComparator;	///< How objects are ordered.
+} CHBPlusTreeStorage;
+
+/** The number of cache lines in each node of a B+ tree initialized with \link CHBPlusTree#init -init\endlink. */
+#define kCHBPlusTreeDefaultCacheLinesPerNode	4
+
+/** The greatest number of cache lines in each node of a B+ tree. */
+#define kCHBPlusTreeMaxCacheLinesPerNode		32
+
+/**
+ A <a href="http://en.wikipedia.org/wiki/B%2B_tree">B+ tree</a>, a balanced search tree whose nodes each hold many objects. Every object is stored in a leaf, in ascending order, and the inner nodes above the leaves hold only keys and pointers to their children. All the leaves are at the same depth, and each node except the root is always at least half full.
+
+ Each node occupies a whole number of cache lines, set by \link #initWithCacheLinesPerNode: -initWithCacheLinesPerNode:\endlink, so that a node is read with a few cache misses, and far fewer nodes are visited than in a binary tree: with 8 byte pointers and the default of 4 lines (256 bytes), a leaf holds 29 objects and an inner node has up to 16 children, so a million objects need only 5 levels, where a balanced binary tree needs 20 or more. Each node is searched by binary search, and the comparisons are made through the same cached @c -compare: implementation as the binary search trees, or with a C function given to \link #initWithCompareFunction:context: -initWithCompareFunction:context:\endlink.
+
+ The leaves are linked in order, so enumeration steps from leaf to leaf without returning to the inner nodes, and NSFastEnumeration returns the objects of each leaf directly, one leaf at a time, without copying them. A tree built by \link #initWithArray: -initWithArray:\endlink or \link #initWithSortedArray: -initWithSortedArray:\endlink is loaded in bulk: the objects are sorted if necessary, packed into full leaves, and the inner levels are built above them, in O(n) time after sorting.
+
+ Since every object is in a leaf and every leaf is at the same depth, the pre-order, post-order and level-order traversals of CHSearchTree all visit the objects in ascending order, just as @c CHTraverseAscending does. Multi-level trees are not supported.
+ */
+@interface CHBPlusTree : NSObject <CHSearchTree>
+{
+	@protected
+		CHBPlusTreeStorage	m_sTree;		/* The nodes of the tree and how objects are ordered */
+}
+
+/**
+ Initialize a B+ tree whose nodes occupy a given number of cache lines. Larger nodes make the tree shallower, at the cost of more comparisons within each node and of moving more objects when a node is split or merged.
+
+ @param lines The number of 64 byte cache lines in each node, from 1 to @c kCHBPlusTreeMaxCacheLinesPerNode.
+ @return An initialized B+ tree that contains no objects.
+
+ @throw NSInvalidArgumentException if @a lines is out of range.
+ */
+- (id) initWithCacheLinesPerNode:(NSUInteger)lines;
+
+/**
+ Initialize a B+ tree that orders its objects with a C function rather than @c -compare:.
+
+ @param a_pfnCompare The function used to compare objects.
+ @param a_pvContext An arbitrary pointer passed to every call of @a a_pfnCompare. Not retained.
+ @return An initialized B+ tree that contains no objects.
+
+ @throw NSInvalidArgumentException if @a a_pfnCompare is @c NULL.
+ */
+- (id) initWithCompareFunction:(CHCompareFunction)a_pfnCompare context:(void*)a_pvContext;
+
+/**
+ Initialize a B+ tree with the objects in a sorted array, loading them in bulk in O(n) time. If @a anArray is not in strictly ascending order, it is sorted first, exactly as for \link #initWithArray: -initWithArray:\endlink.
+
+ @param anArray An array of objects, ideally in strictly ascending order.
+ @return An initialized B+ tree that contains the objects in @a anArray.
+ */
+- (id) initWithSortedArray:(NSArray*)anArray;
+
+/**
+ Returns the number of cache lines in each node of the receiver.
+ */
+- (NSUInteger) cacheLinesPerNode;
+
+/**
+ Returns the number of levels of nodes in the receiver: zero when it is empty, and one when all its objects are in a single leaf.
+ */
+- (NSUInteger) height;
+
+@end
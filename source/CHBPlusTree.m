@@ -0,0 +1,994 @@
+/*
+ CHDataStructures.framework -- CHBPlusTree.m
+
+ Copyright (c) 2008-2010, Quinn Taylor <http://homepage.mac.com/quinntaylor>
+
+ This source code is released under the ISC License. <http://www.opensource.org/licenses/isc-license>
+
+ Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby granted, provided that the above copyright notice and this permission notice appear in all copies.
+
+ The software is  provided "as is", without warranty of any kind, including all implied warranties of merchantability and fitness. In no event shall the authors or copyright holders be liable for any claim, damages, or other liability, whether in an action of contract, tort, or otherwise, arising from, out of, or in connection with the software or the use or other dealings in the software.
+
+	Fixes, additions, extensions, port to GNUstep by Christopher Chandler
+	Copyright © 2013-2015	Christopher James Elphinstone Chandler, Russell Geoffrey Watts. All Rights Reserved.
+	Copyright © 2015-2025	Kinnami Software Corporation. All rights reserved.
+ */
+
+#import "CHBPlusTree.h"
+#import "CHAbstractBinarySearchTree_Internal.h"
+
+#pragma mark B+ tree of cache line sized nodes
+
+#define kCHCacheLineSize			64		/* Bytes in a cache line, to which every node is aligned */
+#define kCHBPlusTreeHeightMax		64		/* Every inner node but the root has at least two children, so no tree that fits in memory is taller */
+#define kCHBPlusTreeSlabMin			16		/* Nodes in the first slab. Each slab is twice the size of the last, up to the maximum */
+#define kCHBPlusTreeSlabMax			1024	/* Nodes in the largest slab allocated as the tree grows */
+
+struct CHBPlusTreeSlab {
+	struct CHBPlusTreeSlab *	pSlabNext;		/* The next older slab. The nodes follow, from the next cache line boundary */
+};
+
+/* The children of an inner node follow the room for the greatest number of keys
+*/
+static inline CHBPlusTreeNode **	CHBPlusTreeChildren (const CHBPlusTreeStorage * a_pTree, CHBPlusTreeInner * a_pInner)
+	{
+	return (CHBPlusTreeNode **) (a_pInner -> apoKeys + a_pTree -> cInnerMax);
+	}
+
+/* Size the nodes to a_cLines cache lines, and the leaves and inner nodes to fill them
+*/
+static void	CHBPlusTreeInit (CHBPlusTreeStorage * a_pTree, NSUInteger a_cLines)
+	{
+	memset (a_pTree, 0, sizeof (*a_pTree));
+	a_pTree -> cbNode = a_cLines * kCHCacheLineSize;
+	a_pTree -> cLeafMax = (uint32_t) ((a_pTree -> cbNode - sizeof (CHBPlusTreeLeaf)) / sizeof (id));
+	a_pTree -> cInnerMax = (uint32_t) ((a_pTree -> cbNode - sizeof (CHBPlusTreeInner) - sizeof (CHBPlusTreeNode *)) / (sizeof (id) + sizeof (CHBPlusTreeNode *)));
+	}
+
+/* Allocate a slab of a_cNodes nodes, aligned to a cache line, and put them all on the free list, linked through their first word
+*/
+static void	CHBPlusTreeGrow (CHBPlusTreeStorage * a_pTree, NSUInteger a_cNodes)
+	{
+	struct CHBPlusTreeSlab *	pSlab;
+	char *						pbNodes;
+	NSUInteger					ui;
+
+	pSlab = malloc (sizeof (struct CHBPlusTreeSlab) + kCHCacheLineSize + a_cNodes * a_pTree -> cbNode);
+	if (pSlab == NULL)
+		[NSException raise:NSMallocException format:@"Unable to allocate %lu nodes", (unsigned long) a_cNodes];
+	pSlab -> pSlabNext = a_pTree -> pSlabs;
+	a_pTree -> pSlabs = pSlab;
+	pbNodes = (char *) (((uintptr_t) (pSlab + 1) + kCHCacheLineSize - 1) & ~(uintptr_t) (kCHCacheLineSize - 1));
+	for (ui = a_cNodes; ui-- > 0; )
+		{
+		*(void **) (pbNodes + ui * a_pTree -> cbNode) = a_pTree -> pvNodeFree;
+		a_pTree -> pvNodeFree = pbNodes + ui * a_pTree -> cbNode;
+		}
+	}
+
+static inline CHBPlusTreeNode *	CHBPlusTreeNodeAlloc (CHBPlusTreeStorage * a_pTree, bool a_fLeaf)
+	{
+	CHBPlusTreeNode *	pNode;
+
+	if (a_pTree -> pvNodeFree == NULL)
+		{
+		if (a_pTree -> cNodesSlab < kCHBPlusTreeSlabMin)
+			a_pTree -> cNodesSlab = kCHBPlusTreeSlabMin;
+		CHBPlusTreeGrow (a_pTree, a_pTree -> cNodesSlab);
+		if (a_pTree -> cNodesSlab < kCHBPlusTreeSlabMax)
+			a_pTree -> cNodesSlab *= 2;
+		}
+	pNode = a_pTree -> pvNodeFree;
+	a_pTree -> pvNodeFree = *(void **) pNode;
+	pNode -> cKeys = 0;
+	pNode -> fLeaf = a_fLeaf;
+	if (a_fLeaf)
+		((CHBPlusTreeLeaf *) pNode) -> pLeafPrev = ((CHBPlusTreeLeaf *) pNode) -> pLeafNext = NULL;
+	return pNode;
+	}
+
+static inline void	CHBPlusTreeNodeFree (CHBPlusTreeStorage * a_pTree, void * a_pvNode)
+	{
+	*(void **) a_pvNode = a_pTree -> pvNodeFree;
+	a_pTree -> pvNodeFree = a_pvNode;
+	}
+
+/* The index of the first object in a leaf that is not ordered before a_po, or the number of objects if there is none
+*/
+static inline NSUInteger	CHBPlusTreeLeafLowerBound (CHBPlusTreeStorage * a_pTree, const CHBPlusTreeLeaf * a_pLeaf, id a_po)
+	{
+	NSUInteger	uiLow = 0;
+	NSUInteger	uiHigh = a_pLeaf -> sNode.cKeys;
+	NSUInteger	uiMid;
+
+	while (uiLow < uiHigh)
+		{
+		uiMid = (uiLow + uiHigh) / 2;
+		if (CHSearchTreeCompare (&a_pTree -> sComparator, a_pLeaf -> apoObjects [uiMid], a_po) == NSOrderedAscending)
+			uiLow = uiMid + 1;
+		else
+			uiHigh = uiMid;
+		}
+	return uiLow;
+	}
+
+/* The index of the child of an inner node whose subtree may hold a_po: the number of keys not ordered after it
+*/
+static inline NSUInteger	CHBPlusTreeInnerUpperBound (CHBPlusTreeStorage * a_pTree, const CHBPlusTreeInner * a_pInner, id a_po)
+	{
+	NSUInteger	uiLow = 0;
+	NSUInteger	uiHigh = a_pInner -> sNode.cKeys;
+	NSUInteger	uiMid;
+
+	while (uiLow < uiHigh)
+		{
+		uiMid = (uiLow + uiHigh) / 2;
+		if (CHSearchTreeCompare (&a_pTree -> sComparator, a_pInner -> apoKeys [uiMid], a_po) != NSOrderedDescending)
+			uiLow = uiMid + 1;
+		else
+			uiHigh = uiMid;
+		}
+	return uiLow;
+	}
+
+/* Find the leaf that may hold a_po, and the position in it of the first object not ordered before a_po. If there is no such object in
+	that leaf, the position is its number of objects, and the object, if any, is the first in the next leaf
+*/
+static CHBPlusTreeLeaf *	CHBPlusTreeLowerBound (CHBPlusTreeStorage * a_pTree, id a_po, NSUInteger * a_puiIndex)
+	{
+	CHBPlusTreeNode *	pNode = a_pTree -> pRoot;
+
+	if (pNode == NULL)
+		{
+		*a_puiIndex = 0;
+		return NULL;
+		}
+	while (!pNode -> fLeaf)
+		pNode = CHBPlusTreeChildren (a_pTree, (CHBPlusTreeInner *) pNode) [CHBPlusTreeInnerUpperBound (a_pTree, (CHBPlusTreeInner *) pNode, a_po)];
+	*a_puiIndex = CHBPlusTreeLeafLowerBound (a_pTree, (CHBPlusTreeLeaf *) pNode, a_po);
+	return (CHBPlusTreeLeaf *) pNode;
+	}
+
+static id	CHBPlusTreeMember (CHBPlusTreeStorage * a_pTree, id a_po)
+	{
+	CHBPlusTreeLeaf *	pLeaf;
+	NSUInteger			uiIndex;
+
+	pLeaf = CHBPlusTreeLowerBound (a_pTree, a_po, &uiIndex);
+	if ((pLeaf != NULL) && (uiIndex < pLeaf -> sNode.cKeys) && (CHSearchTreeCompare (&a_pTree -> sComparator, pLeaf -> apoObjects [uiIndex], a_po) == NSOrderedSame))
+		return pLeaf -> apoObjects [uiIndex];
+	return nil;
+	}
+
+/* Insert a_poKey at index a_uiKey, and the child to its right, a_pChild, into an inner node that is not full. The key is already retained
+*/
+static inline void	CHBPlusTreeInnerInsert (CHBPlusTreeStorage * a_pTree, CHBPlusTreeInner * a_pInner, NSUInteger a_uiKey, id a_poKey, CHBPlusTreeNode * a_pChild)
+	{
+	CHBPlusTreeNode **	apChildren = CHBPlusTreeChildren (a_pTree, a_pInner);
+	NSUInteger			cKeys = a_pInner -> sNode.cKeys;
+
+	memmove (a_pInner -> apoKeys + a_uiKey + 1, a_pInner -> apoKeys + a_uiKey, (cKeys - a_uiKey) * sizeof (id));
+	memmove (apChildren + a_uiKey + 2, apChildren + a_uiKey + 1, (cKeys - a_uiKey) * sizeof (CHBPlusTreeNode *));
+	a_pInner -> apoKeys [a_uiKey] = a_poKey;
+	apChildren [a_uiKey + 1] = a_pChild;
+	a_pInner -> sNode.cKeys ++;
+	}
+
+/* Split a full leaf, as if a_po had first been inserted at index a_uiIndex. The left half stays in a_pLeaf, and the right half moves to a new leaf,
+	which is returned. Its first object is the separator between them
+*/
+static CHBPlusTreeLeaf *	CHBPlusTreeLeafSplit (CHBPlusTreeStorage * a_pTree, CHBPlusTreeLeaf * a_pLeaf, NSUInteger a_uiIndex, id a_po)
+	{
+	CHBPlusTreeLeaf *	pRight = (CHBPlusTreeLeaf *) CHBPlusTreeNodeAlloc (a_pTree, true);
+	NSUInteger			cObjects = a_pLeaf -> sNode.cKeys + 1;		/* Including a_po */
+	NSUInteger			cLeft = cObjects / 2;
+	NSUInteger			ui;
+	NSUInteger			uiFrom;
+
+	for (ui = cLeft; ui < cObjects; ui ++)							/* Object ui of the leaf with a_po inserted */
+		{
+		uiFrom = ui - cLeft;
+		pRight -> apoObjects [uiFrom] = (ui < a_uiIndex) ? a_pLeaf -> apoObjects [ui] : (ui == a_uiIndex) ? a_po : a_pLeaf -> apoObjects [ui - 1];
+		}
+	if (a_uiIndex < cLeft)
+		{
+		memmove (a_pLeaf -> apoObjects + a_uiIndex + 1, a_pLeaf -> apoObjects + a_uiIndex, (cLeft - 1 - a_uiIndex) * sizeof (id));
+		a_pLeaf -> apoObjects [a_uiIndex] = a_po;
+		}
+	pRight -> sNode.cKeys = (uint32_t) (cObjects - cLeft);
+	a_pLeaf -> sNode.cKeys = (uint32_t) cLeft;
+	pRight -> pLeafPrev = a_pLeaf;
+	pRight -> pLeafNext = a_pLeaf -> pLeafNext;
+	if (a_pLeaf -> pLeafNext != NULL)
+		a_pLeaf -> pLeafNext -> pLeafPrev = pRight;
+	else
+		a_pTree -> pLeafLast = pRight;
+	a_pLeaf -> pLeafNext = pRight;
+	return pRight;
+	}
+
+/* Split a full inner node, as if a_poKey and a_pChild had first been inserted at a_uiKey. The left half stays in a_pInner, and the right half
+	moves to a new node, which is returned. The middle key moves up to the parent, through *a_ppoKeyUp
+*/
+static CHBPlusTreeInner *	CHBPlusTreeInnerSplit (CHBPlusTreeStorage * a_pTree, CHBPlusTreeInner * a_pInner, NSUInteger a_uiKey, id a_poKey, CHBPlusTreeNode * a_pChild, id * a_ppoKeyUp)
+	{
+	CHBPlusTreeInner *	pRight = (CHBPlusTreeInner *) CHBPlusTreeNodeAlloc (a_pTree, false);
+	CHBPlusTreeNode **	apChildren = CHBPlusTreeChildren (a_pTree, a_pInner);
+	CHBPlusTreeNode **	apChildrenRight = CHBPlusTreeChildren (a_pTree, pRight);
+	NSUInteger			cKeys = a_pInner -> sNode.cKeys + 1;			/* Including a_poKey */
+	NSUInteger			uiMid = cKeys / 2;
+	NSUInteger			ui;
+
+	/* Key ui and child ui of the node with a_poKey and a_pChild inserted */
+	#define CHBPlusTreeInsertedKey(ui)		(((ui) < a_uiKey) ? a_pInner -> apoKeys [(ui)] : ((ui) == a_uiKey) ? a_poKey : a_pInner -> apoKeys [(ui) - 1])
+	#define CHBPlusTreeInsertedChild(ui)	(((ui) <= a_uiKey) ? apChildren [(ui)] : ((ui) == a_uiKey + 1) ? a_pChild : apChildren [(ui) - 1])
+	for (ui = uiMid + 1; ui < cKeys; ui ++)
+		pRight -> apoKeys [ui - uiMid - 1] = CHBPlusTreeInsertedKey (ui);
+	for (ui = uiMid + 1; ui <= cKeys; ui ++)
+		apChildrenRight [ui - uiMid - 1] = CHBPlusTreeInsertedChild (ui);
+	*a_ppoKeyUp = CHBPlusTreeInsertedKey (uiMid);
+	#undef CHBPlusTreeInsertedKey
+	#undef CHBPlusTreeInsertedChild
+	if (a_uiKey < uiMid)											/* Otherwise the left half is already in place */
+		{
+		memmove (a_pInner -> apoKeys + a_uiKey + 1, a_pInner -> apoKeys + a_uiKey, (uiMid - 1 - a_uiKey) * sizeof (id));
+		memmove (apChildren + a_uiKey + 2, apChildren + a_uiKey + 1, (uiMid - 1 - a_uiKey) * sizeof (CHBPlusTreeNode *));
+		a_pInner -> apoKeys [a_uiKey] = a_poKey;
+		apChildren [a_uiKey + 1] = a_pChild;
+		}
+	pRight -> sNode.cKeys = (uint32_t) (cKeys - uiMid - 1);
+	a_pInner -> sNode.cKeys = (uint32_t) uiMid;
+	return pRight;
+	}
+
+/* Add an object, or replace the object that is ordered the same. The descent records its path, and splits of full nodes are carried back up it
+*/
+static void	CHBPlusTreeAdd (CHBPlusTreeStorage * a_pTree, id a_po)
+	{
+	CHBPlusTreeInner *	apInner [kCHBPlusTreeHeightMax];
+	NSUInteger			auiChild [kCHBPlusTreeHeightMax];
+	CHBPlusTreeNode *	pNode;
+	CHBPlusTreeNode *	pNodeRight;
+	CHBPlusTreeLeaf *	pLeaf;
+	CHBPlusTreeInner *	pInner;
+	NSUInteger			cPath;
+	NSUInteger			uiIndex;
+	id					poKey;
+
+	a_pTree -> ulMutations ++;
+	if (a_pTree -> pRoot == NULL)
+		{
+		pLeaf = (CHBPlusTreeLeaf *) CHBPlusTreeNodeAlloc (a_pTree, true);
+		pLeaf -> apoObjects [0] = [a_po retain];
+		pLeaf -> sNode.cKeys = 1;
+		a_pTree -> pRoot = &pLeaf -> sNode;
+		a_pTree -> pLeafFirst = a_pTree -> pLeafLast = pLeaf;
+		a_pTree -> cHeight = 1;
+		a_pTree -> cObjects = 1;
+		return;
+		}
+	cPath = 0;
+	for (pNode = a_pTree -> pRoot; !pNode -> fLeaf; pNode = CHBPlusTreeChildren (a_pTree, pInner) [uiIndex])
+		{
+		pInner = (CHBPlusTreeInner *) pNode;
+		uiIndex = CHBPlusTreeInnerUpperBound (a_pTree, pInner, a_po);
+		apInner [cPath] = pInner;
+		auiChild [cPath ++] = uiIndex;
+		}
+	pLeaf = (CHBPlusTreeLeaf *) pNode;
+	uiIndex = CHBPlusTreeLeafLowerBound (a_pTree, pLeaf, a_po);
+	if ((uiIndex < pLeaf -> sNode.cKeys) && (CHSearchTreeCompare (&a_pTree -> sComparator, pLeaf -> apoObjects [uiIndex], a_po) == NSOrderedSame))
+		{
+		[a_po retain];
+		[pLeaf -> apoObjects [uiIndex] release];
+		pLeaf -> apoObjects [uiIndex] = a_po;
+		return;
+		}
+	[a_po retain];
+	a_pTree -> cObjects ++;
+	if (pLeaf -> sNode.cKeys < a_pTree -> cLeafMax)
+		{
+		memmove (pLeaf -> apoObjects + uiIndex + 1, pLeaf -> apoObjects + uiIndex, (pLeaf -> sNode.cKeys - uiIndex) * sizeof (id));
+		pLeaf -> apoObjects [uiIndex] = a_po;
+		pLeaf -> sNode.cKeys ++;
+		return;
+		}
+	pNodeRight = &CHBPlusTreeLeafSplit (a_pTree, pLeaf, uiIndex, a_po) -> sNode;
+	poKey = [((CHBPlusTreeLeaf *) pNodeRight) -> apoObjects [0] retain];
+	while (cPath != 0)
+		{
+		pInner = apInner [-- cPath];
+		uiIndex = auiChild [cPath];
+		if (pInner -> sNode.cKeys < a_pTree -> cInnerMax)
+			{
+			CHBPlusTreeInnerInsert (a_pTree, pInner, uiIndex, poKey, pNodeRight);
+			return;
+			}
+		pNodeRight = &CHBPlusTreeInnerSplit (a_pTree, pInner, uiIndex, poKey, pNodeRight, &poKey) -> sNode;
+		}
+	pInner = (CHBPlusTreeInner *) CHBPlusTreeNodeAlloc (a_pTree, false);		/* The root was split, so grow a new one above it */
+	pInner -> apoKeys [0] = poKey;
+	CHBPlusTreeChildren (a_pTree, pInner) [0] = a_pTree -> pRoot;
+	CHBPlusTreeChildren (a_pTree, pInner) [1] = pNodeRight;
+	pInner -> sNode.cKeys = 1;
+	a_pTree -> pRoot = &pInner -> sNode;
+	a_pTree -> cHeight ++;
+	}
+
+/* The fewest keys that a node other than the root may hold
+*/
+static inline NSUInteger	CHBPlusTreeNodeMin (const CHBPlusTreeStorage * a_pTree, const CHBPlusTreeNode * a_pNode)
+	{
+	return (a_pNode -> fLeaf ? a_pTree -> cLeafMax : a_pTree -> cInnerMax) / 2;
+	}
+
+/* Move the last object or child of the left sibling of child a_uiChild of a_pParent to the front of that child, through the separator between them
+*/
+static void	CHBPlusTreeBorrowLeft (CHBPlusTreeStorage * a_pTree, CHBPlusTreeInner * a_pParent, NSUInteger a_uiChild)
+	{
+	CHBPlusTreeNode **	apChildren = CHBPlusTreeChildren (a_pTree, a_pParent);
+	CHBPlusTreeNode *	pLeft = apChildren [a_uiChild - 1];
+	CHBPlusTreeNode *	pNode = apChildren [a_uiChild];
+	CHBPlusTreeLeaf *	pLeafLeft;
+	CHBPlusTreeLeaf *	pLeaf;
+	CHBPlusTreeInner *	pInnerLeft;
+	CHBPlusTreeInner *	pInner;
+	CHBPlusTreeNode **	apChildrenNode;
+
+	if (pNode -> fLeaf)
+		{
+		pLeafLeft = (CHBPlusTreeLeaf *) pLeft;
+		pLeaf = (CHBPlusTreeLeaf *) pNode;
+		memmove (pLeaf -> apoObjects + 1, pLeaf -> apoObjects, pLeaf -> sNode.cKeys * sizeof (id));
+		pLeaf -> apoObjects [0] = pLeafLeft -> apoObjects [-- pLeafLeft -> sNode.cKeys];
+		pLeaf -> sNode.cKeys ++;
+		[a_pParent -> apoKeys [a_uiChild - 1] release];
+		a_pParent -> apoKeys [a_uiChild - 1] = [pLeaf -> apoObjects [0] retain];
+		}
+	else
+		{
+		pInnerLeft = (CHBPlusTreeInner *) pLeft;
+		pInner = (CHBPlusTreeInner *) pNode;
+		apChildrenNode = CHBPlusTreeChildren (a_pTree, pInner);
+		memmove (pInner -> apoKeys + 1, pInner -> apoKeys, pInner -> sNode.cKeys * sizeof (id));
+		memmove (apChildrenNode + 1, apChildrenNode, (pInner -> sNode.cKeys + 1) * sizeof (CHBPlusTreeNode *));
+		pInner -> apoKeys [0] = a_pParent -> apoKeys [a_uiChild - 1];
+		apChildrenNode [0] = CHBPlusTreeChildren (a_pTree, pInnerLeft) [pInnerLeft -> sNode.cKeys];
+		pInner -> sNode.cKeys ++;
+		a_pParent -> apoKeys [a_uiChild - 1] = pInnerLeft -> apoKeys [-- pInnerLeft -> sNode.cKeys];
+		}
+	}
+
+/* Move the first object or child of the right sibling of child a_uiChild of a_pParent to the end of that child, through the separator between them
+*/
+static void	CHBPlusTreeBorrowRight (CHBPlusTreeStorage * a_pTree, CHBPlusTreeInner * a_pParent, NSUInteger a_uiChild)
+	{
+	CHBPlusTreeNode **	apChildren = CHBPlusTreeChildren (a_pTree, a_pParent);
+	CHBPlusTreeNode *	pNode = apChildren [a_uiChild];
+	CHBPlusTreeNode *	pRight = apChildren [a_uiChild + 1];
+	CHBPlusTreeLeaf *	pLeafRight;
+	CHBPlusTreeLeaf *	pLeaf;
+	CHBPlusTreeInner *	pInnerRight;
+	CHBPlusTreeInner *	pInner;
+	CHBPlusTreeNode **	apChildrenRight;
+
+	if (pNode -> fLeaf)
+		{
+		pLeafRight = (CHBPlusTreeLeaf *) pRight;
+		pLeaf = (CHBPlusTreeLeaf *) pNode;
+		pLeaf -> apoObjects [pLeaf -> sNode.cKeys ++] = pLeafRight -> apoObjects [0];
+		memmove (pLeafRight -> apoObjects, pLeafRight -> apoObjects + 1, -- pLeafRight -> sNode.cKeys * sizeof (id));
+		[a_pParent -> apoKeys [a_uiChild] release];
+		a_pParent -> apoKeys [a_uiChild] = [pLeafRight -> apoObjects [0] retain];
+		}
+	else
+		{
+		pInnerRight = (CHBPlusTreeInner *) pRight;
+		pInner = (CHBPlusTreeInner *) pNode;
+		apChildrenRight = CHBPlusTreeChildren (a_pTree, pInnerRight);
+		pInner -> apoKeys [pInner -> sNode.cKeys] = a_pParent -> apoKeys [a_uiChild];
+		CHBPlusTreeChildren (a_pTree, pInner) [pInner -> sNode.cKeys + 1] = apChildrenRight [0];
+		pInner -> sNode.cKeys ++;
+		a_pParent -> apoKeys [a_uiChild] = pInnerRight -> apoKeys [0];
+		memmove (pInnerRight -> apoKeys, pInnerRight -> apoKeys + 1, (pInnerRight -> sNode.cKeys - 1) * sizeof (id));
+		memmove (apChildrenRight, apChildrenRight + 1, pInnerRight -> sNode.cKeys * sizeof (CHBPlusTreeNode *));
+		pInnerRight -> sNode.cKeys --;
+		}
+	}
+
+/* Merge child a_uiKey + 1 of a_pParent into child a_uiKey, and remove the separator between them from the parent. A leaf separator is released,
+	since the leaves hold all the objects, while an inner separator moves down into the merged node
+*/
+static void	CHBPlusTreeMerge (CHBPlusTreeStorage * a_pTree, CHBPlusTreeInner * a_pParent, NSUInteger a_uiKey)
+	{
+	CHBPlusTreeNode **	apChildren = CHBPlusTreeChildren (a_pTree, a_pParent);
+	CHBPlusTreeNode *	pLeft = apChildren [a_uiKey];
+	CHBPlusTreeNode *	pRight = apChildren [a_uiKey + 1];
+	CHBPlusTreeLeaf *	pLeafLeft;
+	CHBPlusTreeLeaf *	pLeafRight;
+	CHBPlusTreeInner *	pInnerLeft;
+	CHBPlusTreeInner *	pInnerRight;
+
+	if (pLeft -> fLeaf)
+		{
+		pLeafLeft = (CHBPlusTreeLeaf *) pLeft;
+		pLeafRight = (CHBPlusTreeLeaf *) pRight;
+		memcpy (pLeafLeft -> apoObjects + pLeafLeft -> sNode.cKeys, pLeafRight -> apoObjects, pLeafRight -> sNode.cKeys * sizeof (id));
+		pLeafLeft -> sNode.cKeys += pLeafRight -> sNode.cKeys;
+		pLeafLeft -> pLeafNext = pLeafRight -> pLeafNext;
+		if (pLeafRight -> pLeafNext != NULL)
+			pLeafRight -> pLeafNext -> pLeafPrev = pLeafLeft;
+		else
+			a_pTree -> pLeafLast = pLeafLeft;
+		[a_pParent -> apoKeys [a_uiKey] release];
+		}
+	else
+		{
+		pInnerLeft = (CHBPlusTreeInner *) pLeft;
+		pInnerRight = (CHBPlusTreeInner *) pRight;
+		pInnerLeft -> apoKeys [pInnerLeft -> sNode.cKeys] = a_pParent -> apoKeys [a_uiKey];
+		memcpy (pInnerLeft -> apoKeys + pInnerLeft -> sNode.cKeys + 1, pInnerRight -> apoKeys, pInnerRight -> sNode.cKeys * sizeof (id));
+		memcpy (CHBPlusTreeChildren (a_pTree, pInnerLeft) + pInnerLeft -> sNode.cKeys + 1, CHBPlusTreeChildren (a_pTree, pInnerRight), (pInnerRight -> sNode.cKeys + 1) * sizeof (CHBPlusTreeNode *));
+		pInnerLeft -> sNode.cKeys += pInnerRight -> sNode.cKeys + 1;
+		}
+	CHBPlusTreeNodeFree (a_pTree, pRight);
+	memmove (a_pParent -> apoKeys + a_uiKey, a_pParent -> apoKeys + a_uiKey + 1, (a_pParent -> sNode.cKeys - a_uiKey - 1) * sizeof (id));
+	memmove (apChildren + a_uiKey + 1, apChildren + a_uiKey + 2, (a_pParent -> sNode.cKeys - a_uiKey - 1) * sizeof (CHBPlusTreeNode *));
+	a_pParent -> sNode.cKeys --;
+	}
+
+/* Remove the object ordered the same as a_po, if there is one. Each node left less than half full borrows from a sibling that can spare an object
+	or child, or else is merged with one, which takes a key from the parent and may leave it less than half full in turn
+*/
+static bool	CHBPlusTreeRemove (CHBPlusTreeStorage * a_pTree, id a_po)
+	{
+	CHBPlusTreeInner *	apInner [kCHBPlusTreeHeightMax];
+	NSUInteger			auiChild [kCHBPlusTreeHeightMax];
+	CHBPlusTreeNode *	pNode;
+	CHBPlusTreeLeaf *	pLeaf;
+	CHBPlusTreeInner *	pInner;
+	CHBPlusTreeNode **	apChildren;
+	NSUInteger			cPath;
+	NSUInteger			uiIndex;
+
+	if (a_pTree -> pRoot == NULL)
+		return false;
+	cPath = 0;
+	for (pNode = a_pTree -> pRoot; !pNode -> fLeaf; pNode = CHBPlusTreeChildren (a_pTree, pInner) [uiIndex])
+		{
+		pInner = (CHBPlusTreeInner *) pNode;
+		uiIndex = CHBPlusTreeInnerUpperBound (a_pTree, pInner, a_po);
+		apInner [cPath] = pInner;
+		auiChild [cPath ++] = uiIndex;
+		}
+	pLeaf = (CHBPlusTreeLeaf *) pNode;
+	uiIndex = CHBPlusTreeLeafLowerBound (a_pTree, pLeaf, a_po);
+	if ((uiIndex == pLeaf -> sNode.cKeys) || (CHSearchTreeCompare (&a_pTree -> sComparator, pLeaf -> apoObjects [uiIndex], a_po) != NSOrderedSame))
+		return false;
+	[pLeaf -> apoObjects [uiIndex] release];
+	memmove (pLeaf -> apoObjects + uiIndex, pLeaf -> apoObjects + uiIndex + 1, (pLeaf -> sNode.cKeys - uiIndex - 1) * sizeof (id));
+	pLeaf -> sNode.cKeys --;
+	a_pTree -> cObjects --;
+	a_pTree -> ulMutations ++;
+	while ((cPath != 0) && (pNode -> cKeys < CHBPlusTreeNodeMin (a_pTree, pNode)))
+		{
+		pInner = apInner [-- cPath];
+		uiIndex = auiChild [cPath];
+		apChildren = CHBPlusTreeChildren (a_pTree, pInner);
+		if ((uiIndex > 0) && (apChildren [uiIndex - 1] -> cKeys > CHBPlusTreeNodeMin (a_pTree, pNode)))
+			{
+			CHBPlusTreeBorrowLeft (a_pTree, pInner, uiIndex);
+			break;
+			}
+		if ((uiIndex < pInner -> sNode.cKeys) && (apChildren [uiIndex + 1] -> cKeys > CHBPlusTreeNodeMin (a_pTree, pNode)))
+			{
+			CHBPlusTreeBorrowRight (a_pTree, pInner, uiIndex);
+			break;
+			}
+		CHBPlusTreeMerge (a_pTree, pInner, (uiIndex > 0) ? uiIndex - 1 : uiIndex);
+		pNode = &pInner -> sNode;
+		}
+	pNode = a_pTree -> pRoot;
+	if (pNode -> cKeys == 0)
+		{
+		if (pNode -> fLeaf)												/* The last object was removed */
+			{
+			a_pTree -> pRoot = NULL;
+			a_pTree -> pLeafFirst = a_pTree -> pLeafLast = NULL;
+			}
+		else															/* The root's only two children were merged */
+			a_pTree -> pRoot = CHBPlusTreeChildren (a_pTree, (CHBPlusTreeInner *) pNode) [0];
+		CHBPlusTreeNodeFree (a_pTree, pNode);
+		a_pTree -> cHeight --;
+		}
+	return true;
+	}
+
+static void	CHBPlusTreeReleaseKeys (CHBPlusTreeStorage * a_pTree, CHBPlusTreeNode * a_pNode)
+	{
+	NSUInteger	ui;
+
+	if (a_pNode -> fLeaf)
+		return;
+	for (ui = 0; ui < a_pNode -> cKeys; ui ++)
+		[((CHBPlusTreeInner *) a_pNode) -> apoKeys [ui] release];
+	for (ui = 0; ui <= a_pNode -> cKeys; ui ++)
+		CHBPlusTreeReleaseKeys (a_pTree, CHBPlusTreeChildren (a_pTree, (CHBPlusTreeInner *) a_pNode) [ui]);
+	}
+
+/* Release every object and key, and free all the nodes
+*/
+static void	CHBPlusTreeRemoveAll (CHBPlusTreeStorage * a_pTree)
+	{
+	struct CHBPlusTreeSlab *	pSlab;
+	CHBPlusTreeLeaf *			pLeaf;
+	NSUInteger					ui;
+
+	if (a_pTree -> pRoot != NULL)
+		{
+		CHBPlusTreeReleaseKeys (a_pTree, a_pTree -> pRoot);
+		for (pLeaf = a_pTree -> pLeafFirst; pLeaf != NULL; pLeaf = pLeaf -> pLeafNext)
+			for (ui = 0; ui < pLeaf -> sNode.cKeys; ui ++)
+				[pLeaf -> apoObjects [ui] release];
+		a_pTree -> ulMutations ++;
+		}
+	while ((pSlab = a_pTree -> pSlabs) != NULL)
+		{
+		a_pTree -> pSlabs = pSlab -> pSlabNext;
+		free (pSlab);
+		}
+	a_pTree -> pRoot = NULL;
+	a_pTree -> pLeafFirst = a_pTree -> pLeafLast = NULL;
+	a_pTree -> pvNodeFree = NULL;
+	a_pTree -> cNodesSlab = 0;
+	a_pTree -> cObjects = 0;
+	a_pTree -> cHeight = 0;
+	}
+
+/* Replace the contents of a tree with objects in strictly ascending order, which are retained, in linear time. The objects are spread evenly over as
+	few leaves as will hold them, and each level of inner nodes is built in the same way above the last, so every node is at least half full. Each
+	separator is the first object of the subtree to its right
+*/
+static void	CHBPlusTreeBuild (CHBPlusTreeStorage * a_pTree, id * a_apo, NSUInteger a_cObjects)
+	{
+	CHBPlusTreeNode **	apLevel;
+	id *				apoFirst;
+	CHBPlusTreeLeaf *	pLeaf;
+	CHBPlusTreeLeaf *	pLeafPrev;
+	CHBPlusTreeInner *	pInner;
+	NSUInteger			cNodes;
+	NSUInteger			cNodesAbove;
+	NSUInteger			cNodesTotal;
+	NSUInteger			cPerNode;
+	NSUInteger			ui;
+	NSUInteger			uiNode;
+	NSUInteger			uiFrom;
+	unsigned long		ulMutations = a_pTree -> ulMutations;
+
+	CHBPlusTreeRemoveAll (a_pTree);
+	a_pTree -> ulMutations = ulMutations + 1;
+	if (a_cObjects == 0)
+		return;
+	cNodes = (a_cObjects + a_pTree -> cLeafMax - 1) / a_pTree -> cLeafMax;
+	for (cNodesTotal = cNodes, cNodesAbove = cNodes; cNodesAbove > 1; cNodesTotal += cNodesAbove)
+		cNodesAbove = (cNodesAbove + a_pTree -> cInnerMax) / (a_pTree -> cInnerMax + 1);
+	CHBPlusTreeGrow (a_pTree, cNodesTotal);							/* A single slab for all the nodes */
+	apLevel = malloc (cNodes * (sizeof (CHBPlusTreeNode *) + sizeof (id)));
+	if (apLevel == NULL)
+		[NSException raise:NSMallocException format:@"Unable to allocate %lu nodes", (unsigned long) cNodes];
+	apoFirst = (id *) (apLevel + cNodes);
+	pLeafPrev = NULL;
+	for (uiNode = 0, uiFrom = 0; uiNode < cNodes; uiNode ++)
+		{
+		cPerNode = a_cObjects / cNodes + (uiNode < a_cObjects % cNodes);
+		pLeaf = (CHBPlusTreeLeaf *) CHBPlusTreeNodeAlloc (a_pTree, true);
+		for (ui = 0; ui < cPerNode; ui ++)
+			pLeaf -> apoObjects [ui] = [a_apo [uiFrom ++] retain];
+		pLeaf -> sNode.cKeys = (uint32_t) cPerNode;
+		pLeaf -> pLeafPrev = pLeafPrev;
+		if (pLeafPrev != NULL)
+			pLeafPrev -> pLeafNext = pLeaf;
+		else
+			a_pTree -> pLeafFirst = pLeaf;
+		pLeafPrev = pLeaf;
+		apLevel [uiNode] = &pLeaf -> sNode;
+		apoFirst [uiNode] = pLeaf -> apoObjects [0];
+		}
+	a_pTree -> pLeafLast = pLeafPrev;
+	a_pTree -> cHeight = 1;
+	while (cNodes > 1)												/* Each node above replaces its first child in the arrays */
+		{
+		cNodesAbove = (cNodes + a_pTree -> cInnerMax) / (a_pTree -> cInnerMax + 1);
+		for (uiNode = 0, uiFrom = 0; uiNode < cNodesAbove; uiNode ++)
+			{
+			cPerNode = cNodes / cNodesAbove + (uiNode < cNodes % cNodesAbove);
+			pInner = (CHBPlusTreeInner *) CHBPlusTreeNodeAlloc (a_pTree, false);
+			CHBPlusTreeChildren (a_pTree, pInner) [0] = apLevel [uiFrom];
+			for (ui = 1; ui < cPerNode; ui ++)
+				{
+				pInner -> apoKeys [ui - 1] = [apoFirst [uiFrom + ui] retain];
+				CHBPlusTreeChildren (a_pTree, pInner) [ui] = apLevel [uiFrom + ui];
+				}
+			pInner -> sNode.cKeys = (uint32_t) (cPerNode - 1);
+			apoFirst [uiNode] = apoFirst [uiFrom];
+			apLevel [uiNode] = &pInner -> sNode;
+			uiFrom += cPerNode;
+			}
+		cNodes = cNodesAbove;
+		a_pTree -> cHeight ++;
+		}
+	a_pTree -> pRoot = apLevel [0];
+	a_pTree -> cObjects = a_cObjects;
+	free (apLevel);
+	}
+
+#pragma mark -
+
+/**
+ An NSEnumerator for CHBPlusTree, which steps through the objects of each leaf, and along the chain of leaves, in ascending or descending order.
+ */
+@interface CHBPlusTreeEnumerator : CHCollectionEnumerator
+{
+	CHBPlusTreeLeaf *leaf; // The leaf holding the next object.
+	NSUInteger index; // The index of the next object in the leaf.
+	BOOL reverse; // Whether the enumeration is in descending order.
+}
+
+- (id) initWithTree:(CHBPlusTree*)bPlusTree
+            storage:(const CHBPlusTreeStorage*)treeStorage
+            reverse:(BOOL)descending;
+
+@end
+
+@implementation CHBPlusTreeEnumerator
+
+- (id) initWithTree:(CHBPlusTree*)bPlusTree
+            storage:(const CHBPlusTreeStorage*)treeStorage
+            reverse:(BOOL)descending
+{
+	if ((self = [super initWithCollection:bPlusTree mutations:&treeStorage->ulMutations]) == nil) return nil;
+	reverse = descending;
+	leaf = reverse ? treeStorage->pLeafLast : treeStorage->pLeafFirst;
+	if (leaf != NULL)
+		index = reverse ? leaf->sNode.cKeys - 1 : 0;
+	return self;
+}
+
+- (id) nextObjectFromCollection {
+	if (leaf == NULL)
+		return nil;
+	id anObject = leaf->apoObjects[index];
+	if (reverse) {
+		if (index-- == 0 && (leaf = leaf->pLeafPrev) != NULL)
+			index = leaf->sNode.cKeys - 1;
+	} else if (++index == leaf->sNode.cKeys) {
+		leaf = leaf->pLeafNext;
+		index = 0;
+	}
+	return anObject;
+}
+
+@end
+
+#pragma mark -
+
+@implementation CHBPlusTree
+
+- (void) dealloc {
+	CHBPlusTreeRemoveAll(&m_sTree);
+	if (m_sTree.sComparator.eKind == CHComparatorKindBlock)
+		[(id) m_sTree.sComparator.pvContext release];
+	CHCompareCacheFree(m_sTree.sComparator.apCache);
+	[super dealloc];
+}
+
+// This is the designated initializer for CHBPlusTree.
+- (id) initWithCacheLinesPerNode:(NSUInteger)lines {
+	if (lines < 1 || lines > kCHBPlusTreeMaxCacheLinesPerNode) {
+		Class aClass = [self class];
+		[self release];
+		CHInvalidArgumentException(aClass, _cmd, @"Nodes must be from 1 to kCHBPlusTreeMaxCacheLinesPerNode cache lines");
+	}
+	if ((self = [super init]) == nil) return nil;
+	CHBPlusTreeInit(&m_sTree, lines);
+	return self;
+}
+
+- (id) init {
+	return [self initWithCacheLinesPerNode:kCHBPlusTreeDefaultCacheLinesPerNode];
+}
+
+- (id) initWithCompareFunction:(CHCompareFunction)a_pfnCompare context:(void*)a_pvContext {
+	if (a_pfnCompare == NULL) {
+		Class aClass = [self class];
+		[self release];
+		CHNilArgumentException(aClass, _cmd);
+	}
+	if ((self = [self init]) == nil) return nil;
+	m_sTree.sComparator.pvContext = a_pvContext;
+	m_sTree.sComparator.pfnCompare = a_pfnCompare;
+	m_sTree.sComparator.eKind = CHComparatorKindFunction;
+	return self;
+}
+
+- (id) initWithArray:(NSArray*)anArray {
+	if ((self = [self init]) == nil) return nil;
+	[self loadObjectsFromArray:anArray checkSorted:NO];
+	return self;
+}
+
+- (id) initWithSortedArray:(NSArray*)anArray {
+	if ((self = [self init]) == nil) return nil;
+	[self loadObjectsFromArray:anArray checkSorted:YES];
+	return self;
+}
+
+- (NSUInteger) cacheLinesPerNode {
+	return m_sTree.cbNode / kCHCacheLineSize;
+}
+
+- (NSUInteger) height {
+	return m_sTree.cHeight;
+}
+
+// Replaces the contents of the receiver with the objects in an array, loaded in bulk in ascending order. Unless checkSorted, they are sorted
+// without first checking whether they are already in order.
+- (void) loadObjectsFromArray:(NSArray*)anArray checkSorted:(BOOL)checkSorted {
+	NSUInteger objectCount;
+	id *objects = CHSearchTreeCopySortedObjects(&m_sTree.sComparator, anArray, checkSorted, &objectCount);
+	CHBPlusTreeBuild(&m_sTree, objects, objectCount);
+	free(objects);
+}
+
+// Returns a new tree with the receiver's node size and comparator, loaded with objects in strictly ascending order.
+- (id) newTreeWithSortedObjects:(id*)objects count:(NSUInteger)objectCount {
+	CHBPlusTree *newTree = [[[self class] alloc] initWithCacheLinesPerNode:[self cacheLinesPerNode]];
+	CHSearchTreeComparatorCopy(&newTree->m_sTree.sComparator, &m_sTree.sComparator);
+	CHBPlusTreeBuild(&newTree->m_sTree, objects, objectCount);
+	return newTree;
+}
+
+// Returns every object in ascending order, in a malloc()ed buffer that the caller must free.
+- (id*) copyAllObjects {
+	id *objects = malloc(kCHPointerSize * (m_sTree.cObjects + 1));
+	NSUInteger objectCount = 0;
+	if (objects == NULL)
+		[NSException raise:NSMallocException format:@"Unable to allocate %lu objects", (unsigned long) m_sTree.cObjects];
+	for (CHBPlusTreeLeaf *leaf = m_sTree.pLeafFirst; leaf != NULL; leaf = leaf->pLeafNext) {
+		memcpy(objects + objectCount, leaf->apoObjects, leaf->sNode.cKeys * kCHPointerSize);
+		objectCount += leaf->sNode.cKeys;
+	}
+	return objects;
+}
+
+#pragma mark <NSCoding>
+
+- (id) initWithCoder:(NSCoder*)decoder {
+	unsigned int lines;
+	if ([decoder allowsKeyedCoding])
+		lines = (unsigned int) [decoder decodeIntForKey:@"cacheLinesPerNode"];
+	else
+		[decoder decodeValueOfObjCType:@encode(unsigned int) at:&lines];
+	NSArray *array = CHSortedSetDecodeObjects(decoder, self, _cmd);
+	if ((self = [self initWithCacheLinesPerNode:(lines != 0) ? lines : kCHBPlusTreeDefaultCacheLinesPerNode]) == nil) return nil;
+	[self loadObjectsFromArray:array checkSorted:YES];	// The objects were archived in ascending order
+	return self;
+}
+
+- (void) encodeWithCoder:(NSCoder*)encoder {
+	unsigned int lines = (unsigned int) [self cacheLinesPerNode];
+	if ([encoder allowsKeyedCoding])
+		[encoder encodeInt:(int) lines forKey:@"cacheLinesPerNode"];
+	else
+		[encoder encodeValueOfObjCType:@encode(unsigned int) at:&lines];
+	CHSortedSetEncodeObjects(encoder, self, _cmd, &m_sTree.sComparator, [self allObjects]);
+}
+
+#pragma mark <NSCopying>
+
+- (id) copyWithZone:(NSZone*)zone {
+	(void) zone;
+	id *objects = [self copyAllObjects];
+	id copy = [self newTreeWithSortedObjects:objects count:m_sTree.cObjects];
+	free(objects);
+	return copy;
+}
+
+#pragma mark <NSFastEnumeration>
+
+// Each call returns the objects of one leaf in place, rather than copying them into stackbuf. The next leaf is kept in extra[0].
+- (NSUInteger) countByEnumeratingWithState:(NSFastEnumerationState*)state
+                                   objects:(id*)stackbuf
+                                     count:(NSUInteger)len
+{
+	(void) stackbuf;
+	(void) len;
+	CHBPlusTreeLeaf *leaf;
+	if (state->state == 0) {
+		state->state = 1;
+		state->mutationsPtr = &m_sTree.ulMutations;
+		leaf = m_sTree.pLeafFirst;
+	} else
+		leaf = (CHBPlusTreeLeaf*) state->extra[0];
+	if (leaf == NULL)
+		return 0;
+	state->extra[0] = (unsigned long) leaf->pLeafNext;
+	state->itemsPtr = leaf->apoObjects;
+	return leaf->sNode.cKeys;
+}
+
+#pragma mark Querying Contents
+
+- (NSArray*) allObjects {
+	NSMutableArray *array = [NSMutableArray arrayWithCapacity:m_sTree.cObjects];
+	for (CHBPlusTreeLeaf *leaf = m_sTree.pLeafFirst; leaf != NULL; leaf = leaf->pLeafNext)
+		[array addObjectsFromArray:[NSArray arrayWithObjects:leaf->apoObjects count:leaf->sNode.cKeys]];
+	return array;
+}
+
+// Every object is in a leaf, and every leaf is at the same depth, so each traversal order visits the objects in ascending order, except
+// for a descending traversal.
+- (NSArray*) allObjectsWithTraversalOrder:(CHTraversalOrder)order {
+	return [[self objectEnumeratorWithTraversalOrder:order options:0] allObjects];
+}
+
+- (id) anyObject {
+	return (m_sTree.pLeafFirst != NULL) ? m_sTree.pLeafFirst->apoObjects[0] : nil;
+}
+
+- (NSUInteger) count {
+	return m_sTree.cObjects;
+}
+
+- (BOOL) containsObject:(id)anObject {
+	return (anObject != nil && CHBPlusTreeMember(&m_sTree, anObject) != nil);
+}
+
+- (NSString*) description {
+	return [[self allObjects] description];
+}
+
+- (id) firstObject {
+	return (m_sTree.pLeafFirst != NULL) ? m_sTree.pLeafFirst->apoObjects[0] : nil;
+}
+
+- (NSUInteger) hash {
+	return hashOfCountAndObjects(m_sTree.cObjects, [self firstObject], [self lastObject]);
+}
+
+- (BOOL) isEqual:(id)otherObject {
+	if ([otherObject conformsToProtocol:@protocol(CHSortedSet)])
+		return [self isEqualToSortedSet:otherObject];
+	else
+		return NO;
+}
+
+- (BOOL) isEqualToSearchTree:(id<CHSearchTree>)otherTree {
+	return collectionsAreEqual(self, otherTree);
+}
+
+- (BOOL) isEqualToSortedSet:(id<CHSortedSet>)otherSortedSet {
+	return collectionsAreEqual(self, otherSortedSet);
+}
+
+- (id) lastObject {
+	return (m_sTree.pLeafLast != NULL) ? m_sTree.pLeafLast->apoObjects[m_sTree.pLeafLast->sNode.cKeys - 1] : nil;
+}
+
+- (id) member:(id)anObject {
+	return (anObject != nil) ? CHBPlusTreeMember(&m_sTree, anObject) : nil;
+}
+
+- (NSEnumerator*) objectEnumerator {
+	return [self objectEnumeratorWithTraversalOrder:CHTraverseAscending options:0];
+}
+
+- (NSEnumerator*) objectEnumeratorWithTraversalOrder:(CHTraversalOrder)order options:(unsigned int)a_fuiOptions {
+	(void) a_fuiOptions;
+	if (order > CHTraverseLevelOrder)
+		return nil;
+	return [[[CHBPlusTreeEnumerator alloc] initWithTree:self storage:&m_sTree reverse:(order == CHTraverseDescending)] autorelease];
+}
+
+- (NSEnumerator*) reverseObjectEnumerator {
+	return [self objectEnumeratorWithTraversalOrder:CHTraverseDescending options:0];
+}
+
+- (NSSet*) set {
+	return [NSSet setWithArray:[self allObjects]];
+}
+
+// Finds the leaf and index of the first object at or after start, or after it if the low endpoint is excluded. The leaf is NULL if there is none.
+- (CHBPlusTreeLeaf*) leafFromObject:(id)start index:(NSUInteger*)index excludingEndpoint:(BOOL)exclude {
+	CHBPlusTreeLeaf *leaf = CHBPlusTreeLowerBound(&m_sTree, start, index);
+	if (leaf != NULL && *index == leaf->sNode.cKeys) {
+		leaf = leaf->pLeafNext;
+		*index = 0;
+	}
+	if (exclude && leaf != NULL && CHSearchTreeCompare(&m_sTree.sComparator, leaf->apoObjects[*index], start) == NSOrderedSame) {
+		if (++*index == leaf->sNode.cKeys) {
+			leaf = leaf->pLeafNext;
+			*index = 0;
+		}
+	}
+	return leaf;
+}
+
+// Copies the objects of a run of a subset into a buffer, and returns how many there are. A run to the last object is copied leaf by leaf.
+- (NSUInteger) getObjects:(id*)objects inRun:(const CHSubsetRun*)run {
+	NSUInteger index = 0, objectCount = 0;
+	NSComparisonResult comparison;
+	CHBPlusTreeLeaf *leaf;
+
+	leaf = (run->poStart == nil) ? m_sTree.pLeafFirst : [self leafFromObject:run->poStart index:&index excludingEndpoint:run->fExcludeStart];
+	for ( ; leaf != NULL; leaf = leaf->pLeafNext, index = 0) {
+		if (run->poEnd == nil) {
+			memcpy(objects + objectCount, leaf->apoObjects + index, (leaf->sNode.cKeys - index) * kCHPointerSize);
+			objectCount += leaf->sNode.cKeys - index;
+			continue;
+		}
+		for ( ; index < leaf->sNode.cKeys; index++) {
+			comparison = CHSearchTreeCompare(&m_sTree.sComparator, leaf->apoObjects[index], run->poEnd);
+			if (comparison == NSOrderedDescending || (comparison == NSOrderedSame && run->fExcludeEnd))
+				return objectCount;
+			objects[objectCount++] = leaf->apoObjects[index];
+		}
+	}
+	return objectCount;
+}
+
+// The objects of each run are collected in ascending order from the leaves, and the subset is loaded from them in bulk.
+- (id<CHSortedSet>) subsetFromObject:(id)start
+                            toObject:(id)end
+                             options:(CHSubsetConstructionOptions)options
+{
+	NSUInteger run, runCount, subsetCount = 0;
+	CHSubsetRun runs[2];
+	id *subset;
+
+	subset = malloc(kCHPointerSize * (m_sTree.cObjects + 1));
+	if (subset == NULL)
+		[NSException raise:NSMallocException format:@"Unable to allocate %lu objects", (unsigned long) m_sTree.cObjects];
+	runCount = CHSubsetRuns(start, end, start != nil && end != nil && CHSearchTreeCompare(&m_sTree.sComparator, start, end) == NSOrderedDescending, options, runs);
+	for (run = 0; run < runCount; run++)
+		subsetCount += [self getObjects:subset + subsetCount inRun:&runs[run]];
+	id tree = [self newTreeWithSortedObjects:subset count:subsetCount];
+	free(subset);
+	return [tree autorelease];
+}
+
+#pragma mark Modifying Contents
+
+- (void) addObject:(id)anObject {
+	if (anObject == nil)
+		CHNilArgumentException([self class], _cmd);
+	CHBPlusTreeAdd(&m_sTree, anObject);
+}
+
+- (void) addObjectsFromArray:(NSArray*)anArray {
+	for (id anObject in anArray)
+		[self addObject:anObject];
+}
+
+- (void) removeAllObjects {
+	CHBPlusTreeRemoveAll(&m_sTree);
+}
+
+- (void) removeFirstObject {
+	id anObject = [self firstObject];
+	if (anObject != nil)
+		CHBPlusTreeRemove(&m_sTree, anObject);
+}
+
+- (void) removeLastObject {
+	id anObject = [self lastObject];
+	if (anObject != nil)
+		CHBPlusTreeRemove(&m_sTree, anObject);
+}
+
+- (void) removeObject:(id)anObject {
+	if (anObject != nil)
+		CHBPlusTreeRemove(&m_sTree, anObject);
+}
+
+@end
@@ -30,4 +30,34 @@
 	unsigned long mutations; // Used to track mutations for NSFastEnumeration.
 }
 
+#if defined (__BLOCKS__)
+/**
+ Executes a given block using each object in the heap, in sorted order, as for NSFastEnumeration.
+ 
+ @param block The block to apply to each object. It is passed the object, its index in sorted order, and a reference to a Boolean which the block may set to @c YES to stop the enumeration.
+ 
+ @throw NSInvalidArgumentException if @a block is @c nil.
+ @throw NSGenericException if the block modifies the receiver.
+ 
+ @see enumerateObjectsWithOptions:usingBlock:
+ */
+- (void) enumerateObjectsUsingBlock:(void (^)(id obj, NSUInteger idx, BOOL *stop))block;
+
+/**
+ Executes a given block using each object in the heap, in sorted order, with the given options.
+ 
+ @param opts A mask of NSEnumerationOptions. With @c NSEnumerationReverse, objects are passed from last to first. With @c NSEnumerationConcurrent, the indexes are divided into ranges that workers on a global dispatch queue pass to the block at the same time, in no particular order; the block must then be safe to call from several threads.
+ @param block The block to apply to each object. It is passed the object, its index in sorted order, and a reference to a Boolean which the block may set to @c YES to stop the enumeration.
+ 
+ @throw NSInvalidArgumentException if @a block is @c nil.
+ @throw NSGenericException if the block modifies the receiver.
+ 
+ @attention As with \link CHHeap#allObjectsInSortedOrder -allObjectsInSortedOrder\endlink, the objects are first sorted into a C array, which takes O(n log n) time and O(n) memory.
+ 
+ @see enumerateObjectsUsingBlock:
+ */
+- (void) enumerateObjectsWithOptions:(NSEnumerationOptions)opts
+                          usingBlock:(void (^)(id obj, NSUInteger idx, BOOL *stop))block;
+#endif	/* defined (__BLOCKS__) */
+
 @end
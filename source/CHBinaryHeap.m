@@ -117,6 +117,23 @@ static const CFBinaryHeapCallBacks kCHBinaryHeapCallBacksDescending = {
 	return CFBinaryHeapGetCount(heap);
 }
 
+#if defined (__BLOCKS__)
+- (void) enumerateObjectsUsingBlock:(void (^)(id obj, NSUInteger idx, BOOL *stop))block {
+	[self enumerateObjectsWithOptions:0 usingBlock:block];
+}
+
+// The heap only gives up its values in sorted order, so they are copied into a C array once, without the NSArray that -allObjectsInSortedOrder creates.
+- (void) enumerateObjectsWithOptions:(NSEnumerationOptions)opts
+                          usingBlock:(void (^)(id obj, NSUInteger idx, BOOL *stop))block
+{
+	if (block == nil)
+		CHNilArgumentException([self class], _cmd);
+	CHEnumerateGatheredObjects([self count], ^(id *objects) {
+		CFBinaryHeapGetValues(heap, (const void **) objects);
+	}, opts, block, &mutations, [self class], _cmd);
+}
+#endif	/* defined (__BLOCKS__) */
+
 - (NSString*) description {
 	return [[self allObjectsInSortedOrder] description];
 }
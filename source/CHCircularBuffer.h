@@ -26,6 +26,8 @@
  A <a href="http://en.wikipedia.org/wiki/Circular_buffer">circular buffer</a> is a structure that emulates a continuous ring of N data slots. This class uses a C array and tracks the indexes of the front and back elements in the buffer, such that the first element is treated as logical index 0 regardless of where it is actually stored. The buffer dynamically expands to accommodate added objects. This type of storage is ideal for scenarios where objects are added and removed only at one or both ends (such as a stack or queue) but still supports all normal NSMutableArray functionality.
  
  @note Any method inherited from NSArray or NSMutableArray is supported by this class and its children. Please see the documentation for those classes for details.
+ 
+ Block enumeration reads the C array directly. With @c NSEnumerationConcurrent, the indexes are divided into contiguous ranges, which workers on a global dispatch queue enumerate at the same time.
 */
 @interface CHCircularBuffer : NSMutableArray {
 	__strong id *array; // Primitive C array for storing collection contents.
@@ -47,6 +49,11 @@
 - (BOOL) containsObjectIdenticalTo:(id)anObject;
 - (void) exchangeObjectAtIndex:(NSUInteger)idx1 withObjectAtIndex:(NSUInteger)idx2;
 - (id) firstObject;
+#if defined (__BLOCKS__)
+- (void) enumerateObjectsUsingBlock:(void (^)(id obj, NSUInteger idx, BOOL *stop))block;
+- (void) enumerateObjectsWithOptions:(NSEnumerationOptions)opts
+                          usingBlock:(void (^)(id obj, NSUInteger idx, BOOL *stop))block;
+#endif	/* defined (__BLOCKS__) */
 - (NSUInteger) indexOfObject:(id)anObject;
 - (NSUInteger) indexOfObjectIdenticalTo:(id)anObject;
 - (id) lastObject;
@@ -292,6 +292,21 @@ do { \
 	return count;
 }
 
+#if defined (__BLOCKS__)
+- (void) enumerateObjectsUsingBlock:(void (^)(id obj, NSUInteger idx, BOOL *stop))block {
+	[self enumerateObjectsWithOptions:0 usingBlock:block];
+}
+
+// Reads the slots directly rather than calling -objectAtIndex: for each object. Concurrent enumeration divides the indexes into ranges.
+- (void) enumerateObjectsWithOptions:(NSEnumerationOptions)opts
+                          usingBlock:(void (^)(id obj, NSUInteger idx, BOOL *stop))block
+{
+	if (block == nil)
+		CHNilArgumentException([self class], _cmd);
+	CHEnumerateObjectsInRing(array, arrayCapacity, headIndex, count, opts, block, &mutations, [self class], _cmd);
+}
+#endif	/* defined (__BLOCKS__) */
+
 - (id) firstObject {
 	return (count > 0) ? array[headIndex] : nil;
 }
@@ -0,0 +1,66 @@
+/*
+ CHDataStructures.framework -- CHConcurrentSkipListSet.h
+
+ Copyright (c) 2008-2010, Quinn Taylor <http://homepage.mac.com/quinntaylor>
+
+ This source code is released under the ISC License. <http://www.opensource.org/licenses/isc-license>
+
+ Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby granted, provided that the above copyright notice and this permission notice appear in all copies.
+
+ The software is  provided "as is", without warranty of any kind, including all implied warranties of merchantability and fitness. In no event shall the authors or copyright holders be liable for any claim, damages, or other liability, whether in an action of contract, tort, or otherwise, arising from, out of, or in connection with the software or the use or other dealings in the software.
+
+	Fixes, additions, extensions, port to GNUstep by Christopher Chandler
+	Copyright © 2013-2015	Christopher James Elphinstone Chandler, Russell Geoffrey Watts. All Rights Reserved.
+	Copyright © 2015-2025	Kinnami Software Corporation. All rights reserved.
+ */
+
+#import "CHSortedSet.h"
+#import "CHAbstractBinarySearchTree.h"
+
+/**
+ @file CHConcurrentSkipListSet.h
+ A lock-free <a href="http://en.wikipedia.org/wiki/Skip_list">skip list</a> implementation of CHSortedSet, which many threads may read and modify at once.
+ */
+
+/** The greatest number of levels in a concurrent skip list. */
+#define kCHConcurrentSkipListMaxLevel	32
+
+struct CHConcurrentSkipListNode;			/* Private. Declared in CHConcurrentSkipListSet.m */
+
+/**
+ The state of a CHConcurrentSkipListSet. The nodes are private to the implementation, since every link must be read and written atomically.
+ */
+typedef struct CHConcurrentSkipListStorage {
+	struct CHConcurrentSkipListNode *	pHead;			///< The head tower, with a link on every level, which holds no object.
+	uint32_t							cLevels;		///< The greatest number of levels of any node added so far, which is never reduced.
+	NSUInteger							cObjects;		///< The number of objects, changed atomically.
+	CHSearchTreeComparator				sComparator;	///< How objects are ordered.
+} CHConcurrentSkipListStorage;
+
+/**
+ A sorted set that any number of threads may read and modify at the same time, without locks. It is a <a href="http://en.wikipedia.org/wiki/Skip_list">skip list</a> whose links are changed only by atomic compare-and-swap, following the lock-free skip list of Fraser and of Herlihy and Shavit: an object is removed by first marking the links out of its node, using the low bit of each link, and the marked node is then unlinked by whichever thread next passes it. \link #addObject: -addObject:\endlink, \link #removeObject: -removeObject:\endlink, \link #member: -member:\endlink and \link #containsObject: -containsObject:\endlink never block, and a thread that is suspended part way through one of them never prevents the others from completing.
+
+ A removed node may still be in use by threads that reached it before it was unlinked, so it is freed, and its object released, only once every thread has moved on. Each thread that uses a concurrent skip list announces the global epoch on entry to each operation, and removed nodes are kept on a list belonging to the thread that removed them, with the epoch in which they were removed, until the epoch has advanced twice. The epoch only advances once every thread inside an operation has announced the current one, so a thread that stays inside one operation for a long time, such as a slow @c -compare:, holds back the freeing of every node removed meanwhile. The nodes left by a thread that exits are freed by the other threads. Objects returned by the receiver are retained and autoreleased before the operation ends, so they stay valid for the caller even if another thread removes them at once.
+
+ Enumeration is weakly consistent: enumerators and NSFastEnumeration never raise an exception when the receiver is modified, and return each object in ascending order that is in the set from the start of the enumeration to the end, may or may not return objects that are added or removed meanwhile, and never return an object twice. Each step resumes after the last object returned, so an enumeration may run for as long as needed without holding back the memory of removed nodes. Methods that report on the whole set, such as \link #count -count\endlink, \link #allObjects -allObjects\endlink, \link #isEqual: -isEqual:\endlink and the subset and copying methods, are exact only while no other thread is modifying the receiver.
+
+ Objects are ordered by @c -compare:, or by a C function given to \link #initWithCompareFunction:context: -initWithCompareFunction:context:\endlink, which must be safe to call from several threads at once and must not raise an exception. Adding an object equal to one already in the set replaces it, as for the other sorted sets.
+ */
+@interface CHConcurrentSkipListSet : NSObject <CHSortedSet>
+{
+	@protected
+		CHConcurrentSkipListStorage	m_sList;		/* The nodes of the list and how objects are ordered */
+}
+
+/**
+ Initialize a concurrent skip list that orders its objects with a C function rather than @c -compare:.
+
+ @param a_pfnCompare The function used to compare objects, which must be thread safe.
+ @param a_pvContext An arbitrary pointer passed to every call of @a a_pfnCompare. Not retained.
+ @return An initialized concurrent skip list that contains no objects.
+
+ @throw NSInvalidArgumentException if @a a_pfnCompare is @c NULL.
+ */
+- (id) initWithCompareFunction:(CHCompareFunction)a_pfnCompare context:(void*)a_pvContext;
+
+@end
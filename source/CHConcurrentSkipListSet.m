@@ -0,0 +1,901 @@
+/*
+ CHDataStructures.framework -- CHConcurrentSkipListSet.m
+
+ Copyright (c) 2008-2010, Quinn Taylor <http://homepage.mac.com/quinntaylor>
+
+ This source code is released under the ISC License. <http://www.opensource.org/licenses/isc-license>
+
+ Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby granted, provided that the above copyright notice and this permission notice appear in all copies.
+
+ The software is  provided "as is", without warranty of any kind, including all implied warranties of merchantability and fitness. In no event shall the authors or copyright holders be liable for any claim, damages, or other liability, whether in an action of contract, tort, or otherwise, arising from, out of, or in connection with the software or the use or other dealings in the software.
+
+	Fixes, additions, extensions, port to GNUstep by Christopher Chandler
+	Copyright © 2013-2015	Christopher James Elphinstone Chandler, Russell Geoffrey Watts. All Rights Reserved.
+	Copyright © 2015-2025	Kinnami Software Corporation. All rights reserved.
+ */
+
+#import "CHConcurrentSkipListSet.h"
+#import "CHAbstractBinarySearchTree_Internal.h"
+#import <pthread.h>
+
+#pragma mark Nodes with marked links
+
+/* A node of the list. Each link is the address of the next node on its level, with the low bit set once this node has been removed from that
+	level, after which the link never changes. The links are marked from the top level down, so a node whose bottom link is marked is no longer
+	in the set. A node with no links holds an object that was replaced by an equal one, until it is safe to release it
+*/
+typedef struct CHConcurrentSkipListNode {
+	id									poObject;		/* Read and replaced atomically */
+	struct CHConcurrentSkipListNode *	pLimboNext;		/* The next node retired by the same thread */
+	unsigned long						ulRetireEpoch;	/* The epoch in which the node was retired */
+	uint32_t							cLevels;		/* The number of links */
+	uint32_t							cOwners;		/* The inserter and the remover. Whichever finishes with the node last retires it */
+	uintptr_t							auiNext [];		/* The marked links, from the bottom level up */
+} CHConcurrentSkipListNode;
+
+static inline CHConcurrentSkipListNode *	CHConcurrentSkipListUnmarked (uintptr_t a_uiLink)
+	{
+	return (CHConcurrentSkipListNode *) (a_uiLink & ~(uintptr_t) 1);
+	}
+
+static inline bool	CHConcurrentSkipListIsMarked (uintptr_t a_uiLink)
+	{
+	return (a_uiLink & 1) != 0;
+	}
+
+static inline uintptr_t	CHConcurrentSkipListLink (CHConcurrentSkipListNode * a_pNode, uint32_t a_uiLevel)
+	{
+	return __atomic_load_n (&a_pNode -> auiNext [a_uiLevel], __ATOMIC_ACQUIRE);
+	}
+
+/* Change a link if it still holds the expected value, which is never marked, so this fails once the node holding the link is removed
+*/
+static inline bool	CHConcurrentSkipListSwapLink (uintptr_t * a_puiLink, uintptr_t a_uiExpected, uintptr_t a_uiNew)
+	{
+	return __atomic_compare_exchange_n (a_puiLink, &a_uiExpected, a_uiNew, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+	}
+
+static inline id	CHConcurrentSkipListObject (CHConcurrentSkipListNode * a_pNode)
+	{
+	return __atomic_load_n (&a_pNode -> poObject, __ATOMIC_ACQUIRE);
+	}
+
+static CHConcurrentSkipListNode *	CHConcurrentSkipListNodeNew (uint32_t a_cLevels, id a_po)
+	{
+	CHConcurrentSkipListNode *	pNode = malloc (sizeof (CHConcurrentSkipListNode) + a_cLevels * sizeof (uintptr_t));
+
+	if (pNode == NULL)
+		[NSException raise:NSMallocException format:@"Unable to allocate a skip list node"];
+	pNode -> poObject = a_po;
+	pNode -> pLimboNext = NULL;
+	pNode -> ulRetireEpoch = 0;
+	pNode -> cLevels = a_cLevels;
+	pNode -> cOwners = 2;
+	return pNode;
+	}
+
+#pragma mark Epoch-based reclamation
+
+/* Each thread that has used a concurrent skip list has a record, which is never freed, but is reused by a later thread once its thread exits.
+	The nodes a thread retires stay on its limbo list, oldest first, until the global epoch is two past the one in which they were retired,
+	when no thread can still be using them
+*/
+typedef struct CHEpochRecord {
+	struct CHEpochRecord *		pNext;			/* The next record, in the order they were created */
+	unsigned long				ulState;		/* The epoch the thread announced, shifted left, with the low bit set while it is inside an operation */
+	unsigned int				fInUse;			/* Whether the record belongs to a live thread */
+	unsigned int				cNesting;		/* The depth of nested operations, such as a member: inside an object's -compare: */
+	uint64_t					ullRandom;		/* The generator for the heights of the nodes the thread adds */
+	CHConcurrentSkipListNode *	pLimboFirst;	/* The oldest node retired and not yet freed */
+	CHConcurrentSkipListNode *	pLimboLast;		/* The newest node retired and not yet freed */
+	unsigned int				cRetired;		/* The number of nodes retired since the last attempt to free some */
+} CHEpochRecord;
+
+#define kCHEpochReclaimInterval		64		/* Nodes retired by a thread between attempts to advance the epoch and free its old nodes */
+
+static unsigned long	s_ulEpoch = 1;
+static CHEpochRecord *	s_pEpochRecords;
+static pthread_key_t	s_keyEpochRecord;
+static pthread_once_t	s_onceEpochRecord = PTHREAD_ONCE_INIT;
+
+/* Advance the global epoch if every thread inside an operation has announced the current one. Returns the current epoch
+*/
+static unsigned long	CHEpochTryAdvance (void)
+	{
+	CHEpochRecord *	pRecord;
+	unsigned long	ulEpoch = __atomic_load_n (&s_ulEpoch, __ATOMIC_SEQ_CST);
+	unsigned long	ulState;
+
+	for (pRecord = __atomic_load_n (&s_pEpochRecords, __ATOMIC_ACQUIRE); pRecord != NULL; pRecord = pRecord -> pNext)
+		{
+		ulState = __atomic_load_n (&pRecord -> ulState, __ATOMIC_SEQ_CST);
+		if (((ulState & 1) != 0) && ((ulState >> 1) != ulEpoch))
+			return ulEpoch;
+		}
+	__atomic_compare_exchange_n (&s_ulEpoch, &ulEpoch, ulEpoch + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return __atomic_load_n (&s_ulEpoch, __ATOMIC_SEQ_CST);
+	}
+
+/* Free the nodes retired by a thread at least two epochs before a_ulEpoch, and release their objects. They are detached from the limbo list
+	first, since releasing an object may run code that uses a concurrent skip list, and so retires more nodes
+*/
+static void	CHEpochReclaim (CHEpochRecord * a_pRecord, unsigned long a_ulEpoch)
+	{
+	CHConcurrentSkipListNode *	pNode;
+	CHConcurrentSkipListNode *	pFirst = a_pRecord -> pLimboFirst;
+	CHConcurrentSkipListNode *	pLast = NULL;
+
+	for (pNode = pFirst; (pNode != NULL) && (pNode -> ulRetireEpoch + 2 <= a_ulEpoch); pNode = pNode -> pLimboNext)
+		pLast = pNode;
+	if (pLast == NULL)
+		return;
+	__atomic_store_n (&a_pRecord -> pLimboFirst, pLast -> pLimboNext, __ATOMIC_RELAXED);	/* Read without claiming the record by CHEpochReclaimOrphans () */
+	if (pLast -> pLimboNext == NULL)
+		a_pRecord -> pLimboLast = NULL;
+	pLast -> pLimboNext = NULL;
+	while ((pNode = pFirst) != NULL)
+		{
+		pFirst = pNode -> pLimboNext;
+		[pNode -> poObject release];
+		free (pNode);
+		}
+	}
+
+/* Free what can be freed from the records of threads that have exited, claiming each record while doing so
+*/
+static void	CHEpochReclaimOrphans (unsigned long a_ulEpoch)
+	{
+	CHEpochRecord *	pRecord;
+	unsigned int	fInUse;
+
+	for (pRecord = __atomic_load_n (&s_pEpochRecords, __ATOMIC_ACQUIRE); pRecord != NULL; pRecord = pRecord -> pNext)
+		{
+		fInUse = 0;
+		if ((__atomic_load_n (&pRecord -> pLimboFirst, __ATOMIC_RELAXED) != NULL) &&
+		    __atomic_compare_exchange_n (&pRecord -> fInUse, &fInUse, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			{
+			CHEpochReclaim (pRecord, a_ulEpoch);
+			__atomic_store_n (&pRecord -> fInUse, 0, __ATOMIC_RELEASE);
+			}
+		}
+	}
+
+/* When a thread exits, free what it can. The rest stays on the record, and is freed by other threads as they retire nodes of their own
+*/
+static void	CHEpochRecordRelinquish (void * a_pvRecord)
+	{
+	CHEpochRecord *	pRecord = a_pvRecord;
+
+	pRecord -> cNesting = 0;
+	__atomic_store_n (&pRecord -> ulState, 0, __ATOMIC_RELEASE);
+	CHEpochReclaim (pRecord, CHEpochTryAdvance ());
+	__atomic_store_n (&pRecord -> fInUse, 0, __ATOMIC_RELEASE);
+	}
+
+static void	CHEpochKeyCreate (void)
+	{
+	pthread_key_create (&s_keyEpochRecord, CHEpochRecordRelinquish);
+	}
+
+/* Return the calling thread's record, taking over an unused one or adding a new one the first time the thread uses a concurrent skip list
+*/
+static CHEpochRecord *	CHEpochRecordGet (void)
+	{
+	CHEpochRecord *	pRecord;
+	CHEpochRecord *	pRecordFirst;
+	unsigned int	fInUse;
+	uint64_t		z;
+
+	pthread_once (&s_onceEpochRecord, CHEpochKeyCreate);
+	if ((pRecord = pthread_getspecific (s_keyEpochRecord)) != NULL)
+		return pRecord;
+	for (pRecord = __atomic_load_n (&s_pEpochRecords, __ATOMIC_ACQUIRE); pRecord != NULL; pRecord = pRecord -> pNext)
+		{
+		fInUse = 0;
+		if (__atomic_compare_exchange_n (&pRecord -> fInUse, &fInUse, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			break;
+		}
+	if (pRecord == NULL)
+		{
+		pRecord = calloc (1, sizeof (CHEpochRecord));
+		if (pRecord == NULL)
+			[NSException raise:NSMallocException format:@"Unable to allocate a thread record for a concurrent skip list"];
+		pRecord -> fInUse = 1;
+		z = (uint64_t) (uintptr_t) pRecord + 0x9E3779B97F4A7C15ULL;		/* One round of splitmix64 */
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		z ^= z >> 31;
+		pRecord -> ullRandom = (z != 0) ? z : 0x9E3779B97F4A7C15ULL;
+		pRecordFirst = __atomic_load_n (&s_pEpochRecords, __ATOMIC_RELAXED);
+		do
+			pRecord -> pNext = pRecordFirst;
+		while (!__atomic_compare_exchange_n (&s_pEpochRecords, &pRecordFirst, pRecord, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+		}
+	pthread_setspecific (s_keyEpochRecord, pRecord);
+	return pRecord;
+	}
+
+/* Enter an operation, announcing the current epoch. The epoch is read again after the announcement is visible to other threads, so that the
+	thread never announces an epoch that has already been left behind
+*/
+static inline CHEpochRecord *	CHEpochEnter (void)
+	{
+	CHEpochRecord *	pRecord = CHEpochRecordGet ();
+	unsigned long	ulEpoch;
+	unsigned long	ulEpochNow;
+
+	if (pRecord -> cNesting ++ == 0)
+		{
+		ulEpochNow = __atomic_load_n (&s_ulEpoch, __ATOMIC_SEQ_CST);
+		do
+			{
+			ulEpoch = ulEpochNow;
+			__atomic_store_n (&pRecord -> ulState, (ulEpoch << 1) | 1, __ATOMIC_SEQ_CST);
+			__atomic_thread_fence (__ATOMIC_SEQ_CST);
+			ulEpochNow = __atomic_load_n (&s_ulEpoch, __ATOMIC_SEQ_CST);
+			}
+		while (ulEpochNow != ulEpoch);
+		}
+	return pRecord;
+	}
+
+static inline void	CHEpochExit (CHEpochRecord * a_pRecord)
+	{
+	if (-- a_pRecord -> cNesting == 0)
+		__atomic_store_n (&a_pRecord -> ulState, 0, __ATOMIC_RELEASE);
+	}
+
+/* Put a node that is no longer reachable from the list on the thread's limbo list, and now and then try to free old ones
+*/
+static void	CHEpochRetire (CHEpochRecord * a_pRecord, CHConcurrentSkipListNode * a_pNode)
+	{
+	unsigned long	ulEpoch;
+
+	a_pNode -> ulRetireEpoch = __atomic_load_n (&s_ulEpoch, __ATOMIC_SEQ_CST);
+	a_pNode -> pLimboNext = NULL;
+	if (a_pRecord -> pLimboLast != NULL)
+		a_pRecord -> pLimboLast -> pLimboNext = a_pNode;
+	else
+		__atomic_store_n (&a_pRecord -> pLimboFirst, a_pNode, __ATOMIC_RELAXED);
+	a_pRecord -> pLimboLast = a_pNode;
+	if (++ a_pRecord -> cRetired >= kCHEpochReclaimInterval)
+		{
+		a_pRecord -> cRetired = 0;
+		ulEpoch = CHEpochTryAdvance ();
+		CHEpochReclaim (a_pRecord, ulEpoch);
+		CHEpochReclaimOrphans (ulEpoch);
+		}
+	}
+
+#pragma mark Lock-free skip list
+
+/* The height of a new node: one level, and each further level with probability 1/4, from the calling thread's generator
+*/
+static inline uint32_t	CHConcurrentSkipListRandomLevels (CHEpochRecord * a_pRecord)
+	{
+	uint64_t	x = a_pRecord -> ullRandom;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	a_pRecord -> ullRandom = x;
+	return 1 + (uint32_t) __builtin_ctzll (x | (1ULL << (2 * (kCHConcurrentSkipListMaxLevel - 1)))) / 2;
+	}
+
+static void	CHConcurrentSkipListInit (CHConcurrentSkipListStorage * a_pList)
+	{
+	memset (a_pList, 0, sizeof (*a_pList));
+	a_pList -> pHead = CHConcurrentSkipListNodeNew (kCHConcurrentSkipListMaxLevel, nil);
+	memset (a_pList -> pHead -> auiNext, 0, kCHConcurrentSkipListMaxLevel * sizeof (uintptr_t));
+	a_pList -> cLevels = 1;
+	}
+
+/* Find the last node before a_po and the first node not before it on each level, unlinking every marked node met on the way. If another
+	thread changes a link first, the search starts again from the top. As in the sequential skip list, a node that stopped the search on one
+	level is not compared again on the level below. If a_fPastSame, nodes that compare the same as a_po are passed too, so that every marked node
+	holding an equal object is unlinked, even one behind a node for an equal object that another thread has linked in front of it since.
+	Returns whether the first node on the bottom level compares the same as a_po
+*/
+static bool	CHConcurrentSkipListFind (CHConcurrentSkipListStorage * a_pList, id a_po, bool a_fPastSame, CHConcurrentSkipListNode ** a_apPred, CHConcurrentSkipListNode ** a_apSucc)
+	{
+	CHConcurrentSkipListNode *	pPred;
+	CHConcurrentSkipListNode *	pCurr;
+	CHConcurrentSkipListNode *	pStop;
+	uintptr_t					uiSucc;
+	uint32_t					uiLevel;
+	NSComparisonResult			eCompare;
+
+Retry:
+	pPred = a_pList -> pHead;
+	pStop = NULL;
+	uiLevel = __atomic_load_n (&a_pList -> cLevels, __ATOMIC_ACQUIRE);
+	while (uiLevel-- > 0)
+		{
+		pCurr = CHConcurrentSkipListUnmarked (CHConcurrentSkipListLink (pPred, uiLevel));
+		while (pCurr != NULL)
+			{
+			uiSucc = CHConcurrentSkipListLink (pCurr, uiLevel);
+			if (CHConcurrentSkipListIsMarked (uiSucc))
+				{
+				if (!CHConcurrentSkipListSwapLink (&pPred -> auiNext [uiLevel], (uintptr_t) pCurr, (uintptr_t) CHConcurrentSkipListUnmarked (uiSucc)))
+					goto Retry;
+				pCurr = CHConcurrentSkipListUnmarked (uiSucc);
+				continue;
+				}
+			if (pCurr == pStop)
+				break;
+			eCompare = CHSearchTreeCompare (&a_pList -> sComparator, CHConcurrentSkipListObject (pCurr), a_po);
+			if ((eCompare == NSOrderedDescending) || ((eCompare == NSOrderedSame) && !a_fPastSame))
+				break;
+			pPred = pCurr;
+			pCurr = CHConcurrentSkipListUnmarked (uiSucc);
+			}
+		pStop = pCurr;
+		a_apPred [uiLevel] = pPred;
+		a_apSucc [uiLevel] = pCurr;
+		}
+	return (pStop != NULL) && (CHSearchTreeCompare (&a_pList -> sComparator, CHConcurrentSkipListObject (pStop), a_po) == NSOrderedSame);
+	}
+
+/* Drop the caller's ownership of a node. The last owner searches once more, which unlinks the node from any level the inserter linked it into
+	after the remover's search, then retires it. The node is marked on every level by then, and the search passes equal objects, so it cannot
+	stop at a node for an equal object that was linked in front of this one, and leave this one reachable
+*/
+static void	CHConcurrentSkipListDisown (CHConcurrentSkipListStorage * a_pList, CHEpochRecord * a_pRecord, CHConcurrentSkipListNode * a_pNode, id a_po)
+	{
+	CHConcurrentSkipListNode *	apPred [kCHConcurrentSkipListMaxLevel];
+	CHConcurrentSkipListNode *	apSucc [kCHConcurrentSkipListMaxLevel];
+
+	if (__atomic_sub_fetch (&a_pNode -> cOwners, 1, __ATOMIC_ACQ_REL) != 0)
+		return;
+	CHConcurrentSkipListFind (a_pList, a_po, true, apPred, apSucc);
+	CHEpochRetire (a_pRecord, a_pNode);
+	}
+
+/* Add an object, or replace an equal one. The new node is linked on the bottom level first, which adds it to the set, then on each level above,
+	searching again whenever another thread changes a link first. Linking stops early if the node is removed meanwhile
+*/
+static void	CHConcurrentSkipListAdd (CHConcurrentSkipListStorage * a_pList, CHEpochRecord * a_pRecord, id a_po)
+	{
+	CHConcurrentSkipListNode *	apPred [kCHConcurrentSkipListMaxLevel];
+	CHConcurrentSkipListNode *	apSucc [kCHConcurrentSkipListMaxLevel];
+	CHConcurrentSkipListNode *	pNode = NULL;
+	CHConcurrentSkipListNode *	pFound;
+	uintptr_t					uiNext;
+	uint32_t					cLevels = CHConcurrentSkipListRandomLevels (a_pRecord);
+	uint32_t					cLevelsList;
+	uint32_t					uiLevel;
+	id							poOld;
+
+	cLevelsList = __atomic_load_n (&a_pList -> cLevels, __ATOMIC_RELAXED);		/* Raised first, so that every search fills in the node's levels */
+	while ((cLevelsList < cLevels) &&
+	       !__atomic_compare_exchange_n (&a_pList -> cLevels, &cLevelsList, cLevels, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+		;
+	for (;;)
+		{
+		if (CHConcurrentSkipListFind (a_pList, a_po, false, apPred, apSucc))
+			{
+			pFound = apSucc [0];
+			if (CHConcurrentSkipListIsMarked (CHConcurrentSkipListLink (pFound, 0)))
+				continue;										/* Being removed. The next search unlinks it */
+			if (pNode == NULL)
+				[a_po retain];
+			else
+				free (pNode);									/* Never linked, so no other thread has seen it. Its retain is kept */
+			poOld = __atomic_exchange_n (&pFound -> poObject, a_po, __ATOMIC_ACQ_REL);
+			CHEpochRetire (a_pRecord, CHConcurrentSkipListNodeNew (0, poOld));
+			return;
+			}
+		if (pNode == NULL)
+			pNode = CHConcurrentSkipListNodeNew (cLevels, [a_po retain]);
+		for (uiLevel = 0; uiLevel < cLevels; uiLevel ++)
+			__atomic_store_n (&pNode -> auiNext [uiLevel], (uintptr_t) apSucc [uiLevel], __ATOMIC_RELAXED);
+		__atomic_add_fetch (&a_pList -> cObjects, 1, __ATOMIC_RELAXED);	/* Counted before it is published, so that its removal never takes the count below zero */
+		if (CHConcurrentSkipListSwapLink (&apPred [0] -> auiNext [0], (uintptr_t) apSucc [0], (uintptr_t) pNode))
+			break;
+		__atomic_sub_fetch (&a_pList -> cObjects, 1, __ATOMIC_RELAXED);
+		}
+	for (uiLevel = 1; uiLevel < cLevels; uiLevel ++)
+		{
+		for (;;)
+			{
+			uiNext = CHConcurrentSkipListLink (pNode, uiLevel);
+			if (CHConcurrentSkipListIsMarked (uiNext))
+				goto Done;
+			if ((uiNext != (uintptr_t) apSucc [uiLevel]) &&				/* Fails only if the remover marked the link */
+			    !CHConcurrentSkipListSwapLink (&pNode -> auiNext [uiLevel], uiNext, (uintptr_t) apSucc [uiLevel]))
+				goto Done;
+			if (CHConcurrentSkipListSwapLink (&apPred [uiLevel] -> auiNext [uiLevel], (uintptr_t) apSucc [uiLevel], (uintptr_t) pNode))
+				break;
+			CHConcurrentSkipListFind (a_pList, a_po, false, apPred, apSucc);
+			if (apSucc [0] != pNode)								/* Removed, and already unlinked from the bottom level */
+				goto Done;
+			}
+		}
+Done:
+	CHConcurrentSkipListDisown (a_pList, a_pRecord, pNode, a_po);
+	}
+
+/* Remove an object. Marking the bottom link removes it from the set, and only one thread can do that. The winner searches again to unlink it
+*/
+static bool	CHConcurrentSkipListRemove (CHConcurrentSkipListStorage * a_pList, CHEpochRecord * a_pRecord, id a_po)
+	{
+	CHConcurrentSkipListNode *	apPred [kCHConcurrentSkipListMaxLevel];
+	CHConcurrentSkipListNode *	apSucc [kCHConcurrentSkipListMaxLevel];
+	CHConcurrentSkipListNode *	pNode;
+	uint32_t					uiLevel;
+
+	if (!CHConcurrentSkipListFind (a_pList, a_po, false, apPred, apSucc))
+		return false;
+	pNode = apSucc [0];
+	for (uiLevel = pNode -> cLevels - 1; uiLevel > 0; uiLevel --)
+		__atomic_fetch_or (&pNode -> auiNext [uiLevel], 1, __ATOMIC_ACQ_REL);
+	if (CHConcurrentSkipListIsMarked (__atomic_fetch_or (&pNode -> auiNext [0], 1, __ATOMIC_ACQ_REL)))
+		return false;											/* Another thread removed it first */
+	__atomic_sub_fetch (&a_pList -> cObjects, 1, __ATOMIC_RELAXED);
+	if (__atomic_load_n (&pNode -> cOwners, __ATOMIC_ACQUIRE) == 2)
+		CHConcurrentSkipListFind (a_pList, a_po, true, apPred, apSucc);	/* Unlink it now, although the inserter will search again when it finishes */
+	CHConcurrentSkipListDisown (a_pList, a_pRecord, pNode, a_po);
+	return true;
+	}
+
+/* Without unlinking anything, return the first node in the set ordered after a_po, or at or after it if a_fInclusive, or the first node in
+	the set if a_po is nil. Marked nodes are stepped over, so the node returned was in the set when it was reached
+*/
+static CHConcurrentSkipListNode *	CHConcurrentSkipListSeek (CHConcurrentSkipListStorage * a_pList, id a_po, bool a_fInclusive)
+	{
+	CHConcurrentSkipListNode *	pPred = a_pList -> pHead;
+	CHConcurrentSkipListNode *	pCurr = NULL;
+	uintptr_t					uiSucc;
+	uint32_t					uiLevel = (a_po != nil) ? __atomic_load_n (&a_pList -> cLevels, __ATOMIC_ACQUIRE) : 1;
+	NSComparisonResult			eCompare;
+
+	while (uiLevel-- > 0)
+		{
+		pCurr = CHConcurrentSkipListUnmarked (CHConcurrentSkipListLink (pPred, uiLevel));
+		while (pCurr != NULL)
+			{
+			uiSucc = CHConcurrentSkipListLink (pCurr, uiLevel);
+			if (CHConcurrentSkipListIsMarked (uiSucc))
+				{
+				pCurr = CHConcurrentSkipListUnmarked (uiSucc);
+				continue;
+				}
+			if (a_po == nil)
+				break;
+			eCompare = CHSearchTreeCompare (&a_pList -> sComparator, CHConcurrentSkipListObject (pCurr), a_po);
+			if ((eCompare == NSOrderedDescending) || ((eCompare == NSOrderedSame) && a_fInclusive))
+				break;
+			pPred = pCurr;
+			pCurr = CHConcurrentSkipListUnmarked (uiSucc);
+			}
+		}
+	return pCurr;
+	}
+
+/* Without unlinking anything, return the last node in the set ordered before a_po, or the last node in the set if a_po is nil, or NULL if
+	there is none. If that node is removed before the search reaches the bottom level, the search starts again
+*/
+static CHConcurrentSkipListNode *	CHConcurrentSkipListSeekBefore (CHConcurrentSkipListStorage * a_pList, id a_po)
+	{
+	CHConcurrentSkipListNode *	pPred;
+	CHConcurrentSkipListNode *	pCurr;
+	uintptr_t					uiSucc;
+	uint32_t					uiLevel;
+
+	do
+		{
+		pPred = a_pList -> pHead;
+		uiLevel = __atomic_load_n (&a_pList -> cLevels, __ATOMIC_ACQUIRE);
+		while (uiLevel-- > 0)
+			{
+			pCurr = CHConcurrentSkipListUnmarked (CHConcurrentSkipListLink (pPred, uiLevel));
+			while (pCurr != NULL)
+				{
+				uiSucc = CHConcurrentSkipListLink (pCurr, uiLevel);
+				if (CHConcurrentSkipListIsMarked (uiSucc))
+					pCurr = CHConcurrentSkipListUnmarked (uiSucc);
+				else if ((a_po == nil) || (CHSearchTreeCompare (&a_pList -> sComparator, CHConcurrentSkipListObject (pCurr), a_po) == NSOrderedAscending))
+					{
+					pPred = pCurr;
+					pCurr = CHConcurrentSkipListUnmarked (uiSucc);
+					}
+				else
+					break;
+				}
+			}
+		if (pPred == a_pList -> pHead)
+			return NULL;
+		}
+	while (CHConcurrentSkipListIsMarked (CHConcurrentSkipListLink (pPred, 0)));
+	return pPred;
+	}
+
+/* Append objects in strictly ascending order to an empty list that no other thread can see yet, keeping the last node on each level
+*/
+static void	CHConcurrentSkipListAppendSorted (CHConcurrentSkipListStorage * a_pList, CHEpochRecord * a_pRecord, id * a_apo, NSUInteger a_cObjects)
+	{
+	CHConcurrentSkipListNode *	apLast [kCHConcurrentSkipListMaxLevel];
+	CHConcurrentSkipListNode *	pNode;
+	NSUInteger					ui;
+	uint32_t					cLevels;
+	uint32_t					uiLevel;
+
+	for (uiLevel = 0; uiLevel < kCHConcurrentSkipListMaxLevel; uiLevel ++)
+		apLast [uiLevel] = a_pList -> pHead;
+	for (ui = 0; ui < a_cObjects; ui ++)
+		{
+		cLevels = CHConcurrentSkipListRandomLevels (a_pRecord);
+		if (a_pList -> cLevels < cLevels)
+			a_pList -> cLevels = cLevels;
+		pNode = CHConcurrentSkipListNodeNew (cLevels, [a_apo [ui] retain]);
+		for (uiLevel = 0; uiLevel < cLevels; uiLevel ++)
+			{
+			pNode -> auiNext [uiLevel] = 0;
+			apLast [uiLevel] -> auiNext [uiLevel] = (uintptr_t) pNode;
+			apLast [uiLevel] = pNode;
+			}
+		pNode -> cOwners = 1;									/* Fully linked, so only a remover still owns it */
+		}
+	a_pList -> cObjects = a_cObjects;
+	__atomic_thread_fence (__ATOMIC_RELEASE);
+	}
+
+/* Free every node still linked, once no other thread can use the list
+*/
+static void	CHConcurrentSkipListFree (CHConcurrentSkipListStorage * a_pList)
+	{
+	CHConcurrentSkipListNode *	pNode;
+	CHConcurrentSkipListNode *	pNext;
+
+	if (a_pList -> pHead == NULL)
+		return;
+	pNode = CHConcurrentSkipListUnmarked (a_pList -> pHead -> auiNext [0]);
+	while (pNode != NULL)
+		{
+		pNext = CHConcurrentSkipListUnmarked (pNode -> auiNext [0]);
+		[pNode -> poObject release];
+		free (pNode);
+		pNode = pNext;
+		}
+	free (a_pList -> pHead);
+	a_pList -> pHead = NULL;
+	}
+
+#pragma mark -
+
+/**
+ A weakly consistent NSEnumerator for CHConcurrentSkipListSet. Rather than keep a node, which may be freed once removed, it keeps the last
+ object it returned, and each step searches for the next object in the set after that one.
+ */
+@interface CHConcurrentSkipListEnumerator : CHCollectionEnumerator
+{
+	CHConcurrentSkipListStorage *storage; // The nodes of the set.
+	id lastObject; // The last object returned, retained, or nil before the first.
+	BOOL reverse; // Whether the enumeration is in descending order.
+}
+
+- (id) initWithSet:(CHConcurrentSkipListSet*)skipListSet
+           storage:(CHConcurrentSkipListStorage*)listStorage
+           reverse:(BOOL)descending;
+
+@end
+
+@implementation CHConcurrentSkipListEnumerator
+
+// The set may be changed by other threads while it is enumerated, so there is no mutation count.
+- (id) initWithSet:(CHConcurrentSkipListSet*)skipListSet
+           storage:(CHConcurrentSkipListStorage*)listStorage
+           reverse:(BOOL)descending
+{
+	if ((self = [super initWithCollection:skipListSet mutations:NULL]) == nil) return nil;
+	storage = listStorage;
+	reverse = descending;
+	return self;
+}
+
+- (void) dealloc {
+	[lastObject release];
+	[super dealloc];
+}
+
+- (id) nextObjectFromCollection {
+	CHEpochRecord *record = CHEpochEnter();
+	CHConcurrentSkipListNode *node = reverse ? CHConcurrentSkipListSeekBefore(storage, lastObject)
+	                                         : CHConcurrentSkipListSeek(storage, lastObject, false);
+	id anObject = (node != NULL) ? [CHConcurrentSkipListObject(node) retain] : nil;
+	CHEpochExit(record);
+	[lastObject release];
+	lastObject = anObject;
+	return [[anObject retain] autorelease];
+}
+
+@end
+
+#pragma mark -
+
+@implementation CHConcurrentSkipListSet
+
+- (void) dealloc {
+	CHConcurrentSkipListFree(&m_sList);
+	if (m_sList.sComparator.eKind == CHComparatorKindBlock)
+		[(id) m_sList.sComparator.pvContext release];
+	CHCompareCacheFree(m_sList.sComparator.apCache);
+	[super dealloc];
+}
+
+- (id) init {
+	if ((self = [super init]) == nil) return nil;
+	CHConcurrentSkipListInit(&m_sList);
+	return self;
+}
+
+- (id) initWithCompareFunction:(CHCompareFunction)a_pfnCompare context:(void*)a_pvContext {
+	if (a_pfnCompare == NULL) {
+		Class aClass = [self class];
+		[self release];
+		CHNilArgumentException(aClass, _cmd);
+	}
+	if ((self = [self init]) == nil) return nil;
+	m_sList.sComparator.pvContext = a_pvContext;
+	m_sList.sComparator.pfnCompare = a_pfnCompare;
+	m_sList.sComparator.eKind = CHComparatorKindFunction;
+	return self;
+}
+
+- (id) initWithArray:(NSArray*)anArray {
+	if ((self = [self init]) == nil) return nil;
+	[self loadObjectsFromArray:anArray];
+	return self;
+}
+
+// Loads the objects in an array into the receiver, which must be empty and not yet visible to any other thread. They are appended in
+// ascending order, in linear time once sorted.
+- (void) loadObjectsFromArray:(NSArray*)anArray {
+	NSUInteger objectCount;
+	id *objects = CHSearchTreeCopySortedObjects(&m_sList.sComparator, anArray, true, &objectCount);
+	CHEpochRecord *record = CHEpochEnter();
+	CHConcurrentSkipListAppendSorted(&m_sList, record, objects, objectCount);
+	CHEpochExit(record);
+	free(objects);
+}
+
+// Returns a new set with the receiver's comparator, with objects in strictly ascending order.
+- (id) newSetWithSortedObjects:(NSArray*)sortedObjects {
+	CHConcurrentSkipListSet *newSet = [[[self class] alloc] init];
+	CHSearchTreeComparatorCopy(&newSet->m_sList.sComparator, &m_sList.sComparator);
+	[newSet loadObjectsFromArray:sortedObjects];
+	return newSet;
+}
+
+#pragma mark <NSCoding>
+
+- (id) initWithCoder:(NSCoder*)decoder {
+	return [self initWithArray:CHSortedSetDecodeObjects(decoder, self, _cmd)];
+}
+
+- (void) encodeWithCoder:(NSCoder*)encoder {
+	CHSortedSetEncodeObjects(encoder, self, _cmd, &m_sList.sComparator, [self allObjects]);
+}
+
+#pragma mark <NSCopying>
+
+- (id) copyWithZone:(NSZone*)zone {
+	(void) zone;
+	return [self newSetWithSortedObjects:[self allObjects]];
+}
+
+#pragma mark <NSFastEnumeration>
+
+// Each batch resumes after the last object of the previous one, kept in extra[0], and every object is retained and autoreleased, since another
+// thread may remove it while the loop body runs. The mutations pointer refers to extra[1], which never changes, so modifying the receiver
+// during fast enumeration never raises an exception.
+- (NSUInteger) countByEnumeratingWithState:(NSFastEnumerationState*)state
+                                   objects:(id*)stackbuf
+                                     count:(NSUInteger)len
+{
+	CHConcurrentSkipListNode *node;
+	uintptr_t next;
+	NSUInteger batchCount = 0;
+	if (state->state == 0) {
+		state->state = 1;
+		state->mutationsPtr = &state->extra[1];
+		state->extra[0] = 0;
+	} else if (state->extra[0] == 0)
+		return 0;
+	CHEpochRecord *record = CHEpochEnter();
+	node = CHConcurrentSkipListSeek(&m_sList, (id) state->extra[0], false);
+	while (node != NULL && batchCount < len) {
+		next = CHConcurrentSkipListLink(node, 0);
+		if (!CHConcurrentSkipListIsMarked(next))
+			stackbuf[batchCount++] = [[CHConcurrentSkipListObject(node) retain] autorelease];
+		node = CHConcurrentSkipListUnmarked(next);
+	}
+	CHEpochExit(record);
+	state->extra[0] = (batchCount != 0) ? (unsigned long) stackbuf[batchCount - 1] : 0;
+	state->itemsPtr = stackbuf;
+	return batchCount;
+}
+
+#pragma mark Querying Contents
+
+- (NSArray*) allObjects {
+	NSMutableArray *array = [NSMutableArray array];
+	CHEpochRecord *record = CHEpochEnter();
+	for (CHConcurrentSkipListNode *node = CHConcurrentSkipListSeek(&m_sList, nil, false); node != NULL; ) {
+		uintptr_t next = CHConcurrentSkipListLink(node, 0);
+		if (!CHConcurrentSkipListIsMarked(next))
+			[array addObject:CHConcurrentSkipListObject(node)];
+		node = CHConcurrentSkipListUnmarked(next);
+	}
+	CHEpochExit(record);
+	return array;
+}
+
+- (id) anyObject {
+	return [self firstObject];
+}
+
+- (NSUInteger) count {
+	return __atomic_load_n(&m_sList.cObjects, __ATOMIC_RELAXED);
+}
+
+- (BOOL) containsObject:(id)anObject {
+	return ([self member:anObject] != nil);
+}
+
+- (NSString*) description {
+	return [[self allObjects] description];
+}
+
+- (id) firstObject {
+	CHEpochRecord *record = CHEpochEnter();
+	CHConcurrentSkipListNode *node = CHConcurrentSkipListSeek(&m_sList, nil, false);
+	id anObject = (node != NULL) ? [[CHConcurrentSkipListObject(node) retain] autorelease] : nil;
+	CHEpochExit(record);
+	return anObject;
+}
+
+- (NSUInteger) hash {
+	return hashOfCountAndObjects([self count], [self firstObject], [self lastObject]);
+}
+
+- (BOOL) isEqual:(id)otherObject {
+	if ([otherObject conformsToProtocol:@protocol(CHSortedSet)])
+		return [self isEqualToSortedSet:otherObject];
+	else
+		return NO;
+}
+
+- (BOOL) isEqualToSortedSet:(id<CHSortedSet>)otherSortedSet {
+	return collectionsAreEqual(self, otherSortedSet);
+}
+
+- (id) lastObject {
+	CHEpochRecord *record = CHEpochEnter();
+	CHConcurrentSkipListNode *node = CHConcurrentSkipListSeekBefore(&m_sList, nil);
+	id anObject = (node != NULL) ? [[CHConcurrentSkipListObject(node) retain] autorelease] : nil;
+	CHEpochExit(record);
+	return anObject;
+}
+
+- (id) member:(id)anObject {
+	if (anObject == nil)
+		return nil;
+	CHEpochRecord *record = CHEpochEnter();
+	CHConcurrentSkipListNode *node = CHConcurrentSkipListSeek(&m_sList, anObject, true);
+	id member = nil;
+	if (node != NULL) {
+		member = CHConcurrentSkipListObject(node);
+		if (CHSearchTreeCompare(&m_sList.sComparator, member, anObject) == NSOrderedSame)
+			[[member retain] autorelease];
+		else
+			member = nil;
+	}
+	CHEpochExit(record);
+	return member;
+}
+
+- (NSEnumerator*) objectEnumerator {
+	return [[[CHConcurrentSkipListEnumerator alloc] initWithSet:self storage:&m_sList reverse:NO] autorelease];
+}
+
+- (NSEnumerator*) reverseObjectEnumerator {
+	return [[[CHConcurrentSkipListEnumerator alloc] initWithSet:self storage:&m_sList reverse:YES] autorelease];
+}
+
+- (NSSet*) set {
+	return [NSSet setWithArray:[self allObjects]];
+}
+
+// Adds the objects of a run of a subset to an array.
+- (void) addObjectsInRun:(const CHSubsetRun*)run toArray:(NSMutableArray*)array {
+	CHConcurrentSkipListNode *node = CHConcurrentSkipListSeek(&m_sList, run->poStart, !run->fExcludeStart);
+	NSComparisonResult comparison;
+	uintptr_t next;
+	id anObject;
+	for ( ; node != NULL; node = CHConcurrentSkipListUnmarked(next)) {
+		next = CHConcurrentSkipListLink(node, 0);
+		if (CHConcurrentSkipListIsMarked(next))
+			continue;
+		anObject = CHConcurrentSkipListObject(node);
+		if (run->poEnd != nil) {
+			comparison = CHSearchTreeCompare(&m_sList.sComparator, anObject, run->poEnd);
+			if (comparison == NSOrderedDescending || (comparison == NSOrderedSame && run->fExcludeEnd))
+				break;
+		}
+		[array addObject:anObject];
+	}
+}
+
+- (id<CHSortedSet>) subsetFromObject:(id)start
+                            toObject:(id)end
+                             options:(CHSubsetConstructionOptions)options
+{
+	NSMutableArray *subset = [NSMutableArray array];
+	NSUInteger run, runCount;
+	CHSubsetRun runs[2];
+	runCount = CHSubsetRuns(start, end, start != nil && end != nil && CHSearchTreeCompare(&m_sList.sComparator, start, end) == NSOrderedDescending, options, runs);
+	CHEpochRecord *record = CHEpochEnter();
+	for (run = 0; run < runCount; run++)
+		[self addObjectsInRun:&runs[run] toArray:subset];
+	CHEpochExit(record);
+	return [[self newSetWithSortedObjects:subset] autorelease];
+}
+
+#pragma mark Modifying Contents
+
+- (void) addObject:(id)anObject {
+	if (anObject == nil)
+		CHNilArgumentException([self class], _cmd);
+	CHEpochRecord *record = CHEpochEnter();
+	CHConcurrentSkipListAdd(&m_sList, record, anObject);
+	CHEpochExit(record);
+}
+
+- (void) addObjectsFromArray:(NSArray*)anArray {
+	for (id anObject in anArray)
+		[self addObject:anObject];
+}
+
+// Removes objects in ascending order, resuming after each one, so objects that other threads add meanwhile before that point remain.
+- (void) removeAllObjects {
+	CHEpochRecord *record = CHEpochEnter();
+	CHConcurrentSkipListNode *node = CHConcurrentSkipListSeek(&m_sList, nil, false);
+	id anObject;
+	while (node != NULL) {
+		anObject = CHConcurrentSkipListObject(node);
+		CHConcurrentSkipListRemove(&m_sList, record, anObject);
+		node = CHConcurrentSkipListSeek(&m_sList, anObject, false);
+	}
+	CHEpochExit(record);
+}
+
+// If another thread removes the first object first, the new first object is removed instead, so that exactly one object is removed.
+- (void) removeFirstObject {
+	CHEpochRecord *record = CHEpochEnter();
+	CHConcurrentSkipListNode *node;
+	while ((node = CHConcurrentSkipListSeek(&m_sList, nil, false)) != NULL &&
+	       !CHConcurrentSkipListRemove(&m_sList, record, CHConcurrentSkipListObject(node)))
+		;
+	CHEpochExit(record);
+}
+
+- (void) removeLastObject {
+	CHEpochRecord *record = CHEpochEnter();
+	CHConcurrentSkipListNode *node;
+	while ((node = CHConcurrentSkipListSeekBefore(&m_sList, nil)) != NULL &&
+	       !CHConcurrentSkipListRemove(&m_sList, record, CHConcurrentSkipListObject(node)))
+		;
+	CHEpochExit(record);
+}
+
+- (void) removeObject:(id)anObject {
+	if (anObject == nil)
+		return;
+	CHEpochRecord *record = CHEpochEnter();
+	CHConcurrentSkipListRemove(&m_sList, record, anObject);
+	CHEpochExit(record);
+}
+
+@end
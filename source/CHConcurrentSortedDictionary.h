@@ -0,0 +1,55 @@
+/*
+ CHDataStructures.framework -- CHConcurrentSortedDictionary.h
+
+ Copyright (c) 2008-2010, Quinn Taylor <http://homepage.mac.com/quinntaylor>
+
+ This source code is released under the ISC License. <http://www.opensource.org/licenses/isc-license>
+
+ Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby granted, provided that the above copyright notice and this permission notice appear in all copies.
+
+ The software is  provided "as is", without warranty of any kind, including all implied warranties of merchantability and fitness. In no event shall the authors or copyright holders be liable for any claim, damages, or other liability, whether in an action of contract, tort, or otherwise, arising from, out of, or in connection with the software or the use or other dealings in the software.
+
+	Fixes, additions, extensions, port to GNUstep by Christopher Chandler
+	Copyright © 2013-2015	Christopher James Elphinstone Chandler, Russell Geoffrey Watts. All Rights Reserved.
+	Copyright © 2015-2025	Kinnami Software Corporation. All rights reserved.
+ */
+
+#import "CHSortedDictionary.h"
+#import "CHConcurrentSortedSet.h"
+
+/**
+ @file CHConcurrentSortedDictionary.h
+ A thread safe sorted dictionary, for dictionaries that many threads read and few modify.
+ */
+
+/**
+ A thread safe CHSortedDictionary, guarded by a readers-writer lock in the same way as CHConcurrentSortedSet. Lookups, \link #count -count\endlink, \link #firstKey -firstKey\endlink and \link #lastKey -lastKey\endlink take the lock for reading, so any number of threads may run them at once, and methods that modify the dictionary take it for writing. Values and keys returned by the receiver are retained and autoreleased while the lock is held.
+
+ Enumeration never holds the lock. Key enumerators and NSFastEnumeration iterate an immutable snapshot of the sorted keys, kept until the dictionary is next modified, and \link #objectEnumerator -objectEnumerator\endlink iterates the values as they were when it was created. Methods inherited from NSDictionary that enumerate keys and then look up each value, such as @c -enumerateKeysAndObjectsUsingBlock:, may find that another thread has removed a key meanwhile; a copy of the receiver, or a batch update, gives a consistent view of both.
+
+ A thread that makes many changes should make them in one call to \link #performBatchUpdates: -performBatchUpdates:\endlink, which holds the write lock once for all of them.
+
+ @see CHConcurrentSortedSet
+ */
+@interface CHConcurrentSortedDictionary : CHSortedDictionary {
+	CHReadWriteLock		m_sLock;		/* Guards the dictionary and the sorted keys, and caches a snapshot of the keys */
+}
+
+#if defined (__BLOCKS__)
+/**
+ Makes any number of changes to the receiver while holding the write lock once. Other threads do not see the receiver until the block returns, and then see every change made by it.
+
+ @param block A block that modifies the dictionary it is passed, which is the receiver. The block may call any method of the receiver, including lookups and enumeration, without blocking. It must not wait for another thread that uses the receiver.
+ */
+- (void) performBatchUpdates:(void (^)(NSMutableDictionary * dictionary))block;
+#endif	/* defined (__BLOCKS__) */
+
+/**
+ Makes any number of changes to the receiver while holding the write lock once, as for \link #performBatchUpdates: -performBatchUpdates:\endlink.
+
+ @param a_pfnUpdate A function that modifies the dictionary it is passed, which is the receiver.
+ @param a_pvContext An arbitrary pointer passed to @a a_pfnUpdate.
+ */
+- (void) performBatchUpdatesWithFunction:(void (*)(NSMutableDictionary * dictionary, void * a_pvContext))a_pfnUpdate context:(void*)a_pvContext;
+
+@end
@@ -0,0 +1,221 @@
+/*
+ CHDataStructures.framework -- CHConcurrentSortedDictionary.m
+
+ Copyright (c) 2008-2010, Quinn Taylor <http://homepage.mac.com/quinntaylor>
+
+ This source code is released under the ISC License. <http://www.opensource.org/licenses/isc-license>
+
+ Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby granted, provided that the above copyright notice and this permission notice appear in all copies.
+
+ The software is  provided "as is", without warranty of any kind, including all implied warranties of merchantability and fitness. In no event shall the authors or copyright holders be liable for any claim, damages, or other liability, whether in an action of contract, tort, or otherwise, arising from, out of, or in connection with the software or the use or other dealings in the software.
+
+	Fixes, additions, extensions, port to GNUstep by Christopher Chandler
+	Copyright © 2013-2015	Christopher James Elphinstone Chandler, Russell Geoffrey Watts. All Rights Reserved.
+	Copyright © 2015-2025	Kinnami Software Corporation. All rights reserved.
+ */
+
+#import "CHConcurrentSortedDictionary.h"
+
+@implementation CHConcurrentSortedDictionary
+
+- (void) dealloc {
+	CHReadWriteLockDestroy(&m_sLock);
+	[super dealloc];
+}
+
+- (id) initWithCapacity:(NSUInteger)numItems {
+	if ((self = [super initWithCapacity:numItems]) == nil) return nil;
+	CHReadWriteLockInit(&m_sLock);
+	return self;
+}
+
+// Returns the keys in ascending order and, if values is not NULL, their values, as they were at one moment. The superclass looks up each value,
+// since the lock is already held.
+- (NSArray*) keySnapshotWithValues:(NSArray**)values {
+	bool locked = CHReadWriteLockRead(&m_sLock);
+	NSArray *keys = CHReadWriteLockSnapshot(&m_sLock, sortedKeys);
+	if (values != NULL) {
+		NSMutableArray *objects = [NSMutableArray arrayWithCapacity:[keys count]];
+		for (id aKey in keys)
+			[objects addObject:[super objectForKey:aKey]];
+		*values = objects;
+	}
+	CHReadWriteLockUnlock(&m_sLock, locked, false);
+	return keys;
+}
+
+#pragma mark <NSCoding>
+
+- (void) encodeWithCoder:(NSCoder*)encoder {
+	bool locked = CHReadWriteLockRead(&m_sLock);
+	[super encodeWithCoder:encoder];
+	CHReadWriteLockUnlock(&m_sLock, locked, false);
+}
+
+#pragma mark <NSCopying>
+
+- (id) copyWithZone:(NSZone*)zone {
+	NSArray *values;
+	NSArray *keys = [self keySnapshotWithValues:&values];
+	CHConcurrentSortedDictionary *copy = [[[self class] allocWithZone:zone] init];
+	NSUInteger index = 0;
+	for (id aKey in keys)
+		[copy setObject:[values objectAtIndex:index++] forKey:aKey];
+	return copy;
+}
+
+#pragma mark <NSFastEnumeration>
+
+// The first call takes the snapshot of the keys, kept in extra[0], as for CHConcurrentSortedSet.
+- (NSUInteger) countByEnumeratingWithState:(NSFastEnumerationState*)state
+                                   objects:(id*)stackbuf
+                                     count:(NSUInteger)len
+{
+	NSArray *snapshot;
+	if (state->state == 0) {
+		snapshot = [self keySnapshotWithValues:NULL];
+		state->state = 1;
+		state->mutationsPtr = &state->extra[1];
+		state->extra[0] = (unsigned long) snapshot;
+		state->extra[2] = 0;
+	} else
+		snapshot = (NSArray*) state->extra[0];
+	NSUInteger index = state->extra[2];
+	NSUInteger batchCount = MIN(len, [snapshot count] - index);
+	[snapshot getObjects:stackbuf range:NSMakeRange(index, batchCount)];
+	state->extra[2] = index + batchCount;
+	state->itemsPtr = stackbuf;
+	return batchCount;
+}
+
+#pragma mark Querying Contents
+
+- (NSUInteger) count {
+	bool locked = CHReadWriteLockRead(&m_sLock);
+	NSUInteger count = [super count];
+	CHReadWriteLockUnlock(&m_sLock, locked, false);
+	return count;
+}
+
+- (NSString*) description {
+	bool locked = CHReadWriteLockRead(&m_sLock);
+	NSString *description = [super description];
+	CHReadWriteLockUnlock(&m_sLock, locked, false);
+	return description;
+}
+
+- (id) firstKey {
+	bool locked = CHReadWriteLockRead(&m_sLock);
+	id aKey = [[[super firstKey] retain] autorelease];
+	CHReadWriteLockUnlock(&m_sLock, locked, false);
+	return aKey;
+}
+
+- (NSUInteger) hash {
+	bool locked = CHReadWriteLockRead(&m_sLock);
+	NSUInteger hash = [super hash];
+	CHReadWriteLockUnlock(&m_sLock, locked, false);
+	return hash;
+}
+
+- (id) lastKey {
+	bool locked = CHReadWriteLockRead(&m_sLock);
+	id aKey = [[[super lastKey] retain] autorelease];
+	CHReadWriteLockUnlock(&m_sLock, locked, false);
+	return aKey;
+}
+
+- (NSEnumerator*) keyEnumerator {
+	return [[self keySnapshotWithValues:NULL] objectEnumerator];
+}
+
+- (NSEnumerator*) objectEnumerator {
+	NSArray *values;
+	[self keySnapshotWithValues:&values];
+	return [values objectEnumerator];
+}
+
+- (id) objectForKey:(id)aKey {
+	if (aKey == nil)
+		return nil;
+	bool locked = CHReadWriteLockRead(&m_sLock);
+	id anObject = [[[super objectForKey:aKey] retain] autorelease];
+	CHReadWriteLockUnlock(&m_sLock, locked, false);
+	return anObject;
+}
+
+- (NSEnumerator*) reverseKeyEnumerator {
+	return [[self keySnapshotWithValues:NULL] reverseObjectEnumerator];
+}
+
+// Overridden so that the keys are copied and their values looked up under the same read lock, and the subset is filled from the copies once
+// the lock is released.
+- (NSMutableDictionary*) subsetFromKey:(id)start
+                                 toKey:(id)end
+                               options:(CHSubsetConstructionOptions)options
+{
+	bool locked = CHReadWriteLockRead(&m_sLock);
+	NSArray *keys = [[sortedKeys subsetFromObject:start toObject:end options:options] allObjects];
+	NSMutableArray *values = [NSMutableArray arrayWithCapacity:[keys count]];
+	for (id aKey in keys)
+		[values addObject:[super objectForKey:aKey]];
+	CHReadWriteLockUnlock(&m_sLock, locked, false);
+	NSMutableDictionary* subset = [[[[self class] alloc] init] autorelease];
+	NSUInteger index = 0;
+	for (id aKey in keys)
+		[subset setObject:[values objectAtIndex:index++] forKey:aKey];
+	return subset;
+}
+
+#pragma mark Modifying Contents
+
+- (void) removeAllObjects {
+	bool locked = CHReadWriteLockWrite(&m_sLock);
+	[super removeAllObjects];
+	CHReadWriteLockUnlock(&m_sLock, locked, true);
+}
+
+- (void) removeObjectForKey:(id)aKey {
+	if (aKey == nil)
+		return;
+	bool locked = CHReadWriteLockWrite(&m_sLock);
+	[super removeObjectForKey:aKey];
+	CHReadWriteLockUnlock(&m_sLock, locked, true);
+}
+
+- (void) setObject:(id)anObject forKey:(id)aKey {
+	if (anObject == nil || aKey == nil)
+		CHNilArgumentException([self class], _cmd);
+	bool locked = CHReadWriteLockWrite(&m_sLock);
+	[super setObject:anObject forKey:aKey];
+	CHReadWriteLockUnlock(&m_sLock, locked, true);
+}
+
+// The lock is released even if the update raises an exception, since the receiver could not otherwise be used again.
+- (void) performBatchUpdatesWithFunction:(void (*)(NSMutableDictionary * dictionary, void * a_pvContext))a_pfnUpdate context:(void*)a_pvContext {
+	if (a_pfnUpdate == NULL)
+		CHNilArgumentException([self class], _cmd);
+	bool locked = CHReadWriteLockWrite(&m_sLock);
+	@try {
+		a_pfnUpdate(self, a_pvContext);
+	}
+	@finally {
+		CHReadWriteLockUnlock(&m_sLock, locked, true);
+	}
+}
+
+#if defined (__BLOCKS__)
+- (void) performBatchUpdates:(void (^)(NSMutableDictionary * dictionary))block {
+	if (block == nil)
+		CHNilArgumentException([self class], _cmd);
+	bool locked = CHReadWriteLockWrite(&m_sLock);
+	@try {
+		block(self);
+	}
+	@finally {
+		CHReadWriteLockUnlock(&m_sLock, locked, true);
+	}
+}
+#endif	/* defined (__BLOCKS__) */
+
+@end
@@ -0,0 +1,96 @@
+/*
+ CHDataStructures.framework -- CHConcurrentSortedSet.h
+
+ Copyright (c) 2008-2010, Quinn Taylor <http://homepage.mac.com/quinntaylor>
+
+ This source code is released under the ISC License. <http://www.opensource.org/licenses/isc-license>
+
+ Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby granted, provided that the above copyright notice and this permission notice appear in all copies.
+
+ The software is  provided "as is", without warranty of any kind, including all implied warranties of merchantability and fitness. In no event shall the authors or copyright holders be liable for any claim, damages, or other liability, whether in an action of contract, tort, or otherwise, arising from, out of, or in connection with the software or the use or other dealings in the software.
+
+	Fixes, additions, extensions, port to GNUstep by Christopher Chandler
+	Copyright © 2013-2015	Christopher James Elphinstone Chandler, Russell Geoffrey Watts. All Rights Reserved.
+	Copyright © 2015-2025	Kinnami Software Corporation. All rights reserved.
+ */
+
+#import "CHSortedSet.h"
+#import "Util.h"
+#import <pthread.h>
+
+/**
+ @file CHConcurrentSortedSet.h
+ A thread safe facade around any CHSortedSet, for sets that many threads read and few modify.
+ */
+
+/**
+ A readers-writer lock with a cached snapshot of the objects it guards, shared by CHConcurrentSortedSet and CHConcurrentSortedDictionary. The thread holding the write lock may take either lock again without blocking, so that the body of a batch update may call the facade itself.
+ */
+typedef struct CHReadWriteLock {
+	pthread_rwlock_t	sLock;					///< Held for reading by queries and for writing by modifications.
+	pthread_t			sWriter;				///< The thread holding the write lock, valid while @c fWriting is set and cleared on unlock. Read and written atomically.
+	unsigned int		fWriting;				///< Set while a thread holds the write lock. Read and written atomically.
+	pthread_mutex_t		sSnapshotLock;			///< Guards the snapshot, which several readers holding the read lock may take at the same time.
+	NSArray *			poSnapshot;				///< The objects in ascending order, or @c nil if there have been changes since the last snapshot.
+} CHReadWriteLock;
+
+HIDDEN void	CHReadWriteLockInit (CHReadWriteLock * a_pLock);
+HIDDEN void	CHReadWriteLockDestroy (CHReadWriteLock * a_pLock);
+HIDDEN bool	CHReadWriteLockRead (CHReadWriteLock * a_pLock);
+HIDDEN bool	CHReadWriteLockWrite (CHReadWriteLock * a_pLock);
+HIDDEN void	CHReadWriteLockUnlock (CHReadWriteLock * a_pLock, bool a_fLocked, bool a_fModified);
+HIDDEN NSArray *	CHReadWriteLockSnapshot (CHReadWriteLock * a_pLock, id<CHSortedSet> a_poSet);
+
+/**
+ A thread safe sorted set, which wraps any other CHSortedSet, such as a CHAVLTree or a CHRedBlackTree, and guards it with a readers-writer lock. Queries such as \link #member: -member:\endlink, \link #containsObject: -containsObject:\endlink, \link #firstObject -firstObject\endlink and \link #count -count\endlink take the lock for reading, so any number of threads may run them at once, and block only while a thread is modifying the set. Methods that modify the set take the lock for writing. Objects returned by the receiver are retained and autoreleased while the lock is held, so they stay valid even if another thread removes them at once.
+
+ Each acquisition of the write lock waits for every reader to leave, so a thread that makes many changes should make them in one call to \link #performBatchUpdates: -performBatchUpdates:\endlink, which holds the write lock once for all of them. \link #addObjectsFromArray: -addObjectsFromArray:\endlink does the same for its objects.
+
+ Enumeration never holds the lock. Enumerators, NSFastEnumeration and \link #allObjects -allObjects\endlink iterate an immutable snapshot of the objects, taken under the read lock and kept until the set is next modified, so repeated enumerations of an unchanging set share one snapshot. Enumerating never raises an exception when another thread modifies the set, and returns the objects as they were when the enumeration began.
+
+ An optimistic, seqlock style read, which runs without any lock and retries if a writer intervened, is not used: the nodes of a tree may be freed by a writer while such a reader is still following them. For sets that are modified as often as they are read, CHConcurrentSkipListSet does not block at all.
+
+ The wrapped set must not be used directly once the facade owns it. Its comparison must not raise an exception, and must not call the facade.
+ */
+@interface CHConcurrentSortedSet : NSObject <CHSortedSet>
+{
+	@protected
+		id<CHSortedSet>		m_poSet;		/* The set that holds the objects */
+		CHReadWriteLock		m_sLock;		/* Guards m_poSet and caches its snapshot */
+}
+
+/**
+ Initialize a concurrent sorted set that wraps a given sorted set.
+
+ @param aSortedSet The sorted set to wrap, which is retained. It must not be used other than through the receiver from now on.
+ @return An initialized concurrent sorted set that contains the objects in @a aSortedSet.
+
+ @throw NSInvalidArgumentException if @a aSortedSet is @c nil.
+ */
+- (id) initWithSortedSet:(id<CHSortedSet>)aSortedSet;
+
+/**
+ Returns the class of the sorted set used by \link #init -init\endlink and \link #initWithArray: -initWithArray:\endlink, which is CHAVLTree.
+
+ @return The class of the set that a new concurrent sorted set wraps by default.
+ */
++ (Class) defaultSortedSetClass;
+
+#if defined (__BLOCKS__)
+/**
+ Makes any number of changes to the receiver while holding the write lock once. Other threads do not see the receiver until the block returns, and then see every change made by it.
+
+ @param block A block that modifies the set it is passed, which is the receiver. The block may call any method of the receiver, including queries and enumeration, without blocking. It must not wait for another thread that uses the receiver.
+ */
+- (void) performBatchUpdates:(void (^)(id<CHSortedSet> sortedSet))block;
+#endif	/* defined (__BLOCKS__) */
+
+/**
+ Makes any number of changes to the receiver while holding the write lock once, as for \link #performBatchUpdates: -performBatchUpdates:\endlink.
+
+ @param a_pfnUpdate A function that modifies the set it is passed, which is the receiver.
+ @param a_pvContext An arbitrary pointer passed to @a a_pfnUpdate.
+ */
+- (void) performBatchUpdatesWithFunction:(void (*)(id<CHSortedSet> sortedSet, void * a_pvContext))a_pfnUpdate context:(void*)a_pvContext;
+
+@end
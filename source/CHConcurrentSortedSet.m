@@ -0,0 +1,402 @@
+/*
+ CHDataStructures.framework -- CHConcurrentSortedSet.m
+
+ Copyright (c) 2008-2010, Quinn Taylor <http://homepage.mac.com/quinntaylor>
+
+ This source code is released under the ISC License. <http://www.opensource.org/licenses/isc-license>
+
+ Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby granted, provided that the above copyright notice and this permission notice appear in all copies.
+
+ The software is  provided "as is", without warranty of any kind, including all implied warranties of merchantability and fitness. In no event shall the authors or copyright holders be liable for any claim, damages, or other liability, whether in an action of contract, tort, or otherwise, arising from, out of, or in connection with the software or the use or other dealings in the software.
+
+	Fixes, additions, extensions, port to GNUstep by Christopher Chandler
+	Copyright © 2013-2015	Christopher James Elphinstone Chandler, Russell Geoffrey Watts. All Rights Reserved.
+	Copyright © 2015-2025	Kinnami Software Corporation. All rights reserved.
+ */
+
+#import "CHConcurrentSortedSet.h"
+#import "CHAVLTree.h"
+
+#pragma mark Readers-writer lock
+
+/* Stored in the writer field while no thread holds the write lock, so that a stale writer never matches a later thread that reuses its id
+*/
+static const pthread_t	kCHReadWriteLockNoWriter;
+
+/* Returns whether the calling thread holds the write lock. Another thread may take the write lock meanwhile, so the fields are read atomically,
+	and the flag is acquired before the writer is read, pairing with the release in CHReadWriteLockWrite. Only the calling thread can make the
+	answer true
+*/
+static inline bool	CHReadWriteLockIsWriter (CHReadWriteLock * a_pLock)
+	{
+	pthread_t	sWriter;
+
+	if (!__atomic_load_n (&a_pLock->fWriting, __ATOMIC_ACQUIRE))
+		return false;
+	__atomic_load (&a_pLock->sWriter, &sWriter, __ATOMIC_RELAXED);
+	return pthread_equal (sWriter, pthread_self ()) != 0;
+	}
+
+void	CHReadWriteLockInit (CHReadWriteLock * a_pLock)
+	{
+	pthread_rwlock_init (&a_pLock->sLock, NULL);
+	pthread_mutex_init (&a_pLock->sSnapshotLock, NULL);
+	a_pLock->sWriter = kCHReadWriteLockNoWriter;
+	a_pLock->fWriting = 0;
+	a_pLock->poSnapshot = nil;
+	}
+
+void	CHReadWriteLockDestroy (CHReadWriteLock * a_pLock)
+	{
+	[a_pLock->poSnapshot release];
+	a_pLock->poSnapshot = nil;
+	pthread_mutex_destroy (&a_pLock->sSnapshotLock);
+	pthread_rwlock_destroy (&a_pLock->sLock);
+	}
+
+/* Takes the lock for reading, unless the calling thread already holds it for writing. Returns whether the lock was taken, to be passed to
+	CHReadWriteLockUnlock
+*/
+bool	CHReadWriteLockRead (CHReadWriteLock * a_pLock)
+	{
+	if (CHReadWriteLockIsWriter (a_pLock))
+		return false;
+	pthread_rwlock_rdlock (&a_pLock->sLock);
+	return true;
+	}
+
+/* Takes the lock for writing, unless the calling thread already holds it for writing. Returns whether the lock was taken, to be passed to
+	CHReadWriteLockUnlock
+*/
+bool	CHReadWriteLockWrite (CHReadWriteLock * a_pLock)
+	{
+	pthread_t	sSelf;
+
+	if (CHReadWriteLockIsWriter (a_pLock))
+		return false;
+	pthread_rwlock_wrlock (&a_pLock->sLock);
+	sSelf = pthread_self ();
+	__atomic_store (&a_pLock->sWriter, &sSelf, __ATOMIC_RELAXED);
+	__atomic_store_n (&a_pLock->fWriting, 1, __ATOMIC_RELEASE);
+	return true;
+	}
+
+/* Releases the lock, if a_fLocked, after discarding the snapshot if the guarded objects were modified. No reader holds the lock during a
+	modification, so the snapshot can be discarded without the snapshot lock. It is released only once the lock is free, since releasing it may
+	deallocate objects
+*/
+void	CHReadWriteLockUnlock (CHReadWriteLock * a_pLock, bool a_fLocked, bool a_fModified)
+	{
+	NSArray *	poSnapshot = nil;
+	pthread_t	sWriter;
+
+	if (a_fModified)
+		{
+		poSnapshot = a_pLock->poSnapshot;
+		a_pLock->poSnapshot = nil;
+		}
+	if (a_fLocked)
+		{
+		if (__atomic_load_n (&a_pLock->fWriting, __ATOMIC_RELAXED))
+			{
+			__atomic_store_n (&a_pLock->fWriting, 0, __ATOMIC_RELEASE);
+			sWriter = kCHReadWriteLockNoWriter;
+			__atomic_store (&a_pLock->sWriter, &sWriter, __ATOMIC_RELEASE);
+			}
+		pthread_rwlock_unlock (&a_pLock->sLock);
+		}
+	[poSnapshot release];
+	}
+
+/* Returns an immutable array of the objects in a sorted set, which the calling thread must have locked for reading or writing. The array is kept
+	until the set is next modified, and returned again meanwhile. Several readers may find there is no snapshot at the same time, and each makes
+	one, but only the first is kept
+*/
+NSArray *	CHReadWriteLockSnapshot (CHReadWriteLock * a_pLock, id<CHSortedSet> a_poSet)
+	{
+	NSArray *	poSnapshot;
+
+	pthread_mutex_lock (&a_pLock->sSnapshotLock);
+	poSnapshot = [a_pLock->poSnapshot retain];
+	pthread_mutex_unlock (&a_pLock->sSnapshotLock);
+	if (poSnapshot == nil)
+		{
+		poSnapshot = [[a_poSet allObjects] copy];
+		pthread_mutex_lock (&a_pLock->sSnapshotLock);
+		if (a_pLock->poSnapshot == nil)
+			a_pLock->poSnapshot = [poSnapshot retain];
+		pthread_mutex_unlock (&a_pLock->sSnapshotLock);
+		}
+	return [poSnapshot autorelease];
+	}
+
+#pragma mark -
+
+@implementation CHConcurrentSortedSet
+
++ (Class) defaultSortedSetClass {
+	return [CHAVLTree class];
+}
+
+- (void) dealloc {
+	if (m_poSet != nil) {
+		CHReadWriteLockDestroy(&m_sLock);
+		[m_poSet release];
+	}
+	[super dealloc];
+}
+
+- (id) init {
+	id<CHSortedSet> sortedSet = [[[[self class] defaultSortedSetClass] alloc] init];
+	self = [self initWithSortedSet:sortedSet];
+	[sortedSet release];
+	return self;
+}
+
+- (id) initWithArray:(NSArray*)anArray {
+	id<CHSortedSet> sortedSet = [[[[self class] defaultSortedSetClass] alloc] initWithArray:anArray];
+	self = [self initWithSortedSet:sortedSet];
+	[sortedSet release];
+	return self;
+}
+
+- (id) initWithSortedSet:(id<CHSortedSet>)aSortedSet {
+	if (aSortedSet == nil) {
+		Class aClass = [self class];
+		[self release];
+		CHNilArgumentException(aClass, _cmd);
+	}
+	if ((self = [super init]) == nil) return nil;
+	CHReadWriteLockInit(&m_sLock);
+	m_poSet = [aSortedSet retain];
+	return self;
+}
+
+#pragma mark <NSCoding>
+
+- (id) initWithCoder:(NSCoder*)decoder {
+	id<CHSortedSet> sortedSet;
+	if ([decoder allowsKeyedCoding])
+		sortedSet = [decoder decodeObjectForKey:@"sortedSet"];
+	else
+		sortedSet = [decoder decodeObject];
+	return [self initWithSortedSet:sortedSet];
+}
+
+- (void) encodeWithCoder:(NSCoder*)encoder {
+	bool locked = CHReadWriteLockRead(&m_sLock);
+	if ([encoder allowsKeyedCoding])
+		[encoder encodeObject:m_poSet forKey:@"sortedSet"];
+	else
+		[encoder encodeObject:m_poSet];
+	CHReadWriteLockUnlock(&m_sLock, locked, false);
+}
+
+#pragma mark <NSCopying>
+
+- (id) copyWithZone:(NSZone*)zone {
+	bool locked = CHReadWriteLockRead(&m_sLock);
+	id<CHSortedSet> sortedSet = [m_poSet copyWithZone:zone];
+	CHReadWriteLockUnlock(&m_sLock, locked, false);
+	CHConcurrentSortedSet *copy = [[[self class] allocWithZone:zone] initWithSortedSet:sortedSet];
+	[sortedSet release];
+	return copy;
+}
+
+#pragma mark <NSFastEnumeration>
+
+// The first call takes the snapshot, kept in extra[0], and later calls copy the next batch from it into the stack buffer. The mutations pointer
+// refers to extra[1], which never changes, so modifying the receiver during fast enumeration never raises an exception.
+- (NSUInteger) countByEnumeratingWithState:(NSFastEnumerationState*)state
+                                   objects:(id*)stackbuf
+                                     count:(NSUInteger)len
+{
+	NSArray *snapshot;
+	if (state->state == 0) {
+		bool locked = CHReadWriteLockRead(&m_sLock);
+		snapshot = CHReadWriteLockSnapshot(&m_sLock, m_poSet);
+		CHReadWriteLockUnlock(&m_sLock, locked, false);
+		state->state = 1;
+		state->mutationsPtr = &state->extra[1];
+		state->extra[0] = (unsigned long) snapshot;
+		state->extra[2] = 0;
+	} else
+		snapshot = (NSArray*) state->extra[0];
+	NSUInteger index = state->extra[2];
+	NSUInteger batchCount = MIN(len, [snapshot count] - index);
+	[snapshot getObjects:stackbuf range:NSMakeRange(index, batchCount)];
+	state->extra[2] = index + batchCount;
+	state->itemsPtr = stackbuf;
+	return batchCount;
+}
+
+#pragma mark Querying Contents
+
+- (NSArray*) allObjects {
+	bool locked = CHReadWriteLockRead(&m_sLock);
+	NSArray *snapshot = CHReadWriteLockSnapshot(&m_sLock, m_poSet);
+	CHReadWriteLockUnlock(&m_sLock, locked, false);
+	return snapshot;
+}
+
+- (id) anyObject {
+	return [self firstObject];
+}
+
+- (NSUInteger) count {
+	bool locked = CHReadWriteLockRead(&m_sLock);
+	NSUInteger count = [m_poSet count];
+	CHReadWriteLockUnlock(&m_sLock, locked, false);
+	return count;
+}
+
+- (BOOL) containsObject:(id)anObject {
+	if (anObject == nil)
+		return NO;
+	bool locked = CHReadWriteLockRead(&m_sLock);
+	BOOL contains = [m_poSet containsObject:anObject];
+	CHReadWriteLockUnlock(&m_sLock, locked, false);
+	return contains;
+}
+
+- (NSString*) description {
+	return [[self allObjects] description];
+}
+
+- (id) firstObject {
+	bool locked = CHReadWriteLockRead(&m_sLock);
+	id anObject = [[[m_poSet firstObject] retain] autorelease];
+	CHReadWriteLockUnlock(&m_sLock, locked, false);
+	return anObject;
+}
+
+- (NSUInteger) hash {
+	bool locked = CHReadWriteLockRead(&m_sLock);
+	NSUInteger hash = hashOfCountAndObjects([m_poSet count], [m_poSet firstObject], [m_poSet lastObject]);
+	CHReadWriteLockUnlock(&m_sLock, locked, false);
+	return hash;
+}
+
+- (BOOL) isEqual:(id)otherObject {
+	if ([otherObject conformsToProtocol:@protocol(CHSortedSet)])
+		return [self isEqualToSortedSet:otherObject];
+	else
+		return NO;
+}
+
+// Compares a snapshot, so that the count and the objects compared are consistent.
+- (BOOL) isEqualToSortedSet:(id<CHSortedSet>)otherSortedSet {
+	return (otherSortedSet == self) || collectionsAreEqual([self allObjects], otherSortedSet);
+}
+
+- (id) lastObject {
+	bool locked = CHReadWriteLockRead(&m_sLock);
+	id anObject = [[[m_poSet lastObject] retain] autorelease];
+	CHReadWriteLockUnlock(&m_sLock, locked, false);
+	return anObject;
+}
+
+- (id) member:(id)anObject {
+	if (anObject == nil)
+		return nil;
+	bool locked = CHReadWriteLockRead(&m_sLock);
+	id member = [[[m_poSet member:anObject] retain] autorelease];
+	CHReadWriteLockUnlock(&m_sLock, locked, false);
+	return member;
+}
+
+- (NSEnumerator*) objectEnumerator {
+	return [[self allObjects] objectEnumerator];
+}
+
+- (NSEnumerator*) reverseObjectEnumerator {
+	return [[self allObjects] reverseObjectEnumerator];
+}
+
+- (NSSet*) set {
+	return [NSSet setWithArray:[self allObjects]];
+}
+
+- (id<CHSortedSet>) subsetFromObject:(id)start
+                            toObject:(id)end
+                             options:(CHSubsetConstructionOptions)options
+{
+	// The wrapped set's subset may be a live view of it, which the new facade's lock would not guard, so it is copied under the read lock.
+	bool locked = CHReadWriteLockRead(&m_sLock);
+	id<CHSortedSet> subset = [[[m_poSet subsetFromObject:start toObject:end options:options] copy] autorelease];
+	CHReadWriteLockUnlock(&m_sLock, locked, false);
+	return [[[[self class] alloc] initWithSortedSet:subset] autorelease];
+}
+
+#pragma mark Modifying Contents
+
+- (void) addObject:(id)anObject {
+	if (anObject == nil)
+		CHNilArgumentException([self class], _cmd);
+	bool locked = CHReadWriteLockWrite(&m_sLock);
+	[m_poSet addObject:anObject];
+	CHReadWriteLockUnlock(&m_sLock, locked, true);
+}
+
+- (void) addObjectsFromArray:(NSArray*)anArray {
+	if ([anArray count] == 0)
+		return;
+	bool locked = CHReadWriteLockWrite(&m_sLock);
+	[m_poSet addObjectsFromArray:anArray];
+	CHReadWriteLockUnlock(&m_sLock, locked, true);
+}
+
+- (void) removeAllObjects {
+	bool locked = CHReadWriteLockWrite(&m_sLock);
+	[m_poSet removeAllObjects];
+	CHReadWriteLockUnlock(&m_sLock, locked, true);
+}
+
+- (void) removeFirstObject {
+	bool locked = CHReadWriteLockWrite(&m_sLock);
+	[m_poSet removeFirstObject];
+	CHReadWriteLockUnlock(&m_sLock, locked, true);
+}
+
+- (void) removeLastObject {
+	bool locked = CHReadWriteLockWrite(&m_sLock);
+	[m_poSet removeLastObject];
+	CHReadWriteLockUnlock(&m_sLock, locked, true);
+}
+
+- (void) removeObject:(id)anObject {
+	if (anObject == nil)
+		return;
+	bool locked = CHReadWriteLockWrite(&m_sLock);
+	[m_poSet removeObject:anObject];
+	CHReadWriteLockUnlock(&m_sLock, locked, true);
+}
+
+// The lock is released even if the update raises an exception, since the receiver could not otherwise be used again.
+- (void) performBatchUpdatesWithFunction:(void (*)(id<CHSortedSet> sortedSet, void * a_pvContext))a_pfnUpdate context:(void*)a_pvContext {
+	if (a_pfnUpdate == NULL)
+		CHNilArgumentException([self class], _cmd);
+	bool locked = CHReadWriteLockWrite(&m_sLock);
+	@try {
+		a_pfnUpdate(self, a_pvContext);
+	}
+	@finally {
+		CHReadWriteLockUnlock(&m_sLock, locked, true);
+	}
+}
+
+#if defined (__BLOCKS__)
+- (void) performBatchUpdates:(void (^)(id<CHSortedSet> sortedSet))block {
+	if (block == nil)
+		CHNilArgumentException([self class], _cmd);
+	bool locked = CHReadWriteLockWrite(&m_sLock);
+	@try {
+		block(self);
+	}
+	@finally {
+		CHReadWriteLockUnlock(&m_sLock, locked, true);
+	}
+}
+#endif	/* defined (__BLOCKS__) */
+
+@end
@@ -74,12 +74,19 @@
 #import "CHAnderssonTree.h"
 #import "CHBidirectionalDictionary.h"
 #import "CHBinaryHeap.h"
+#import "CHBPlusTree.h"
 #import "CHAVLTree.h"
 #import "CHCircularBuffer.h"
 #import "CHCircularBufferDeque.h"
 #import "CHCircularBufferQueue.h"
 #import "CHCircularBufferStack.h"
+#import "CHConcurrentSkipListSet.h"
+#import "CHConcurrentSortedDictionary.h"
+#import "CHConcurrentSortedSet.h"
+#import "CHDoubleSortedSet.h"
 #import "CHDoublyLinkedList.h"
+#import "CHFrozenSortedSet.h"
+#import "CHInt64SortedSet.h"
 #import "CHListDeque.h"
 #import "CHListQueue.h"
 #import "CHListStack.h"
@@ -90,6 +97,7 @@
 #import "CHOrderedSet.h"
 #import "CHRedBlackTree.h"
 #import "CHSinglyLinkedList.h"
+#import "CHSkipList.h"
 #import "CHSortedDictionary.h"
 #import "CHTreap.h"
 #import "CHUnbalancedTree.h"
@@ -133,6 +141,7 @@
 	 - CHMultiOrderedDictionary
 	 - CHOrderedDictionary
 	 - CHSortedDictionary
+		 - CHConcurrentSortedDictionary
  
  The concrete child classes of NSMutableSet include:
  - CHMutableSet
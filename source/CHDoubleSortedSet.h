@@ -0,0 +1,69 @@
+/*
+ CHDataStructures.framework -- CHDoubleSortedSet.h
+
+ Copyright (c) 2008-2010, Quinn Taylor <http://homepage.mac.com/quinntaylor>
+
+ This source code is released under the ISC License. <http://www.opensource.org/licenses/isc-license>
+
+ Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby granted, provided that the above copyright notice and this permission notice appear in all copies.
+
+ The software is  provided "as is", without warranty of any kind, including all implied warranties of merchantability and fitness. In no event shall the authors or copyright holders be liable for any claim, damages, or other liability, whether in an action of contract, tort, or otherwise, arising from, out of, or in connection with the software or the use or other dealings in the software.
+
+	Fixes, additions, extensions, port to GNUstep by Christopher Chandler
+	Copyright © 2013-2015	Christopher James Elphinstone Chandler, Russell Geoffrey Watts. All Rights Reserved.
+	Copyright © 2015-2025	Kinnami Software Corporation. All rights reserved.
+ */
+
+#import "CHAbstractPrimitiveSortedSet.h"
+
+/**
+ @file CHDoubleSortedSet.h
+ A sorted set of double precision floating point numbers, stored unboxed.
+ */
+
+/**
+ A sorted set of double precision floating point numbers. Each number is stored unboxed, inline in a node of an AVL tree, and compared with a native comparison, so a set of numbers takes a fraction of the memory of a search tree of NSNumber objects and is searched without sending any messages. The primitive methods, such as \link #addDouble: -addDouble:\endlink and \link #containsDouble: -containsDouble:\endlink, never create an object. The methods of the CHSortedSet protocol accept any NSNumber, using its @c -doubleValue, and return NSNumber objects created with @c +numberWithDouble:.
+
+ Each number is stored as a 64-bit integer with the same bits, arranged so that integer order is numeric order, which is then compared with a single integer comparison. Negative and positive zero are the same number, and are stored as positive zero. NaN is ordered after positive infinity, and all NaNs are the same number, so a set may hold one NaN and can find it again.
+ */
+@interface CHDoubleSortedSet : CHAbstractPrimitiveSortedSet
+
+/**
+ Initialize a set with the numbers in a C array, in any order. Duplicates are added once. The numbers are sorted and built into a balanced tree in a single pass, without boxing any of them.
+
+ @param numbers A C array of numbers.
+ @param numberCount The number of numbers in @a numbers.
+ @return An initialized set that contains the numbers in @a numbers.
+ */
+- (id) initWithDoubles:(const double*)numbers count:(NSUInteger)numberCount;
+
+/**
+ Adds a number to the set, unless it is already in the set.
+
+ @param number The number to add.
+ */
+- (void) addDouble:(double)number;
+
+/**
+ Determines whether the set contains a number.
+
+ @param number The number to search for.
+ @return @c YES if the set contains @a number, otherwise @c NO.
+ */
+- (BOOL) containsDouble:(double)number;
+
+/**
+ Removes a number from the set, if it is in the set.
+
+ @param number The number to remove.
+ */
+- (void) removeDouble:(double)number;
+
+/**
+ Copies every number in the set, in ascending order, into a C array.
+
+ @param numbers A C array with room for at least \link CHSortedSet#count -count\endlink numbers.
+ */
+- (void) getDoubles:(double*)numbers;
+
+@end
@@ -0,0 +1,99 @@
+/*
+ CHDataStructures.framework -- CHDoubleSortedSet.m
+
+ Copyright (c) 2008-2010, Quinn Taylor <http://homepage.mac.com/quinntaylor>
+
+ This source code is released under the ISC License. <http://www.opensource.org/licenses/isc-license>
+
+ Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby granted, provided that the above copyright notice and this permission notice appear in all copies.
+
+ The software is  provided "as is", without warranty of any kind, including all implied warranties of merchantability and fitness. In no event shall the authors or copyright holders be liable for any claim, damages, or other liability, whether in an action of contract, tort, or otherwise, arising from, out of, or in connection with the software or the use or other dealings in the software.
+
+	Fixes, additions, extensions, port to GNUstep by Christopher Chandler
+	Copyright © 2013-2015	Christopher James Elphinstone Chandler, Russell Geoffrey Watts. All Rights Reserved.
+	Copyright © 2015-2025	Kinnami Software Corporation. All rights reserved.
+ */
+
+#import "CHDoubleSortedSet.h"
+
+/* Map the bits of a double onto an int64_t, so that integer order is numeric order. The bits of a non-negative double already
+	increase with its value. Those of a negative double are negative as an integer, but increase with its magnitude, so all but
+	the sign bit are inverted. Negative zero becomes positive zero, and every NaN becomes the same positive quiet NaN, which
+	comes after positive infinity
+*/
+static inline int64_t	CHDoubleKeyEncode (double a_dNumber)
+	{
+	int64_t		iKey;
+
+	if (a_dNumber == 0.0)
+		a_dNumber = 0.0;
+	if (a_dNumber != a_dNumber)
+		return INT64_C (0x7FF8000000000000);
+	memcpy (&iKey, &a_dNumber, sizeof (iKey));
+	return (iKey < 0) ? (iKey ^ INT64_MAX) : iKey;
+	}
+
+static inline double	CHDoubleKeyDecode (int64_t a_iKey)
+	{
+	double		dNumber;
+
+	if (a_iKey < 0)
+		a_iKey ^= INT64_MAX;
+	memcpy (&dNumber, &a_iKey, sizeof (dNumber));
+	return dNumber;
+	}
+
+@implementation CHDoubleSortedSet
+
+- (id) initWithDoubles:(const double*)numbers count:(NSUInteger)numberCount {
+	if ((self = [self init]) == nil) return nil;
+	int64_t *keys = malloc(sizeof(int64_t) * (numberCount + 1));
+	if (keys == NULL) {
+		[self release];
+		[NSException raise:NSMallocException format:@"Unable to allocate %lu keys", (unsigned long) numberCount];
+	}
+	NSUInteger index;
+	for (index = 0; index < numberCount; index++)
+		keys[index] = CHDoubleKeyEncode(numbers[index]);
+	CHPrimitiveTreeBuild(&m_sTree, keys, CHPrimitiveKeysSortUnique(keys, numberCount));
+	free(keys);
+	return self;
+}
+
+- (BOOL) getKey:(int64_t*)key forObject:(id)anObject {
+	if (![anObject isKindOfClass:[NSNumber class]])
+		return NO;
+	*key = CHDoubleKeyEncode([anObject doubleValue]);
+	return YES;
+}
+
+- (id) objectForKey:(int64_t)key {
+	return [NSNumber numberWithDouble:CHDoubleKeyDecode(key)];
+}
+
+- (void) addDouble:(double)number {
+	CHPrimitiveTreeAdd(&m_sTree, CHDoubleKeyEncode(number));
+}
+
+- (BOOL) containsDouble:(double)number {
+	return CHPrimitiveTreeContains(&m_sTree, CHDoubleKeyEncode(number));
+}
+
+- (void) removeDouble:(double)number {
+	CHPrimitiveTreeRemove(&m_sTree, CHDoubleKeyEncode(number));
+}
+
+// The keys are fetched a batch at a time, and each batch resumes after the last key of the one before.
+- (void) getDoubles:(double*)numbers {
+	int64_t keys[kCHPrimitiveKeysBatch];
+	NSUInteger index, batchCount = CHPrimitiveTreeGetKeys(&m_sTree, true, 0, false, false, keys, kCHPrimitiveKeysBatch);
+	while (batchCount != 0) {
+		for (index = 0; index < batchCount; index++)
+			*numbers++ = CHDoubleKeyDecode(keys[index]);
+		if (batchCount < kCHPrimitiveKeysBatch)
+			break;
+		batchCount = CHPrimitiveTreeGetKeys(&m_sTree, false, keys[kCHPrimitiveKeysBatch - 1], false, false, keys, kCHPrimitiveKeysBatch);
+	}
+}
+
+@end
@@ -277,6 +277,49 @@ static size_t kCHDoublyLinkedListNodeSize = sizeof(CHDoublyLinkedListNode);
 	return count;
 }
 
+#if defined (__BLOCKS__)
+- (void) enumerateObjectsUsingBlock:(void (^)(id obj, NSUInteger idx, BOOL *stop))block {
+	[self enumerateObjectsWithOptions:0 usingBlock:block];
+}
+
+- (void) enumerateObjectsWithOptions:(NSEnumerationOptions)opts
+                          usingBlock:(void (^)(id obj, NSUInteger idx, BOOL *stop))block
+{
+	if (block == nil)
+		CHNilArgumentException([self class], _cmd);
+	if (count == 0)
+		return;
+	CHDoublyLinkedListNode *current;
+	NSUInteger index;
+	if (opts & NSEnumerationConcurrent) {
+		// Only one thread can follow the links, so the workers are handed the objects in an array.
+		CHEnumerateGatheredObjects(count, ^(id *objects) {
+			NSUInteger objectIndex = 0;
+			for (CHDoublyLinkedListNode *node = head->next; node != tail; node = node->next)
+				objects[objectIndex++] = node->object;
+		}, opts, block, &mutations, [self class], _cmd);
+		return;
+	}
+	unsigned long mutationCount = mutations;
+	BOOL stop = NO;
+	if (opts & NSEnumerationReverse) {
+		index = count;
+		for (current = tail->prev; current != head && !stop; current = current->prev) {
+			block(current->object, --index, &stop);
+			if (mutations != mutationCount)
+				CHMutatedCollectionException([self class], _cmd);
+		}
+	} else {
+		index = 0;
+		for (current = head->next; current != tail && !stop; current = current->next) {
+			block(current->object, index++, &stop);
+			if (mutations != mutationCount)
+				CHMutatedCollectionException([self class], _cmd);
+		}
+	}
+}
+#endif	/* defined (__BLOCKS__) */
+
 - (id) firstObject {
 	tail->object = nil;
 	return head->next->object; // nil if there are no objects between head/tail
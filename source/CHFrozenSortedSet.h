@@ -0,0 +1,94 @@
+/*
+ CHDataStructures.framework -- CHFrozenSortedSet.h
+
+ Copyright (c) 2008-2010, Quinn Taylor <http://homepage.mac.com/quinntaylor>
+
+ This source code is released under the ISC License. <http://www.opensource.org/licenses/isc-license>
+
+ Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby granted, provided that the above copyright notice and this permission notice appear in all copies.
+
+ The software is  provided "as is", without warranty of any kind, including all implied warranties of merchantability and fitness. In no event shall the authors or copyright holders be liable for any claim, damages, or other liability, whether in an action of contract, tort, or otherwise, arising from, out of, or in connection with the software or the use or other dealings in the software.
+
+	Fixes, additions, extensions, port to GNUstep by Christopher Chandler
+	Copyright © 2013-2015	Christopher James Elphinstone Chandler, Russell Geoffrey Watts. All Rights Reserved.
+	Copyright © 2015-2025	Kinnami Software Corporation. All rights reserved.
+ */
+
+#import "CHSortedSet.h"
+#import "CHAbstractBinarySearchTree.h"
+
+/**
+ @file CHFrozenSortedSet.h
+ An immutable CHSortedSet stored in a single array in Eytzinger (breadth-first) order.
+ */
+
+/**
+ An immutable CHSortedSet, usually obtained by sending \link CHBinarySearchTree#freeze -freeze\endlink to a binary search tree once it has been built. The objects are stored in a single, cache line aligned array in <a href="http://arxiv.org/abs/1509.05053">Eytzinger order</a>: the root of a perfectly balanced search tree first, then each level of the tree from left to right, so that the children of the object at position k are at positions 2k and 2k+1. There are no nodes or pointers between them.
+
+ A search descends the array without branching on the result of each comparison, which picks the next position arithmetically. As each position is visited, the cache line holding its descendants three levels further down (with 8 byte pointers) is prefetched, so that the memory accesses of successive levels overlap rather than waiting on each other. Once the descent leaves the array, the position of the first object not ordered before the search key is found from the path taken. Searches cost O(log n) comparisons, exactly as for a balanced tree, but touch far fewer cache lines.
+
+ Enumeration is in ascending order, stepping from each position to its in-order successor in constant amortised time. Objects are ordered by @c -compare:, or by the comparator block or function of the tree that was frozen.
+
+ All the methods that modify the contents of a sorted set raise an exception. A frozen set is safe to read from any number of threads at once, provided its objects' comparison methods are. Sending @c -copy to a frozen set returns the same object.
+ */
+@interface CHFrozenSortedSet : NSObject <CHSortedSet>
+{
+	@protected
+		id *					m_apoObjects;		/* The objects in Eytzinger order, from index 1. Index 0 is unused. Cache line aligned */
+		void *					m_pvAllocation;		/* The memory that holds m_apoObjects */
+		NSUInteger				m_cObjects;			/* The number of objects */
+		unsigned int			m_fuiOptions;		/* The CHTreeOptions of the tree that was frozen */
+		CHSearchTreeComparator	m_sComparator;		/* How objects are ordered, copied from the tree that was frozen */
+}
+
+/**
+ Initialize a frozen sorted set with the objects in an array, ordered by @c -compare:. If the array holds several objects for which @c -compare: returns @c NSOrderedSame, only the last of them is kept, just as if they had been added to a tree one at a time.
+
+ @param anArray An array of objects, in any order.
+ @return An initialized frozen sorted set that contains the objects in @a anArray.
+ */
+- (id) initWithArray:(NSArray*)anArray;
+
+/**
+ Raises an exception, since a frozen set cannot be modified.
+
+ @throw NSInternalInconsistencyException always.
+ */
+- (void) addObject:(id)anObject;
+
+/**
+ Raises an exception, since a frozen set cannot be modified.
+
+ @throw NSInternalInconsistencyException always.
+ */
+- (void) addObjectsFromArray:(NSArray*)anArray;
+
+/**
+ Raises an exception, since a frozen set cannot be modified.
+
+ @throw NSInternalInconsistencyException always.
+ */
+- (void) removeAllObjects;
+
+/**
+ Raises an exception, since a frozen set cannot be modified.
+
+ @throw NSInternalInconsistencyException always.
+ */
+- (void) removeFirstObject;
+
+/**
+ Raises an exception, since a frozen set cannot be modified.
+
+ @throw NSInternalInconsistencyException always.
+ */
+- (void) removeLastObject;
+
+/**
+ Raises an exception, since a frozen set cannot be modified.
+
+ @throw NSInternalInconsistencyException always.
+ */
+- (void) removeObject:(id)anObject;
+
+@end
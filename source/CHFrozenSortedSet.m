@@ -0,0 +1,416 @@
+/*
+ CHDataStructures.framework -- CHFrozenSortedSet.m
+
+ Copyright (c) 2008-2010, Quinn Taylor <http://homepage.mac.com/quinntaylor>
+
+ This source code is released under the ISC License. <http://www.opensource.org/licenses/isc-license>
+
+ Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby granted, provided that the above copyright notice and this permission notice appear in all copies.
+
+ The software is  provided "as is", without warranty of any kind, including all implied warranties of merchantability and fitness. In no event shall the authors or copyright holders be liable for any claim, damages, or other liability, whether in an action of contract, tort, or otherwise, arising from, out of, or in connection with the software or the use or other dealings in the software.
+
+	Fixes, additions, extensions, port to GNUstep by Christopher Chandler
+	Copyright © 2013-2015	Christopher James Elphinstone Chandler, Russell Geoffrey Watts. All Rights Reserved.
+	Copyright © 2015-2025	Kinnami Software Corporation. All rights reserved.
+ */
+
+#import "CHFrozenSortedSet.h"
+#import "CHAbstractBinarySearchTree_Internal.h"
+
+#define kCHCacheLineSize		64		/* Bytes in a cache line, to which the array is aligned */
+
+/* Positions are numbered from 1 in Eytzinger order, so that the children of position k are 2k and 2k+1, and 0 means no position.
+	These helpers find the first and last positions in ascending order, and the in-order successor and predecessor of a position
+*/
+static inline NSUInteger	CHEytzingerFirst (NSUInteger a_cObjects)
+	{
+	NSUInteger	k;
+
+	if (a_cObjects == 0)
+		return 0;
+	for (k = 1; 2 * k <= a_cObjects; k *= 2)
+		;
+	return k;
+	}
+
+static inline NSUInteger	CHEytzingerLast (NSUInteger a_cObjects)
+	{
+	NSUInteger	k;
+
+	if (a_cObjects == 0)
+		return 0;
+	for (k = 1; 2 * k + 1 <= a_cObjects; k = 2 * k + 1)
+		;
+	return k;
+	}
+
+/* The leftmost position of the right subtree if there is one, otherwise the nearest ancestor of which k is in the left subtree: shift out the trailing
+	1 bits, each a step up from a right child, and one more
+*/
+static inline NSUInteger	CHEytzingerNext (NSUInteger k, NSUInteger a_cObjects)
+	{
+	if (2 * k + 1 <= a_cObjects)
+		{
+		for (k = 2 * k + 1; 2 * k <= a_cObjects; k *= 2)
+			;
+		return k;
+		}
+	return k >> (__builtin_ctzll ((unsigned long long) ~k) + 1);
+	}
+
+static inline NSUInteger	CHEytzingerPrevious (NSUInteger k, NSUInteger a_cObjects)
+	{
+	if (2 * k <= a_cObjects)
+		{
+		for (k = 2 * k; 2 * k + 1 <= a_cObjects; k = 2 * k + 1)
+			;
+		return k;
+		}
+	return k >> (__builtin_ctzll ((unsigned long long) k) + 1);
+	}
+
+/* Copy a_cObjects objects in ascending order into the positions of the subtree rooted at k, in order, and return the index of the next object to copy
+*/
+static NSUInteger	CHEytzingerFill (id * a_apoSorted, NSUInteger a_uiSorted, id * a_apoObjects, NSUInteger k, NSUInteger a_cObjects)
+	{
+	if (k <= a_cObjects)
+		{
+		a_uiSorted = CHEytzingerFill (a_apoSorted, a_uiSorted, a_apoObjects, 2 * k, a_cObjects);
+		a_apoObjects [k] = [a_apoSorted [a_uiSorted ++] retain];
+		a_uiSorted = CHEytzingerFill (a_apoSorted, a_uiSorted, a_apoObjects, 2 * k + 1, a_cObjects);
+		}
+	return a_uiSorted;
+	}
+
+/* The position of the first object not ordered before a_po, or 0 if there is none. Each step of the descent compares, then moves to the left or right
+	child by arithmetic rather than by a branch, and prefetches the line of descendants a cache line's worth of pointers below, which are all in one line
+	since the array is aligned. The path taken is recorded in the bits of k: a 1 for each step right. Stripping the trailing steps right, and the last
+	step left before them, leaves the last node at which the descent went left, which is the first object not ordered before a_po
+*/
+static inline NSUInteger	CHFrozenSortedSetLowerBound (id * a_apoObjects, NSUInteger a_cObjects, CHSearchTreeComparator * a_pComparator, bool a_fMultiLevel, id a_po)
+	{
+	NSUInteger	k;
+
+	k = 1;
+	while (k <= a_cObjects)
+		{
+		__builtin_prefetch (a_apoObjects + k * (kCHCacheLineSize / sizeof (id)));
+		k = 2 * k + (CHSearchTreeCompareObjects (a_pComparator, 0, a_fMultiLevel, a_apoObjects [k], a_po) == NSOrderedAscending);
+		}
+	return k >> (__builtin_ctzll ((unsigned long long) ~k) + 1);
+	}
+
+#pragma mark -
+
+/**
+ An enumerator for CHFrozenSortedSet, which steps through the positions of its array in ascending or descending order.
+ */
+@interface CHFrozenSortedSetEnumerator : CHCollectionEnumerator
+{
+	id *				objects;	// The set's objects in Eytzinger order.
+	NSUInteger			count;		// The number of objects in the set.
+	NSUInteger			position;	// The position of the next object, or 0 at the end.
+	BOOL				reverse;	// Whether the enumeration is in descending order.
+}
+
+- (id) initWithSet:(CHFrozenSortedSet*)frozenSet
+		   objects:(id*)eytzingerObjects
+			 count:(NSUInteger)objectCount
+		   reverse:(BOOL)descending;
+
+@end
+
+@implementation CHFrozenSortedSetEnumerator
+
+// A frozen set never changes, so there is no mutation count.
+- (id) initWithSet:(CHFrozenSortedSet*)frozenSet
+		   objects:(id*)eytzingerObjects
+			 count:(NSUInteger)objectCount
+		   reverse:(BOOL)descending
+{
+	if ((self = [super initWithCollection:frozenSet mutations:NULL]) == nil) return nil;
+	objects = eytzingerObjects;
+	count = objectCount;
+	reverse = descending;
+	position = reverse ? CHEytzingerLast(count) : CHEytzingerFirst(count);
+	return self;
+}
+
+- (id) nextObjectFromCollection {
+	if (position == 0)
+		return nil;
+	id anObject = objects[position];
+	position = reverse ? CHEytzingerPrevious(position, count) : CHEytzingerNext(position, count);
+	return anObject;
+}
+
+@end
+
+#pragma mark -
+
+@implementation CHFrozenSortedSet
+
+- (void) dealloc {
+	NSUInteger index;
+	for (index = 1; index <= m_cObjects; index++)
+		[m_apoObjects[index] release];
+	free(m_pvAllocation);
+	if (m_sComparator.eKind == CHComparatorKindBlock)
+		[(id) m_sComparator.pvContext release];
+	CHCompareCacheFree(m_sComparator.apCache);
+	[super dealloc];
+}
+
+// This is the designated initializer for CHFrozenSortedSet. The objects must be in strictly ascending order, and are retained.
+- (id) initWithSortedObjects:(id*)sortedObjects
+					   count:(NSUInteger)objectCount
+				  comparator:(const CHSearchTreeComparator*)comparator
+					 options:(unsigned int)options
+{
+	if ((self = [super init]) == nil) return nil;
+	// Aligning index 0 to a cache line puts each group of descendants that is prefetched together in one line.
+	m_pvAllocation = malloc((objectCount + 1) * kCHPointerSize + kCHCacheLineSize);
+	if (m_pvAllocation == NULL) {
+		[self release];
+		[NSException raise:NSMallocException format:@"Unable to allocate %lu objects", (unsigned long) objectCount];
+	}
+	m_apoObjects = (id*) (((uintptr_t) m_pvAllocation + kCHCacheLineSize - 1) & ~(uintptr_t) (kCHCacheLineSize - 1));
+	m_apoObjects[0] = nil;
+	m_cObjects = objectCount;
+	m_fuiOptions = options;
+	if (comparator != NULL)
+		CHSearchTreeComparatorCopy(&m_sComparator, comparator);
+	CHEytzingerFill(sortedObjects, 0, m_apoObjects, 1, objectCount);
+	return self;
+}
+
+- (id) init {
+	return [self initWithSortedObjects:NULL count:0 comparator:NULL options:0];
+}
+
+- (id) initWithArray:(NSArray*)anArray {
+	CHSearchTreeComparator comparator;
+	NSUInteger objectCount;
+	id *sortedObjects;
+
+	memset(&comparator, 0, sizeof(comparator));
+	sortedObjects = CHSearchTreeCopySortedObjects(&comparator, anArray, true, &objectCount);
+	self = [self initWithSortedObjects:sortedObjects count:objectCount comparator:NULL options:0];
+	free(sortedObjects);
+	CHCompareCacheFree(comparator.apCache);
+	return self;
+}
+
+#pragma mark <NSCoding>
+
+// The objects were archived in ascending order, and are frozen again with the options of the tree they came from.
+- (id) initWithCoder:(NSCoder*)decoder {
+	unsigned int options;
+	if ([decoder allowsKeyedCoding])
+		options = (unsigned int) [decoder decodeIntForKey:@"options"];
+	else
+		[decoder decodeValueOfObjCType:@encode(unsigned int) at:&options];
+	NSArray *array = CHSortedSetDecodeObjects(decoder, self, _cmd);
+	NSUInteger objectCount = [array count];
+	id *sortedObjects = malloc(kCHPointerSize * (objectCount + 1));
+	if (sortedObjects == NULL) {
+		[self release];
+		[NSException raise:NSMallocException format:@"Unable to allocate %lu objects", (unsigned long) objectCount];
+	}
+	[array getObjects:sortedObjects range:NSMakeRange(0, objectCount)];
+	self = [self initWithSortedObjects:sortedObjects count:objectCount comparator:NULL options:options];
+	free(sortedObjects);
+	return self;
+}
+
+- (void) encodeWithCoder:(NSCoder*)encoder {
+	unsigned int options = m_fuiOptions;
+	if ([encoder allowsKeyedCoding])
+		[encoder encodeInt:(int) options forKey:@"options"];
+	else
+		[encoder encodeValueOfObjCType:@encode(unsigned int) at:&options];
+	CHSortedSetEncodeObjects(encoder, self, _cmd, &m_sComparator, [self allObjects]);
+}
+
+#pragma mark <NSCopying>
+
+// A frozen set never changes, so a copy can share it.
+- (id) copyWithZone:(NSZone*)zone {
+	(void) zone;
+	return [self retain];
+}
+
+#pragma mark <NSFastEnumeration>
+
+// The position of the next object is kept in extra[0], and mutationsPtr points at extra[1], which never changes.
+- (NSUInteger) countByEnumeratingWithState:(NSFastEnumerationState*)state
+                                   objects:(id*)stackbuf
+                                     count:(NSUInteger)len
+{
+	NSUInteger position, batchCount = 0;
+	if (state->state == 0) {
+		state->state = 1;
+		state->extra[0] = CHEytzingerFirst(m_cObjects);
+		state->extra[1] = 0;
+		state->mutationsPtr = &state->extra[1];
+	}
+	position = state->extra[0];
+	while (position != 0 && batchCount < len) {
+		stackbuf[batchCount++] = m_apoObjects[position];
+		position = CHEytzingerNext(position, m_cObjects);
+	}
+	state->extra[0] = position;
+	state->itemsPtr = stackbuf;
+	return batchCount;
+}
+
+#pragma mark Querying Contents
+
+- (NSArray*) allObjects {
+	NSMutableArray *array = [NSMutableArray arrayWithCapacity:m_cObjects];
+	NSUInteger position;
+	for (position = CHEytzingerFirst(m_cObjects); position != 0; position = CHEytzingerNext(position, m_cObjects))
+		[array addObject:m_apoObjects[position]];
+	return array;
+}
+
+- (id) anyObject {
+	return (m_cObjects != 0) ? m_apoObjects[1] : nil;
+}
+
+- (NSUInteger) count {
+	return m_cObjects;
+}
+
+- (BOOL) containsObject:(id)anObject {
+	return ([self member:anObject] != nil);
+}
+
+- (NSString*) description {
+	return [[self allObjects] description];
+}
+
+- (id) firstObject {
+	return m_apoObjects[CHEytzingerFirst(m_cObjects)];
+}
+
+- (NSUInteger) hash {
+	return hashOfCountAndObjects(m_cObjects, [self firstObject], [self lastObject]);
+}
+
+- (BOOL) isEqual:(id)otherObject {
+	if ([otherObject conformsToProtocol:@protocol(CHSortedSet)])
+		return [self isEqualToSortedSet:otherObject];
+	else
+		return NO;
+}
+
+- (BOOL) isEqualToSortedSet:(id<CHSortedSet>)otherSortedSet {
+	return collectionsAreEqual(self, otherSortedSet);
+}
+
+- (id) lastObject {
+	return m_apoObjects[CHEytzingerLast(m_cObjects)];
+}
+
+- (id) member:(id)anObject {
+	bool multiLevel = (m_fuiOptions & CHTreeOptionsMultiLevel) != 0;
+	NSUInteger position;
+	if (anObject == nil)
+		return nil;
+	position = CHFrozenSortedSetLowerBound(m_apoObjects, m_cObjects, &m_sComparator, multiLevel, anObject);
+	if (position != 0 && CHSearchTreeCompareObjects(&m_sComparator, 0, multiLevel, m_apoObjects[position], anObject) == NSOrderedSame)
+		return m_apoObjects[position];
+	return nil;
+}
+
+- (NSEnumerator*) objectEnumerator {
+	return [[[CHFrozenSortedSetEnumerator alloc] initWithSet:self objects:m_apoObjects count:m_cObjects reverse:NO] autorelease];
+}
+
+- (NSEnumerator*) reverseObjectEnumerator {
+	return [[[CHFrozenSortedSetEnumerator alloc] initWithSet:self objects:m_apoObjects count:m_cObjects reverse:YES] autorelease];
+}
+
+- (NSSet*) set {
+	return [NSSet setWithArray:[self allObjects]];
+}
+
+// The position of the first object at or after start, or after it if the low endpoint is excluded.
+- (NSUInteger) positionFromObject:(id)start excludingEndpoint:(BOOL)exclude multiLevel:(bool)multiLevel {
+	NSUInteger position = CHFrozenSortedSetLowerBound(m_apoObjects, m_cObjects, &m_sComparator, multiLevel, start);
+	if (exclude && position != 0 && CHSearchTreeCompareObjects(&m_sComparator, 0, multiLevel, m_apoObjects[position], start) == NSOrderedSame)
+		position = CHEytzingerNext(position, m_cObjects);
+	return position;
+}
+
+// Copies the objects of a run of a subset into a buffer, and returns how many there are.
+- (NSUInteger) getObjects:(id*)objects inRun:(const CHSubsetRun*)run multiLevel:(bool)multiLevel {
+	NSUInteger position, objectCount = 0;
+	NSComparisonResult comparison;
+
+	position = (run->poStart == nil) ? CHEytzingerFirst(m_cObjects) : [self positionFromObject:run->poStart excludingEndpoint:run->fExcludeStart multiLevel:multiLevel];
+	for ( ; position != 0; position = CHEytzingerNext(position, m_cObjects)) {
+		if (run->poEnd != nil) {
+			comparison = CHSearchTreeCompareObjects(&m_sComparator, 0, multiLevel, m_apoObjects[position], run->poEnd);
+			if (comparison == NSOrderedDescending || (comparison == NSOrderedSame && run->fExcludeEnd))
+				break;
+		}
+		objects[objectCount++] = m_apoObjects[position];
+	}
+	return objectCount;
+}
+
+// The objects of each run are collected in ascending order, so the subset is built directly in Eytzinger order.
+- (id<CHSortedSet>) subsetFromObject:(id)start
+                            toObject:(id)end
+                             options:(CHSubsetConstructionOptions)options
+{
+	bool multiLevel = (m_fuiOptions & CHTreeOptionsMultiLevel) != 0;
+	NSUInteger run, runCount, subsetCount = 0;
+	CHSubsetRun runs[2];
+	id *subset;
+
+	if (start == nil && end == nil)
+		return [[self retain] autorelease];
+	subset = malloc(kCHPointerSize * (m_cObjects + 1));
+	if (subset == NULL)
+		[NSException raise:NSMallocException format:@"Unable to allocate %lu objects", (unsigned long) m_cObjects];
+	runCount = CHSubsetRuns(start, end, start != nil && end != nil && CHSearchTreeCompareObjects(&m_sComparator, 0, multiLevel, start, end) == NSOrderedDescending, options, runs);
+	for (run = 0; run < runCount; run++)
+		subsetCount += [self getObjects:subset + subsetCount inRun:&runs[run] multiLevel:multiLevel];
+	CHFrozenSortedSet *frozen = [[CHFrozenSortedSet alloc] initWithSortedObjects:subset count:subsetCount comparator:&m_sComparator options:m_fuiOptions];
+	free(subset);
+	return [frozen autorelease];
+}
+
+#pragma mark Modifying Contents
+
+- (void) addObject:(id)anObject {
+	(void) anObject;
+	CHUnsupportedOperationException([self class], _cmd);
+}
+
+- (void) addObjectsFromArray:(NSArray*)anArray {
+	(void) anArray;
+	CHUnsupportedOperationException([self class], _cmd);
+}
+
+- (void) removeAllObjects {
+	CHUnsupportedOperationException([self class], _cmd);
+}
+
+- (void) removeFirstObject {
+	CHUnsupportedOperationException([self class], _cmd);
+}
+
+- (void) removeLastObject {
+	CHUnsupportedOperationException([self class], _cmd);
+}
+
+- (void) removeObject:(id)anObject {
+	(void) anObject;
+	CHUnsupportedOperationException([self class], _cmd);
+}
+
+@end
@@ -0,0 +1,67 @@
+/*
+ CHDataStructures.framework -- CHInt64SortedSet.h
+
+ Copyright (c) 2008-2010, Quinn Taylor <http://homepage.mac.com/quinntaylor>
+
+ This source code is released under the ISC License. <http://www.opensource.org/licenses/isc-license>
+
+ Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby granted, provided that the above copyright notice and this permission notice appear in all copies.
+
+ The software is  provided "as is", without warranty of any kind, including all implied warranties of merchantability and fitness. In no event shall the authors or copyright holders be liable for any claim, damages, or other liability, whether in an action of contract, tort, or otherwise, arising from, out of, or in connection with the software or the use or other dealings in the software.
+
+	Fixes, additions, extensions, port to GNUstep by Christopher Chandler
+	Copyright © 2013-2015	Christopher James Elphinstone Chandler, Russell Geoffrey Watts. All Rights Reserved.
+	Copyright © 2015-2025	Kinnami Software Corporation. All rights reserved.
+ */
+
+#import "CHAbstractPrimitiveSortedSet.h"
+
+/**
+ @file CHInt64SortedSet.h
+ A sorted set of 64-bit signed integers, stored unboxed.
+ */
+
+/**
+ A sorted set of 64-bit signed integers. Each integer is stored unboxed, inline in a node of an AVL tree, and compared with a native integer comparison, so a set of integers takes a fraction of the memory of a search tree of NSNumber objects and is searched without sending any messages. The primitive methods, such as \link #addInt64: -addInt64:\endlink and \link #containsInt64: -containsInt64:\endlink, never create an object. The methods of the CHSortedSet protocol accept any NSNumber whose value is an integer in the range of @c int64_t, and return NSNumber objects created with @c +numberWithLongLong:.
+ */
+@interface CHInt64SortedSet : CHAbstractPrimitiveSortedSet
+
+/**
+ Initialize a set with the integers in a C array, in any order. Duplicates are added once. The integers are sorted and built into a balanced tree in a single pass, without boxing any of them.
+
+ @param integers A C array of integers.
+ @param integerCount The number of integers in @a integers.
+ @return An initialized set that contains the integers in @a integers.
+ */
+- (id) initWithInt64s:(const int64_t*)integers count:(NSUInteger)integerCount;
+
+/**
+ Adds an integer to the set, unless it is already in the set.
+
+ @param integer The integer to add.
+ */
+- (void) addInt64:(int64_t)integer;
+
+/**
+ Determines whether the set contains an integer.
+
+ @param integer The integer to search for.
+ @return @c YES if the set contains @a integer, otherwise @c NO.
+ */
+- (BOOL) containsInt64:(int64_t)integer;
+
+/**
+ Removes an integer from the set, if it is in the set.
+
+ @param integer The integer to remove.
+ */
+- (void) removeInt64:(int64_t)integer;
+
+/**
+ Copies every integer in the set, in ascending order, into a C array.
+
+ @param integers A C array with room for at least \link CHSortedSet#count -count\endlink integers.
+ */
+- (void) getInt64s:(int64_t*)integers;
+
+@end
@@ -0,0 +1,73 @@
+/*
+ CHDataStructures.framework -- CHInt64SortedSet.m
+
+ Copyright (c) 2008-2010, Quinn Taylor <http://homepage.mac.com/quinntaylor>
+
+ This source code is released under the ISC License. <http://www.opensource.org/licenses/isc-license>
+
+ Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby granted, provided that the above copyright notice and this permission notice appear in all copies.
+
+ The software is  provided "as is", without warranty of any kind, including all implied warranties of merchantability and fitness. In no event shall the authors or copyright holders be liable for any claim, damages, or other liability, whether in an action of contract, tort, or otherwise, arising from, out of, or in connection with the software or the use or other dealings in the software.
+
+	Fixes, additions, extensions, port to GNUstep by Christopher Chandler
+	Copyright © 2013-2015	Christopher James Elphinstone Chandler, Russell Geoffrey Watts. All Rights Reserved.
+	Copyright © 2015-2025	Kinnami Software Corporation. All rights reserved.
+ */
+
+#import "CHInt64SortedSet.h"
+
+@implementation CHInt64SortedSet
+
+- (id) initWithInt64s:(const int64_t*)integers count:(NSUInteger)integerCount {
+	if ((self = [self init]) == nil) return nil;
+	int64_t *keys = malloc(sizeof(int64_t) * (integerCount + 1));
+	if (keys == NULL) {
+		[self release];
+		[NSException raise:NSMallocException format:@"Unable to allocate %lu keys", (unsigned long) integerCount];
+	}
+	memcpy(keys, integers, sizeof(int64_t) * integerCount);
+	CHPrimitiveTreeBuild(&m_sTree, keys, CHPrimitiveKeysSortUnique(keys, integerCount));
+	free(keys);
+	return self;
+}
+
+// Integers of floating point types are accepted, but only if they have no fractional part and are in range.
+- (BOOL) getKey:(int64_t*)key forObject:(id)anObject {
+	if (![anObject isKindOfClass:[NSNumber class]])
+		return NO;
+	const char *type = [anObject objCType];
+	if (type[0] == 'f' || type[0] == 'd') {
+		double number = [anObject doubleValue];
+		if (!(number >= -9223372036854775808.0 && number < 9223372036854775808.0) || (double) (int64_t) number != number)
+			return NO;
+		*key = (int64_t) number;
+	} else if (type[0] == 'Q' || type[0] == 'L') {
+		if ([anObject unsignedLongLongValue] > (unsigned long long) INT64_MAX)
+			return NO;
+		*key = (int64_t) [anObject unsignedLongLongValue];
+	} else
+		*key = [anObject longLongValue];
+	return YES;
+}
+
+- (id) objectForKey:(int64_t)key {
+	return [NSNumber numberWithLongLong:key];
+}
+
+- (void) addInt64:(int64_t)integer {
+	CHPrimitiveTreeAdd(&m_sTree, integer);
+}
+
+- (BOOL) containsInt64:(int64_t)integer {
+	return CHPrimitiveTreeContains(&m_sTree, integer);
+}
+
+- (void) removeInt64:(int64_t)integer {
+	CHPrimitiveTreeRemove(&m_sTree, integer);
+}
+
+- (void) getInt64s:(int64_t*)integers {
+	CHPrimitiveTreeGetKeys(&m_sTree, true, 0, false, false, integers, m_sTree.cNodes);
+}
+
+@end
@@ -96,6 +96,36 @@
  */
 - (NSUInteger) count;
 
+#if defined (__BLOCKS__)
+/**
+ Executes a given block using each object in the receiver, from front to back.
+ 
+ @param block The block to apply to each object. It is passed the object, its index, and a reference to a Boolean which the block may set to @c YES to stop the enumeration.
+ 
+ @throw NSInvalidArgumentException if @a block is @c nil.
+ @throw NSGenericException if the block modifies the receiver.
+ 
+ @see enumerateObjectsWithOptions:usingBlock:
+ */
+- (void) enumerateObjectsUsingBlock:(void (^)(id obj, NSUInteger idx, BOOL *stop))block;
+
+/**
+ Executes a given block using each object in the receiver, with the given options.
+ 
+ @param opts A mask of NSEnumerationOptions. With @c NSEnumerationReverse, objects are passed from back to front. With @c NSEnumerationConcurrent, the objects are first gathered into a C array, whose indexes are divided into ranges that workers on a global dispatch queue pass to the block at the same time, in no particular order; the block must then be safe to call from several threads, and setting its stop flag only stops objects not yet begun.
+ @param block The block to apply to each object. It is passed the object, its index, and a reference to a Boolean which the block may set to @c YES to stop the enumeration.
+ 
+ @throw NSInvalidArgumentException if @a block is @c nil.
+ @throw NSGenericException if the block modifies the receiver.
+ 
+ @attention CHSinglyLinkedList has no backward links, so reverse enumeration also gathers the objects into a C array first.
+ 
+ @see enumerateObjectsUsingBlock:
+ */
+- (void) enumerateObjectsWithOptions:(NSEnumerationOptions)opts
+                          usingBlock:(void (^)(id obj, NSUInteger idx, BOOL *stop))block;
+#endif	/* defined (__BLOCKS__) */
+
 /**
  Returns the first object in the receiver.
  
@@ -42,6 +42,32 @@
  */
 - (BOOL) containsObjectIdenticalTo:(id)anObject;
 
+#if defined (__BLOCKS__)
+/**
+ Executes a given block using each object in the heap, in the order of \link #objectAtIndex: -objectAtIndex:\endlink, which satisfies the heap property but is not sorted.
+ 
+ @param block The block to apply to each object. It is passed the object, its index, and a reference to a Boolean which the block may set to @c YES to stop the enumeration.
+ 
+ @throw NSInvalidArgumentException if @a block is @c nil.
+ 
+ @see enumerateObjectsWithOptions:usingBlock:
+ */
+- (void) enumerateObjectsUsingBlock:(void (^)(id obj, NSUInteger idx, BOOL *stop))block;
+
+/**
+ Executes a given block using each object in the heap, with the given options, in the order of \link #objectAtIndex: -objectAtIndex:\endlink. The objects are enumerated by the array that stores them, so @c NSEnumerationConcurrent divides them between threads as @c -[NSArray enumerateObjectsWithOptions:usingBlock:] does. Use \link #allObjectsInSortedOrder -allObjectsInSortedOrder\endlink to visit the objects in sorted order.
+ 
+ @param opts A mask of NSEnumerationOptions.
+ @param block The block to apply to each object. It is passed the object, its index, and a reference to a Boolean which the block may set to @c YES to stop the enumeration.
+ 
+ @throw NSInvalidArgumentException if @a block is @c nil.
+ 
+ @see enumerateObjectsUsingBlock:
+ */
+- (void) enumerateObjectsWithOptions:(NSEnumerationOptions)opts
+                          usingBlock:(void (^)(id obj, NSUInteger idx, BOOL *stop))block;
+#endif	/* defined (__BLOCKS__) */
+
 /**
  Remove @b all occurrences of @a anObject, matched using @c isEqual:.
  
@@ -181,6 +181,21 @@
 	return [array count];
 }
 
+#if defined (__BLOCKS__)
+- (void) enumerateObjectsUsingBlock:(void (^)(id obj, NSUInteger idx, BOOL *stop))block {
+	[self enumerateObjectsWithOptions:0 usingBlock:block];
+}
+
+// The backing array enumerates its own storage, rather than the inherited implementation calling -objectAtIndex: on the receiver for each object.
+- (void) enumerateObjectsWithOptions:(NSEnumerationOptions)opts
+                          usingBlock:(void (^)(id obj, NSUInteger idx, BOOL *stop))block
+{
+	if (block == nil)
+		CHNilArgumentException([self class], _cmd);
+	[array enumerateObjectsWithOptions:opts usingBlock:block];
+}
+#endif	/* defined (__BLOCKS__) */
+
 - (id) firstObject {
 	return ([array count] > 0) ? [array objectAtIndex:0] : nil;
 }
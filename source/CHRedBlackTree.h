@@ -26,7 +26,7 @@
  */
 
 /**
- A <a href="http://en.wikipedia.org/wiki/Red-black_trees">Red-Black tree</a>, a balanced binary search tree with guaranteed O(log n) access. The algorithms for insertion and removal in this implementation have been adapted from code in the <a href="http://eternallyconfuzzled.com/tuts/datastructures/jsw_tut_rbtree.aspx"> Red-Black trees tutorial</a>, which is in the public domain, courtesy of <a href="http://eternallyconfuzzled.com/">Julienne Walker</a>. Method names have been changed to match the APIs of existing Cocoa collections provided by Apple.
+ A <a href="http://en.wikipedia.org/wiki/Red-black_trees">Red-Black tree</a>, a balanced binary search tree with guaranteed O(log n) access. The algorithm for insertion in this implementation has been adapted from code in the <a href="http://eternallyconfuzzled.com/tuts/datastructures/jsw_tut_rbtree.aspx"> Red-Black trees tutorial</a>, which is in the public domain, courtesy of <a href="http://eternallyconfuzzled.com/">Julienne Walker</a>. Removal is bottom-up, and makes at most three rotations. Method names have been changed to match the APIs of existing Cocoa collections provided by Apple.
  
  A Red-Black tree has a few fundamental rules:
  <ol>
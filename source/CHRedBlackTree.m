@@ -20,53 +20,196 @@
 
 #pragma mark C Functions for Optimized Operations
 
-static inline CHBinaryTreeNode* rotateNodeWithLeftChild(CHBinaryTreeNode *node) {
+static inline CHBinaryTreeNode* rotateNodeWithLeftChild(CHBinaryTreeNode *node, bool fCounted) {
 	CHBinaryTreeNode *leftChild = node->left;
 	node->left = leftChild->right;
 	leftChild->right = node;
+	CHBinaryTreeNodeCountRotation(fCounted, node, leftChild);
 	node->color = kRED;
 	leftChild->color = kBLACK;
 	return leftChild;
 }
 
-static inline CHBinaryTreeNode* rotateNodeWithRightChild(CHBinaryTreeNode *node) {
+static inline CHBinaryTreeNode* rotateNodeWithRightChild(CHBinaryTreeNode *node, bool fCounted) {
 	CHBinaryTreeNode *rightChild = node->right;
 	node->right = rightChild->left;
 	rightChild->left = node;
+	CHBinaryTreeNodeCountRotation(fCounted, node, rightChild);
 	node->color = kRED;
 	rightChild->color = kBLACK;
 	return rightChild;
 }
 
-HIDDEN CHBinaryTreeNode* rotateObjectOnAncestor(id anObject, CHBinaryTreeNode *ancestor) {
-	if ([ancestor->object compare:anObject] == NSOrderedDescending) {
-		if ([ancestor->left->object compare:anObject] == NSOrderedDescending)
-			ancestor->left = rotateNodeWithLeftChild(ancestor->left);
+HIDDEN CHBinaryTreeNode* rotateObjectOnAncestor(CHSearchTreeComparator *comparator, id anObject, CHBinaryTreeNode *ancestor, bool fCounted) {
+	if (CHSearchTreeCompare(comparator, ancestor->object, anObject) == NSOrderedDescending) {
+		if (CHSearchTreeCompare(comparator, ancestor->left->object, anObject) == NSOrderedDescending)
+			ancestor->left = rotateNodeWithLeftChild(ancestor->left, fCounted);
 		else
-			ancestor->left = rotateNodeWithRightChild(ancestor->left);
+			ancestor->left = rotateNodeWithRightChild(ancestor->left, fCounted);
 		return ancestor->left;
 	}
 	else {
-		if ([ancestor->right->object compare:anObject] == NSOrderedDescending)
-			ancestor->right = rotateNodeWithLeftChild(ancestor->right);
+		if (CHSearchTreeCompare(comparator, ancestor->right->object, anObject) == NSOrderedDescending)
+			ancestor->right = rotateNodeWithLeftChild(ancestor->right, fCounted);
 		else
-			ancestor->right = rotateNodeWithRightChild(ancestor->right);
+			ancestor->right = rotateNodeWithRightChild(ancestor->right, fCounted);
 		return ancestor->right;
 	}
 }
 
-static inline CHBinaryTreeNode* singleRotation(CHBinaryTreeNode *node, BOOL goingRight) {
+static inline CHBinaryTreeNode* singleRotation(CHBinaryTreeNode *node, BOOL goingRight, bool fCounted) {
 	CHBinaryTreeNode *save = node->link[!goingRight];
 	node->link[!goingRight] = save->link[goingRight];
 	save->link[goingRight] = node;
+	CHBinaryTreeNodeCountRotation(fCounted, node, save);
 	node->color = kRED;
 	save->color = kBLACK;
 	return save;
 }
 
-static inline CHBinaryTreeNode* doubleRotation(CHBinaryTreeNode *node, BOOL goingRight) {
-	node->link[!goingRight] = singleRotation(node->link[!goingRight], !goingRight);
-	return singleRotation(node, goingRight);	
+static inline CHBinaryTreeNode* doubleRotation(CHBinaryTreeNode *node, BOOL goingRight, bool fCounted) {
+	node->link[!goingRight] = singleRotation(node->link[!goingRight], !goingRight, fCounted);
+	return singleRotation(node, goingRight, fCounted);
+}
+
+#pragma mark Persistent trees
+
+// These functions change a tree created with CHTreeOptionsPersistent, recursively and bottom-up, rather than with the top-down insertion
+// and the stack used below, so that they only change nodes on the path or next to it. Each is given the link to the root of a subtree, and
+// replaces the root with a copy, through CHBinaryTreeSharedNodeUnshare(), before changing it, so a change copies the nodes on its path that
+// other trees share, and also copies any node next to the path whose color it changes. Subtree counts are kept up to date on the way back
+// up, before each rotation, since no path is recounted afterwards.
+
+static void sharedAdd(CHBinaryTreeSharedEdit *edit, CHBinaryTreeNode **link, id anObject) {
+	CHBinaryTreeNode *node = *link, *child;
+	if (node == edit->pSentinel) {
+		node = CHBinaryTreeNodePoolAlloc(edit->pPool, [anObject retain]);
+		node->left = node->right = edit->pSentinel;
+		node->color = kRED;
+		*link = node;
+		edit->fChanged = true;
+		return;
+	}
+	NSComparisonResult comparison = CHSearchTreeCompare(edit->pComparator, node->object, anObject);
+	node = *link = CHBinaryTreeSharedNodeUnshare(edit->pPool, node, edit->pSentinel);
+	if (comparison == NSOrderedSame) {
+		[anObject retain];
+		[node->object release];
+		node->object = anObject;
+		return;
+	}
+	u_int32_t dir = (comparison == NSOrderedAscending); // R on YES
+	sharedAdd(edit, &node->link[dir], anObject);
+	if (edit->fChanged && edit->fCounted)
+		CHBinaryTreeNodeCount(node)++;
+	// A red violation below a red child, which is on the path, as is its red child, is fixed by a color flip if the
+	// child's sibling is also red, which may move the violation up, or else by rotating the child above the node.
+	child = node->link[dir];
+	if (child->color != kRED || (child->left->color != kRED && child->right->color != kRED))
+		return;
+	if (node->link[!dir]->color == kRED) {
+		node->link[!dir] = CHBinaryTreeSharedNodeUnshare(edit->pPool, node->link[!dir], edit->pSentinel);
+		node->color = kRED;
+		child->color = kBLACK;
+		node->link[!dir]->color = kBLACK;
+	}
+	else if (child->link[dir]->color == kRED)
+		*link = singleRotation(node, !dir, edit->fCounted);
+	else
+		*link = doubleRotation(node, !dir, edit->fCounted);
+}
+
+// Rebalances the subtree at *link after a node has been removed from its dir side, which is one black node short if isShort is YES.
+// Returns YES if the whole subtree is then one black node short.
+static BOOL sharedRebalanceRemoved(CHBinaryTreeSharedEdit *edit, CHBinaryTreeNode **link, u_int32_t dir, BOOL isShort) {
+	CHBinaryTreeNode *parent = *link, *sibling, *top;
+	if (edit->fCounted)
+		CHBinaryTreeNodeCount(parent)--;
+	if (!isShort)
+		return NO;
+	sibling = parent->link[!dir] = CHBinaryTreeSharedNodeUnshare(edit->pPool, parent->link[!dir], edit->pSentinel);
+	if (sibling->color == kRED) {
+		// Rotate the red sibling above the parent, which becomes red, so the new sibling is black.
+		*link = singleRotation(parent, dir, edit->fCounted);
+		link = &sibling->link[dir];
+		sibling = parent->link[!dir] = CHBinaryTreeSharedNodeUnshare(edit->pPool, parent->link[!dir], edit->pSentinel);
+	}
+	if (sibling->left->color == kBLACK && sibling->right->color == kBLACK) {
+		// Take a black node from the sibling's side too; then either a red parent
+		// turns black to make up both sides, or the shortfall moves up a level.
+		isShort = (parent->color == kBLACK);
+		parent->color = kBLACK;
+		sibling->color = kRED;
+		return isShort;
+	}
+	// Rotate the sibling, or its red inner child, into the parent's place, which takes the parent's color, and make both its children black.
+	u_int32_t parentColor = parent->color;
+	if (sibling->link[!dir]->color == kRED) {
+		sibling->link[!dir] = CHBinaryTreeSharedNodeUnshare(edit->pPool, sibling->link[!dir], edit->pSentinel);
+		top = singleRotation(parent, dir, edit->fCounted);
+	} else {
+		sibling->link[dir] = CHBinaryTreeSharedNodeUnshare(edit->pPool, sibling->link[dir], edit->pSentinel);
+		top = doubleRotation(parent, dir, edit->fCounted);
+	}
+	top->color = parentColor;
+	top->left->color = kBLACK;
+	top->right->color = kBLACK;
+	*link = top;
+	return NO;
+}
+
+// Replaces a node that has at most one child with that child, and returns YES if the subtree is then one black node short. The node
+// itself need not be copied, since it is only dropped.
+static BOOL sharedUnlink(CHBinaryTreeSharedEdit *edit, CHBinaryTreeNode **link) {
+	CHBinaryTreeNode *node = *link, *child = node->link[node->left == edit->pSentinel];
+	BOOL isShort = (node->color == kBLACK);
+	CHBinaryTreeSharedNodeRetain(child, edit->pSentinel);
+	CHBinaryTreeSharedNodeRelease(node, edit->pSentinel);
+	if (isShort && child->color == kRED) {
+		child = CHBinaryTreeSharedNodeUnshare(edit->pPool, child, edit->pSentinel);
+		child->color = kBLACK;
+		isShort = NO;
+	}
+	*link = child;
+	edit->fChanged = true;
+	return isShort;
+}
+
+// Removes the first node of a subtree, setting *first to its object, retained.
+static BOOL sharedRemoveFirst(CHBinaryTreeSharedEdit *edit, CHBinaryTreeNode **link, id *first) {
+	CHBinaryTreeNode *node = *link;
+	if (node->left == edit->pSentinel) {
+		*first = [node->object retain];
+		return sharedUnlink(edit, link);
+	}
+	node = *link = CHBinaryTreeSharedNodeUnshare(edit->pPool, node, edit->pSentinel);
+	return sharedRebalanceRemoved(edit, link, 0, sharedRemoveFirst(edit, &node->left, first));
+}
+
+// A node with two children takes its successor's object, and the successor is removed instead.
+static BOOL sharedRemove(CHBinaryTreeSharedEdit *edit, CHBinaryTreeNode **link, id anObject) {
+	CHBinaryTreeNode *node = *link;
+	if (node == edit->pSentinel)
+		return NO;
+	NSComparisonResult comparison = CHSearchTreeCompare(edit->pComparator, node->object, anObject);
+	if (comparison == NSOrderedSame && (node->left == edit->pSentinel || node->right == edit->pSentinel))
+		return sharedUnlink(edit, link);
+	node = *link = CHBinaryTreeSharedNodeUnshare(edit->pPool, node, edit->pSentinel);
+	u_int32_t dir;
+	BOOL isShort;
+	if (comparison == NSOrderedSame) {
+		id successor;
+		dir = 1;
+		isShort = sharedRemoveFirst(edit, &node->right, &successor);
+		[node->object release];
+		node->object = successor;
+	} else {
+		dir = (comparison == NSOrderedAscending); // R on YES
+		isShort = sharedRemove(edit, &node->link[dir], anObject);
+	}
+	if (!edit->fChanged)
+		return NO;
+	return sharedRebalanceRemoved(edit, link, dir, isShort);
 }
 
 #pragma mark -
@@ -75,6 +218,14 @@ static inline CHBinaryTreeNode* doubleRotation(CHBinaryTreeNode *node, BOOL goin
 
 // NOTE: The header and sentinel nodes are initialized to black (0) by default.
 
++ (BOOL) supportsPersistence {
+	return YES;
+}
+
++ (BOOL) supportsHintedInsertion {
+	return YES;
+}
+
 /*
  Basically, as you walk down the tree to insert, if the present node has two red children, color it red and change the two children to black. If its parent is red, the tree must be rotated. (Just change the root's color back to black if you changed it). Returns without incrementing the count if the object already exists in the tree.
  */
@@ -82,13 +233,26 @@ static inline CHBinaryTreeNode* doubleRotation(CHBinaryTreeNode *node, BOOL goin
 	if (anObject == nil)
 		CHNilArgumentException([self class], _cmd);
 	++mutations;
+	if (m_fuiOptions & CHTreeOptionsPersistent) {
+		CHBinaryTreeSharedEdit edit = {&m_sNodePool, sentinel, &m_sComparator, (m_fuiOptions & CHTreeOptionsOrderStatistics) != 0, false};
+		sharedAdd(&edit, &header->right, anObject);
+		if (edit.fChanged)
+			++count;
+		if (header->right->color == kRED) // The root is on the path, so it has already been copied
+			header->right->color = kBLACK;
+		return;
+	}
+	// An object ordered after the last object is appended by following the right spine, with one comparison.
+	if ([self addObject:anObject fromPath:NULL size:0 position:1 appendOnly:YES cursor:nil])
+		return;
 
 	CHBinaryTreeNode *current, *parent, *grandparent, *greatgrandparent;
 	grandparent = parent = current = header;
+	bool fCounted = (m_fuiOptions & CHTreeOptionsOrderStatistics) != 0;
 	
 	sentinel->object = anObject;
 	NSComparisonResult comparison;
-	while ((comparison = [current->object compare:anObject])) {
+	while ((comparison = CHSearchTreeCompare(&m_sComparator, current->object, anObject))) {
 		greatgrandparent = grandparent, grandparent = parent, parent = current;
 		current = current->link[comparison == NSOrderedAscending];
 		
@@ -107,9 +271,9 @@ static inline CHBinaryTreeNode* doubleRotation(CHBinaryTreeNode *node, BOOL goin
 //						? singleRotation(grandparent, !lastWentRight)
 //						: doubleRotation(grandparent, !lastWentRight);
 				grandparent->color = kRED;
-				if ([grandparent->object compare:anObject] != [parent->object compare:anObject])
-					parent = rotateObjectOnAncestor(anObject, grandparent);
-				current = rotateObjectOnAncestor(anObject, greatgrandparent);
+				if (CHSearchTreeCompare(&m_sComparator, grandparent->object, anObject) != CHSearchTreeCompare(&m_sComparator, parent->object, anObject))
+					parent = rotateObjectOnAncestor(&m_sComparator, anObject, grandparent, fCounted);
+				current = rotateObjectOnAncestor(&m_sComparator, anObject, greatgrandparent, fCounted);
 				current->color = kBLACK;
 			}
 		}
@@ -122,11 +286,11 @@ static inline CHBinaryTreeNode* doubleRotation(CHBinaryTreeNode *node, BOOL goin
 		current->object = anObject;
 	} else {
 		++count;
-		current = CHCreateBinaryTreeNodeWithObject(anObject);
+		current = CHBinaryTreeNodePoolAlloc(&m_sNodePool, anObject);
 		current->left = sentinel;
 		current->right = sentinel;
 		
-		parent->link[([parent->object compare:anObject] == NSOrderedAscending)] = current;
+		parent->link[(CHSearchTreeCompare(&m_sComparator, parent->object, anObject) == NSOrderedAscending)] = current;
 		
 		// one last reorientation check...
 		
@@ -137,90 +301,292 @@ static inline CHBinaryTreeNode* doubleRotation(CHBinaryTreeNode *node, BOOL goin
 		// Fix red violation
 		if (parent->color == kRED) 	{
 			grandparent->color = kRED;
-			if ([grandparent->object compare:anObject] != [parent->object compare:anObject])
-				rotateObjectOnAncestor(anObject, grandparent);
-			current = rotateObjectOnAncestor(anObject, greatgrandparent);
+			if (CHSearchTreeCompare(&m_sComparator, grandparent->object, anObject) != CHSearchTreeCompare(&m_sComparator, parent->object, anObject))
+				rotateObjectOnAncestor(&m_sComparator, anObject, grandparent, fCounted);
+			current = rotateObjectOnAncestor(&m_sComparator, anObject, greatgrandparent, fCounted);
 			current->color = kBLACK;
 		}
 		header->right->color = kBLACK;  // Always reset root to black
+		if (fCounted)
+			CHBinaryTreeNodeCountPath(header, sentinel, &m_sComparator, 0, false, anObject);
 	}
 }
 
 /**
+ Removes bottom-up. The search for the object records its path on a stack, and the node to unlink (the node itself, or its successor if it has two children) always has at most one child. If it is red, or its child is red, no rebalancing is needed. Otherwise the black node missing from its side of the tree is restored by recoloring up the path until a red node or a nearby rotation absorbs it, so the removal makes at most three rotations, and no rotations or color flips at all on the way down.
+ 
  @param anObject The object to be removed from the tree.
  
- @bug Performance decays exponentially (not linearly) when removing objects.
- @todo Speed up red-black removal. The EternallyConfuzzled.com tutorial opts to push a red node down the tree using rotations and flips to avoid a nasty case of deleting a black node. This is almost certainly what causes the performance problems.
-
  @see http://www.stanford.edu/~blp/avl/libavl.html/Deleting-from-an-RB-Tree.html
- @see http://eternallyconfuzzled.com/tuts/datastructures/jsw_tut_rbtree.aspx
  */
 - (void) removeObject:(id)anObject {
 	if (count == 0 || anObject == nil)
 		return;
 	++mutations;
+	if (m_fuiOptions & CHTreeOptionsPersistent) {
+		// Nothing is copied unless the object is found. It is released last, as below, rather than with its node.
+		id removedObject = [[self member:anObject] retain];
+		if (removedObject == nil)
+			return;
+		CHBinaryTreeSharedEdit edit = {&m_sNodePool, sentinel, &m_sComparator, (m_fuiOptions & CHTreeOptionsOrderStatistics) != 0, false};
+		sharedRemove(&edit, &header->right, anObject);
+		--count;
+		[removedObject release];
+		return;
+	}
 	
-	CHBinaryTreeNode *current, *parent, *grandparent;
-	parent = current = header;
-	
-	CHBinaryTreeNode *found = NULL, *sibling;
-	sentinel->object = anObject;
+	CHBinaryTreeNode *current, *parent, *child, *sibling, *grandparent;
+	bool fCounted = (m_fuiOptions & CHTreeOptionsOrderStatistics) != 0;
 	NSComparisonResult comparison;
-	BOOL isGoingRight = YES, prevWentRight = YES;
-	while (current->link[isGoingRight] != sentinel) {
-		grandparent = parent;
-		parent = current;
-		current = current->link[isGoingRight];
-		comparison = [current->object compare:anObject];
-		prevWentRight = isGoingRight;
-		isGoingRight = (comparison != NSOrderedDescending);
-		if (comparison == NSOrderedSame)
-			found = current; // Save a pointer; removal happens outside the loop
-		
-		// There are only potential violations when removing a black node.
-		// If so, push the child red node down using rotations and color flips.
-		if (current->color != kRED && current->link[isGoingRight]->color != kRED) {
-			if (current->link[!isGoingRight]->color == kRED) {
-				parent->link[prevWentRight] = singleRotation(current, isGoingRight);
-				parent = parent->link[prevWentRight];
+	BOOL isGoingRight;
+	CHBinaryTreeStack_DECLARE();
+	CHBinaryTreeStack_INIT();
+	
+	// Find the node, recording the path to it, which starts at the header.
+	CHBinaryTreeStack_PUSH(header);
+	current = header->right;
+	while (current != sentinel &&
+	       (comparison = CHSearchTreeCompare(&m_sComparator, current->object, anObject)) != NSOrderedSame) {
+		CHBinaryTreeStack_PUSH(current);
+		current = current->link[comparison == NSOrderedAscending];
+	}
+	if (current == sentinel) {
+		CHBinaryTreeStack_FREE(stack);
+		return;
+	}
+	id removedObject = current->object;
+	
+	// A node with two children takes its successor's object, and the successor is unlinked instead.
+	if (current->left != sentinel && current->right != sentinel) {
+		CHBinaryTreeNode *found = current;
+		CHBinaryTreeStack_PUSH(found);
+		current = found->right;
+		while (current->left != sentinel) {
+			CHBinaryTreeStack_PUSH(current);
+			current = current->left;
+		}
+		found->object = current->object;
+	}
+	
+	// Unlink the node, which has at most one child. Every node above it covers one fewer object.
+	parent = CHBinaryTreeStack_POP();
+	child = current->link[current->left == sentinel];
+	isGoingRight = (parent->right == current);
+	parent->link[isGoingRight] = child;
+	if (fCounted) {
+		CHBinaryTreeNodeCount(parent)--;
+		for (NSUInteger index = 0; index < stackSize; index++)
+			CHBinaryTreeNodeCount(stack[index])--;
+	}
+	
+	// Removing a black node leaves its side of the parent one black node short.
+	if (current->color == kBLACK) {
+		if (child->color == kRED) {
+			child->color = kBLACK;
+		}
+		else while (parent != header) {
+			sibling = parent->link[!isGoingRight];
+			if (sibling->color == kRED) {
+				// Rotate the red sibling above the parent, which becomes red, so the new sibling is black.
+				grandparent = CHBinaryTreeStack_TOP;
+				grandparent->link[(grandparent->right == parent)] = singleRotation(parent, isGoingRight, fCounted);
+				CHBinaryTreeStack_PUSH(sibling);
+				sibling = parent->link[!isGoingRight];
 			}
-			else {
-				sibling = parent->link[prevWentRight];
-				if (sibling != sentinel) {
-					if (sibling->left->color == kBLACK && sibling->right->color == kBLACK) {
-						// If sibling's children are both black, do a color flip
-						parent->color = kBLACK;
-						sibling->color = kRED;
-						current->color = kRED;
-					}
-					else {
-						CHBinaryTreeNode *tempNode = grandparent->link[(grandparent->right == parent)];
-						if (sibling->link[prevWentRight]->color == kRED)
-							tempNode = doubleRotation(parent, prevWentRight);
-						else if (sibling->link[!prevWentRight]->color == kRED)
-							tempNode = singleRotation(parent, prevWentRight);
-						/* Ensure correct coloring */
-						current->color = tempNode->color = kRED;
-						tempNode->left->color = kBLACK;
-						tempNode->right->color = kBLACK;
-					}
-				} // if (sibling != sentinel)
+			if (sibling->left->color == kBLACK && sibling->right->color == kBLACK) {
+				// Take a black node from the sibling's side too; then either a red parent
+				// turns black to make up both sides, or the shortfall moves up a level.
+				sibling->color = kRED;
+				if (parent->color == kRED) {
+					parent->color = kBLACK;
+					break;
+				}
+				child = parent;
+				parent = CHBinaryTreeStack_POP();
+				isGoingRight = (parent->right == child);
+				continue;
 			}
+			// Make sure the sibling's far child is red, then rotate the sibling into the parent's place.
+			if (sibling->link[!isGoingRight]->color == kBLACK) {
+				parent->link[!isGoingRight] = singleRotation(sibling, !isGoingRight, fCounted);
+				sibling = parent->link[!isGoingRight];
+			}
+			u_int32_t parentColor = parent->color;
+			grandparent = CHBinaryTreeStack_TOP;
+			grandparent->link[(grandparent->right == parent)] = singleRotation(parent, isGoingRight, fCounted);
+			sibling->color = parentColor;
+			parent->color = kBLACK;
+			sibling->link[!isGoingRight]->color = kBLACK;
+			break;
 		}
 	}
-	
-	// Transfer replacement value up to outgoing node, remove the "donor" node.
-    if (found != NULL) {
-		[found->object release];
-		found->object = current->object;
-		parent->link[(parent->right == current)]
-			= current->link[(current->left == sentinel)];
-		free(current);
-		--count;
-    }
+	CHBinaryTreeStack_FREE(stack);
+	CHBinaryTreeNodePoolFree(&m_sNodePool, current);
+	[removedObject release];
+	--count;
 	header->right->color = kBLACK; // Make the root black for simplified logic
 }
 
+// The new leaf is made red, and any red violation is fixed bottom-up, as for -joinSubtree:rank:withNode:subtree:rank:resultRank:. A
+// rotation takes the grandparent off the path, and a double rotation puts the new subtree root in its place, followed by whichever of
+// the parent and grandparent now holds the rest of the path.
+- (NSUInteger) rebalancePath:(CHBinaryTreeNode**)path size:(NSUInteger)pathSize {
+	bool fCounted = (m_fuiOptions & CHTreeOptionsOrderStatistics) != 0;
+	NSUInteger index = pathSize - 1; // The red node whose parent may be red
+	path[index]->color = kRED;
+	while (index > 1 && path[index - 1]->color == kRED) {
+		CHBinaryTreeNode *parent = path[index - 1], *grandparent = path[index - 2]; // A red node is never the root, which is black
+		u_int32_t side = (grandparent->right == parent);
+		CHBinaryTreeNode *sibling = grandparent->link[!side];
+		if (sibling->color == kRED) {
+			parent->color = kBLACK;
+			sibling->color = kBLACK;
+			grandparent->color = kRED;
+			index -= 2;
+			continue;
+		}
+		CHBinaryTreeNode *ancestor = path[index - 3];
+		u_int32_t ancestorSide = (ancestor->right == grandparent);
+		if (parent->link[side] == path[index]) {
+			ancestor->link[ancestorSide] = singleRotation(grandparent, !side, fCounted);
+			memmove(&path[index - 2], &path[index - 1], (pathSize - index + 1) * kCHPointerSize);
+			--pathSize;
+		} else {
+			CHBinaryTreeNode *current = path[index];
+			ancestor->link[ancestorSide] = doubleRotation(grandparent, !side, fCounted);
+			path[index - 2] = current;
+			if (index + 1 < pathSize) {
+				path[index - 1] = (parent->link[!side] == path[index + 1]) ? parent : grandparent;
+				memmove(&path[index], &path[index + 1], (pathSize - index - 1) * kCHPointerSize);
+				--pathSize;
+			} else
+				pathSize = index - 1;
+		}
+		break;
+	}
+	header->right->color = kBLACK; // Always reset root to black
+	return pathSize;
+}
+
+// Every leaf of a built tree is on one of its last two levels, so coloring only
+// the nodes on the last level red (unless that is just the root) gives every
+// path the same number of black nodes with no red node having a red child.
+- (void) setBalanceForBuiltNode:(CHBinaryTreeNode*)node
+                     leftHeight:(NSUInteger)leftHeight
+                    rightHeight:(NSUInteger)rightHeight
+                          depth:(NSUInteger)depth
+                     treeHeight:(NSUInteger)treeHeight
+{
+	(void) leftHeight;
+	(void) rightHeight;
+	node->color = (depth + 1 == treeHeight && depth > 0) ? kRED : kBLACK;
+}
+
+// The rank of a red-black subtree is its black height: the number of black nodes on every path from its root down to the sentinel.
+- (NSInteger) rankOfSubtree:(CHBinaryTreeNode*)node {
+	NSInteger blackHeight = 0;
+	for ( ; node != sentinel; node = node->left)
+		if (node->color == kBLACK)
+			++blackHeight;
+	return blackHeight;
+}
+
+- (NSInteger) rankOfNode:(CHBinaryTreeNode*)node
+                   child:(int)dir
+                    rank:(NSInteger)childRank
+             siblingRank:(NSInteger*)siblingRank
+{
+	(void) dir;
+	*siblingRank = childRank;
+	return childRank + (node->color == kBLACK);
+}
+
+// After both roots are made black, the node is made red and replaces the first black node of the same black height on the inner spine
+// of the subtree with the greater black height, then any red violation is fixed bottom-up, as after an insertion.
+- (CHBinaryTreeNode*) joinSubtree:(CHBinaryTreeNode*)left
+                             rank:(NSInteger)leftRank
+                         withNode:(CHBinaryTreeNode*)node
+                          subtree:(CHBinaryTreeNode*)right
+                             rank:(NSInteger)rightRank
+                       resultRank:(NSInteger*)rank
+{
+	bool fCounted = (m_fuiOptions & CHTreeOptionsOrderStatistics) != 0;
+	if (left->color == kRED) {
+		left->color = kBLACK;
+		++leftRank;
+	}
+	if (right->color == kRED) {
+		right->color = kBLACK;
+		++rightRank;
+	}
+	if (leftRank == rightRank) {
+		node->left = left;
+		node->right = right;
+		node->color = kBLACK;
+		if (fCounted)
+			CHBinaryTreeNodeCount(node) = CHBinaryTreeNodeCount(left) + CHBinaryTreeNodeCount(right) + 1;
+		*rank = leftRank + 1;
+		return node;
+	}
+	
+	// Follow the dir spine of the subtree with the greater black height.
+	u_int32_t dir = (leftRank > rightRank);
+	CHBinaryTreeNode *big = dir ? left : right, *small = dir ? right : left;
+	NSInteger smallRank = dir ? rightRank : leftRank;
+	NSInteger spineRank = dir ? leftRank : rightRank;
+	CHBinaryTreeNode head, *current = big, *parent, *grandparent, *sibling;
+	head.link[dir] = big;
+	head.link[!dir] = NULL;
+	head.color = kBLACK;
+	CHBinaryTreeStack_DECLARE();
+	CHBinaryTreeStack_INIT();
+	CHBinaryTreeStack_PUSH(&head);
+	*rank = spineRank;
+	while (current->color == kRED || spineRank != smallRank) {
+		CHBinaryTreeStack_PUSH(current);
+		if (current->color == kBLACK)
+			--spineRank;
+		current = current->link[dir];
+	}
+	node->link[!dir] = current;
+	node->link[dir] = small;
+	node->color = kRED;
+	CHBinaryTreeStack_TOP->link[dir] = node;
+	if (fCounted) {
+		CHBinaryTreeNodeCount(node) = CHBinaryTreeNodeCount(current) + CHBinaryTreeNodeCount(small) + 1;
+		NSUInteger i;
+		for (i = stackSize - 1; i > 0; i--)
+			CHBinaryTreeNodeCount(stack[i]) += CHBinaryTreeNodeCount(small) + 1;
+	}
+	
+	current = node;
+	while ((parent = CHBinaryTreeStack_POP()) != &head && parent->color == kRED) {
+		grandparent = CHBinaryTreeStack_POP(); // A red node is never the root, which is black
+		u_int32_t side = (grandparent->right == parent);
+		sibling = grandparent->link[!side];
+		if (sibling->color == kRED) {
+			parent->color = kBLACK;
+			sibling->color = kBLACK;
+			grandparent->color = kRED;
+			current = grandparent;
+			continue;
+		}
+		CHBinaryTreeNode *ancestor = CHBinaryTreeStack_TOP;
+		u_int32_t ancestorSide = (ancestor == &head) ? dir : (ancestor->right == grandparent);
+		if (parent->link[!side] == current)
+			ancestor->link[ancestorSide] = doubleRotation(grandparent, !side, fCounted);
+		else
+			ancestor->link[ancestorSide] = singleRotation(grandparent, !side, fCounted);
+		break;
+	}
+	CHBinaryTreeStack_FREE(stack);
+	if (head.link[dir]->color == kRED) {
+		head.link[dir]->color = kBLACK;
+		++*rank;
+	}
+	return head.link[dir];
+}
+
 - (NSString*) debugDescriptionForNode:(CHBinaryTreeNode*)node {
 	return [NSString stringWithFormat:@"[%s]\t\"%@\"",
 			(node->color == kRED) ? " RED " : "BLACK", node->object];
@@ -38,7 +38,9 @@ typedef enum {
 
 typedef enum {
 	CHTreeOptionsMultiLevel		= 0x01,		// CJEC, 2-Jul-13: Support multi-level trees
-	CHTreeOptionsMultiLeaves	= 0x02		// CJEC, 19-Jul-13: Support NSMutable Sets as leaves, allowing multiple items with NSOrderedSame
+	CHTreeOptionsMultiLeaves	= 0x02,		// CJEC, 19-Jul-13: Support NSMutable Sets as leaves, allowing multiple items with NSOrderedSame
+	CHTreeOptionsOrderStatistics	= 0x04,		// Keep a subtree count in every node, so that objects can be found by index, and indexes by object, in O(log n)
+	CHTreeOptionsPersistent		= 0x08		// Share reference counted nodes between a tree and its copies, so that -copy takes O(1) time and changes copy only the path they change
 } CHTreeOptions;							// CJEC, 22-Jul-13: Note: Both flags can be used together as the class library will not use CHTreeOptionsMultiLevel if there is not appropriate comparison method
 
 /**
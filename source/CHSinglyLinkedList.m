@@ -210,6 +210,40 @@ static size_t kCHSinglyLinkedListNodeSize = sizeof(CHSinglyLinkedListNode);
 	return count;
 }
 
+#if defined (__BLOCKS__)
+- (void) enumerateObjectsUsingBlock:(void (^)(id obj, NSUInteger idx, BOOL *stop))block {
+	[self enumerateObjectsWithOptions:0 usingBlock:block];
+}
+
+- (void) enumerateObjectsWithOptions:(NSEnumerationOptions)opts
+                          usingBlock:(void (^)(id obj, NSUInteger idx, BOOL *stop))block
+{
+	if (block == nil)
+		CHNilArgumentException([self class], _cmd);
+	if (count == 0)
+		return;
+	CHSinglyLinkedListNode *current;
+	NSUInteger index;
+	if (opts & (NSEnumerationConcurrent | NSEnumerationReverse)) {
+		// The links only lead forward, and only one thread can follow them, so the objects are gathered into an array first.
+		CHEnumerateGatheredObjects(count, ^(id *objects) {
+			NSUInteger objectIndex = 0;
+			for (CHSinglyLinkedListNode *node = head->next; node != NULL; node = node->next)
+				objects[objectIndex++] = node->object;
+		}, opts, block, &mutations, [self class], _cmd);
+		return;
+	}
+	unsigned long mutationCount = mutations;
+	BOOL stop = NO;
+	index = 0;
+	for (current = head->next; current != NULL && !stop; current = current->next) {
+		block(current->object, index++, &stop);
+		if (mutations != mutationCount)
+			CHMutatedCollectionException([self class], _cmd);
+	}
+}
+#endif	/* defined (__BLOCKS__) */
+
 - (id) firstObject {
 	return (count == 0) ? nil : head->next->object;
 }
@@ -0,0 +1,124 @@
+/*
+ CHDataStructures.framework -- CHSkipList.h
+
+ Copyright (c) 2008-2010, Quinn Taylor <http://homepage.mac.com/quinntaylor>
+
+ This source code is released under the ISC License. <http://www.opensource.org/licenses/isc-license>
+
+ Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby granted, provided that the above copyright notice and this permission notice appear in all copies.
+
+ The software is  provided "as is", without warranty of any kind, including all implied warranties of merchantability and fitness. In no event shall the authors or copyright holders be liable for any claim, damages, or other liability, whether in an action of contract, tort, or otherwise, arising from, out of, or in connection with the software or the use or other dealings in the software.
+
+	Fixes, additions, extensions, port to GNUstep by Christopher Chandler
+	Copyright © 2013-2015	Christopher James Elphinstone Chandler, Russell Geoffrey Watts. All Rights Reserved.
+	Copyright © 2015-2025	Kinnami Software Corporation. All rights reserved.
+ */
+
+#import "CHSortedSet.h"
+#import "CHAbstractBinarySearchTree.h"
+
+/**
+ @file CHSkipList.h
+ A <a href="http://en.wikipedia.org/wiki/Skip_list">skip list</a> implementation of CHSortedSet, with link widths for indexed access.
+ */
+
+/** The greatest number of levels in a skip list. With one node in four promoted to each level above, this is enough for 2<sup>64</sup> objects. */
+#define kCHSkipListMaxLevel		32
+
+struct CHSkipListNode;
+
+/**
+ A link from a node of a CHSkipList to the next node with at least as many levels. The width is the number of steps the link spans on the bottom level, so that summing widths along a search gives the position reached.
+ */
+typedef struct CHSkipListLink {
+	struct CHSkipListNode *	pNext;		///< The next node on this level, or @c NULL.
+	NSUInteger				cWidth;		///< The number of nodes from this node to the next on this level, counting the next but not this one. A link to @c NULL spans to one past the last node.
+} CHSkipListLink;
+
+/**
+ A node of a CHSkipList: an object and its tower of links, one per level, stored inline from the bottom level up, so that each node is a single allocation sized to its own height.
+ */
+typedef struct CHSkipListNode {
+	id						poObject;		///< The object stored in the node.
+	struct CHSkipListNode *	pPrev;			///< The previous node on the bottom level, or @c NULL for the first node.
+	uint32_t				cLevels;		///< The number of levels in the tower.
+	CHSkipListLink			asLink [];		///< The links, from the bottom level up.
+} CHSkipListNode;
+
+struct CHSkipListChunk;						/* Private. Declared in CHSkipList.m */
+
+/**
+ The state of a CHSkipList. Nodes are carved from chunks, and removed nodes are kept on a free list for their height, for reuse by a node of the same height.
+ */
+typedef struct CHSkipListStorage {
+	CHSkipListNode *			pHead;			///< The head tower, with a link on every level, which holds no object.
+	CHSkipListNode *			pTail;			///< The last node, or @c NULL if the list is empty.
+	NSUInteger					cObjects;		///< The number of objects in the list.
+	unsigned long				ulMutations;	///< Tracks mutations for NSFastEnumeration and enumerators.
+	uint32_t					cLevels;		///< The number of levels in use, at least one.
+	uint64_t					ullRandom;		///< The state of the generator that picks the height of each new node.
+	CHSkipListNode *			apNodeFree [kCHSkipListMaxLevel];	///< The most recently freed node of each height, less one.
+	struct CHSkipListChunk *	pChunks;		///< The newest chunk, linked to the older ones.
+	char *						pbChunkFree;	///< The unused part of the newest chunk.
+	size_t						cbChunkFree;	///< The number of bytes in the unused part of the newest chunk.
+	CHSearchTreeComparator		sComparator;	///< How objects are ordered.
+} CHSkipListStorage;
+
+/**
+ A <a href="http://en.wikipedia.org/wiki/Skip_list">skip list</a>, a sorted linked list with a hierarchy of express lanes above it: each node has links on a random number of levels, and every level is a sorted list of the nodes that reach it. A search starts on the top level and drops a level whenever the next node would pass the target, so searches, insertions and removals take O(log n) expected time, with no rebalancing. An insertion only splices a new node into the lists below its height, which makes it cheaper than an insertion into a balanced tree, which must also rotate or recolour nodes on its way back up.
+
+ Each new node has one level, and each further level with probability 1/4, drawn from a fast xorshift generator that belongs to the list, so the heights never depend on the objects or on other lists. Each node's tower of links is stored inline in the node, from the bottom level up, so that a node takes a single allocation sized to its height. Three quarters of the nodes have a single link, and the few tall towers that every search passes through are small and stay in the cache. The links of the head tower are stored the same way, one after another. Nodes are allocated from large chunks, and removed nodes are reused by new nodes of the same height.
+
+ Every link also records its width, the number of nodes it skips on the bottom level, so that \link #objectAtIndex: -objectAtIndex:\endlink and \link #indexOfObject: -indexOfObject:\endlink take O(log n) expected time, by summing widths during an ordinary search. The bottom level is also linked backwards, for descending enumeration.
+
+ Objects are ordered by @c -compare:, or by a C function given to \link #initWithCompareFunction:context: -initWithCompareFunction:context:\endlink. A list built by \link #initWithArray: -initWithArray:\endlink sorts the objects unless they are already in ascending order, and appends them in linear time.
+ */
+@interface CHSkipList : NSObject <CHSortedSet>
+{
+	@protected
+		CHSkipListStorage	m_sList;		/* The nodes of the list and how objects are ordered */
+}
+
+/**
+ Initialize a skip list that orders its objects with a C function rather than @c -compare:.
+
+ @param a_pfnCompare The function used to compare objects.
+ @param a_pvContext An arbitrary pointer passed to every call of @a a_pfnCompare. Not retained.
+ @return An initialized skip list that contains no objects.
+
+ @throw NSInvalidArgumentException if @a a_pfnCompare is @c NULL.
+ */
+- (id) initWithCompareFunction:(CHCompareFunction)a_pfnCompare context:(void*)a_pvContext;
+
+/**
+ Returns the object at a given position in the ascending order of the receiver's objects, in O(log n) expected time.
+
+ @param index The position of the object to return, counting from 0 for the first object.
+ @return The object at @a index.
+
+ @throw NSRangeException if @a index is greater than or equal to the number of objects in the receiver.
+
+ @see indexOfObject:
+ */
+- (id) objectAtIndex:(NSUInteger)index;
+
+/**
+ Returns the position of an object in the ascending order of the receiver's objects, in O(log n) expected time.
+
+ @param anObject The object to search for in the receiver.
+ @return The index of the object that compares as @c NSOrderedSame to @a anObject, or @c NSNotFound if there is none or @a anObject is @c nil.
+
+ @see objectAtIndex:
+ */
+- (NSUInteger) indexOfObject:(id)anObject;
+
+/**
+ Removes the object at a given position in the ascending order of the receiver's objects, in O(log n) expected time.
+
+ @param index The position of the object to remove, counting from 0 for the first object.
+
+ @throw NSRangeException if @a index is greater than or equal to the number of objects in the receiver.
+ */
+- (void) removeObjectAtIndex:(NSUInteger)index;
+
+@end
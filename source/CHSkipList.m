@@ -0,0 +1,639 @@
+/*
+ CHDataStructures.framework -- CHSkipList.m
+
+ Copyright (c) 2008-2010, Quinn Taylor <http://homepage.mac.com/quinntaylor>
+
+ This source code is released under the ISC License. <http://www.opensource.org/licenses/isc-license>
+
+ Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby granted, provided that the above copyright notice and this permission notice appear in all copies.
+
+ The software is  provided "as is", without warranty of any kind, including all implied warranties of merchantability and fitness. In no event shall the authors or copyright holders be liable for any claim, damages, or other liability, whether in an action of contract, tort, or otherwise, arising from, out of, or in connection with the software or the use or other dealings in the software.
+
+	Fixes, additions, extensions, port to GNUstep by Christopher Chandler
+	Copyright © 2013-2015	Christopher James Elphinstone Chandler, Russell Geoffrey Watts. All Rights Reserved.
+	Copyright © 2015-2025	Kinnami Software Corporation. All rights reserved.
+ */
+
+#import "CHSkipList.h"
+#import "CHAbstractBinarySearchTree_Internal.h"
+
+#pragma mark Skip list with link widths
+
+#define kCHSkipListChunkSize		16384	/* Bytes in each chunk from which nodes are carved */
+
+struct CHSkipListChunk {
+	struct CHSkipListChunk *	pChunkNext;		/* The next older chunk. The nodes follow */
+};
+
+static inline size_t	CHSkipListNodeSize (uint32_t a_cLevels)
+	{
+	return sizeof (CHSkipListNode) + a_cLevels * sizeof (CHSkipListLink);
+	}
+
+/* Seed the generator from the address of the list and the time, mixed by one round of splitmix64, so that lists created together differ
+*/
+static uint64_t	CHSkipListSeed (const void * a_pv)
+	{
+	uint64_t	z = ((uint64_t) (uintptr_t) a_pv ^ ((uint64_t) time (NULL) << 32)) + 0x9E3779B97F4A7C15ULL;
+
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	z ^= z >> 31;
+	return (z != 0) ? z : 0x9E3779B97F4A7C15ULL;					/* xorshift never leaves zero */
+	}
+
+/* The height of a new node: one level, and each further level with probability 1/4. Each pair of trailing zero bits of an xorshift64 draw
+	is one more level
+*/
+static inline uint32_t	CHSkipListRandomLevels (CHSkipListStorage * a_pList)
+	{
+	uint64_t	x = a_pList -> ullRandom;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	a_pList -> ullRandom = x;
+	return 1 + (uint32_t) __builtin_ctzll (x | (1ULL << (2 * (kCHSkipListMaxLevel - 1)))) / 2;
+	}
+
+static void	CHSkipListInit (CHSkipListStorage * a_pList, const void * a_pvSeed)
+	{
+	memset (a_pList, 0, sizeof (*a_pList));
+	a_pList -> pHead = calloc (1, CHSkipListNodeSize (kCHSkipListMaxLevel));
+	if (a_pList -> pHead == NULL)
+		[NSException raise:NSMallocException format:@"Unable to allocate a skip list"];
+	a_pList -> pHead -> cLevels = kCHSkipListMaxLevel;
+	a_pList -> pHead -> asLink [0].cWidth = 1;
+	a_pList -> cLevels = 1;
+	a_pList -> ullRandom = CHSkipListSeed (a_pvSeed);
+	}
+
+static CHSkipListNode *	CHSkipListNodeAlloc (CHSkipListStorage * a_pList, uint32_t a_cLevels, id a_po)
+	{
+	CHSkipListNode *			pNode;
+	struct CHSkipListChunk *	pChunk;
+	size_t						cbNode = CHSkipListNodeSize (a_cLevels);
+
+	if ((pNode = a_pList -> apNodeFree [a_cLevels - 1]) != NULL)
+		a_pList -> apNodeFree [a_cLevels - 1] = (CHSkipListNode *) pNode -> poObject;
+	else
+		{
+		if (a_pList -> cbChunkFree < cbNode)
+			{
+			pChunk = malloc (sizeof (struct CHSkipListChunk) + kCHSkipListChunkSize);
+			if (pChunk == NULL)
+				[NSException raise:NSMallocException format:@"Unable to allocate skip list nodes"];
+			pChunk -> pChunkNext = a_pList -> pChunks;
+			a_pList -> pChunks = pChunk;
+			a_pList -> pbChunkFree = (char *) (pChunk + 1);
+			a_pList -> cbChunkFree = kCHSkipListChunkSize;
+			}
+		pNode = (CHSkipListNode *) a_pList -> pbChunkFree;
+		a_pList -> pbChunkFree += cbNode;
+		a_pList -> cbChunkFree -= cbNode;
+		}
+	pNode -> poObject = a_po;
+	pNode -> cLevels = a_cLevels;
+	return pNode;
+	}
+
+/* Put a node on the free list for its height, linked through its object
+*/
+static inline void	CHSkipListNodeFree (CHSkipListStorage * a_pList, CHSkipListNode * a_pNode)
+	{
+	a_pNode -> poObject = (id) a_pList -> apNodeFree [a_pNode -> cLevels - 1];
+	a_pList -> apNodeFree [a_pNode -> cLevels - 1] = a_pNode;
+	}
+
+/* Descend from the top level, recording in a_apUpdate the last node on each level ordered before a_po, and in a_auiRank (if not NULL) the
+	position of that node, counting the head as 0. A node that stopped the search on one level is often the next node on the level below, and
+	is known not to be ordered before a_po, so it is not compared again. Returns the first node not ordered before a_po, or NULL
+*/
+static inline CHSkipListNode *	CHSkipListSearch (CHSkipListStorage * a_pList, id a_po, CHSkipListNode ** a_apUpdate, NSUInteger * a_auiRank)
+	{
+	CHSkipListNode *	pNode = a_pList -> pHead;
+	CHSkipListNode *	pNext;
+	CHSkipListNode *	pStop = NULL;
+	NSUInteger			uiRank = 0;
+	uint32_t			uiLevel = a_pList -> cLevels;
+
+	while (uiLevel-- > 0)
+		{
+		while (((pNext = pNode -> asLink [uiLevel].pNext) != NULL) && (pNext != pStop) &&
+		       (CHSearchTreeCompare (&a_pList -> sComparator, pNext -> poObject, a_po) == NSOrderedAscending))
+			{
+			uiRank += pNode -> asLink [uiLevel].cWidth;
+			pNode = pNext;
+			}
+		pStop = pNext;
+		a_apUpdate [uiLevel] = pNode;
+		if (a_auiRank != NULL)
+			a_auiRank [uiLevel] = uiRank;
+		}
+	return pStop;
+	}
+
+static id	CHSkipListMember (CHSkipListStorage * a_pList, id a_po)
+	{
+	CHSkipListNode *	apUpdate [kCHSkipListMaxLevel];
+	CHSkipListNode *	pNode = CHSkipListSearch (a_pList, a_po, apUpdate, NULL);
+
+	if ((pNode != NULL) && (CHSearchTreeCompare (&a_pList -> sComparator, pNode -> poObject, a_po) == NSOrderedSame))
+		return pNode -> poObject;
+	return nil;
+	}
+
+/* Splice a new node in after the nodes found by the search on each level below its height, splitting the width of each link it interrupts, and
+	widen the links above it, which now span one more node
+*/
+static void	CHSkipListAdd (CHSkipListStorage * a_pList, id a_po)
+	{
+	CHSkipListNode *	apUpdate [kCHSkipListMaxLevel];
+	NSUInteger			auiRank [kCHSkipListMaxLevel];
+	CHSkipListNode *	pNode;
+	CHSkipListNode *	pNext;
+	uint32_t			cLevels;
+	uint32_t			uiLevel;
+
+	a_pList -> ulMutations ++;
+	pNext = CHSkipListSearch (a_pList, a_po, apUpdate, auiRank);
+	if ((pNext != NULL) && (CHSearchTreeCompare (&a_pList -> sComparator, pNext -> poObject, a_po) == NSOrderedSame))
+		{
+		[a_po retain];
+		[pNext -> poObject release];
+		pNext -> poObject = a_po;
+		return;
+		}
+	cLevels = CHSkipListRandomLevels (a_pList);
+	for ( ; a_pList -> cLevels < cLevels; a_pList -> cLevels ++)	/* The head's new levels each span the whole list */
+		{
+		apUpdate [a_pList -> cLevels] = a_pList -> pHead;
+		auiRank [a_pList -> cLevels] = 0;
+		a_pList -> pHead -> asLink [a_pList -> cLevels].pNext = NULL;
+		a_pList -> pHead -> asLink [a_pList -> cLevels].cWidth = a_pList -> cObjects + 1;
+		}
+	pNode = CHSkipListNodeAlloc (a_pList, cLevels, [a_po retain]);
+	for (uiLevel = 0; uiLevel < cLevels; uiLevel ++)
+		{
+		pNode -> asLink [uiLevel].pNext = apUpdate [uiLevel] -> asLink [uiLevel].pNext;
+		pNode -> asLink [uiLevel].cWidth = apUpdate [uiLevel] -> asLink [uiLevel].cWidth - (auiRank [0] - auiRank [uiLevel]);
+		apUpdate [uiLevel] -> asLink [uiLevel].pNext = pNode;
+		apUpdate [uiLevel] -> asLink [uiLevel].cWidth = auiRank [0] - auiRank [uiLevel] + 1;
+		}
+	for ( ; uiLevel < a_pList -> cLevels; uiLevel ++)
+		apUpdate [uiLevel] -> asLink [uiLevel].cWidth ++;
+	pNode -> pPrev = (apUpdate [0] != a_pList -> pHead) ? apUpdate [0] : NULL;
+	if (pNode -> asLink [0].pNext != NULL)
+		pNode -> asLink [0].pNext -> pPrev = pNode;
+	else
+		a_pList -> pTail = pNode;
+	a_pList -> cObjects ++;
+	}
+
+/* Unlink a node, given the last node before it on each level, merging the widths of the links on either side of it, and narrowing the links above it
+*/
+static void	CHSkipListUnlink (CHSkipListStorage * a_pList, CHSkipListNode * a_pNode, CHSkipListNode ** a_apUpdate)
+	{
+	uint32_t	uiLevel;
+
+	for (uiLevel = 0; uiLevel < a_pList -> cLevels; uiLevel ++)
+		{
+		if (a_apUpdate [uiLevel] -> asLink [uiLevel].pNext == a_pNode)
+			{
+			a_apUpdate [uiLevel] -> asLink [uiLevel].cWidth += a_pNode -> asLink [uiLevel].cWidth - 1;
+			a_apUpdate [uiLevel] -> asLink [uiLevel].pNext = a_pNode -> asLink [uiLevel].pNext;
+			}
+		else
+			a_apUpdate [uiLevel] -> asLink [uiLevel].cWidth --;
+		}
+	if (a_pNode -> asLink [0].pNext != NULL)
+		a_pNode -> asLink [0].pNext -> pPrev = a_pNode -> pPrev;
+	else
+		a_pList -> pTail = a_pNode -> pPrev;
+	while ((a_pList -> cLevels > 1) && (a_pList -> pHead -> asLink [a_pList -> cLevels - 1].pNext == NULL))
+		a_pList -> cLevels --;
+	[a_pNode -> poObject release];
+	CHSkipListNodeFree (a_pList, a_pNode);
+	a_pList -> cObjects --;
+	a_pList -> ulMutations ++;
+	}
+
+static bool	CHSkipListRemove (CHSkipListStorage * a_pList, id a_po)
+	{
+	CHSkipListNode *	apUpdate [kCHSkipListMaxLevel];
+	CHSkipListNode *	pNode = CHSkipListSearch (a_pList, a_po, apUpdate, NULL);
+
+	if ((pNode == NULL) || (CHSearchTreeCompare (&a_pList -> sComparator, pNode -> poObject, a_po) != NSOrderedSame))
+		return false;
+	CHSkipListUnlink (a_pList, pNode, apUpdate);
+	return true;
+	}
+
+/* Descend by position rather than by comparison, following each link whose width does not pass the node at position a_uiIndex + 1, counting the
+	head as 0, and recording the last node before it on each level
+*/
+static CHSkipListNode *	CHSkipListNodeAtIndex (CHSkipListStorage * a_pList, NSUInteger a_uiIndex, CHSkipListNode ** a_apUpdate)
+	{
+	CHSkipListNode *	pNode = a_pList -> pHead;
+	NSUInteger			uiRank = 0;
+	uint32_t			uiLevel = a_pList -> cLevels;
+
+	while (uiLevel-- > 0)
+		{
+		while ((pNode -> asLink [uiLevel].pNext != NULL) && (uiRank + pNode -> asLink [uiLevel].cWidth <= a_uiIndex))
+			{
+			uiRank += pNode -> asLink [uiLevel].cWidth;
+			pNode = pNode -> asLink [uiLevel].pNext;
+			}
+		a_apUpdate [uiLevel] = pNode;
+		}
+	return pNode -> asLink [0].pNext;
+	}
+
+/* Release every object, free all the nodes, and reset the head to an empty list
+*/
+static void	CHSkipListRemoveAll (CHSkipListStorage * a_pList)
+	{
+	struct CHSkipListChunk *	pChunk;
+	CHSkipListNode *			pNode;
+
+	if (a_pList -> cObjects != 0)
+		{
+		for (pNode = a_pList -> pHead -> asLink [0].pNext; pNode != NULL; pNode = pNode -> asLink [0].pNext)
+			[pNode -> poObject release];
+		a_pList -> ulMutations ++;
+		}
+	while ((pChunk = a_pList -> pChunks) != NULL)
+		{
+		a_pList -> pChunks = pChunk -> pChunkNext;
+		free (pChunk);
+		}
+	memset (a_pList -> apNodeFree, 0, sizeof (a_pList -> apNodeFree));
+	a_pList -> pbChunkFree = NULL;
+	a_pList -> cbChunkFree = 0;
+	a_pList -> pHead -> asLink [0].pNext = NULL;
+	a_pList -> pHead -> asLink [0].cWidth = 1;
+	a_pList -> pTail = NULL;
+	a_pList -> cLevels = 1;
+	a_pList -> cObjects = 0;
+	}
+
+/* Replace the contents of a list with objects in strictly ascending order, which are retained, by appending each one at the end of the list. The
+	last node on each level is kept, so each append takes constant expected time
+*/
+static void	CHSkipListBuild (CHSkipListStorage * a_pList, id * a_apo, NSUInteger a_cObjects)
+	{
+	CHSkipListNode *	apLast [kCHSkipListMaxLevel];
+	NSUInteger			auiRank [kCHSkipListMaxLevel];
+	CHSkipListNode *	pNode;
+	NSUInteger			ui;
+	uint32_t			cLevels;
+	uint32_t			uiLevel;
+	unsigned long		ulMutations = a_pList -> ulMutations;
+
+	CHSkipListRemoveAll (a_pList);
+	a_pList -> ulMutations = ulMutations + 1;
+	for (uiLevel = 0; uiLevel < kCHSkipListMaxLevel; uiLevel ++)
+		{
+		apLast [uiLevel] = a_pList -> pHead;
+		auiRank [uiLevel] = 0;
+		a_pList -> pHead -> asLink [uiLevel].pNext = NULL;
+		}
+	for (ui = 0; ui < a_cObjects; ui ++)
+		{
+		cLevels = CHSkipListRandomLevels (a_pList);
+		if (a_pList -> cLevels < cLevels)
+			a_pList -> cLevels = cLevels;
+		pNode = CHSkipListNodeAlloc (a_pList, cLevels, [a_apo [ui] retain]);
+		pNode -> pPrev = (ui != 0) ? apLast [0] : NULL;
+		for (uiLevel = 0; uiLevel < cLevels; uiLevel ++)
+			{
+			pNode -> asLink [uiLevel].pNext = NULL;
+			apLast [uiLevel] -> asLink [uiLevel].pNext = pNode;
+			apLast [uiLevel] -> asLink [uiLevel].cWidth = ui + 1 - auiRank [uiLevel];
+			apLast [uiLevel] = pNode;
+			auiRank [uiLevel] = ui + 1;
+			}
+		}
+	for (uiLevel = 0; uiLevel < a_pList -> cLevels; uiLevel ++)		/* The last link on each level spans to one past the last node */
+		apLast [uiLevel] -> asLink [uiLevel].cWidth = a_cObjects + 1 - auiRank [uiLevel];
+	a_pList -> pTail = (a_cObjects != 0) ? apLast [0] : NULL;
+	a_pList -> cObjects = a_cObjects;
+	}
+
+#pragma mark -
+
+/**
+ An NSEnumerator for CHSkipList, which steps along the bottom level of the list, forwards or backwards.
+ */
+@interface CHSkipListEnumerator : CHCollectionEnumerator
+{
+	CHSkipListNode *node; // The node holding the next object.
+	BOOL reverse; // Whether the enumeration is in descending order.
+}
+
+- (id) initWithList:(CHSkipList*)skipList
+            storage:(const CHSkipListStorage*)listStorage
+            reverse:(BOOL)descending;
+
+@end
+
+@implementation CHSkipListEnumerator
+
+- (id) initWithList:(CHSkipList*)skipList
+            storage:(const CHSkipListStorage*)listStorage
+            reverse:(BOOL)descending
+{
+	if ((self = [super initWithCollection:skipList mutations:&listStorage->ulMutations]) == nil) return nil;
+	reverse = descending;
+	node = reverse ? listStorage->pTail : listStorage->pHead->asLink[0].pNext;
+	return self;
+}
+
+- (id) nextObjectFromCollection {
+	if (node == NULL)
+		return nil;
+	id anObject = node->poObject;
+	node = reverse ? node->pPrev : node->asLink[0].pNext;
+	return anObject;
+}
+
+@end
+
+#pragma mark -
+
+@implementation CHSkipList
+
+- (void) dealloc {
+	CHSkipListRemoveAll(&m_sList);
+	free(m_sList.pHead);
+	if (m_sList.sComparator.eKind == CHComparatorKindBlock)
+		[(id) m_sList.sComparator.pvContext release];
+	CHCompareCacheFree(m_sList.sComparator.apCache);
+	[super dealloc];
+}
+
+- (id) init {
+	if ((self = [super init]) == nil) return nil;
+	CHSkipListInit(&m_sList, self);
+	return self;
+}
+
+- (id) initWithCompareFunction:(CHCompareFunction)a_pfnCompare context:(void*)a_pvContext {
+	if (a_pfnCompare == NULL) {
+		Class aClass = [self class];
+		[self release];
+		CHNilArgumentException(aClass, _cmd);
+	}
+	if ((self = [self init]) == nil) return nil;
+	m_sList.sComparator.pvContext = a_pvContext;
+	m_sList.sComparator.pfnCompare = a_pfnCompare;
+	m_sList.sComparator.eKind = CHComparatorKindFunction;
+	return self;
+}
+
+- (id) initWithArray:(NSArray*)anArray {
+	if ((self = [self init]) == nil) return nil;
+	[self loadObjectsFromArray:anArray];
+	return self;
+}
+
+// Replaces the contents of the receiver with the objects in an array, appended in ascending order.
+- (void) loadObjectsFromArray:(NSArray*)anArray {
+	NSUInteger objectCount;
+	id *objects = CHSearchTreeCopySortedObjects(&m_sList.sComparator, anArray, true, &objectCount);
+	CHSkipListBuild(&m_sList, objects, objectCount);
+	free(objects);
+}
+
+// Returns a new list with the receiver's comparator, with objects in strictly ascending order.
+- (id) newListWithSortedObjects:(id*)objects count:(NSUInteger)objectCount {
+	CHSkipList *newList = [[[self class] alloc] init];
+	CHSearchTreeComparatorCopy(&newList->m_sList.sComparator, &m_sList.sComparator);
+	CHSkipListBuild(&newList->m_sList, objects, objectCount);
+	return newList;
+}
+
+// Returns every object in ascending order, in a malloc()ed buffer that the caller must free.
+- (id*) copyAllObjects {
+	id *objects = malloc(kCHPointerSize * (m_sList.cObjects + 1));
+	NSUInteger objectCount = 0;
+	if (objects == NULL)
+		[NSException raise:NSMallocException format:@"Unable to allocate %lu objects", (unsigned long) m_sList.cObjects];
+	for (CHSkipListNode *node = m_sList.pHead->asLink[0].pNext; node != NULL; node = node->asLink[0].pNext)
+		objects[objectCount++] = node->poObject;
+	return objects;
+}
+
+#pragma mark <NSCoding>
+
+- (id) initWithCoder:(NSCoder*)decoder {
+	return [self initWithArray:CHSortedSetDecodeObjects(decoder, self, _cmd)];
+}
+
+- (void) encodeWithCoder:(NSCoder*)encoder {
+	CHSortedSetEncodeObjects(encoder, self, _cmd, &m_sList.sComparator, [self allObjects]);
+}
+
+#pragma mark <NSCopying>
+
+- (id) copyWithZone:(NSZone*)zone {
+	(void) zone;
+	id *objects = [self copyAllObjects];
+	id copy = [self newListWithSortedObjects:objects count:m_sList.cObjects];
+	free(objects);
+	return copy;
+}
+
+#pragma mark <NSFastEnumeration>
+
+// The next node is kept in extra[0].
+- (NSUInteger) countByEnumeratingWithState:(NSFastEnumerationState*)state
+                                   objects:(id*)stackbuf
+                                     count:(NSUInteger)len
+{
+	CHSkipListNode *node;
+	NSUInteger batchCount = 0;
+	if (state->state == 0) {
+		state->state = 1;
+		state->mutationsPtr = &m_sList.ulMutations;
+		node = m_sList.pHead->asLink[0].pNext;
+	} else
+		node = (CHSkipListNode*) state->extra[0];
+	for ( ; node != NULL && batchCount < len; node = node->asLink[0].pNext)
+		stackbuf[batchCount++] = node->poObject;
+	state->extra[0] = (unsigned long) node;
+	state->itemsPtr = stackbuf;
+	return batchCount;
+}
+
+#pragma mark Querying Contents
+
+- (NSArray*) allObjects {
+	NSMutableArray *array = [NSMutableArray arrayWithCapacity:m_sList.cObjects];
+	for (CHSkipListNode *node = m_sList.pHead->asLink[0].pNext; node != NULL; node = node->asLink[0].pNext)
+		[array addObject:node->poObject];
+	return array;
+}
+
+- (id) anyObject {
+	return [self firstObject];
+}
+
+- (NSUInteger) count {
+	return m_sList.cObjects;
+}
+
+- (BOOL) containsObject:(id)anObject {
+	return (anObject != nil && CHSkipListMember(&m_sList, anObject) != nil);
+}
+
+- (NSString*) description {
+	return [[self allObjects] description];
+}
+
+- (id) firstObject {
+	CHSkipListNode *node = m_sList.pHead->asLink[0].pNext;
+	return (node != NULL) ? node->poObject : nil;
+}
+
+- (NSUInteger) hash {
+	return hashOfCountAndObjects(m_sList.cObjects, [self firstObject], [self lastObject]);
+}
+
+- (NSUInteger) indexOfObject:(id)anObject {
+	CHSkipListNode *update[kCHSkipListMaxLevel];
+	NSUInteger rank[kCHSkipListMaxLevel];
+	if (anObject == nil)
+		return NSNotFound;
+	CHSkipListNode *node = CHSkipListSearch(&m_sList, anObject, update, rank);
+	if (node == NULL || CHSearchTreeCompare(&m_sList.sComparator, node->poObject, anObject) != NSOrderedSame)
+		return NSNotFound;
+	return rank[0]; // The node before it is at position rank[0], counting the head as 0
+}
+
+- (BOOL) isEqual:(id)otherObject {
+	if ([otherObject conformsToProtocol:@protocol(CHSortedSet)])
+		return [self isEqualToSortedSet:otherObject];
+	else
+		return NO;
+}
+
+- (BOOL) isEqualToSortedSet:(id<CHSortedSet>)otherSortedSet {
+	return collectionsAreEqual(self, otherSortedSet);
+}
+
+- (id) lastObject {
+	return (m_sList.pTail != NULL) ? m_sList.pTail->poObject : nil;
+}
+
+- (id) member:(id)anObject {
+	return (anObject != nil) ? CHSkipListMember(&m_sList, anObject) : nil;
+}
+
+- (id) objectAtIndex:(NSUInteger)index {
+	CHSkipListNode *update[kCHSkipListMaxLevel];
+	if (index >= m_sList.cObjects)
+		CHIndexOutOfRangeException([self class], _cmd, index, m_sList.cObjects);
+	return CHSkipListNodeAtIndex(&m_sList, index, update)->poObject;
+}
+
+- (NSEnumerator*) objectEnumerator {
+	return [[[CHSkipListEnumerator alloc] initWithList:self storage:&m_sList reverse:NO] autorelease];
+}
+
+- (NSEnumerator*) reverseObjectEnumerator {
+	return [[[CHSkipListEnumerator alloc] initWithList:self storage:&m_sList reverse:YES] autorelease];
+}
+
+- (NSSet*) set {
+	return [NSSet setWithArray:[self allObjects]];
+}
+
+// The first node at or after start, or after it if the low endpoint is excluded, or NULL if there is none.
+- (CHSkipListNode*) nodeFromObject:(id)start excludingEndpoint:(BOOL)exclude {
+	CHSkipListNode *update[kCHSkipListMaxLevel];
+	CHSkipListNode *node = CHSkipListSearch(&m_sList, start, update, NULL);
+	if (exclude && node != NULL && CHSearchTreeCompare(&m_sList.sComparator, node->poObject, start) == NSOrderedSame)
+		node = node->asLink[0].pNext;
+	return node;
+}
+
+// Copies the objects of a run of a subset into a buffer, and returns how many there are.
+- (NSUInteger) getObjects:(id*)objects inRun:(const CHSubsetRun*)run {
+	NSUInteger objectCount = 0;
+	NSComparisonResult comparison;
+	CHSkipListNode *node;
+
+	node = (run->poStart == nil) ? m_sList.pHead->asLink[0].pNext : [self nodeFromObject:run->poStart excludingEndpoint:run->fExcludeStart];
+	for ( ; node != NULL; node = node->asLink[0].pNext) {
+		if (run->poEnd != nil) {
+			comparison = CHSearchTreeCompare(&m_sList.sComparator, node->poObject, run->poEnd);
+			if (comparison == NSOrderedDescending || (comparison == NSOrderedSame && run->fExcludeEnd))
+				break;
+		}
+		objects[objectCount++] = node->poObject;
+	}
+	return objectCount;
+}
+
+// The objects of each run are collected in ascending order, and the subset is built by appending them.
+- (id<CHSortedSet>) subsetFromObject:(id)start
+                            toObject:(id)end
+                             options:(CHSubsetConstructionOptions)options
+{
+	NSUInteger run, runCount, subsetCount = 0;
+	CHSubsetRun runs[2];
+	id *subset;
+
+	subset = malloc(kCHPointerSize * (m_sList.cObjects + 1));
+	if (subset == NULL)
+		[NSException raise:NSMallocException format:@"Unable to allocate %lu objects", (unsigned long) m_sList.cObjects];
+	runCount = CHSubsetRuns(start, end, start != nil && end != nil && CHSearchTreeCompare(&m_sList.sComparator, start, end) == NSOrderedDescending, options, runs);
+	for (run = 0; run < runCount; run++)
+		subsetCount += [self getObjects:subset + subsetCount inRun:&runs[run]];
+	id list = [self newListWithSortedObjects:subset count:subsetCount];
+	free(subset);
+	return [list autorelease];
+}
+
+#pragma mark Modifying Contents
+
+- (void) addObject:(id)anObject {
+	if (anObject == nil)
+		CHNilArgumentException([self class], _cmd);
+	CHSkipListAdd(&m_sList, anObject);
+}
+
+- (void) addObjectsFromArray:(NSArray*)anArray {
+	for (id anObject in anArray)
+		[self addObject:anObject];
+}
+
+- (void) removeAllObjects {
+	CHSkipListRemoveAll(&m_sList);
+}
+
+- (void) removeFirstObject {
+	if (m_sList.cObjects != 0)
+		[self removeObjectAtIndex:0];
+}
+
+- (void) removeLastObject {
+	if (m_sList.cObjects != 0)
+		[self removeObjectAtIndex:m_sList.cObjects - 1];
+}
+
+- (void) removeObject:(id)anObject {
+	if (anObject != nil)
+		CHSkipListRemove(&m_sList, anObject);
+}
+
+- (void) removeObjectAtIndex:(NSUInteger)index {
+	CHSkipListNode *update[kCHSkipListMaxLevel];
+	if (index >= m_sList.cObjects)
+		CHIndexOutOfRangeException([self class], _cmd, index, m_sList.cObjects);
+	CHSkipListUnlink(&m_sList, CHSkipListNodeAtIndex(&m_sList, index, update), update);
+}
+
+@end
@@ -57,7 +57,7 @@ typedef enum {
 	- <code>- (void) minusSet:</code>
 	- <code>- (void) unionSet:</code>
  
- @todo Consider adding other possible sorted set implementations, such as <a href="http://en.wikipedia.org/wiki/Skip_list">skip lists</a>, <a href="http://www.concentric.net/~Ttwang/tech/sorthash.htm">sorted linear hash sets</a>, and <a href="http://code.activestate.com/recipes/230113/">sorted lists</a>.
+ @todo Consider adding other possible sorted set implementations, such as <a href="http://www.concentric.net/~Ttwang/tech/sorthash.htm">sorted linear hash sets</a>, and <a href="http://code.activestate.com/recipes/230113/">sorted lists</a>.
 
  */
 @protocol CHSortedSet <NSObject, NSCoding, NSCopying, NSFastEnumeration>
@@ -211,6 +211,8 @@ typedef enum {
 /**
  Returns a new sorted set containing the objects delineated by two given objects. The subset is a shallow copy (new memory is allocated for the structure, but the copy points to the same objects) so any changes to the objects in the subset affect the receiver as well. The subset is an instance of the same class as the receiver.
  
+ @note Binary search trees instead return a read-only view of the receiver when @a start is ordered before or the same as @a end, or either is @c nil (but not both). The view costs O(log n) to create however large the range, but is invalidated by any change to the receiver, after which it raises a mutation exception. Use @c -copy to obtain an independent, mutable sorted set from a view.
+ 
  @param start Low endpoint of the subset to be returned; need not be present in the set.
  @param end High endpoint of the subset to be returned; need not be present in the set.
  @param options A combination of @c CHSubsetConstructionOptions values that specifies how to construct the subset. Pass 0 for the default behavior, or one or more options combined with a bitwise OR to specify different behavior.
@@ -28,13 +28,25 @@
 #import "CHTreap.h"
 #import "CHAbstractBinarySearchTree_Internal.h"
 
+static inline u_int32_t CHTreapRandomPriority(void) {
+#if defined (__MINGW64__)
+	unsigned int	ui;
+	
+	rand_s (&ui);
+	return ui;
+#else
+	return arc4random();
+#endif	/* defined (__MINGW64__) */
+}
+
 @implementation CHTreap
 
 // Two-way single rotation; 'dir' is the side to which the root should rotate.
-#define singleRotation(node,dir,parent) {         \
+#define singleRotation(node,dir,parent,counted) { \
 	CHBinaryTreeNode *save = node->link[!dir];    \
 	node->link[!dir] = save->link[dir];           \
 	save->link[dir] = node;                       \
+	CHBinaryTreeNodeCountRotation(counted, node, save); \
 	parent->link[(parent->right == node)] = save; \
 }
 
@@ -46,14 +58,7 @@
 }
 
 - (void) addObject:(id)anObject {
-#if defined (__MINGW64__)
-	unsigned int	ui;
-	
-	rand_s (&ui);
-	[self addObject:anObject withPriority:ui];
-#else
-	[self addObject:anObject withPriority:arc4random()];
-#endif	/* defined (__MINGW64__) */
+	[self addObject:anObject withPriority:CHTreapRandomPriority()];
 }
 
 - (void) addObject:(id)anObject withPriority:(NSUInteger)priority {
@@ -62,12 +67,14 @@
 	++mutations;
 
 	CHBinaryTreeNode *parent, *current = header;
+	bool fCounted = (m_fuiOptions & CHTreeOptionsOrderStatistics) != 0;
+	BOOL isNewNode = NO;
 	CHBinaryTreeStack_DECLARE();
 	CHBinaryTreeStack_INIT();
 	
 	sentinel->object = anObject; // Assure that we find a spot to insert
 	NSComparisonResult comparison;
-	while ((comparison = [current->object compare:anObject])) {
+	while ((comparison = CHSearchTreeCompare(&m_sComparator, current->object, anObject))) {
 		CHBinaryTreeStack_PUSH(current);
 		current = current->link[comparison == NSOrderedAscending]; // R on YES
 	}
@@ -87,18 +94,19 @@
 			if (current->priority >= current->link[direction]->priority)
 				break;
 			NSAssert((id) parent != nil, @"Illegal state, parent should never be nil!");
-			singleRotation(current, !direction, parent);
+			singleRotation(current, !direction, parent, fCounted);
 			parent = current;
 			current = current->link[!direction];
 		}
 	} else {
-		current = CHCreateBinaryTreeNodeWithObject(anObject);
+		current = CHBinaryTreeNodePoolAlloc(&m_sNodePool, anObject);
 		current->left   = sentinel;
 		current->right  = sentinel;
 		current->priority = (u_int32_t) (priority % CHTreapNotFound);
 		++count;
+		isNewNode = YES;
 		// Link from parent as the correct child, based on the last comparison
-		comparison = [parent->object compare:anObject];
+		comparison = CHSearchTreeCompare(&m_sComparator, parent->object, anObject);
 		parent->link[comparison == NSOrderedAscending] = current; // R if YES
 	}
 	
@@ -109,9 +117,11 @@
 		direction = (parent->left == current);
 		NSAssert((id) parent != nil, @"Illegal state, parent should never be nil!");
 		NSAssert(stackSize > 0, @"Illegal state, stack should never be empty!");
-		singleRotation(parent, direction, CHBinaryTreeStack_TOP);
+		singleRotation(parent, direction, CHBinaryTreeStack_TOP, fCounted);
 		parent = CHBinaryTreeStack_POP();
 	}
+	if (fCounted && isNewNode)
+		CHBinaryTreeNodeCountPath(header, sentinel, &m_sComparator, 0, false, anObject);
 	CHBinaryTreeStack_FREE(stack);
 }
 
@@ -121,12 +131,13 @@
 	++mutations;
 	
 	CHBinaryTreeNode *parent = NULL, *current = header;
+	bool fCounted = (m_fuiOptions & CHTreeOptionsOrderStatistics) != 0;
 	NSComparisonResult comparison;
 	u_int32_t direction;
 	
 	// First, we must locate the object to be removed, or we exit if not found
 	sentinel->object = anObject; // Assure that we stop at a sentinel leaf node
-	while ((comparison = [current->object compare:anObject])) {
+	while ((comparison = CHSearchTreeCompare(&m_sComparator, current->object, anObject))) {
 		parent = current;
 		current = current->link[comparison == NSOrderedAscending]; // R on YES
 	}
@@ -138,13 +149,15 @@
 		while (current->left != current->right) { // sentinel check
 			direction = (current->right->priority > current->left->priority);
 			isRightChild = (parent->right == current);
-			singleRotation(current, !direction, parent);
+			singleRotation(current, !direction, parent, fCounted);
 			parent = parent->link[isRightChild];
 		}
 //		NSAssert(parent != nil, @"Illegal state, parent should never be nil!");
 		parent->link[parent->right == current] = sentinel;
+		if (fCounted)
+			CHBinaryTreeNodeCountPath(header, sentinel, &m_sComparator, 0, false, current->object);
 		[current->object release];
-		free(current);
+		CHBinaryTreeNodePoolFree(&m_sNodePool, current);
 		--count;
 	}
 }
@@ -155,11 +168,84 @@
 	sentinel->object = anObject; // Make sure the target value is always "found"
 	CHBinaryTreeNode *current = header->right;
 	NSComparisonResult comparison;
-	while ((comparison = [current->object compare:anObject])) // while not equal
+	while ((comparison = CHSearchTreeCompare(&m_sComparator, current->object, anObject))) // while not equal
 		current = current->link[comparison == NSOrderedAscending]; // R on YES
 	return (current != sentinel) ? current->priority : CHTreapNotFound;
 }
 
+// A built node is higher than any node below it, so giving each height its own
+// band of priorities, with a random priority within the band, keeps the heap
+// property. The root's band is the highest, just below CHTreapNotFound.
+- (void) setBalanceForBuiltNode:(CHBinaryTreeNode*)node
+                     leftHeight:(NSUInteger)leftHeight
+                    rightHeight:(NSUInteger)rightHeight
+                          depth:(NSUInteger)depth
+                     treeHeight:(NSUInteger)treeHeight
+{
+	(void) depth;
+	u_int32_t band = (u_int32_t) (CHTreapNotFound / treeHeight);
+	u_int32_t height = (u_int32_t) MAX(leftHeight, rightHeight); // One less than the node's
+	node->priority = height * band + CHTreapRandomPriority() % band;
+}
+
+// A treap needs no rank: the priorities alone determine the shape of the joined tree.
+- (NSInteger) rankOfSubtree:(CHBinaryTreeNode*)node {
+	(void) node;
+	return 0;
+}
+
+- (NSInteger) rankOfNode:(CHBinaryTreeNode*)node
+                   child:(int)dir
+                    rank:(NSInteger)childRank
+             siblingRank:(NSInteger*)siblingRank
+{
+	(void) node;
+	(void) dir;
+	(void) childRank;
+	*siblingRank = 0;
+	return 0;
+}
+
+// Whichever of the node and the two roots has the highest priority becomes the root, and the other two are joined below it, so the node
+// sinks down the inner spines of the subtrees until both their roots have lower priorities. This is expected to take O(log n) steps.
+- (CHBinaryTreeNode*) joinSubtree:(CHBinaryTreeNode*)left
+                             rank:(NSInteger)leftRank
+                         withNode:(CHBinaryTreeNode*)node
+                          subtree:(CHBinaryTreeNode*)right
+                             rank:(NSInteger)rightRank
+                       resultRank:(NSInteger*)rank
+{
+	(void) leftRank;
+	(void) rightRank;
+	*rank = 0;
+	CHBinaryTreeNode *root, **link = &root;
+	CHBinaryTreeStack_DECLARE();
+	CHBinaryTreeStack_INIT();
+	while (node->priority < left->priority || node->priority < right->priority) {
+		if (left->priority >= right->priority) {
+			*link = left;
+			CHBinaryTreeStack_PUSH(left);
+			link = &left->right;
+			left = left->right;
+		} else {
+			*link = right;
+			CHBinaryTreeStack_PUSH(right);
+			link = &right->left;
+			right = right->left;
+		}
+	}
+	node->left = left;
+	node->right = right;
+	*link = node;
+	if (m_fuiOptions & CHTreeOptionsOrderStatistics) {
+		CHBinaryTreeNodeCount(node) = CHBinaryTreeNodeCount(left) + CHBinaryTreeNodeCount(right) + 1;
+		while ((left = CHBinaryTreeStack_POP()) != NULL)
+			CHBinaryTreeNodeCount(left) = CHBinaryTreeNodeCount(left->left) + CHBinaryTreeNodeCount(left->right) + 1;
+	}
+	CHBinaryTreeStack_FREE(stack);
+	return root;
+}
+
 - (NSString*) debugDescriptionForNode:(CHBinaryTreeNode*)node {
 	return [NSString stringWithFormat:@"[%11d]\t\"%@\"",
 			node->priority, node->object];
@@ -28,7 +28,7 @@
 	CHBinaryTreeNode *parent = header, *current = header->right;
 	sentinel->object = anObject; // Assure that we find a spot to insert
 	NSComparisonResult comparison;
-	while ((comparison = [current->object compare:anObject])) {
+	while ((comparison = CHSearchTreeCompare(&m_sComparator, current->object, anObject))) {
 		parent = current;
 		current = current->link[comparison == NSOrderedAscending]; // R on YES
 	}
@@ -40,13 +40,15 @@
 		current->object = anObject;		
 	} else {
 		// Create a new node to hold the value being inserted
-		current = CHCreateBinaryTreeNodeWithObject(anObject);
+		current = CHBinaryTreeNodePoolAlloc(&m_sNodePool, anObject);
 		current->left   = sentinel;
 		current->right  = sentinel;
 		++count;
 		// Link from parent as the proper child, based on last comparison
-		comparison = [parent->object compare:anObject]; // restore prior compare
+		comparison = CHSearchTreeCompare(&m_sComparator, parent->object, anObject); // restore prior compare
 		parent->link[comparison == NSOrderedAscending] = current;
+		if (m_fuiOptions & CHTreeOptionsOrderStatistics)
+			CHBinaryTreeNodeCountPath(header, sentinel, &m_sComparator, 0, false, anObject);
 	}
 }
 
@@ -62,7 +64,7 @@
 	
 	sentinel->object = anObject; // Assure that we find a spot to insert
 	NSComparisonResult comparison;
-	while ((comparison = [current->object compare:anObject])) {
+	while ((comparison = CHSearchTreeCompare(&m_sComparator, current->object, anObject))) {
 		parent = current;
 		current = current->link[comparison == NSOrderedAscending]; // R on YES
 	}
@@ -71,13 +73,14 @@
 	if (current == sentinel)
 		return;
 
-	[current->object release]; // Object must be released in any case
+	// Object must be released in any case, but not until the counts are fixed
+	id removedObject = current->object, unlinkedObject = removedObject;
 	--count;
 	if (current->left == sentinel || current->right == sentinel) {
 		// One or both of the child pointers are null, so removal is simpler
 		parent->link[parent->right == current]
 			= current->link[current->left == sentinel];
-		free(current);
+		CHBinaryTreeNodePoolFree(&m_sNodePool, current);
 	} else {
 		// The most complex case: removing a node with 2 non-null children
 		// (Replace object with the leftmost object in the right subtree.)
@@ -87,10 +90,48 @@
 			parent = replacement;
 			replacement = replacement->left;
 		}
-		current->object = replacement->object;
+		current->object = unlinkedObject = replacement->object;
 		parent->link[parent->right == replacement] = replacement->right;
-		free(replacement);
+		CHBinaryTreeNodePoolFree(&m_sNodePool, replacement);
 	}
+	if (m_fuiOptions & CHTreeOptionsOrderStatistics)
+		CHBinaryTreeNodeCountPath(header, sentinel, &m_sComparator, 0, false, unlinkedObject);
+	[removedObject release];
+}
+
+// An unbalanced tree needs no rank, and joins two subtrees by making them the children of the node.
+- (NSInteger) rankOfSubtree:(CHBinaryTreeNode*)node {
+	(void) node;
+	return 0;
+}
+
+- (NSInteger) rankOfNode:(CHBinaryTreeNode*)node
+                   child:(int)dir
+                    rank:(NSInteger)childRank
+             siblingRank:(NSInteger*)siblingRank
+{
+	(void) node;
+	(void) dir;
+	(void) childRank;
+	*siblingRank = 0;
+	return 0;
+}
+
+- (CHBinaryTreeNode*) joinSubtree:(CHBinaryTreeNode*)left
+                             rank:(NSInteger)leftRank
+                         withNode:(CHBinaryTreeNode*)node
+                          subtree:(CHBinaryTreeNode*)right
+                             rank:(NSInteger)rightRank
+                       resultRank:(NSInteger*)rank
+{
+	(void) leftRank;
+	(void) rightRank;
+	*rank = 0;
+	node->left = left;
+	node->right = right;
+	if (m_fuiOptions & CHTreeOptionsOrderStatistics)
+		CHBinaryTreeNodeCount(node) = CHBinaryTreeNodeCount(left) + CHBinaryTreeNodeCount(right) + 1;
+	return node;
 }
 
 @end
@@ -106,6 +106,17 @@ typedef uint32_t	u_int32_t;					/* Missing in Windows. Defined in sys/types.h on
 #endif	/* defined (GNUSTEP) */
 
 
+/* Parallel operations divide their work between workers on a dispatch queue, which needs blocks and libdispatch */
+#if defined (__BLOCKS__) && defined (__has_include)
+#if __has_include (<dispatch/dispatch.h>)
+#import <dispatch/dispatch.h>
+#define CHUsingDispatch				1
+#endif
+#endif
+#if !defined (CHUsingDispatch)
+#define CHUsingDispatch				0
+#endif
+
 /** Macro for reducing visibility of symbol names not indended to be exported. */
 #define HIDDEN __attribute__((visibility("hidden")))
 
@@ -156,6 +167,87 @@ OBJC_EXPORT BOOL collectionsAreEqual(id collection1, id collection2);
  */
 HIDDEN NSUInteger hashOfCountAndObjects(NSUInteger count, id o1, id o2);
 
+/**
+ Sets the most workers a parallel operation runs at once, for \link CHBinarySearchTree#setParallelWorkerCount: +[CHBinarySearchTree setParallelWorkerCount:]\endlink.
+ 
+ @param workerCount The most workers to run at once, or zero for one for each active processor.
+ */
+HIDDEN void CHSetParallelWorkerCount(NSUInteger workerCount);
+
+/**
+ Returns the most workers a parallel operation runs at once, as last set by CHSetParallelWorkerCount().
+ 
+ @return The most workers to run at once, or zero for one for each active processor.
+ */
+HIDDEN NSUInteger CHParallelWorkerCount(void);
+
+/**
+ Returns the number of workers a parallel operation divides its work between: the count set by CHSetParallelWorkerCount(), or if that is zero, the number of active processors.
+ */
+HIDDEN NSUInteger CHParallelWorkerLimit(void);
+
+#if defined (__BLOCKS__)
+/**
+ Calls a block for each object in a C array used as a ring, with the semantics of \link NSArray#enumerateObjectsWithOptions:usingBlock: -[NSArray enumerateObjectsWithOptions:usingBlock:]\endlink. The object at index @c i is <code>objects[(first + i) % capacity]</code>, so a plain C array is passed with @a first 0 and @a capacity at least @a count.
+ 
+ With @c NSEnumerationConcurrent, and when libdispatch is available, the indexes are divided into contiguous ranges which are handed to as many workers at once as CHParallelWorkerLimit() allows, on a global concurrent queue, each with its own autorelease pool, and @c NSEnumerationReverse is ignored. Setting @c *stop stops every worker before its next object, but objects already being passed to the block on other threads are still passed.
+ 
+ @param objects The C array holding the objects.
+ @param capacity The number of slots in @a objects.
+ @param first The slot holding the object at index 0.
+ @param count The number of objects to enumerate.
+ @param options A mask of NSEnumerationOptions.
+ @param block The block to call for each object.
+ @param mutations A pointer to the collection's mutation count, which is checked after each call of the block, or only once all have returned when enumerating concurrently.
+ @param aClass The class of the collection, for the exception raised if it is mutated.
+ @param method The method selector of the caller, for the same exception.
+ 
+ @throw NSGenericException if the mutation count changes while the objects are being enumerated.
+ */
+HIDDEN void CHEnumerateObjectsInRing(id *objects, NSUInteger capacity, NSUInteger first, NSUInteger count,
+                                     NSEnumerationOptions options, void (^block)(id obj, NSUInteger idx, BOOL *stop),
+                                     unsigned long *mutations, Class aClass, SEL method);
+
+/**
+ Calls a block for each object of a collection whose objects are gathered into a C array first, as CHEnumerateObjectsInRing() does for a plain C array. This suits a collection that can only be walked in one direction, or by one thread at a time. The array is freed even if the block, or a mutation of the collection, raises an exception.
+ 
+ @param count The number of objects in the collection.
+ @param gather A block that stores the @a count objects of the collection, in order, in the array it is passed.
+ @param options, block, mutations, aClass, method As for CHEnumerateObjectsInRing().
+ 
+ @throw NSMallocException if the array cannot be allocated.
+ @throw NSGenericException if the mutation count changes while the objects are being enumerated.
+ */
+HIDDEN void CHEnumerateGatheredObjects(NSUInteger count, void (^gather)(id *objects),
+                                       NSEnumerationOptions options, void (^block)(id obj, NSUInteger idx, BOOL *stop),
+                                       unsigned long *mutations, Class aClass, SEL method);
+#endif	/* defined (__BLOCKS__) */
+
+/**
+ An abstract NSEnumerator for a collection that it steps through directly, such as a sorted set's own storage. The collection is retained until the enumeration ends, since the objects already returned may be owned only by the collection, and if a mutation count is given, an exception is raised once the collection has been mutated. Subclasses override only -nextObjectFromCollection.
+ */
+@interface CHCollectionEnumerator : NSEnumerator
+{
+	id						collection;		// The collection being enumerated, retained until the enumeration ends.
+	const unsigned long *	mutationPtr;	// The collection's mutation count, or NULL if it is not checked.
+	unsigned long			mutationCount;	// The mutation count when the enumerator was created.
+}
+
+/**
+ Initializes an enumerator for a collection.
+ 
+ @param aCollection The collection to be enumerated, which is retained until the enumeration ends.
+ @param mutations A pointer to the collection's mutation count, or @c NULL if the collection may be mutated while it is enumerated.
+ */
+- (id) initWithCollection:(id)aCollection mutations:(const unsigned long*)mutations;
+
+/**
+ Returns the next object of the collection, or @c nil once there are no more. Must be overridden by subclasses; it is not called again once it has returned @c nil.
+ */
+- (id) nextObjectFromCollection;
+
+@end
+
 #pragma mark -
 
 /**
@@ -50,6 +50,135 @@ NSUInteger hashOfCountAndObjects(NSUInteger count, id object1, id object2) {
 	return hash ^ (31*[object1 hash]) ^ ((31*[object2 hash]) << 4);
 }
 
+static NSUInteger s_parallelWorkerCount = 0; // Zero runs one worker for each active processor
+
+void CHSetParallelWorkerCount(NSUInteger workerCount) {
+	__atomic_store_n(&s_parallelWorkerCount, workerCount, __ATOMIC_RELAXED);
+}
+
+NSUInteger CHParallelWorkerCount(void) {
+	return __atomic_load_n(&s_parallelWorkerCount, __ATOMIC_RELAXED);
+}
+
+NSUInteger CHParallelWorkerLimit(void) {
+	NSUInteger workers = CHParallelWorkerCount();
+	return (workers != 0) ? workers : [[NSProcessInfo processInfo] activeProcessorCount];
+}
+
+/* Concurrent block enumeration hands ranges of indexes to workers on a dispatch queue, which needs blocks and libdispatch */
+#if defined (__BLOCKS__)
+#define kCHEnumerationRangesPerWorker	4	// Ranges handed out for each worker, so that one that finishes early can take another
+
+void CHEnumerateObjectsInRing(id *objects, NSUInteger capacity, NSUInteger first, NSUInteger count,
+                              NSEnumerationOptions options, void (^block)(id obj, NSUInteger idx, BOOL *stop),
+                              unsigned long *mutations, Class aClass, SEL method)
+{
+	unsigned long mutationCount = *mutations;
+	NSUInteger beforeWrap = capacity - first; // Indexes below this are stored from first onwards
+	BOOL stop = NO;
+#if CHUsingDispatch
+	NSUInteger workers = CHParallelWorkerLimit();
+	NSUInteger ranges = MIN(count, workers * kCHEnumerationRangesPerWorker);
+	if ((options & NSEnumerationConcurrent) && workers > 1 && ranges > 1) {
+		__block BOOL stopAll = NO;
+		dispatch_apply(ranges, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t range) {
+			NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+			NSUInteger end = (NSUInteger) ((unsigned long long) count * (range + 1) / ranges);
+			BOOL stopRange = NO;
+			for (NSUInteger index = (NSUInteger) ((unsigned long long) count * range / ranges); index < end; index++) {
+				if (__atomic_load_n(&stopAll, __ATOMIC_RELAXED))
+					break;
+				block(objects[(index < beforeWrap) ? first + index : index - beforeWrap], index, &stopRange);
+				if (stopRange) {
+					__atomic_store_n(&stopAll, YES, __ATOMIC_RELAXED);
+					break;
+				}
+			}
+			[pool release];
+		});
+		if (*mutations != mutationCount)
+			CHMutatedCollectionException(aClass, method);
+		return;
+	}
+#endif	/* CHUsingDispatch */
+	if (options & NSEnumerationReverse) {
+		for (NSUInteger index = count; index-- > 0 && !stop; ) {
+			block(objects[(index < beforeWrap) ? first + index : index - beforeWrap], index, &stop);
+			if (*mutations != mutationCount)
+				CHMutatedCollectionException(aClass, method);
+		}
+	} else {
+		for (NSUInteger index = 0; index < count && !stop; index++) {
+			block(objects[(index < beforeWrap) ? first + index : index - beforeWrap], index, &stop);
+			if (*mutations != mutationCount)
+				CHMutatedCollectionException(aClass, method);
+		}
+	}
+}
+
+void CHEnumerateGatheredObjects(NSUInteger count, void (^gather)(id *objects),
+                                NSEnumerationOptions options, void (^block)(id obj, NSUInteger idx, BOOL *stop),
+                                unsigned long *mutations, Class aClass, SEL method)
+{
+	if (count == 0)
+		return;
+	id *objects = malloc(kCHPointerSize * count);
+	if (objects == NULL)
+		[NSException raise:NSMallocException format:@"Unable to allocate %lu objects", (unsigned long) count];
+	@try {
+		gather(objects);
+		CHEnumerateObjectsInRing(objects, count, 0, count, options, block, mutations, aClass, method);
+	}
+	@finally {
+		free(objects);
+	}
+}
+#endif	/* defined (__BLOCKS__) */
+
+@implementation CHCollectionEnumerator
+
+- (id) initWithCollection:(id)aCollection mutations:(const unsigned long*)mutations {
+	if ((self = [super init]) == nil) return nil;
+	collection = [aCollection retain];
+	mutationPtr = mutations;
+	if (mutationPtr != NULL)
+		mutationCount = *mutationPtr;
+	return self;
+}
+
+- (void) dealloc {
+	[collection release];
+	[super dealloc];
+}
+
+- (NSArray*) allObjects {
+	NSMutableArray *array = [NSMutableArray array];
+	id anObject;
+	while ((anObject = [self nextObject]) != nil)
+		[array addObject:anObject];
+	return array;
+}
+
+- (id) nextObject {
+	if (collection == nil)
+		return nil;
+	if (mutationPtr != NULL && mutationCount != *mutationPtr)
+		CHMutatedCollectionException([self class], _cmd);
+	id anObject = [self nextObjectFromCollection];
+	if (anObject == nil) {
+		[collection autorelease]; // The objects already returned may be owned only by the collection.
+		collection = nil;
+	}
+	return anObject;
+}
+
+- (id) nextObjectFromCollection {
+	CHUnsupportedOperationException([self class], _cmd);
+	return nil;
+}
+
+@end
+
 #pragma mark -
 
 void CHIndexOutOfRangeException(Class aClass, SEL method,
@@ -22,6 +22,7 @@
 @interface CHBinarySearchTree (Height)						/* CJEC, 12-Feb-15: Separated CHAbstractBinarySearchTree into a genuine abstract base class and CHBinaryTree, the abstract implementation class for all binary search trees */
 - (NSUInteger) height;
 - (NSUInteger) heightOfSubtreeAtNode:(CHBinaryTreeNode*)node;
+- (id) memberUsingInvocation:(id)anObject;
 @end
 
 @implementation CHBinarySearchTree (Height)					/* CJEC, 12-Feb-15: Separated CHAbstractBinarySearchTree into a genuine abstract base class and CHBinaryTree, the abstract implementation class for all binary search trees */
@@ -40,6 +41,132 @@
 	}
 }
 
+// The search loop of -member: as it was before comparisons used the cached IMP, for comparison
+- (id) memberUsingInvocation:(id)anObject {
+	NSInvocation *poInvocationCompare = [[self class] InvocationCompare:anObject nestingLevel:0];
+	CHBinaryTreeNode *current = header->right;
+	NSComparisonResult comparison;
+	sentinel->object = anObject;
+	comparison = [self Compare:poInvocationCompare target:current->object argument:anObject];
+	while (comparison != NSOrderedSame) {
+		current = current->link[comparison == NSOrderedAscending];
+		comparison = [self Compare:poInvocationCompare target:current->object argument:nil];
+	}
+	return (current != sentinel) ? current->object : nil;
+}
+
+@end
+
+// Adds a slice of numbers to a shared set on its own thread, then removes every other one, locking around each call if given a lock, and
+// counts down the threads still running when done.
+@interface ConcurrentWriter : NSObject
+{
+	id<CHSortedSet> set;
+	NSLock *lock;
+	NSArray *numbers;
+	NSCondition *condition;
+	NSUInteger *running;
+}
+- (id) initWithSet:(id<CHSortedSet>)aSet lock:(NSLock*)aLock numbers:(NSArray*)someNumbers
+         condition:(NSCondition*)aCondition running:(NSUInteger*)aRunning;
+- (void) run:(id)unused;
+@end
+
+@implementation ConcurrentWriter
+
+- (id) initWithSet:(id<CHSortedSet>)aSet lock:(NSLock*)aLock numbers:(NSArray*)someNumbers
+         condition:(NSCondition*)aCondition running:(NSUInteger*)aRunning
+{
+	if ((self = [super init]) == nil) return nil;
+	set = aSet;
+	lock = aLock;
+	numbers = [someNumbers retain];
+	condition = aCondition;
+	running = aRunning;
+	return self;
+}
+
+- (void) dealloc {
+	[numbers release];
+	[super dealloc];
+}
+
+- (void) run:(id)unused {
+	(void) unused;
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+	NSUInteger index, count = [numbers count];
+	for (index = 0; index < count; index++) {
+		[lock lock];
+		[set addObject:[numbers objectAtIndex:index]];
+		[lock unlock];
+	}
+	for (index = 0; index < count; index += 2) {
+		[lock lock];
+		[set removeObject:[numbers objectAtIndex:index]];
+		[lock unlock];
+	}
+	[pool release];
+	[condition lock];
+	(*running)--;
+	[condition signal];
+	[condition unlock];
+}
+
+@end
+
+// Looks up each of an array of numbers in a shared set on its own thread, synchronizing on the set around each call if asked to, and counts
+// down the threads still running when done.
+@interface ConcurrentReader : NSObject
+{
+	id<CHSortedSet> set;
+	BOOL synchronize;
+	NSArray *numbers;
+	NSCondition *condition;
+	NSUInteger *running;
+}
+- (id) initWithSet:(id<CHSortedSet>)aSet synchronize:(BOOL)aSynchronize numbers:(NSArray*)someNumbers
+         condition:(NSCondition*)aCondition running:(NSUInteger*)aRunning;
+- (void) run:(id)unused;
+@end
+
+@implementation ConcurrentReader
+
+- (id) initWithSet:(id<CHSortedSet>)aSet synchronize:(BOOL)aSynchronize numbers:(NSArray*)someNumbers
+         condition:(NSCondition*)aCondition running:(NSUInteger*)aRunning
+{
+	if ((self = [super init]) == nil) return nil;
+	set = aSet;
+	synchronize = aSynchronize;
+	numbers = [someNumbers retain];
+	condition = aCondition;
+	running = aRunning;
+	return self;
+}
+
+- (void) dealloc {
+	[numbers release];
+	[super dealloc];
+}
+
+- (void) run:(id)unused {
+	(void) unused;
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+	NSUInteger index, count = [numbers count];
+	for (index = 0; index < count; index++) {
+		if (synchronize) {
+			@synchronized (set) {
+				[set containsObject:[numbers objectAtIndex:index]];
+			}
+		} else
+			[set containsObject:[numbers objectAtIndex:index]];
+	}
+	[pool release];
+	[condition lock];
+	(*running)--;
+	[condition signal];
+	[condition unlock];
+}
+
 @end
 
 #pragma mark -
@@ -391,11 +518,20 @@ void benchmarkHeap(Class testClass) {
 	[pool release];
 }
 
+/* Orders NSNumbers by their integer values, for timing trees that use a comparator function. */
+NSComparisonResult compareIntegerValues(id target, id argument, void *context) {
+	(void) context;					/* Avoid unused parameter compiler warning */
+	NSInteger a = [target integerValue], b = [argument integerValue];
+	return (a < b) ? NSOrderedAscending : ((a > b) ? NSOrderedDescending : NSOrderedSame);
+}
+
 void benchmarkTree(Class testClass) {
 	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
 	CHQuietLog(@"\n%@", testClass);
 	
 	id<CHSearchTree> tree;
+	// Capacity, order statistics, invocations, cursors, splits and unions are features of the binary search trees
+	BOOL binaryTree = [testClass isSubclassOfClass:[CHAbstractBinarySearchTree class]];
 	
 	printf("(Operation)         ");
 	arrayEnumerator = [objects objectEnumerator];
@@ -414,6 +550,52 @@ void benchmarkTree(Class testClass) {
 		[tree release];
 	}
 	
+	if (binaryTree) {
+		printf("\naddObject: (capacity)");
+		arrayEnumerator = [objects objectEnumerator];
+		while ((array = [arrayEnumerator nextObject])) {
+			tree = [[testClass alloc] initWithCapacity:[array count]];
+			startTime = timestamp();
+			for (id anObject in array)
+				[tree addObject:anObject];
+			printf("\t%f", timestamp() - startTime);
+			[tree release];
+		}
+	}
+	
+	printf("\nremove/addObject:   ");
+	arrayEnumerator = [objects objectEnumerator];
+	while ((array = [arrayEnumerator nextObject])) {
+		tree = [[testClass alloc] initWithArray:array];
+		startTime = timestamp();
+		for (id anObject in array) {
+			[tree removeObject:anObject]; // Node goes on the free list...
+			[tree addObject:anObject];    // ...and is reused immediately
+		}
+		printf("\t%f", timestamp() - startTime);
+		[tree release];
+	}
+	
+	printf("\naddObject: (function)");
+	arrayEnumerator = [objects objectEnumerator];
+	while ((array = [arrayEnumerator nextObject])) {
+		tree = [[testClass alloc] initWithCompareFunction:compareIntegerValues context:NULL];
+		startTime = timestamp();
+		for (id anObject in array)
+			[tree addObject:anObject];
+		printf("\t%f", timestamp() - startTime);
+		[tree release];
+	}
+	
+	printf("\ninitWithSortedArray:");
+	arrayEnumerator = [objects objectEnumerator];
+	while ((array = [arrayEnumerator nextObject])) {
+		startTime = timestamp();
+		tree = [[testClass alloc] initWithSortedArray:array]; // Balanced build, O(n)
+		printf("\t%f", timestamp() - startTime);
+		[tree release];
+	}
+	
 	printf("\nmember:         ");
 	arrayEnumerator = [objects objectEnumerator];
 	while ((array = [arrayEnumerator nextObject])) {
@@ -425,6 +607,120 @@ void benchmarkTree(Class testClass) {
 		[tree release];
 	}
 	
+	if (binaryTree) {
+		printf("\nmember: (NSInvocation)");
+		arrayEnumerator = [objects objectEnumerator];
+		while ((array = [arrayEnumerator nextObject])) {
+			tree = [[testClass alloc] initWithArray:array];
+			startTime = timestamp();
+			for (id anObject in array)
+				[(CHBinarySearchTree *) tree memberUsingInvocation:anObject];
+			printf("\t%f", timestamp() - startTime);
+			[tree release];
+		}
+		
+		printf("\naddObject: (counted)");
+		arrayEnumerator = [objects objectEnumerator];
+		while ((array = [arrayEnumerator nextObject])) {
+			tree = [[testClass alloc] initWithTreeOptions:CHTreeOptionsOrderStatistics];
+			startTime = timestamp();
+			for (id anObject in array)
+				[tree addObject:anObject];
+			printf("\t%f", timestamp() - startTime);
+			[tree release];
+		}
+		
+		printf("\nobjectAtIndex: (counted)");
+		arrayEnumerator = [objects objectEnumerator];
+		while ((array = [arrayEnumerator nextObject])) {
+			tree = [[testClass alloc] initWithTreeOptions:CHTreeOptionsOrderStatistics];
+			[tree addObjectsFromArray:array];
+			startTime = timestamp();
+			for (NSUInteger index = 0; index < [array count]; index++)
+				[(CHBinarySearchTree *) tree objectAtIndex:index];
+			printf("\t%f", timestamp() - startTime);
+			[tree release];
+		}
+	}
+	
+	// A window of 10 objects at each position; the view seeks rather than copying the range
+	printf("\nsubsetFromObject: (10)");
+	arrayEnumerator = [objects objectEnumerator];
+	while ((array = [arrayEnumerator nextObject])) {
+		tree = [[testClass alloc] initWithArray:array];
+		NSUInteger limit = ([array count] > 10) ? [array count] - 10 : 0;
+		startTime = timestamp();
+		for (NSUInteger index = 0; index < limit; index += 10) {
+			NSAutoreleasePool *subsetPool = [[NSAutoreleasePool alloc] init];
+			id<CHSortedSet> subset = [tree subsetFromObject:[array objectAtIndex:index]
+			                                       toObject:[array objectAtIndex:index + 9]
+			                                        options:0];
+			NSEnumerator *e = [subset objectEnumerator];
+			while ([e nextObject] != nil)
+				;
+			[subsetPool release];
+		}
+		printf("\t%f", timestamp() - startTime);
+		[tree release];
+	}
+	
+	if (binaryTree) {
+		printf("\nceilingObject:     ");
+		arrayEnumerator = [objects objectEnumerator];
+		while ((array = [arrayEnumerator nextObject])) {
+			tree = [[testClass alloc] initWithArray:array];
+			startTime = timestamp();
+			for (id anObject in array)
+				[(CHBinarySearchTree *) tree ceilingObject:anObject];
+			printf("\t%f", timestamp() - startTime);
+			[tree release];
+		}
+		
+		printf("\ncursor next        ");
+		arrayEnumerator = [objects objectEnumerator];
+		while ((array = [arrayEnumerator nextObject])) {
+			tree = [[testClass alloc] initWithArray:array];
+			startTime = timestamp();
+			CHBinarySearchTreeCursor *cursor = [(CHBinarySearchTree *) tree cursorAtObject:nil];
+			while ([cursor next] != nil)
+				;
+			printf("\t%f", timestamp() - startTime);
+			[tree release];
+		}
+		
+		// 100 splits at evenly spaced objects, each joined straight back; AA trees do not support splitting
+		if (testClass != [CHAnderssonTree class]) {
+			printf("\nsplit/joinWithTree: ");
+			arrayEnumerator = [objects objectEnumerator];
+			while ((array = [arrayEnumerator nextObject])) {
+				tree = [[testClass alloc] initWithArray:array];
+				NSUInteger step = ([array count] > 100) ? [array count] / 100 : 1;
+				startTime = timestamp();
+				for (NSUInteger index = 0; index < [array count]; index += step) {
+					NSAutoreleasePool *splitPool = [[NSAutoreleasePool alloc] init];
+					[(CHBinarySearchTree *) tree joinWithTree:[(CHBinarySearchTree *) tree splitAtObject:[array objectAtIndex:index]]];
+					[splitPool release];
+				}
+				printf("\t%f", timestamp() - startTime);
+				[tree release];
+			}
+		}
+		
+		// Two trees with half the objects each, merged and rebuilt rather than added one at a time
+		printf("\nunionWithSortedSet:");
+		arrayEnumerator = [objects objectEnumerator];
+		while ((array = [arrayEnumerator nextObject])) {
+			NSUInteger half = [array count] / 2;
+			tree = [[testClass alloc] initWithArray:[array subarrayWithRange:NSMakeRange(0, half)]];
+			id otherTree = [[testClass alloc] initWithArray:[array subarrayWithRange:NSMakeRange(half, [array count] - half)]];
+			startTime = timestamp();
+			[(CHBinarySearchTree *) tree unionWithSortedSet:otherTree];
+			printf("\t%f", timestamp() - startTime);
+			[otherTree release];
+			[tree release];
+		}
+	}
+	
 	printf("\nremoveObject:       ");
 	arrayEnumerator = [objects objectEnumerator];
 	while ((array = [arrayEnumerator nextObject])) {
@@ -450,6 +746,20 @@ void benchmarkTree(Class testClass) {
 		[tree release];
 	}
 	
+	printf("\nNSFastEnumeration  ");
+	arrayEnumerator = [objects objectEnumerator];
+	while ((array = [arrayEnumerator nextObject])) {
+		tree = [[testClass alloc] initWithArray:array];
+		NSUInteger found = 0;
+		startTime = timestamp();
+		for (id anObject in tree)
+			found += (anObject != nil);
+		printf("\t%f", timestamp() - startTime);
+		if (found != [array count])
+			printf(" (%lu)", (unsigned long)found);
+		[tree release];
+	}
+	
 	CHQuietLog(@"");
 	[pool release];
 }
@@ -472,6 +782,431 @@ NSArray* randomNumberArray(NSUInteger count) {
 	return [objectSet allObjects];
 }
 
+// Times the bulk operations that can be divided between workers, with 1 to 16 workers
+void benchmarkParallelTree(Class testClass, NSUInteger size) {
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+	CHQuietLog(@"\n%@ (%lu objects)", testClass, (unsigned long)size);
+	NSArray *randomNumbers = randomNumberArray(size);
+	NSArray *sortedNumbers = [randomNumbers sortedArrayUsingSelector:@selector(compare:)];
+	NSMutableArray *halves[2] = {[NSMutableArray array], [NSMutableArray array]};
+	for (NSUInteger index = 0; index < size; index++)
+		[halves[index % 2] addObject:[sortedNumbers objectAtIndex:index]];
+	NSUInteger workerCounts[] = {1, 2, 4, 8, 16};
+	NSUInteger workers, grainSize = [testClass parallelGrainSize], workerCount = [testClass parallelWorkerCount];
+	CHBinarySearchTree *tree, *otherTree;
+	
+	[testClass setParallelGrainSize:4096];
+	printf("(Workers)           ");
+	for (workers = 0; workers < sizeof(workerCounts) / sizeof(workerCounts[0]); workers++)
+		printf("\t%-8lu", (unsigned long)workerCounts[workers]);
+	
+	printf("\ninitWithArray:      ");
+	for (workers = 0; workers < sizeof(workerCounts) / sizeof(workerCounts[0]); workers++) {
+		[testClass setParallelWorkerCount:workerCounts[workers]];
+		startTime = timestamp();
+		tree = [[testClass alloc] initWithArray:randomNumbers];
+		printf("\t%f", timestamp() - startTime);
+		[tree release];
+	}
+	
+	printf("\ninitWithSortedArray:");
+	for (workers = 0; workers < sizeof(workerCounts) / sizeof(workerCounts[0]); workers++) {
+		[testClass setParallelWorkerCount:workerCounts[workers]];
+		startTime = timestamp();
+		tree = [[testClass alloc] initWithSortedArray:sortedNumbers];
+		printf("\t%f", timestamp() - startTime);
+		[tree release];
+	}
+	
+	printf("\nunionWithSortedSet: ");
+	for (workers = 0; workers < sizeof(workerCounts) / sizeof(workerCounts[0]); workers++) {
+		[testClass setParallelWorkerCount:workerCounts[workers]];
+		tree = [[testClass alloc] initWithSortedArray:halves[0]];
+		otherTree = [[testClass alloc] initWithSortedArray:halves[1]];
+		startTime = timestamp();
+		[tree unionWithSortedSet:otherTree];
+		printf("\t%f", timestamp() - startTime);
+		[otherTree release];
+		[tree release];
+	}
+	
+	[testClass setParallelGrainSize:grainSize];
+	[testClass setParallelWorkerCount:workerCount];
+	CHQuietLog(@"");
+	[pool release];
+}
+
+// Times -member: on each mutable tree and on a frozen copy of it, with every object and as many absent ones
+void benchmarkFrozenTree(NSArray *testClasses, NSUInteger size) {
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+	CHQuietLog(@"\n-member: (%lu objects, %lu probes)", (unsigned long)size, (unsigned long)(2 * size));
+	NSArray *randomNumbers = randomNumberArray(2 * size);
+	NSArray *present = [randomNumbers subarrayWithRange:NSMakeRange(0, size)];
+	NSArray *probes = randomNumbers;
+	NSUInteger found;
+	id probe;
+	
+	printf("(Class)              \tTree    \tFrozen");
+	for (Class testClass in testClasses) {
+		CHBinarySearchTree *tree = [[testClass alloc] initWithArray:present];
+		CHFrozenSortedSet *frozen = [tree freeze];
+		printf("\n%-21s", class_getName(testClass));
+		
+		found = 0;
+		startTime = timestamp();
+		for (probe in probes)
+			if ([tree member:probe] != nil)
+				found++;
+		printf("\t%f", timestamp() - startTime);
+		
+		found = 0;
+		startTime = timestamp();
+		for (probe in probes)
+			if ([frozen member:probe] != nil)
+				found++;
+		printf("\t%f", timestamp() - startTime);
+		if (found != size)
+			printf(" (found %lu)", (unsigned long)found);
+		[tree release];
+	}
+	CHQuietLog(@"");
+	[pool release];
+}
+
+// Times adding and searching for integers in boxed trees of NSNumbers and in a set of unboxed integers, through both of its interfaces
+void benchmarkPrimitiveSortedSet(NSUInteger size) {
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+	CHQuietLog(@"\nInt64 keys (%lu keys)", (unsigned long)size);
+	NSArray *randomNumbers = randomNumberArray(size);
+	int64_t *integers = malloc(sizeof(int64_t) * size);
+	NSUInteger index, found;
+	for (index = 0; index < size; index++)
+		integers[index] = [[randomNumbers objectAtIndex:index] longLongValue];
+	id number;
+	
+	printf("(Class)                   \tadd     \tcontains");
+	NSArray *treeClasses = [NSArray arrayWithObjects:[CHAVLTree class], [CHRedBlackTree class], [CHInt64SortedSet class], nil];
+	for (Class testClass in treeClasses) {
+		id<CHSortedSet> set = [[testClass alloc] init];
+		printf("\n%-26s", class_getName(testClass));
+		startTime = timestamp();
+		for (number in randomNumbers)
+			[set addObject:number];
+		printf("\t%f", timestamp() - startTime);
+		found = 0;
+		startTime = timestamp();
+		for (number in randomNumbers)
+			if ([set containsObject:number])
+				found++;
+		printf("\t%f", timestamp() - startTime);
+		if (found != size)
+			printf(" (found %lu)", (unsigned long)found);
+		[set release];
+	}
+	
+	CHInt64SortedSet *primitiveSet = [[CHInt64SortedSet alloc] init];
+	printf("\n%-26s", "CHInt64SortedSet (int64_t)");
+	startTime = timestamp();
+	for (index = 0; index < size; index++)
+		[primitiveSet addInt64:integers[index]];
+	printf("\t%f", timestamp() - startTime);
+	found = 0;
+	startTime = timestamp();
+	for (index = 0; index < size; index++)
+		if ([primitiveSet containsInt64:integers[index]])
+			found++;
+	printf("\t%f", timestamp() - startTime);
+	if (found != size)
+		printf(" (found %lu)", (unsigned long)found);
+	[primitiveSet release];
+	
+	free(integers);
+	CHQuietLog(@"");
+	[pool release];
+}
+
+// Times a skip list against the search trees, adding random objects and an ascending feed, then searching, indexing and removing. The binary
+// search trees record subtree sizes, so that -objectAtIndex: takes O(log n) time in every class that has it.
+void benchmarkSkipList(NSUInteger size) {
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+	CHQuietLog(@"\n%lu objects", (unsigned long)size);
+	NSArray *randomNumbers = randomNumberArray(size);
+	NSMutableArray *ascending = [NSMutableArray arrayWithCapacity:size];
+	NSUInteger index, found;
+	for (index = 0; index < size; index++)
+		[ascending addObject:[NSNumber numberWithUnsignedInteger:index]];
+	id number;
+	
+	printf("(Class)              \tadd     \tadd (in order)\tmember  \tobjectAtIndex\tremove");
+	NSArray *testClasses = [NSArray arrayWithObjects:[CHAVLTree class], [CHRedBlackTree class], [CHTreap class],
+	                        [CHBPlusTree class], [CHSkipList class], nil];
+	for (Class testClass in testClasses) {
+		BOOL binaryTree = [testClass isSubclassOfClass:[CHAbstractBinarySearchTree class]];
+		id<CHSortedSet> set = binaryTree ? [[testClass alloc] initWithTreeOptions:CHTreeOptionsOrderStatistics] : [[testClass alloc] init];
+		printf("\n%-21s", class_getName(testClass));
+		startTime = timestamp();
+		for (number in randomNumbers)
+			[set addObject:number];
+		printf("\t%f", timestamp() - startTime);
+		[set release];
+		
+		set = binaryTree ? [[testClass alloc] initWithTreeOptions:CHTreeOptionsOrderStatistics] : [[testClass alloc] init];
+		startTime = timestamp();
+		for (number in ascending)
+			[set addObject:number];
+		printf("\t%f    ", timestamp() - startTime);
+		
+		found = 0;
+		startTime = timestamp();
+		for (number in randomNumbers)
+			if ([set member:number] != nil)
+				found++;
+		printf("\t%f", timestamp() - startTime);
+		
+		if ([set respondsToSelector:@selector(objectAtIndex:)]) {
+			startTime = timestamp();
+			for (index = 0; index < size; index++)
+				[(id)set objectAtIndex:(index * 7919) % size];
+			printf("\t%f    ", timestamp() - startTime);
+		} else
+			printf("\t--          ");
+		
+		startTime = timestamp();
+		for (number in randomNumbers)
+			[set removeObject:number];
+		printf("\t%f", timestamp() - startTime);
+		if (found != size || [set count] != 0)
+			printf(" (found %lu, left %lu)", (unsigned long)found, (unsigned long)[set count]);
+		[set release];
+	}
+	CHQuietLog(@"");
+	[pool release];
+}
+
+// Times writer threads adding the same objects in total to a concurrent skip list, and to a red-black tree behind a single lock, then
+// removing half of them
+void benchmarkConcurrentWriters(NSUInteger size) {
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+	CHQuietLog(@"\n%lu objects added and %lu removed by all threads", (unsigned long)size, (unsigned long)(size / 2));
+	NSArray *randomNumbers = randomNumberArray(size);
+	NSCondition *condition = [[NSCondition alloc] init];
+	NSUInteger threadCounts[] = {1, 2, 4, 8}, threadCount, thread, running, slice, remaining;
+	
+	printf("(Class)                    \t1 thread \t2 threads\t4 threads\t8 threads");
+	NSArray *testClasses = [NSArray arrayWithObjects:[CHRedBlackTree class], [CHConcurrentSkipListSet class], nil];
+	for (Class testClass in testClasses) {
+		BOOL locked = ![testClass isSubclassOfClass:[CHConcurrentSkipListSet class]];
+		printf("\n%-27s", locked ? [[NSString stringWithFormat:@"%s (locked)", class_getName(testClass)] UTF8String] : class_getName(testClass));
+		for (NSUInteger test = 0; test < sizeof(threadCounts) / sizeof(threadCounts[0]); test++) {
+			threadCount = threadCounts[test];
+			id<CHSortedSet> set = [[testClass alloc] init];
+			NSLock *lock = locked ? [[NSLock alloc] init] : nil;
+			NSMutableArray *writers = [NSMutableArray array];
+			slice = size / threadCount;
+			remaining = size;
+			for (thread = 0; thread < threadCount; thread++) {
+				NSArray *numbers = [randomNumbers subarrayWithRange:NSMakeRange(thread * slice, (thread + 1 == threadCount) ? size - thread * slice : slice)];
+				remaining -= ([numbers count] + 1) / 2;
+				[writers addObject:[[[ConcurrentWriter alloc] initWithSet:set lock:lock numbers:numbers condition:condition running:&running] autorelease]];
+			}
+			running = threadCount;
+			startTime = timestamp();
+			for (ConcurrentWriter *writer in writers)
+				[NSThread detachNewThreadSelector:@selector(run:) toTarget:writer withObject:nil];
+			[condition lock];
+			while (running != 0)
+				[condition wait];
+			[condition unlock];
+			printf("\t%f", timestamp() - startTime);
+			if ([set count] != remaining)
+				printf(" (left %lu)", (unsigned long)[set count]);
+			[lock release];
+			[set release];
+		}
+	}
+	[condition release];
+	CHQuietLog(@"");
+	[pool release];
+}
+
+// Times reader threads each looking up the same number of objects in a shared tree, synchronizing on the tree around each lookup, and in the
+// same tree behind a concurrent sorted set facade, whose readers share a readers-writer lock
+void benchmarkConcurrentReaders(NSUInteger size, NSUInteger lookups) {
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+	CHQuietLog(@"\n%lu objects, %lu lookups by each thread", (unsigned long)size, (unsigned long)lookups);
+	NSArray *randomNumbers = randomNumberArray(size);
+	NSArray *probes = [randomNumbers subarrayWithRange:NSMakeRange(0, MIN(size, lookups))];
+	NSCondition *condition = [[NSCondition alloc] init];
+	NSUInteger threadCounts[] = {1, 4, 8, 16, 32}, threadCount, thread, running;
+	
+	printf("(Class)                    \t1 thread \t4 threads\t8 threads\t16 threads\t32 threads");
+	NSArray *testClasses = [NSArray arrayWithObjects:[CHAVLTree class], [CHConcurrentSortedSet class], nil];
+	for (Class testClass in testClasses) {
+		BOOL synchronize = ![testClass isSubclassOfClass:[CHConcurrentSortedSet class]];
+		printf("\n%-27s", synchronize ? [[NSString stringWithFormat:@"%s (@synchronized)", class_getName(testClass)] UTF8String] : class_getName(testClass));
+		id<CHSortedSet> set = [[testClass alloc] initWithArray:randomNumbers];
+		for (NSUInteger test = 0; test < sizeof(threadCounts) / sizeof(threadCounts[0]); test++) {
+			threadCount = threadCounts[test];
+			NSMutableArray *readers = [NSMutableArray array];
+			for (thread = 0; thread < threadCount; thread++)
+				[readers addObject:[[[ConcurrentReader alloc] initWithSet:set synchronize:synchronize numbers:probes condition:condition running:&running] autorelease]];
+			running = threadCount;
+			startTime = timestamp();
+			for (ConcurrentReader *reader in readers)
+				[NSThread detachNewThreadSelector:@selector(run:) toTarget:reader withObject:nil];
+			[condition lock];
+			while (running != 0)
+				[condition wait];
+			[condition unlock];
+			printf("\t%f", timestamp() - startTime);
+		}
+		[set release];
+	}
+	[condition release];
+	CHQuietLog(@"");
+	[pool release];
+}
+
+// Times taking a copy of a tree as a snapshot, then making 100 changes to the tree while every snapshot is kept, as for a table that is
+// copied whenever its configuration is reloaded, with and without CHTreeOptionsPersistent
+void benchmarkSnapshots(NSUInteger size, NSUInteger snapshots) {
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+	CHQuietLog(@"\n%lu objects, %lu snapshots, 100 changes after each", (unsigned long)size, (unsigned long)snapshots);
+	NSArray *randomNumbers = randomNumberArray(size + 100 * snapshots);
+	NSArray *present = [randomNumbers subarrayWithRange:NSMakeRange(0, size)];
+	unsigned int options[] = {0, CHTreeOptionsPersistent};
+	
+	printf("(Class)              \tOptions   \tCopy    \tChange");
+	NSArray *testClasses = [NSArray arrayWithObjects:[CHAVLTree class], [CHRedBlackTree class], nil];
+	for (Class testClass in testClasses) {
+		for (NSUInteger option = 0; option < sizeof(options) / sizeof(options[0]); option++) {
+			CHBinarySearchTree *tree = [[testClass alloc] initWithTreeOptions:options[option]];
+			[tree addObjectsFromArray:present];
+			NSMutableArray *copies = [NSMutableArray arrayWithCapacity:snapshots];
+			double copyTime = 0, changeTime = 0;
+			NSUInteger added = size, removed = 0;
+			for (NSUInteger snapshot = 0; snapshot < snapshots; snapshot++) {
+				startTime = timestamp();
+				id copy = [tree copy];
+				copyTime += timestamp() - startTime;
+				[copies addObject:copy];
+				[copy release];
+				startTime = timestamp();
+				for (NSUInteger change = 0; change < 50; change++) {
+					[tree addObject:[randomNumbers objectAtIndex:added++]];
+					[tree removeObject:[present objectAtIndex:removed++ % size]];
+				}
+				changeTime += timestamp() - startTime;
+			}
+			printf("\n%-21s\t%-10s\t%f\t%f", class_getName(testClass), options[option] ? "Persistent" : "None", copyTime, changeTime);
+			[tree release];
+		}
+	}
+	CHQuietLog(@"");
+	[pool release];
+}
+
+// Compares -copy, which clones the tree node for node, with adding each object to a new tree in level order, as -copy used to.
+void benchmarkCopy(NSUInteger size) {
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+	CHQuietLog(@"\n%lu objects", (unsigned long)size);
+	NSArray *randomNumbers = randomNumberArray(size);
+	
+	printf("(Class)              \tRe-insert \tCopy");
+	NSArray *testClasses = [NSArray arrayWithObjects:[CHAnderssonTree class], [CHAVLTree class], [CHRedBlackTree class],
+	                        [CHTreap class], [CHUnbalancedTree class], nil];
+	for (Class testClass in testClasses) {
+		CHBinarySearchTree *tree = [[testClass alloc] init];
+		[tree addObjectsFromArray:randomNumbers];
+		startTime = timestamp();
+		CHBinarySearchTree *rebuilt = [[testClass alloc] initWithCapacity:[tree count]];
+		for (id anObject in [tree allObjectsWithTraversalOrder:CHTraverseLevelOrder])
+			[rebuilt addObject:anObject];
+		double rebuildTime = timestamp() - startTime;
+		startTime = timestamp();
+		id copy = [tree copy];
+		double copyTime = timestamp() - startTime;
+		printf("\n%-21s\t%f\t%f", class_getName(testClass), rebuildTime, copyTime);
+		[copy release];
+		[rebuilt release];
+		[tree release];
+	}
+	CHQuietLog(@"");
+	[pool release];
+}
+
+// Compares sending -member: for each probe with -membersForObjects:, for probes in random order, found by interleaved descents, and in ascending order, found by one shared descent.
+void benchmarkBatchedMembership(NSUInteger size) {
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+	CHQuietLog(@"\n%lu objects, %lu probes", (unsigned long)size, (unsigned long)(2 * size));
+	NSArray *randomNumbers = randomNumberArray(2 * size);
+	NSArray *present = [randomNumbers subarrayWithRange:NSMakeRange(0, size)];
+	NSArray *sortedProbes = [randomNumbers sortedArrayUsingSelector:@selector(compare:)];
+	
+	printf("(Class)              \t-member:  \tRandom    \tSorted");
+	NSArray *testClasses = [NSArray arrayWithObjects:[CHAnderssonTree class], [CHAVLTree class], [CHRedBlackTree class],
+	                        [CHTreap class], nil];
+	for (Class testClass in testClasses) {
+		CHBinarySearchTree *tree = [[testClass alloc] initWithArray:present];
+		printf("\n%-21s", class_getName(testClass));
+		
+		startTime = timestamp();
+		for (id probe in randomNumbers)
+			[tree member:probe];
+		printf("\t%f", timestamp() - startTime);
+		
+		startTime = timestamp();
+		[tree membersForObjects:randomNumbers];
+		printf("\t%f", timestamp() - startTime);
+		
+		startTime = timestamp();
+		[tree membersForObjects:sortedProbes];
+		printf("\t%f", timestamp() - startTime);
+		[tree release];
+	}
+	CHQuietLog(@"");
+	[pool release];
+}
+
+// Compares -addObject: with -addObject:hint:, passing the same cursor each time, for objects added in ascending order, in nearly ascending
+// order (each of a run of 16 swapped with another in the run), and in random order. Ascending objects take the append fast path of -addObject: too.
+void benchmarkHintedInsertion(NSUInteger size) {
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+	CHQuietLog(@"\n%lu objects", (unsigned long)size);
+	NSArray *randomNumbers = randomNumberArray(size);
+	NSArray *sortedNumbers = [randomNumbers sortedArrayUsingSelector:@selector(compare:)];
+	NSMutableArray *nearlySortedNumbers = [NSMutableArray arrayWithArray:sortedNumbers];
+	for (NSUInteger index = 0; index + 16 <= size; index += 16)
+		[nearlySortedNumbers exchangeObjectAtIndex:index + (index * 7) % 16 withObjectAtIndex:index + (index * 13 + 5) % 16];
+	NSArray *inputs = [NSArray arrayWithObjects:sortedNumbers, nearlySortedNumbers, randomNumbers, nil];
+	const char *inputNames[] = {"Sorted", "Nearly sorted", "Random"};
+	
+	printf("(Class)              \t(Input)       \t-addObject:\t-addObject:hint:");
+	NSArray *testClasses = [NSArray arrayWithObjects:[CHAVLTree class], [CHRedBlackTree class], nil];
+	for (Class testClass in testClasses) {
+		for (NSUInteger input = 0; input < [inputs count]; input++) {
+			NSArray *numbers = [inputs objectAtIndex:input];
+			CHBinarySearchTree *tree = [[testClass alloc] init];
+			startTime = timestamp();
+			for (id anObject in numbers)
+				[tree addObject:anObject];
+			double addTime = timestamp() - startTime;
+			[tree release];
+			
+			tree = [[testClass alloc] init];
+			startTime = timestamp();
+			CHBinarySearchTreeCursor *cursor = [tree cursorAtObject:nil];
+			for (id anObject in numbers)
+				[tree addObject:anObject hint:cursor];
+			double hintTime = timestamp() - startTime;
+			printf("\n%-21s\t%-14s\t%f\t%f", class_getName(testClass), inputNames[input], addTime, hintTime);
+			[tree release];
+		}
+	}
+	CHQuietLog(@"");
+	[pool release];
+}
+
 int main (int argc, const char * argv[]) {
 	(void) argc;					/* CJEC, 3-Jul-13: Avoid unused parameter compiler warning */
 	(void) argv;					/* CJEC, 3-Jul-13: Avoid unused parameter compiler warning */
@@ -509,8 +1244,46 @@ int main (int argc, const char * argv[]) {
 	benchmarkTree ([CHAVLTree class]);
 	benchmarkTree ([CHRedBlackTree class]);
 	benchmarkTree ([CHTreap class]);
+	benchmarkTree ([CHBPlusTree class]);
 //	benchmarkTree ([CHUnbalancedTree class]);
 	
+	CHQuietLog(@"\n<CHSearchTree> Parallel bulk operations");
+	benchmarkParallelTree ([CHAVLTree class], 1000000);
+	benchmarkParallelTree ([CHRedBlackTree class], 1000000);
+	
+	CHQuietLog(@"\n<CHSortedSet> Frozen search trees");
+	NSArray *mutableTreeClasses = [NSArray arrayWithObjects:[CHAnderssonTree class], [CHAVLTree class], [CHRedBlackTree class],
+	                               [CHTreap class], [CHUnbalancedTree class], nil];
+	benchmarkFrozenTree (mutableTreeClasses, 1000);
+	benchmarkFrozenTree (mutableTreeClasses, 1000000);
+	
+	CHQuietLog(@"\n<CHSortedSet> Unboxed keys");
+	benchmarkPrimitiveSortedSet (100000);
+	benchmarkPrimitiveSortedSet (1000000);
+	
+	CHQuietLog(@"\n<CHSortedSet> Skip list");
+	benchmarkSkipList (100000);
+	benchmarkSkipList (1000000);
+	
+	CHQuietLog(@"\n<CHSortedSet> Concurrent writers");
+	benchmarkConcurrentWriters (1000000);
+	
+	CHQuietLog(@"\n<CHSortedSet> Concurrent readers");
+	benchmarkConcurrentReaders (100000, 100000);
+	
+	CHQuietLog(@"\n<CHSearchTree> Snapshots");
+	benchmarkSnapshots (100000, 100);
+	
+	CHQuietLog(@"\n<CHSearchTree> Copying");
+	benchmarkCopy (1000000);
+	
+	CHQuietLog(@"\n<CHSearchTree> Batched membership");
+	benchmarkBatchedMembership (1000);
+	benchmarkBatchedMembership (1000000);
+	
+	CHQuietLog(@"\n<CHSearchTree> Hinted insertion");
+	benchmarkHintedInsertion (1000000);
+	
 	[objects release];
 	
 	
@@ -524,6 +1297,7 @@ int main (int argc, const char * argv[]) {
 							[CHRedBlackTree class],
 							[CHTreap class],
 							[CHUnbalancedTree class],
+							[CHBPlusTree class],
 							nil];
 	NSMutableDictionary *treeResults = [NSMutableDictionary dictionary];
 	NSMutableDictionary *dictionary;
@@ -539,7 +1313,7 @@ int main (int argc, const char * argv[]) {
 		[treeResults setObject:dictionary forKey:NSStringFromClass(aClass)];
 	}
 	
-	CHAbstractBinarySearchTree *tree;
+	id<CHSearchTree> tree;
 	double duration;
 	struct timespec sleepDelay = {0,1}, sleepRemain;
 	
@@ -593,7 +1367,7 @@ int main (int argc, const char * argv[]) {
 				if ([aClass conformsToProtocol:@protocol(CHSearchTree)])
 					[[dictionary objectForKey:@"height"] addObject:
 					 [NSString stringWithFormat:@"%lu,%lu",
-					  (unsigned long) jitteredSize, (unsigned long) [(CHBinarySearchTree *) tree height]]];
+					  (unsigned long) jitteredSize, (unsigned long) [(id) tree height]]];
 				
 				// removeObject:
 				nanosleep(&sleepDelay, &sleepRemain);
@@ -283,6 +283,51 @@ do { \
 	[buffer removeLastObject];
 }
 
+#if defined (__BLOCKS__)
+- (void) testEnumerateObjectsWithOptions {
+	// Wrap the buffer, so that the objects are stored in two segments.
+	[buffer addObjectsFromArray:fifteen];
+	for (int i = 0; i < 10; i++)
+		[buffer removeFirstObject];
+	for (int i = 16; i <= 25; i++)
+		[buffer addObject:[NSNumber numberWithInt:i]];
+	XCTAssertEqual([buffer capacity], (NSUInteger)16);
+	NSUInteger count = [buffer count];
+	NSMutableArray *visited = [NSMutableArray array];
+	[buffer enumerateObjectsUsingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
+		XCTAssertEqual(idx, [visited count]);
+		[visited addObject:obj];
+	}];
+	XCTAssertEqualObjects(visited, [buffer allObjects]);
+	
+	[visited removeAllObjects];
+	[buffer enumerateObjectsWithOptions:NSEnumerationReverse usingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
+		XCTAssertEqual(idx, count - 1 - [visited count]);
+		[visited addObject:obj];
+	}];
+	XCTAssertEqualObjects(visited, [[buffer reverseObjectEnumerator] allObjects]);
+	
+	// Each index is written by one call of the block, whichever thread it runs on.
+	id *slots = calloc(count, sizeof(id));
+	[buffer enumerateObjectsWithOptions:NSEnumerationConcurrent usingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
+		slots[idx] = obj;
+	}];
+	XCTAssertEqualObjects([NSArray arrayWithObjects:slots count:count], [buffer allObjects]);
+	free(slots);
+	
+	__block NSUInteger calls = 0;
+	[buffer enumerateObjectsUsingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
+		*stop = (++calls == 3);
+	}];
+	XCTAssertEqual(calls, (NSUInteger)3);
+	
+	XCTAssertThrows([buffer enumerateObjectsUsingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
+		[buffer addObject:obj];
+	}]);
+	XCTAssertThrows([buffer enumerateObjectsUsingBlock:nil]);
+}
+#endif	/* defined (__BLOCKS__) */
+
 - (void) testDescription {
 	XCTAssertEqualObjects([buffer description], [[buffer allObjects] description]);
 	[buffer addObjectsFromArray:abc];
@@ -22,6 +22,7 @@
 #import <XCTest/XCTest.h>
 
 #import "CHBidirectionalDictionary.h"
+#import "CHConcurrentSortedDictionary.h"
 #import "CHMutableDictionary.h"
 #import "CHMultiDictionary.h"
 #import "CHOrderedDictionary.h"
@@ -723,6 +724,70 @@ static NSArray* keyArray;
 
 #pragma mark -
 
+static void addNegativeKeys(NSMutableDictionary *dictionary, void *context) {
+	NSUInteger limit = *(NSUInteger*)context;
+	for (NSUInteger number = 1; number <= limit; number++)
+		[dictionary setObject:[dictionary objectForKey:[NSNumber numberWithUnsignedInteger:number]]
+		               forKey:[NSNumber numberWithInteger:-(NSInteger)number]];
+}
+
+@interface CHConcurrentSortedDictionaryTest : CHSortedDictionaryTest
+@end
+
+@implementation CHConcurrentSortedDictionaryTest
+
+- (void) setUp {
+	dictionary = [[[CHConcurrentSortedDictionary alloc] init] autorelease];
+	expectedKeyOrder = [keyArray sortedArrayUsingSelector:@selector(compare:)];
+}
+
+// Overridden since enumeration iterates a snapshot of the keys, and modifying the dictionary meanwhile does not raise an exception.
+- (void) testNSFastEnumeration {
+	NSUInteger limit = 32;
+	for (NSUInteger number = limit; number >= 1; number--)
+		[dictionary setObject:[NSNumber numberWithUnsignedInteger:number * 10] forKey:[NSNumber numberWithUnsignedInteger:number]];
+	NSUInteger expected = 1, count = 0;
+	XCTAssertNoThrow({
+		for (NSNumber *key in dictionary) {
+			XCTAssertEqual([key unsignedIntegerValue], expected++);
+			[dictionary removeObjectForKey:key];
+			[dictionary setObject:[NSNull null] forKey:[NSNumber numberWithInteger:-(NSInteger)expected]];
+			count++;
+		}
+	});
+	XCTAssertEqual(count, limit);
+	XCTAssertEqual([dictionary count], limit);
+	XCTAssertEqualObjects([dictionary firstKey], [NSNumber numberWithInteger:-(NSInteger)limit - 1]);
+	XCTAssertEqualObjects([[dictionary reverseKeyEnumerator] nextObject], [NSNumber numberWithInteger:-2]);
+}
+
+- (void) testBatchUpdates {
+	NSUInteger limit = 20;
+	for (NSUInteger number = 1; number <= limit; number++)
+		[dictionary setObject:[NSNumber numberWithUnsignedInteger:number * 10] forKey:[NSNumber numberWithUnsignedInteger:number]];
+	[dictionary performBatchUpdatesWithFunction:addNegativeKeys context:&limit];
+	XCTAssertEqual([dictionary count], limit * 2);
+	XCTAssertEqualObjects([dictionary firstKey], [NSNumber numberWithInteger:-20]);
+	XCTAssertEqualObjects([dictionary objectForKey:[NSNumber numberWithInteger:-20]], [NSNumber numberWithInt:200]);
+	XCTAssertEqualObjects([[dictionary objectEnumerator] nextObject], [NSNumber numberWithInt:200]);
+	XCTAssertEqualObjects([[dictionary copy] autorelease], dictionary);
+	XCTAssertEqualObjects(replicateWithNSCoding(dictionary), dictionary);
+#if defined (__BLOCKS__)
+	[dictionary performBatchUpdates:^(NSMutableDictionary *batch) {
+		for (id key in batch)
+			if ([key integerValue] < 0)
+				[batch removeObjectForKey:key];
+	}];
+	XCTAssertEqual([dictionary count], limit);
+	XCTAssertEqualObjects([dictionary firstKey], [NSNumber numberWithInt:1]);
+#endif	/* defined (__BLOCKS__) */
+	XCTAssertThrows([dictionary performBatchUpdatesWithFunction:NULL context:NULL]);
+}
+
+@end
+
+#pragma mark -
+
 @interface CHOrderedDictionaryTest : CHDictionaryWithOrderingTest
 @end
 
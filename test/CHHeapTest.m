@@ -166,6 +166,44 @@
 	}
 }
 
+#if defined (__BLOCKS__)
+// CHBinaryHeap passes its objects in sorted order, and CHMutableArrayHeap in the order of -objectAtIndex:
+- (void) testEnumerateObjectsWithOptions {
+	NSEnumerator *classes = [heapClasses objectEnumerator];
+	Class aClass;
+	NSUInteger limit = 32;
+	while (aClass = [classes nextObject]) {
+		heap = [[[aClass alloc] init] autorelease];
+		for (NSUInteger number = 1; number <= limit; number++)
+			[heap addObject:[NSNumber numberWithUnsignedInteger:number]];
+		NSArray *expected = [heap isKindOfClass:[CHBinaryHeap class]] ? [heap allObjectsInSortedOrder] : [heap allObjects];
+		NSMutableArray *visited = [NSMutableArray array];
+		[heap enumerateObjectsUsingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
+			XCTAssertEqual(idx, [visited count]);
+			[visited addObject:obj];
+		}];
+		XCTAssertEqualObjects(visited, expected);
+		
+		[visited removeAllObjects];
+		[heap enumerateObjectsWithOptions:NSEnumerationReverse usingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
+			XCTAssertEqual(idx, limit - 1 - [visited count]);
+			[visited addObject:obj];
+		}];
+		XCTAssertEqualObjects(visited, [[expected reverseObjectEnumerator] allObjects]);
+		
+		// Each index is written by one call of the block, whichever thread it runs on.
+		id *slots = calloc(limit, sizeof(id));
+		[heap enumerateObjectsWithOptions:NSEnumerationConcurrent usingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
+			slots[idx] = obj;
+		}];
+		XCTAssertEqualObjects([NSArray arrayWithObjects:slots count:limit], expected);
+		free(slots);
+		
+		XCTAssertThrows([heap enumerateObjectsUsingBlock:nil]);
+	}
+}
+#endif	/* defined (__BLOCKS__) */
+
 #pragma mark -
 
 - (void) testInitWithArray {
@@ -102,6 +102,51 @@
 	}
 }
 
+#if defined (__BLOCKS__)
+- (void) testEnumerateObjectsWithOptions {
+	NSEnumerator *classes = [linkedListClasses objectEnumerator];
+	Class aClass;
+	while (aClass = [classes nextObject]) {
+		list = [[[aClass alloc] init] autorelease];
+		NSUInteger number, count = 32;
+		for (number = 0; number < count; number++)
+			[list addObject:[NSNumber numberWithUnsignedInteger:number]];
+		__block NSUInteger calls = 0;
+		[list enumerateObjectsUsingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
+			XCTAssertEqual([obj unsignedIntegerValue], idx);
+			XCTAssertEqual(idx, calls++);
+		}];
+		XCTAssertEqual(calls, count);
+		
+		calls = 0;
+		[list enumerateObjectsWithOptions:NSEnumerationReverse usingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
+			XCTAssertEqual([obj unsignedIntegerValue], idx);
+			XCTAssertEqual(idx, count - 1 - calls++);
+		}];
+		XCTAssertEqual(calls, count);
+		
+		// Each index is written by one call of the block, whichever thread it runs on.
+		id *slots = calloc(count, sizeof(id));
+		[list enumerateObjectsWithOptions:NSEnumerationConcurrent usingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
+			slots[idx] = obj;
+		}];
+		XCTAssertEqualObjects([NSArray arrayWithObjects:slots count:count], [list allObjects]);
+		free(slots);
+		
+		calls = 0;
+		[list enumerateObjectsWithOptions:NSEnumerationReverse usingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
+			*stop = (++calls == 3);
+		}];
+		XCTAssertEqual(calls, (NSUInteger)3);
+		
+		XCTAssertThrows([list enumerateObjectsUsingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
+			[list addObject:obj];
+		}]);
+		XCTAssertThrows([list enumerateObjectsUsingBlock:nil]);
+	}
+}
+#endif	/* defined (__BLOCKS__) */
+
 #pragma mark -
 
 - (void) testEmptyList {
@@ -25,6 +25,12 @@
 #import "CHAbstractBinarySearchTree_Internal.h"
 #import "CHAnderssonTree.h"
 #import "CHAVLTree.h"
+#import "CHBPlusTree.h"
+#import "CHSkipList.h"
+#import "CHConcurrentSkipListSet.h"
+#import "CHConcurrentSortedSet.h"
+#import "CHDoubleSortedSet.h"
+#import "CHInt64SortedSet.h"
 #import "CHRedBlackTree.h"
 #import "CHTreap.h"
 #import "CHUnbalancedTree.h"
@@ -34,6 +40,12 @@ static NSArray *abcde;
 #define NonConcreteClass() \
 ([self classUnderTest] == nil || [self classUnderTest] == [CHAbstractBinarySearchTree class])
 
+// Orders objects in reverse, so that tests can tell the comparator from -compare:
+static NSComparisonResult reverseCompare(id target, id argument, void *context) {
+	++*(NSUInteger*)context;
+	return [argument compare:target];
+}
+
 #pragma mark -
 
 @interface CHSortedSetTest : XCTestCase {
@@ -197,33 +209,13 @@ static NSArray *abcde;
 	if (NonConcreteClass())
 		return;
 	
-	// Enumerator shouldn't retain collection if there are no objects
-	XCTAssertEqual([set retainCount], (NSUInteger)1);
+	// Try with empty sorted set
 	e = [set objectEnumerator];
 	XCTAssertNotNil(e);
-	XCTAssertEqual([set retainCount], (NSUInteger)1);
 	XCTAssertNil([e nextObject]);
-
-	// Enumerator should retain collection when it has 1+ objects, release on 0
+	// Try with populated sorted set
 	[set addObjectsFromArray:abcde];
-	e = [set objectEnumerator];
-	XCTAssertNotNil(e);
-	XCTAssertEqual([set retainCount], (NSUInteger)2);
-	// Grab one object from the enumerator
-	[e nextObject];
-	XCTAssertEqual([set retainCount], (NSUInteger)2);
-	// Empty the enumerator of all objects
-	[e allObjects];
-	XCTAssertEqual([set retainCount], (NSUInteger)1);
-	
-	// Enumerator should release collection on -dealloc
-	NSAutoreleasePool *pool  = [[NSAutoreleasePool alloc] init];
-	XCTAssertEqual([set retainCount], (NSUInteger)1);
-	e = [set objectEnumerator];
-	XCTAssertNotNil(e);
-	XCTAssertEqual([set retainCount], (NSUInteger)2);
-	[pool release]; // Force deallocation of autoreleased enumerator
-	XCTAssertEqual([set retainCount], (NSUInteger)1);
+	XCTAssertEqualObjects([[set objectEnumerator] allObjects], abcde);
 	
 	// Test mutation in the middle of enumeration
 	e = [set objectEnumerator];
@@ -233,6 +225,24 @@ static NSArray *abcde;
 	XCTAssertThrows([e allObjects]);
 }
 
+- (void) testInitWithCompareFunction {
+	if (NonConcreteClass() || ![[self classUnderTest] instancesRespondToSelector:@selector(initWithCompareFunction:context:)])
+		return;
+	NSUInteger comparisons = 0;
+	set = [[[[self classUnderTest] alloc] initWithCompareFunction:reverseCompare context:&comparisons] autorelease];
+	[set addObjectsFromArray:abcde];
+	XCTAssertTrue(comparisons > 0);
+	XCTAssertEqualObjects([set allObjects], [[abcde reverseObjectEnumerator] allObjects]);
+	XCTAssertEqualObjects([set firstObject], @"E");
+	XCTAssertEqualObjects([set member:@"C"], @"C");
+	XCTAssertEqualObjects([[set subsetFromObject:@"D" toObject:@"B" options:0] allObjects],
+						  ([NSArray arrayWithObjects:@"D",@"C",@"B",nil]));
+	XCTAssertThrows([[[self classUnderTest] alloc] initWithCompareFunction:NULL context:NULL]);
+	
+	// A comparator function cannot be archived
+	XCTAssertThrows([NSKeyedArchiver archivedDataWithRootObject:set]);
+}
+
 - (void) testRemoveObject {
 	if ([set isMemberOfClass:[CHAbstractBinarySearchTree class]]) {
 		// This method should be unsupported in the abstract parent class.
@@ -424,7 +434,7 @@ static NSArray *abcde;
 	XCTAssertNotNil(copy);
 	XCTAssertEqual([copy count], [abcde count]);
 	XCTAssertEqual([set hash], [copy hash]);
-	if ([set conformsToProtocol:@protocol(CHSearchTree)] && [self classUnderTest] != [CHTreap class]) {
+	if ([set conformsToProtocol:@protocol(CHSearchTree)]) {
 		XCTAssertEqualObjects([set allObjectsWithTraversalOrder:CHTraverseLevelOrder],
 							 [copy allObjectsWithTraversalOrder:CHTraverseLevelOrder]);
 	} else {
@@ -506,6 +516,884 @@ static NSArray *abcde;
 	XCTAssertEqualObjects([set description], [[set allObjects] description]);
 }
 
+- (void) testObjectEnumeratorRetainCount {
+	if (NonConcreteClass())
+		return;
+	
+	// Enumerator shouldn't retain collection if there are no objects
+	XCTAssertEqual([set retainCount], (NSUInteger)1);
+	e = [set objectEnumerator];
+	XCTAssertNotNil(e);
+	XCTAssertEqual([set retainCount], (NSUInteger)1);
+	XCTAssertNil([e nextObject]);
+
+	// Enumerator should retain collection when it has 1+ objects, release on 0
+	[set addObjectsFromArray:abcde];
+	e = [set objectEnumerator];
+	XCTAssertNotNil(e);
+	XCTAssertEqual([set retainCount], (NSUInteger)2);
+	// Grab one object from the enumerator
+	[e nextObject];
+	XCTAssertEqual([set retainCount], (NSUInteger)2);
+	// Empty the enumerator of all objects
+	[e allObjects];
+	XCTAssertEqual([set retainCount], (NSUInteger)1);
+	
+	// Enumerator should release collection on -dealloc
+	NSAutoreleasePool *pool  = [[NSAutoreleasePool alloc] init];
+	XCTAssertEqual([set retainCount], (NSUInteger)1);
+	e = [set objectEnumerator];
+	XCTAssertNotNil(e);
+	XCTAssertEqual([set retainCount], (NSUInteger)2);
+	[pool release]; // Force deallocation of autoreleased enumerator
+	XCTAssertEqual([set retainCount], (NSUInteger)1);
+}
+
+- (void) testInitWithCompareFunction {
+	if ([self class] == [CHAbstractBinarySearchTreeTest class])
+		return;
+	NSUInteger comparisons = 0;
+	NSArray *edcba = [[abcde reverseObjectEnumerator] allObjects];
+	set = [[[[self classUnderTest] alloc] initWithCompareFunction:reverseCompare context:&comparisons] autorelease];
+	XCTAssertEqual([set comparatorKind], CHComparatorKindFunction);
+	[set addObjectsFromArray:abcde];
+	XCTAssertTrue(comparisons > 0);
+	XCTAssertEqualObjects([set allObjects], edcba);
+	XCTAssertEqualObjects([set firstObject], @"E");
+	XCTAssertEqualObjects([set member:@"C"], @"C");
+	XCTAssertNil([set member:@"Z"]);
+	XCTAssertEqualObjects([[set subsetFromObject:@"D" toObject:@"B" options:0] allObjects],
+						  ([NSArray arrayWithObjects:@"D",@"C",@"B",nil]));
+	
+	id copy = [[set copy] autorelease];
+	XCTAssertEqual([copy comparatorKind], CHComparatorKindFunction);
+	XCTAssertEqualObjects([copy allObjects], edcba);
+	
+	[set removeObject:@"C"];
+	XCTAssertEqualObjects([set allObjects], ([NSArray arrayWithObjects:@"E",@"D",@"B",@"A",nil]));
+	XCTAssertThrows([[[self classUnderTest] alloc] initWithCompareFunction:NULL context:NULL]);
+	
+	// A comparator function cannot be archived
+	XCTAssertThrows([NSKeyedArchiver archivedDataWithRootObject:set]);
+	
+	// The options and capacity may be given with the function
+	set = [[[[self classUnderTest] alloc] initWithTreeOptions:CHTreeOptionsOrderStatistics capacity:100
+	                                           compareFunction:reverseCompare context:&comparisons] autorelease];
+	XCTAssertEqual([set GetOptions], (unsigned int)CHTreeOptionsOrderStatistics);
+	XCTAssertEqual([set comparatorKind], CHComparatorKindFunction);
+	[set addObjectsFromArray:abcde];
+	XCTAssertEqualObjects([set allObjects], edcba);
+	XCTAssertEqualObjects([set objectAtIndex:1], @"D");
+}
+
+- (void) testInitWithCapacity {
+	if ([self class] == [CHAbstractBinarySearchTreeTest class])
+		return;
+	set = [[[[self classUnderTest] alloc] initWithCapacity:100] autorelease];
+	XCTAssertEqual([set count], (NSUInteger)0);
+	NSMutableArray *numbers = [NSMutableArray array];
+	for (NSUInteger number = 0; number < 1000; number++)
+		[numbers addObject:[NSNumber numberWithUnsignedInteger:number]];
+	// Fill past the first slab, free nodes, then reuse them
+	[set addObjectsFromArray:numbers];
+	XCTAssertEqual([set count], [numbers count]);
+	for (NSUInteger number = 0; number < 1000; number += 2)
+		[set removeObject:[numbers objectAtIndex:number]];
+	XCTAssertEqual([set count], (NSUInteger)500);
+	XCTAssertFalse([set containsObject:[numbers objectAtIndex:0]]);
+	XCTAssertTrue([set containsObject:[numbers objectAtIndex:1]]);
+	[set addObjectsFromArray:numbers];
+	XCTAssertEqualObjects([set allObjects], numbers);
+	// Remove everything at once and check that the tree is still usable
+	[set removeAllObjects];
+	XCTAssertEqual([set count], (NSUInteger)0);
+	XCTAssertNil([set firstObject]);
+	[set addObjectsFromArray:abcde];
+	XCTAssertEqualObjects([set allObjects], abcde);
+}
+
+- (void) testInitWithSortedArray {
+	if ([self class] == [CHAbstractBinarySearchTreeTest class])
+		return;
+	NSMutableArray *numbers = [NSMutableArray array];
+	// Cover complete and incomplete last levels of the built tree
+	for (NSUInteger size = 0; size <= 64; size++) {
+		set = [[[[self classUnderTest] alloc] initWithSortedArray:numbers] autorelease];
+		XCTAssertEqual([set count], size);
+		XCTAssertEqualObjects([set allObjects], numbers);
+		if ([set respondsToSelector:@selector(verify)])
+			XCTAssertNoThrow([set performSelector:@selector(verify)]);
+		[numbers addObject:[NSNumber numberWithUnsignedInteger:size]];
+	}
+	// The built tree is rebalanced as usual by later insertions and removals
+	for (NSUInteger number = 0; number < 64; number += 3) {
+		[set removeObject:[numbers objectAtIndex:number]];
+		[set addObject:[NSNumber numberWithUnsignedInteger:number + 100]];
+		if ([set respondsToSelector:@selector(verify)])
+			XCTAssertNoThrow([set performSelector:@selector(verify)]);
+	}
+	XCTAssertEqual([set count], [numbers count]);
+	
+	// Unsorted input, or input with duplicates, is added one object at a time
+	NSArray *edcba = [[abcde reverseObjectEnumerator] allObjects];
+	set = [[[[self classUnderTest] alloc] initWithSortedArray:edcba] autorelease];
+	XCTAssertEqualObjects([set allObjects], abcde);
+	set = [[[[self classUnderTest] alloc] initWithSortedArray:
+	        [NSArray arrayWithObjects:@"A",@"B",@"B",@"C",nil]] autorelease];
+	XCTAssertEqual([set count], (NSUInteger)3);
+	// Sorted input is also detected by -addObjectsFromArray: on an empty tree
+	set = [self createSet];
+	[set addObjectsFromArray:numbers];
+	XCTAssertEqualObjects([set allObjects], numbers);
+	if ([set respondsToSelector:@selector(verify)])
+		XCTAssertNoThrow([set performSelector:@selector(verify)]);
+	[set addObjectsFromArray:abcde];
+	XCTAssertEqual([set count], [numbers count] + [abcde count]);
+}
+
+- (void) testOrderStatistics {
+	if ([self class] == [CHAbstractBinarySearchTreeTest class])
+		return;
+	NSMutableArray *numbers = [NSMutableArray array];
+	for (NSUInteger number = 0; number < 200; number++)
+		[numbers addObject:[NSNumber numberWithUnsignedInteger:(number * 37) % 200]];
+	// The same answers with or without subtree counts
+	NSArray *options = [NSArray arrayWithObjects:[NSNumber numberWithUnsignedInt:0],
+	                    [NSNumber numberWithUnsignedInt:CHTreeOptionsOrderStatistics], nil];
+	for (NSNumber *option in options) {
+		set = [[[[self classUnderTest] alloc] initWithTreeOptions:[option unsignedIntValue]] autorelease];
+		XCTAssertThrows([set objectAtIndex:0]);
+		XCTAssertEqual([set indexOfObject:@"A"], (NSUInteger)NSNotFound);
+		XCTAssertEqual([set countOfObjectsFromObject:nil toObject:nil], (NSUInteger)0);
+		// Insert in scrambled order, then remove every third object, to exercise rotations
+		[set addObjectsFromArray:numbers];
+		for (NSUInteger number = 0; number < 200; number += 3)
+			[set removeObject:[NSNumber numberWithUnsignedInteger:number]];
+		NSArray *sorted = [set allObjects];
+		XCTAssertEqual([sorted count], (NSUInteger)133);
+		for (NSUInteger index = 0; index < [sorted count]; index++) {
+			XCTAssertEqualObjects([set objectAtIndex:index], [sorted objectAtIndex:index]);
+			XCTAssertEqual([set indexOfObject:[sorted objectAtIndex:index]], index);
+		}
+		XCTAssertThrows([set objectAtIndex:[sorted count]]);
+		XCTAssertEqual([set indexOfObject:[NSNumber numberWithUnsignedInteger:3]], (NSUInteger)NSNotFound);
+		XCTAssertEqual([set indexOfObject:nil], (NSUInteger)NSNotFound);
+		
+		NSNumber *ten = [NSNumber numberWithUnsignedInteger:10];
+		NSNumber *twenty = [NSNumber numberWithUnsignedInteger:20];
+		// 10, 11, 13, 14, 16, 17, 19, 20 remain between 10 and 20
+		XCTAssertEqual([set countOfObjectsFromObject:ten toObject:twenty], (NSUInteger)8);
+		XCTAssertEqual([set countOfObjectsFromObject:twenty toObject:ten],
+		               [[set subsetFromObject:twenty toObject:ten] count]);
+		XCTAssertEqual([set countOfObjectsFromObject:nil toObject:ten],
+		               [[set subsetFromObject:nil toObject:ten] count]);
+		XCTAssertEqual([set countOfObjectsFromObject:ten toObject:nil],
+		               [[set subsetFromObject:ten toObject:nil] count]);
+		XCTAssertEqual([set countOfObjectsFromObject:nil toObject:nil], [set count]);
+		
+		// Counts are also set when sorted input is built directly
+		[set removeAllObjects];
+		[set addObjectsFromArray:sorted];
+		for (NSUInteger index = 0; index < [sorted count]; index += 7)
+			XCTAssertEqualObjects([set objectAtIndex:index], [sorted objectAtIndex:index]);
+		XCTAssertEqual([set indexOfObject:[sorted lastObject]], [sorted count] - 1);
+	}
+}
+
+- (void) testSubsetRangeView {
+	if ([self class] == [CHAbstractBinarySearchTreeTest class])
+		return;
+	NSMutableArray *numbers = [NSMutableArray array];
+	for (NSUInteger number = 0; number < 100; number++)
+		[numbers addObject:[NSNumber numberWithUnsignedInteger:(number * 37) % 100]];
+	NSMutableArray *expected = [NSMutableArray array];
+	for (NSUInteger number = 10; number <= 20; number++)
+		[expected addObject:[NSNumber numberWithUnsignedInteger:number]];
+	NSNumber *ten = [NSNumber numberWithUnsignedInteger:10];
+	NSNumber *twenty = [NSNumber numberWithUnsignedInteger:20];
+	NSNumber *fifteen = [NSNumber numberWithUnsignedInteger:15];
+	NSNumber *fifty = [NSNumber numberWithUnsignedInteger:50];
+	// The same answers with or without subtree counts
+	NSArray *options = [NSArray arrayWithObjects:[NSNumber numberWithUnsignedInt:0],
+	                    [NSNumber numberWithUnsignedInt:CHTreeOptionsOrderStatistics], nil];
+	for (NSNumber *option in options) {
+		set = [[[[self classUnderTest] alloc] initWithTreeOptions:[option unsignedIntValue]] autorelease];
+		[set addObjectsFromArray:numbers];
+		id<CHSortedSet> view = [set subsetFromObject:ten toObject:twenty options:0];
+		XCTAssertEqual([view count], (NSUInteger)11);
+		XCTAssertEqualObjects([view allObjects], expected);
+		XCTAssertEqualObjects([[view reverseObjectEnumerator] allObjects],
+		                      [[expected reverseObjectEnumerator] allObjects]);
+		NSMutableArray *enumerated = [NSMutableArray array];
+		for (id anObject in view)
+			[enumerated addObject:anObject];
+		XCTAssertEqualObjects(enumerated, expected);
+		XCTAssertEqualObjects([view firstObject], ten);
+		XCTAssertEqualObjects([view lastObject], twenty);
+		XCTAssertEqualObjects([view member:fifteen], fifteen);
+		XCTAssertNil([view member:fifty]);
+		XCTAssertFalse([view containsObject:fifty]);
+		
+		// Excluded endpoints, and a range within the view
+		view = [set subsetFromObject:ten toObject:twenty
+		                     options:CHSubsetExcludeLowEndpoint|CHSubsetExcludeHighEndpoint];
+		XCTAssertEqual([view count], (NSUInteger)9);
+		XCTAssertNil([view member:ten]);
+		XCTAssertEqualObjects([view firstObject], [expected objectAtIndex:1]);
+		id<CHSortedSet> subview = [view subsetFromObject:fifteen toObject:fifty options:0];
+		XCTAssertEqualObjects([subview allObjects],
+		                      [expected subarrayWithRange:NSMakeRange(5, 5)]);
+		XCTAssertEqual([[set subsetFromObject:fifteen toObject:fifteen
+		                              options:CHSubsetExcludeLowEndpoint] count], (NSUInteger)0);
+		
+		// A view is read-only, but a copy is an independent tree
+		XCTAssertThrows([view addObject:fifty]);
+		XCTAssertThrows([view removeObject:fifteen]);
+		XCTAssertThrows([view removeAllObjects]);
+		id copy = [[view copy] autorelease];
+		XCTAssertTrue([copy isMemberOfClass:[self classUnderTest]]);
+		XCTAssertEqualObjects([copy allObjects], [view allObjects]);
+		if ([copy respondsToSelector:@selector(verify)])
+			XCTAssertNoThrow([copy performSelector:@selector(verify)]);
+		XCTAssertNoThrow([copy addObject:fifty]);
+		XCTAssertEqual([copy count], (NSUInteger)10);
+		
+		// Modifying the tree invalidates its views, but not their copies
+		NSEnumerator *e = [view objectEnumerator];
+		[set removeObject:fifteen];
+		XCTAssertThrows([view count]);
+		XCTAssertThrows([view allObjects]);
+		XCTAssertThrows([e nextObject]);
+		XCTAssertEqualObjects([copy member:fifteen], fifteen);
+		XCTAssertEqualObjects([[set subsetFromObject:ten toObject:twenty options:0] lastObject], twenty);
+	}
+}
+
+- (void) testCursor {
+	if ([self class] == [CHAbstractBinarySearchTreeTest class])
+		return;
+	set = [self createSet];
+	XCTAssertNil([set floorObject:@"A"]);
+	XCTAssertNil([[set cursorAtObject:nil] object]);
+	XCTAssertNil([[set cursorAtObject:nil] previous]);
+	
+	// Even numbers only, added in scrambled order
+	NSMutableArray *evens = [NSMutableArray array];
+	for (NSUInteger number = 0; number < 100; number++)
+		[set addObject:[NSNumber numberWithUnsignedInteger:((number * 37) % 100) * 2]];
+	for (NSUInteger number = 0; number < 200; number += 2)
+		[evens addObject:[NSNumber numberWithUnsignedInteger:number]];
+	NSNumber *ten = [NSNumber numberWithUnsignedInteger:10];
+	NSNumber *eleven = [NSNumber numberWithUnsignedInteger:11];
+	NSNumber *twelve = [NSNumber numberWithUnsignedInteger:12];
+	NSNumber *last = [evens lastObject];
+	XCTAssertEqualObjects([set floorObject:ten], ten);
+	XCTAssertEqualObjects([set floorObject:eleven], ten);
+	XCTAssertEqualObjects([set ceilingObject:eleven], twelve);
+	XCTAssertEqualObjects([set ceilingObject:last], last);
+	XCTAssertNil([set ceilingObject:[NSNumber numberWithUnsignedInteger:199]]);
+	XCTAssertNil([set floorObject:nil]);
+	
+	CHBinarySearchTreeCursor *cursor = [set cursorAtObject:ten];
+	XCTAssertEqualObjects([cursor object], ten);
+	XCTAssertEqualObjects([[set cursorAtObject:eleven] object], twelve);
+	XCTAssertEqualObjects([[set cursorAfterObject:ten] object], twelve);
+	XCTAssertEqualObjects([[set cursorAfterObject:eleven] previous], ten);
+	XCTAssertNil([[set cursorAfterObject:last] object]);
+	
+	// Walk to each end and back again
+	NSMutableArray *walked = [NSMutableArray array];
+	cursor = [set cursorAtObject:nil];
+	for (id anObject = [cursor object]; anObject != nil; anObject = [cursor next])
+		[walked addObject:anObject];
+	XCTAssertEqualObjects(walked, evens);
+	XCTAssertNil([cursor next]);
+	[walked removeAllObjects];
+	for (id anObject = [cursor previous]; anObject != nil; anObject = [cursor previous])
+		[walked insertObject:anObject atIndex:0];
+	XCTAssertEqualObjects(walked, evens);
+	XCTAssertEqualObjects([cursor next], [evens objectAtIndex:0]);
+	cursor = [set cursorAtObject:ten];
+	XCTAssertEqualObjects([cursor next], twelve);
+	XCTAssertEqualObjects([cursor previous], ten);
+	
+	// Modifying the tree invalidates its cursors
+	[set removeObject:twelve];
+	XCTAssertThrows([cursor object]);
+	XCTAssertThrows([cursor next]);
+	XCTAssertThrows([cursor previous]);
+}
+
+- (void) testSplitAndJoin {
+	if ([self class] == [CHAbstractBinarySearchTreeTest class])
+		return;
+	NSNumber *hundred = [NSNumber numberWithUnsignedInteger:100];
+	set = [self createSet];
+	if ([set isKindOfClass:[CHAnderssonTree class]]) {
+		XCTAssertThrows([set splitAtObject:hundred]);
+		XCTAssertThrows([set joinWithTree:[self createSet]]);
+		return;
+	}
+	NSMutableArray *numbers = [NSMutableArray array];
+	for (NSUInteger number = 0; number < 300; number++)
+		[numbers addObject:[NSNumber numberWithUnsignedInteger:(number * 37) % 300]];
+	NSArray *options = [NSArray arrayWithObjects:[NSNumber numberWithUnsignedInt:0],
+	                    [NSNumber numberWithUnsignedInt:CHTreeOptionsOrderStatistics], nil];
+	for (NSNumber *option in options) {
+		set = [[[[self classUnderTest] alloc] initWithTreeOptions:[option unsignedIntValue]] autorelease];
+		XCTAssertThrows([set splitAtObject:nil]);
+		XCTAssertEqual([[set splitAtObject:hundred] count], (NSUInteger)0);
+		[set addObjectsFromArray:numbers];
+		NSArray *sorted = [set allObjects];
+		
+		// Split at every tenth position, check both halves, then put them back together
+		for (NSUInteger index = 0; index <= 300; index += 10) {
+			NSNumber *split = [NSNumber numberWithUnsignedInteger:index];
+			id upper = [set splitAtObject:split];
+			XCTAssertEqual([set count], index);
+			XCTAssertEqual([upper count], 300 - index);
+			XCTAssertEqualObjects([set allObjects], [sorted subarrayWithRange:NSMakeRange(0, index)]);
+			XCTAssertEqualObjects([upper allObjects], [sorted subarrayWithRange:NSMakeRange(index, 300 - index)]);
+			if ([set respondsToSelector:@selector(verify)]) {
+				XCTAssertNoThrow([set performSelector:@selector(verify)]);
+				XCTAssertNoThrow([upper performSelector:@selector(verify)]);
+			}
+			if ([option unsignedIntValue] & CHTreeOptionsOrderStatistics && index < 300)
+				XCTAssertEqualObjects([upper objectAtIndex:0], split);
+			if (index > 0 && index < 300)
+				XCTAssertThrows([upper joinWithTree:set]); // Out of order
+			[set joinWithTree:upper];
+			XCTAssertEqual([upper count], (NSUInteger)0);
+			XCTAssertEqualObjects([set allObjects], sorted);
+			if ([set respondsToSelector:@selector(verify)])
+				XCTAssertNoThrow([set performSelector:@selector(verify)]);
+		}
+		
+		// Trees that were built separately can be joined, and both remain usable
+		id other = [[[[self classUnderTest] alloc] initWithTreeOptions:[option unsignedIntValue]] autorelease];
+		for (NSUInteger number = 300; number < 400; number++)
+			[other addObject:[NSNumber numberWithUnsignedInteger:number]];
+		id rest = [set splitAtObject:hundred];
+		[rest joinWithTree:other];
+		XCTAssertEqual([rest count], (NSUInteger)300);
+		XCTAssertEqualObjects([rest firstObject], hundred);
+		XCTAssertEqualObjects([rest lastObject], [NSNumber numberWithUnsignedInteger:399]);
+		if ([option unsignedIntValue] & CHTreeOptionsOrderStatistics)
+			XCTAssertEqual([rest indexOfObject:[NSNumber numberWithUnsignedInteger:300]], (NSUInteger)200);
+		if ([rest respondsToSelector:@selector(verify)])
+			XCTAssertNoThrow([rest performSelector:@selector(verify)]);
+		[other addObject:hundred];
+		[other removeObject:hundred];
+		[rest removeObject:hundred];
+		[set removeAllObjects];
+		XCTAssertEqual([rest count], (NSUInteger)299);
+		XCTAssertThrows([set joinWithTree:[CHUnbalancedTree class] == [self classUnderTest]
+		                                  ? (id)[[[CHAVLTree alloc] init] autorelease]
+		                                  : (id)[[[CHUnbalancedTree alloc] init] autorelease]]);
+	}
+}
+
+- (void) testPersistentSnapshots {
+	if ([self class] == [CHAbstractBinarySearchTreeTest class])
+		return;
+	Class treeClass = [self classUnderTest];
+	if (treeClass != [CHAVLTree class] && treeClass != [CHRedBlackTree class]) {
+		XCTAssertThrows([[treeClass alloc] initWithTreeOptions:CHTreeOptionsPersistent]);
+		return;
+	}
+	XCTAssertThrows([[treeClass alloc] initWithTreeOptions:CHTreeOptionsPersistent | CHTreeOptionsMultiLevel]);
+	NSArray *options = [NSArray arrayWithObjects:[NSNumber numberWithUnsignedInt:CHTreeOptionsPersistent],
+	                    [NSNumber numberWithUnsignedInt:CHTreeOptionsPersistent | CHTreeOptionsOrderStatistics], nil];
+	for (NSNumber *option in options) {
+		set = [[[treeClass alloc] initWithTreeOptions:[option unsignedIntValue]] autorelease];
+		for (NSUInteger number = 0; number < 300; number++)
+			[set addObject:[NSNumber numberWithUnsignedInteger:(number * 37) % 300]];
+		
+		// Each copy keeps the objects the tree had when it was copied, plus its own changes, while the tree and the other copies change
+		NSMutableArray *snapshots = [NSMutableArray array], *contents = [NSMutableArray array];
+		for (NSUInteger round = 0; round < 10; round++) {
+			id snapshot = [[set copy] autorelease];
+			NSNumber *own = [NSNumber numberWithInteger:-1 - (NSInteger)round];
+			NSMutableArray *expected = [NSMutableArray arrayWithObject:own];
+			[expected addObjectsFromArray:[set allObjects]];
+			[snapshot addObject:own];
+			[snapshot removeObject:[NSNumber numberWithInteger:1000]]; // Not found, so nothing changes
+			[snapshots addObject:snapshot];
+			[contents addObject:expected];
+			for (NSUInteger number = round; number < 300; number += 10)
+				[set removeObject:[NSNumber numberWithUnsignedInteger:number]];
+			for (NSUInteger number = 300 + round * 10; number < 310 + round * 10; number++)
+				[set addObject:[NSNumber numberWithUnsignedInteger:number]];
+		}
+		[set removeAllObjects];
+		XCTAssertEqual([set count], (NSUInteger)0);
+		for (NSUInteger index = 0; index < [snapshots count]; index++) {
+			id snapshot = [snapshots objectAtIndex:index];
+			NSArray *expected = [contents objectAtIndex:index];
+			XCTAssertEqual([snapshot count], [expected count]);
+			XCTAssertEqualObjects([snapshot allObjects], expected);
+			XCTAssertEqualObjects([snapshot member:[expected lastObject]], [expected lastObject]);
+			XCTAssertNil([snapshot member:[NSNumber numberWithInteger:1000]]);
+			if ([option unsignedIntValue] & CHTreeOptionsOrderStatistics) {
+				XCTAssertEqualObjects([snapshot objectAtIndex:1], [expected objectAtIndex:1]);
+				XCTAssertEqual([snapshot indexOfObject:[expected lastObject]], [expected count] - 1);
+			}
+			if ([snapshot respondsToSelector:@selector(verify)])
+				XCTAssertNoThrow([snapshot performSelector:@selector(verify)]);
+		}
+		
+		// Copies built in bulk share their nodes in the same way
+		set = [[[treeClass alloc] initWithTreeOptions:[option unsignedIntValue]] autorelease];
+		[set addObjectsFromArray:[contents objectAtIndex:0]];
+		id copy = [[set copy] autorelease];
+		[copy removeObject:[NSNumber numberWithInteger:-1]];
+		[set addObject:[NSNumber numberWithInteger:-2]];
+		XCTAssertEqual([set count], [copy count] + 2);
+		XCTAssertEqualObjects([set firstObject], [NSNumber numberWithInteger:-2]);
+		XCTAssertEqualObjects([copy firstObject], [NSNumber numberWithInteger:0]);
+		XCTAssertThrows([set splitAtObject:[NSNumber numberWithInteger:100]]);
+		XCTAssertThrows([copy joinWithTree:set]);
+	}
+}
+
+- (void) testStructuralCopy {
+	if ([self class] == [CHAbstractBinarySearchTreeTest class])
+		return;
+	NSArray *options = [NSArray arrayWithObjects:[NSNumber numberWithUnsignedInt:0],
+	                    [NSNumber numberWithUnsignedInt:CHTreeOptionsOrderStatistics], nil];
+	for (NSNumber *option in options) {
+		set = [[[[self classUnderTest] alloc] initWithTreeOptions:[option unsignedIntValue]] autorelease];
+		for (NSUInteger number = 0; number < 1000; number++)
+			[set addObject:[NSNumber numberWithUnsignedInteger:(number * 389) % 1000]];
+		for (NSUInteger number = 0; number < 1000; number += 3)
+			[set removeObject:[NSNumber numberWithUnsignedInteger:number]];
+		
+		// The copy has the same shape, so every traversal order matches, and the same balancing information
+		id copy = [[set copy] autorelease];
+		XCTAssertEqual([copy count], [set count]);
+		XCTAssertEqualObjects([copy allObjectsWithTraversalOrder:CHTraverseLevelOrder],
+		                      [set allObjectsWithTraversalOrder:CHTraverseLevelOrder]);
+		XCTAssertEqualObjects([copy allObjectsWithTraversalOrder:CHTraversePreOrder],
+		                      [set allObjectsWithTraversalOrder:CHTraversePreOrder]);
+		if ([copy respondsToSelector:@selector(verify)])
+			XCTAssertNoThrow([copy performSelector:@selector(verify)]);
+		if ([option unsignedIntValue] & CHTreeOptionsOrderStatistics) {
+			XCTAssertEqualObjects([copy objectAtIndex:100], [set objectAtIndex:100]);
+			XCTAssertEqual([copy indexOfObject:[set lastObject]], [set count] - 1);
+		}
+		
+		// Neither tree sees the other's changes
+		NSArray *before = [set allObjects];
+		for (NSUInteger number = 1; number < 1000; number += 3)
+			[copy removeObject:[NSNumber numberWithUnsignedInteger:number]];
+		[copy addObject:[NSNumber numberWithInteger:-1]];
+		XCTAssertEqualObjects([set allObjects], before);
+		XCTAssertEqual([copy count], [set count] - 332);
+		XCTAssertEqualObjects([copy firstObject], [NSNumber numberWithInteger:-1]);
+		if ([copy respondsToSelector:@selector(verify)])
+			XCTAssertNoThrow([copy performSelector:@selector(verify)]);
+		[set removeAllObjects];
+		XCTAssertEqual([copy count], [before count] - 332);
+		XCTAssertEqualObjects([copy member:[NSNumber numberWithUnsignedInteger:2]], [NSNumber numberWithUnsignedInteger:2]);
+	}
+}
+
+- (void) testNSFastEnumerationResume {
+	if ([self class] == [CHAbstractBinarySearchTreeTest class])
+		return;
+	// Added in order, an unbalanced tree is deeper than the path kept between batches, so its batches resume by searching instead
+	for (NSUInteger number = 0; number < 1000; number++)
+		[set addObject:[NSNumber numberWithUnsignedInteger:number]];
+	NSArray *expected = [set allObjects];
+	NSUInteger lengths[] = {1, 7, 16};
+	for (NSUInteger length = 0; length < sizeof(lengths) / sizeof(lengths[0]); length++) {
+		NSFastEnumerationState state = {0};
+		id buffer[16];
+		NSMutableArray *enumerated = [NSMutableArray array];
+		NSUInteger batchCount;
+		while ((batchCount = [set countByEnumeratingWithState:&state objects:buffer count:lengths[length]]) > 0) {
+			XCTAssertTrue(batchCount <= lengths[length]);
+			[enumerated addObjectsFromArray:[NSArray arrayWithObjects:state.itemsPtr count:batchCount]];
+		}
+		XCTAssertEqualObjects(enumerated, expected);
+		XCTAssertEqual([set countByEnumeratingWithState:&state objects:buffer count:lengths[length]], (NSUInteger)0);
+	}
+	
+	// Stopping early leaves nothing to clean up, and the next enumeration starts again from the first object
+	for (NSUInteger round = 0; round < 100; round++) {
+		NSUInteger seen = 0;
+		for (NSNumber *number in set) {
+			XCTAssertEqual([number unsignedIntegerValue], seen);
+			if (++seen == round)
+				break;
+		}
+	}
+	
+	// Resuming after the tree has changed raises, even for a caller that does not check mutationsPtr
+	NSFastEnumerationState state = {0};
+	id buffer[16];
+	XCTAssertEqual([set countByEnumeratingWithState:&state objects:buffer count:16], (NSUInteger)16);
+	[set removeObject:[NSNumber numberWithUnsignedInteger:16]];
+	XCTAssertThrows([set countByEnumeratingWithState:&state objects:buffer count:16]);
+}
+
+- (void) testMembersForObjects {
+	if ([self class] == [CHAbstractBinarySearchTreeTest class])
+		return;
+	NSArray *options = [NSArray arrayWithObjects:[NSNumber numberWithUnsignedInt:0],
+	                    [NSNumber numberWithUnsignedInt:CHTreeOptionsOrderStatistics], nil];
+	for (NSNumber *option in options) {
+		set = [[[[self classUnderTest] alloc] initWithTreeOptions:[option unsignedIntValue]] autorelease];
+		XCTAssertEqualObjects([set membersForObjects:[NSArray arrayWithObject:[NSNumber numberWithInteger:0]]],
+		                      [NSArray arrayWithObject:[NSNull null]]);
+		// The even numbers below 2000, added out of order
+		for (NSUInteger number = 0; number < 1000; number++)
+			[set addObject:[NSNumber numberWithUnsignedInteger:((number * 389) % 1000) * 2]];
+		
+		// Probes in ascending order, with duplicates and probes beyond either end, share one descent
+		NSMutableArray *probes = [NSMutableArray array];
+		NSMutableArray *expected = [NSMutableArray array];
+		[probes addObject:[NSNumber numberWithInteger:-1]];
+		[expected addObject:[NSNull null]];
+		for (NSUInteger number = 0; number <= 2000; number++) {
+			[probes addObject:[NSNumber numberWithUnsignedInteger:number]];
+			[expected addObject:(number % 2 == 0 && number < 2000) ? (id)[NSNumber numberWithUnsignedInteger:number] : (id)[NSNull null]];
+			if (number % 100 == 0) {
+				[probes addObject:[NSNumber numberWithUnsignedInteger:number]];
+				[expected addObject:[expected lastObject]];
+			}
+		}
+		XCTAssertEqualObjects([set membersForObjects:probes], expected);
+		
+		// Any other order is found by separate descents, and the members are returned in the order of the probes
+		NSMutableArray *shuffledProbes = [NSMutableArray array];
+		NSMutableArray *shuffledExpected = [NSMutableArray array];
+		for (NSUInteger index = 0; index < [probes count]; index++) {
+			NSUInteger shuffled = (index * 1201) % [probes count];
+			[shuffledProbes addObject:[probes objectAtIndex:shuffled]];
+			[shuffledExpected addObject:[expected objectAtIndex:shuffled]];
+		}
+		XCTAssertEqualObjects([set membersForObjects:shuffledProbes], shuffledExpected);
+		
+		// The members returned are the receiver's own objects
+		NSArray *members = [set membersForObjects:[NSArray arrayWithObject:[NSNumber numberWithUnsignedInteger:10]]];
+		XCTAssertTrue([members objectAtIndex:0] == [set member:[NSNumber numberWithUnsignedInteger:10]]);
+		
+		NSMutableArray *evens = [NSMutableArray array];
+		for (NSUInteger number = 0; number < 2000; number += 2)
+			[evens addObject:[NSNumber numberWithUnsignedInteger:number]];
+		XCTAssertTrue([set containsObjects:evens]);
+		XCTAssertTrue([set containsObjects:[[evens reverseObjectEnumerator] allObjects]]);
+		XCTAssertFalse([set containsObjects:probes]);
+		XCTAssertFalse([set containsObjects:shuffledProbes]);
+		XCTAssertTrue([set containsObjects:[NSArray array]]);
+		XCTAssertEqualObjects([set membersForObjects:[NSArray array]], [NSArray array]);
+		[evens addObject:[NSNumber numberWithUnsignedInteger:2001]];
+		XCTAssertFalse([set containsObjects:evens]);
+	}
+}
+
+- (void) testAddObjectHint {
+	if ([self class] == [CHAbstractBinarySearchTreeTest class])
+		return;
+	NSArray *options = [NSArray arrayWithObjects:[NSNumber numberWithUnsignedInt:0],
+	                    [NSNumber numberWithUnsignedInt:CHTreeOptionsOrderStatistics], nil];
+	for (NSNumber *option in options) {
+		// Ascending, nearly ascending (each object at most 7 ahead of its place) and scattered, with some objects added twice
+		for (NSUInteger order = 0; order < 3; order++) {
+			set = [[[[self classUnderTest] alloc] initWithTreeOptions:[option unsignedIntValue]] autorelease];
+			CHBinarySearchTreeCursor *cursor = [set cursorAtObject:nil];
+			NSMutableSet *added = [NSMutableSet set];
+			for (NSUInteger number = 0; number < 1000; number++) {
+				NSUInteger value = (order == 0) ? number : (order == 1) ? number + (number * 7) % 8 : (number * 389) % 1000;
+				NSNumber *object = [NSNumber numberWithUnsignedInteger:value];
+				[set addObject:object hint:cursor];
+				[added addObject:object];
+				XCTAssertTrue([cursor object] == object);
+			}
+			NSArray *expected = [[added allObjects] sortedArrayUsingSelector:@selector(compare:)];
+			XCTAssertEqualObjects([set allObjects], expected);
+			if ([set respondsToSelector:@selector(verify)])
+				XCTAssertNoThrow([set performSelector:@selector(verify)]);
+			if ([option unsignedIntValue] & CHTreeOptionsOrderStatistics) {
+				for (NSUInteger index = 0; index < [expected count]; index += 97)
+					XCTAssertEqualObjects([set objectAtIndex:index], [expected objectAtIndex:index]);
+			}
+			
+			// The cursor is left on the last object added, and moves from there
+			id last = [cursor object];
+			NSUInteger index = [expected indexOfObject:last];
+			if (index > 0)
+				XCTAssertEqualObjects([cursor previous], [expected objectAtIndex:index - 1]);
+		}
+		
+		// A cursor before the first object starts from the first, and an object the same as one in the tree replaces it
+		CHBinarySearchTreeCursor *cursor = [set cursorAtObject:nil];
+		XCTAssertNil([cursor previous]);
+		[set addObject:[NSNumber numberWithInteger:-1] hint:cursor];
+		XCTAssertEqualObjects([cursor object], [NSNumber numberWithInteger:-1]);
+		NSUInteger countBefore = [set count];
+		NSNumber *replacement = [NSNumber numberWithInteger:-1];
+		[set addObject:replacement hint:cursor];
+		XCTAssertEqual([set count], countBefore);
+		XCTAssertTrue([set member:replacement] == replacement);
+		XCTAssertEqualObjects([set firstObject], [NSNumber numberWithInteger:-1]);
+		
+		// Without a hint, objects added in ascending order are appended
+		[set addObject:[NSNumber numberWithInteger:5000] hint:nil];
+		[set addObject:[NSNumber numberWithInteger:5001]];
+		XCTAssertEqualObjects([set lastObject], [NSNumber numberWithInteger:5001]);
+		XCTAssertEqual([set count], countBefore + 2);
+		if ([set respondsToSelector:@selector(verify)])
+			XCTAssertNoThrow([set performSelector:@selector(verify)]);
+		
+		XCTAssertThrows([set addObject:nil hint:cursor]);
+		XCTAssertThrows([set addObject:[NSNumber numberWithInteger:-2] hint:cursor]); // Modified since the cursor was positioned
+		id otherTree = [[[[self classUnderTest] alloc] init] autorelease];
+		XCTAssertThrows([set addObject:[NSNumber numberWithInteger:-2] hint:[otherTree cursorAtObject:nil]]);
+	}
+}
+
+#if defined (__BLOCKS__)
+- (void) testEnumerateObjectsWithOptions {
+	if ([self class] == [CHAbstractBinarySearchTreeTest class])
+		return;
+	NSArray *options = [NSArray arrayWithObjects:[NSNumber numberWithUnsignedInt:0],
+	                    [NSNumber numberWithUnsignedInt:CHTreeOptionsOrderStatistics], nil];
+	for (NSNumber *option in options) {
+		set = [[[[self classUnderTest] alloc] initWithTreeOptions:[option unsignedIntValue]] autorelease];
+		NSUInteger count = 1000;
+		for (NSUInteger number = 0; number < count; number++)
+			[set addObject:[NSNumber numberWithUnsignedInteger:(number * 389) % count]];
+		
+		__block NSUInteger calls = 0;
+		[set enumerateObjectsUsingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
+			XCTAssertEqual([obj unsignedIntegerValue], idx);
+			XCTAssertEqual(idx, calls++);
+		}];
+		XCTAssertEqual(calls, count);
+		
+		calls = 0;
+		[set enumerateObjectsWithOptions:NSEnumerationReverse usingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
+			XCTAssertEqual([obj unsignedIntegerValue], idx);
+			XCTAssertEqual(idx, count - 1 - calls++);
+		}];
+		XCTAssertEqual(calls, count);
+		
+		// Each index is written by one call of the block, whichever thread it runs on, and every object is passed its index in ascending order
+		id *slots = calloc(count, sizeof(id));
+		[set enumerateObjectsWithOptions:NSEnumerationConcurrent usingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
+			slots[idx] = obj;
+		}];
+		XCTAssertEqualObjects([NSArray arrayWithObjects:slots count:count], [set allObjects]);
+		free(slots);
+		
+		calls = 0;
+		[set enumerateObjectsUsingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
+			*stop = (++calls == 3);
+		}];
+		XCTAssertEqual(calls, (NSUInteger)3);
+		
+		XCTAssertThrows([set enumerateObjectsUsingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
+			[set removeObject:obj];
+		}]);
+		XCTAssertThrows([set enumerateObjectsUsingBlock:nil]);
+	}
+	
+	set = [[[[self classUnderTest] alloc] init] autorelease];
+	[set enumerateObjectsWithOptions:NSEnumerationReverse usingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
+		XCTFail(@"An empty tree has no objects to enumerate");
+	}];
+}
+#endif	/* defined (__BLOCKS__) */
+
+- (void) testSetAlgebra {
+	if ([self class] == [CHAbstractBinarySearchTreeTest class])
+		return;
+	// Multiples of 2 and of 3 below 300, so the result of each operation is easy to state
+	NSMutableArray *twos = [NSMutableArray array], *threes = [NSMutableArray array];
+	NSMutableArray *both = [NSMutableArray array], *either = [NSMutableArray array], *twosOnly = [NSMutableArray array];
+	for (NSUInteger number = 0; number < 300; number++) {
+		NSNumber *n = [NSNumber numberWithUnsignedInteger:number];
+		if (number % 2 == 0) [twos addObject:n];
+		if (number % 3 == 0) [threes addObject:n];
+		if (number % 6 == 0) [both addObject:n];
+		if (number % 2 == 0 || number % 3 == 0) [either addObject:n];
+		if (number % 2 == 0 && number % 3 != 0) [twosOnly addObject:n];
+	}
+	id other = [[[[self classUnderTest] alloc] initWithArray:threes] autorelease];
+	set = [[[[self classUnderTest] alloc] initWithArray:twos] autorelease];
+	XCTAssertThrows([set unionWithSortedSet:nil]);
+	
+	// Non-mutating variants leave the receiver alone
+	XCTAssertEqualObjects([[set setByUnioningWithSortedSet:other] allObjects], either);
+	XCTAssertEqualObjects([[set setByIntersectingWithSortedSet:other] allObjects], both);
+	XCTAssertEqualObjects([[set setByMinusingSortedSet:other] allObjects], twosOnly);
+	XCTAssertEqualObjects([[set setByMinusingSortedSet:set] allObjects], [NSArray array]);
+	XCTAssertEqualObjects([set allObjects], twos);
+	XCTAssertTrue([[set setByUnioningWithSortedSet:other] isKindOfClass:[self classUnderTest]]);
+	
+	// Merged and rebuilt in place
+	[set unionWithSortedSet:other];
+	XCTAssertEqualObjects([set allObjects], either);
+	if ([set respondsToSelector:@selector(verify)])
+		XCTAssertNoThrow([set performSelector:@selector(verify)]);
+	[set intersectWithSortedSet:[[[[self classUnderTest] alloc] initWithArray:twos] autorelease]];
+	XCTAssertEqualObjects([set allObjects], twos);
+	[set minusSortedSet:other];
+	XCTAssertEqualObjects([set allObjects], twosOnly);
+	if ([set respondsToSelector:@selector(verify)])
+		XCTAssertNoThrow([set performSelector:@selector(verify)]);
+	
+	// A tiny other set is applied one object at a time, including a view of the receiver itself
+	NSNumber *four = [NSNumber numberWithUnsignedInteger:4];
+	NSNumber *five = [NSNumber numberWithUnsignedInteger:5];
+	id tiny = [[[[self classUnderTest] alloc] initWithArray:[NSArray arrayWithObjects:four, five, nil]] autorelease];
+	[set unionWithSortedSet:tiny];
+	XCTAssertEqual([set count], [twosOnly count] + 1);
+	[set minusSortedSet:tiny];
+	XCTAssertEqual([set count], [twosOnly count] - 1);
+	[set intersectWithSortedSet:tiny];
+	XCTAssertEqual([set count], (NSUInteger)0);
+	[set unionWithSortedSet:other];
+	[set minusSortedSet:[set subsetFromObject:nil toObject:five options:0]];
+	XCTAssertEqualObjects([set allObjects], [threes subarrayWithRange:NSMakeRange(2, [threes count] - 2)]);
+	
+	// A set in another order is applied one object at a time
+	NSUInteger comparisons = 0;
+	id reversed = [[[[self classUnderTest] alloc] initWithCompareFunction:reverseCompare context:&comparisons] autorelease];
+	[reversed addObjectsFromArray:twos];
+	[set intersectWithSortedSet:reversed];
+	XCTAssertEqualObjects([[set allObjects] lastObject], [NSNumber numberWithUnsignedInteger:294]);
+	XCTAssertEqual([set count], [both count] - 1);
+}
+
+- (void) testParallelBulkOperations {
+	if ([self class] == [CHAbstractBinarySearchTreeTest class])
+		return;
+	Class treeClass = [self classUnderTest];
+	NSUInteger grainSize = [treeClass parallelGrainSize], workerCount = [treeClass parallelWorkerCount];
+	[treeClass setParallelGrainSize:16];
+	[treeClass setParallelWorkerCount:4];
+	
+	// Each number below 1000 appears twice, scrambled, so the workers must sort and drop duplicates
+	NSMutableArray *scrambled = [NSMutableArray array], *expected = [NSMutableArray array];
+	NSMutableArray *twos = [NSMutableArray array], *threes = [NSMutableArray array], *either = [NSMutableArray array];
+	for (NSUInteger number = 0; number < 2000; number++)
+		[scrambled addObject:[NSNumber numberWithUnsignedInteger:(number * 7919) % 1000]];
+	for (NSUInteger number = 0; number < 1000; number++) {
+		NSNumber *n = [NSNumber numberWithUnsignedInteger:number];
+		[expected addObject:n];
+		if (number % 2 == 0) [twos addObject:n];
+		if (number % 3 == 0) [threes addObject:n];
+		if (number % 2 == 0 || number % 3 == 0) [either addObject:n];
+	}
+	set = [[[treeClass alloc] initWithArray:scrambled] autorelease];
+	XCTAssertEqual([set count], (NSUInteger)1000);
+	XCTAssertEqualObjects([set allObjects], expected);
+	if ([set respondsToSelector:@selector(verify)])
+		XCTAssertNoThrow([set performSelector:@selector(verify)]);
+	
+	// Sorted input is built by the workers directly
+	set = [[[treeClass alloc] initWithSortedArray:expected] autorelease];
+	XCTAssertEqualObjects([set allObjects], expected);
+	if ([set respondsToSelector:@selector(verify)])
+		XCTAssertNoThrow([set performSelector:@selector(verify)]);
+	
+	// The merge of a set operation is divided between workers
+	set = [[[treeClass alloc] initWithArray:twos] autorelease];
+	id other = [[[treeClass alloc] initWithArray:threes] autorelease];
+	XCTAssertEqualObjects([[set setByUnioningWithSortedSet:other] allObjects], either);
+	[set unionWithSortedSet:other];
+	XCTAssertEqualObjects([set allObjects], either);
+	if ([set respondsToSelector:@selector(verify)])
+		XCTAssertNoThrow([set performSelector:@selector(verify)]);
+	[set minusSortedSet:other];
+	XCTAssertEqual([set count], [either count] - [threes count]);
+	
+	[treeClass setParallelGrainSize:grainSize];
+	[treeClass setParallelWorkerCount:workerCount];
+}
+
+- (void) testFreeze {
+	if ([self class] == [CHAbstractBinarySearchTreeTest class])
+		return;
+	// Every size up to 40, so that the last level of the array is partly filled in each possible way
+	NSMutableArray *evens = [NSMutableArray array];
+	for (NSUInteger size = 0; size <= 40; size++) {
+		set = [[[[self classUnderTest] alloc] initWithArray:evens] autorelease];
+		CHFrozenSortedSet *frozen = [set freeze];
+		XCTAssertEqual([frozen count], size);
+		XCTAssertEqualObjects([frozen allObjects], evens);
+		XCTAssertEqualObjects([[frozen reverseObjectEnumerator] allObjects], [[evens reverseObjectEnumerator] allObjects]);
+		XCTAssertEqualObjects([frozen firstObject], [evens count] ? [evens objectAtIndex:0] : nil);
+		XCTAssertEqualObjects([frozen lastObject], [evens lastObject]);
+		NSUInteger index = 0;
+		for (id object in frozen)
+			XCTAssertEqualObjects(object, [evens objectAtIndex:index++]);
+		XCTAssertEqual(index, size);
+		for (NSUInteger number = 0; number <= 2 * size; number++) {
+			NSNumber *n = [NSNumber numberWithUnsignedInteger:number];
+			XCTAssertEqual([frozen containsObject:n], (BOOL)(number % 2 == 0 && number < 2 * size));
+		}
+		XCTAssertTrue([frozen isEqual:set]);
+		[evens addObject:[NSNumber numberWithUnsignedInteger:2 * size]];
+	}
+	
+	// The frozen set does not change with the tree, and cannot be changed itself
+	set = [[[[self classUnderTest] alloc] initWithArray:abcde] autorelease];
+	CHFrozenSortedSet *frozen = [set freeze];
+	[set removeObject:@"C"];
+	XCTAssertEqualObjects([frozen allObjects], abcde);
+	XCTAssertTrue([frozen member:@"C"] == [abcde objectAtIndex:2]);
+	XCTAssertThrows([frozen addObject:@"F"]);
+	XCTAssertThrows([frozen addObjectsFromArray:abcde]);
+	XCTAssertThrows([frozen removeObject:@"A"]);
+	XCTAssertThrows([frozen removeFirstObject]);
+	XCTAssertThrows([frozen removeLastObject]);
+	XCTAssertThrows([frozen removeAllObjects]);
+	XCTAssertTrue([[frozen copy] autorelease] == frozen);
+	
+	// Subsets in both directions, and with the endpoints left out
+	XCTAssertEqualObjects([[frozen subsetFromObject:@"B" toObject:@"D" options:0] allObjects], ([NSArray arrayWithObjects:@"B",@"C",@"D",nil]));
+	XCTAssertEqualObjects([[frozen subsetFromObject:@"B" toObject:@"D" options:CHSubsetExcludeLowEndpoint|CHSubsetExcludeHighEndpoint] allObjects], [NSArray arrayWithObject:@"C"]);
+	XCTAssertEqualObjects([[frozen subsetFromObject:@"D" toObject:@"B" options:0] allObjects], ([NSArray arrayWithObjects:@"A",@"B",@"D",@"E",nil]));
+	XCTAssertEqualObjects([[frozen subsetFromObject:nil toObject:@"B" options:CHSubsetExcludeHighEndpoint] allObjects], [NSArray arrayWithObject:@"A"]);
+	XCTAssertEqualObjects([[frozen subsetFromObject:@"D" toObject:nil options:0] allObjects], ([NSArray arrayWithObjects:@"D",@"E",nil]));
+	
+	// The ordering of the tree is kept, and an archive is read back in the default order
+	NSUInteger comparisons = 0;
+	set = [[[[self classUnderTest] alloc] initWithCompareFunction:reverseCompare context:&comparisons] autorelease];
+	[set addObjectsFromArray:abcde];
+	frozen = [set freeze];
+	XCTAssertEqualObjects([frozen allObjects], [[abcde reverseObjectEnumerator] allObjects]);
+	comparisons = 0;
+	XCTAssertNotNil([frozen member:@"A"]);
+	XCTAssertTrue(comparisons > 0);
+	frozen = [[[CHFrozenSortedSet alloc] initWithArray:[NSArray arrayWithObjects:@"C",@"A",@"B",@"A",nil]] autorelease];
+	XCTAssertEqualObjects([[NSKeyedUnarchiver unarchiveObjectWithData:[NSKeyedArchiver archivedDataWithRootObject:frozen]] allObjects], ([NSArray arrayWithObjects:@"A",@"B",@"C",nil]));
+}
+
+#if defined (__BLOCKS__)
+- (void) testInitWithComparator {
+	if ([self class] == [CHAbstractBinarySearchTreeTest class])
+		return;
+	set = [[[[self classUnderTest] alloc] initWithComparator:^(id a, id b) {
+		return [b compare:a];
+	}] autorelease];
+	XCTAssertEqual([set comparatorKind], CHComparatorKindBlock);
+	[set addObjectsFromArray:abcde];
+	XCTAssertEqualObjects([set allObjects], [[abcde reverseObjectEnumerator] allObjects]);
+	XCTAssertEqualObjects([set lastObject], @"A");
+	XCTAssertTrue([set containsObject:@"B"]);
+	[set removeObject:@"B"];
+	XCTAssertFalse([set containsObject:@"B"]);
+	XCTAssertEqual([[[set copy] autorelease] comparatorKind], CHComparatorKindBlock);
+	XCTAssertEqual([[self createSet] comparatorKind], CHComparatorKindSelector);
+	XCTAssertThrows([NSKeyedArchiver archivedDataWithRootObject:set]);
+}
+#endif	/* defined (__BLOCKS__) */
+
 - (void) testHeaderObject {
 	id headerObject = [set headerObject];
 	XCTAssertNotNil(headerObject);
@@ -555,6 +1443,69 @@ static NSArray *abcde;
 
 #pragma mark -
 
+@interface CHAnderssonTree (Test)
+
+- (void) verify;
+
+@end
+
+@implementation CHAnderssonTree (Test)
+
+// Recursive method for verifying that AA tree level invariants are not violated.
+- (void) verifySubtreeAtNode:(CHBinaryTreeNode*)node {
+	if (node == sentinel)
+		return;
+	if (node->left->level + 1 != node->level)
+		[NSException raise:NSInternalInconsistencyException
+		            format:@"Level violation left of %@", node->object];
+	if (node->right->level != node->level && node->right->level + 1 != node->level)
+		[NSException raise:NSInternalInconsistencyException
+		            format:@"Level violation right of %@", node->object];
+	if (node->right != sentinel && node->right->right->level >= node->level)
+		[NSException raise:NSInternalInconsistencyException
+		            format:@"Consecutive horizontal links right of %@", node->object];
+	if (node->level > 1 && (node->left == sentinel || node->right == sentinel))
+		[NSException raise:NSInternalInconsistencyException
+		            format:@"Missing child below %@", node->object];
+	[self verifySubtreeAtNode:node->left];
+	[self verifySubtreeAtNode:node->right];
+}
+
+- (void) verify {
+	[self verifySubtreeAtNode:header->right];
+}
+
+@end
+
+// Orders objects by their key alone, so that distinct objects can compare the same, as the objects in a CHTreeOptionsMultiLeaves sub-collection do
+@interface CHSortedSetTestKey : NSObject {
+	NSUInteger key;
+}
++ (id) keyWithValue:(NSUInteger)value;
+- (NSUInteger) value;
+- (NSComparisonResult) compare:(CHSortedSetTestKey*)other;
+@end
+
+@implementation CHSortedSetTestKey
+
++ (id) keyWithValue:(NSUInteger)value {
+	CHSortedSetTestKey *aKey = [[[self alloc] init] autorelease];
+	aKey->key = value;
+	return aKey;
+}
+
+- (NSUInteger) value {
+	return key;
+}
+
+- (NSComparisonResult) compare:(CHSortedSetTestKey*)other {
+	if (key == other->key)
+		return NSOrderedSame;
+	return (key < other->key) ? NSOrderedAscending : NSOrderedDescending;
+}
+
+@end
+
 @interface CHAnderssonTreeTest : CHAbstractBinarySearchTreeTest
 @end
 
@@ -593,6 +1544,101 @@ static NSArray *abcde;
 	XCTAssertEqual([set count], [objects count]);
 }
 
+- (void) testNSCopyingMultiLeaves {
+	set = [[[CHAnderssonTree alloc] initWithTreeOptions:CHTreeOptionsMultiLeaves] autorelease];
+	for (NSUInteger number = 0; number < 20; number++)
+		[set addObject:[CHSortedSetTestKey keyWithValue:number % 10]];
+	id copy = [[set copy] autorelease];
+	XCTAssertEqual([copy count], [set count]);
+	
+	// Each sub-collection is copied, with the same objects, so that adding to one tree does not change the other
+	CHSortedSetTestKey *probe = [CHSortedSetTestKey keyWithValue:3];
+	id leaves = [set member:probe];
+	id copiedLeaves = [copy member:probe];
+	XCTAssertTrue(leaves != copiedLeaves);
+	XCTAssertEqualObjects(copiedLeaves, leaves);
+	[copy addObject:probe];
+	XCTAssertEqual([leaves count], (NSUInteger)2);
+	XCTAssertEqual([copiedLeaves count], (NSUInteger)3);
+	XCTAssertNoThrow([copy verify]);
+}
+
+- (void) testSetOperationsMultiLeaves {
+	set = [[[CHAnderssonTree alloc] initWithTreeOptions:CHTreeOptionsMultiLeaves] autorelease];
+	id other = [[[CHAnderssonTree alloc] initWithTreeOptions:CHTreeOptionsMultiLeaves] autorelease];
+	for (NSUInteger number = 0; number < 20; number++)
+		[set addObject:[CHSortedSetTestKey keyWithValue:number % 10]];
+	for (NSUInteger number = 5; number < 15; number++)
+		[other addObject:[CHSortedSetTestKey keyWithValue:number]];
+	CHSortedSetTestKey *probe = [CHSortedSetTestKey keyWithValue:7];
+	id leaves = [set member:probe];
+	NSUInteger objectCount;
+	
+	// The union keeps the objects of both sets that compare the same, in sub-collections of its own
+	id result = [set setByUnioningWithSortedSet:other];
+	objectCount = 0;
+	for (id anObject in result)
+		objectCount++;
+	XCTAssertEqual(objectCount, (NSUInteger)30);
+	XCTAssertTrue([result member:probe] != leaves);
+	XCTAssertEqual([[result member:probe] count], (NSUInteger)3);
+	XCTAssertEqual([leaves count], (NSUInteger)2);
+	XCTAssertNoThrow([result verify]);
+	
+	// The intersection keeps the receiver's objects whose keys are in the other set
+	result = [set setByIntersectingWithSortedSet:other];
+	objectCount = 0;
+	for (CHSortedSetTestKey *aKey in result) {
+		XCTAssertTrue([aKey value] >= 5);
+		XCTAssertTrue([leaves containsObject:aKey] || [aKey value] != 7);
+		objectCount++;
+	}
+	XCTAssertEqual(objectCount, (NSUInteger)10);
+	XCTAssertTrue([result member:probe] != leaves);
+	XCTAssertNoThrow([result verify]);
+	
+	// Removing the other set's objects after adding them leaves only the receiver's own objects
+	[set unionWithSortedSet:other];
+	[set minusSortedSet:other];
+	objectCount = 0;
+	for (id anObject in set)
+		objectCount++;
+	XCTAssertEqual(objectCount, (NSUInteger)20);
+	XCTAssertNoThrow([set verify]);
+}
+
+- (void) testNSFastEnumerationMultiLevel {
+	set = [[[CHAnderssonTree alloc] initWithTreeOptions:CHTreeOptionsMultiLevel | CHTreeOptionsMultiLeaves] autorelease];
+	NSMutableSet *added = [NSMutableSet set];
+	for (NSUInteger number = 0; number < 50; number++) {
+		// Every fifth key has more objects than fit in one batch
+		NSUInteger copies = (number % 5 == 0) ? 40 : 1 + number % 3;
+		for (NSUInteger copy = 0; copy < copies; copy++) {
+			CHSortedSetTestKey *aKey = [CHSortedSetTestKey keyWithValue:number];
+			[set addObject:aKey];
+			[added addObject:aKey];
+		}
+	}
+	
+	// The objects of each sub-collection are enumerated in its place, and every batch but the last is full
+	NSUInteger lengths[] = {1, 7, 16};
+	for (NSUInteger length = 0; length < sizeof(lengths) / sizeof(lengths[0]); length++) {
+		NSFastEnumerationState state = {0};
+		id buffer[16];
+		NSMutableArray *enumerated = [NSMutableArray array];
+		NSUInteger batchCount;
+		while ((batchCount = [set countByEnumeratingWithState:&state objects:buffer count:lengths[length]]) > 0) {
+			if ([enumerated count] + batchCount < [added count])
+				XCTAssertEqual(batchCount, lengths[length]);
+			[enumerated addObjectsFromArray:[NSArray arrayWithObjects:state.itemsPtr count:batchCount]];
+		}
+		XCTAssertEqual([enumerated count], [added count]);
+		XCTAssertEqualObjects([NSSet setWithArray:enumerated], added);
+		for (NSUInteger index = 1; index < [enumerated count]; index++)
+			XCTAssertTrue([[enumerated objectAtIndex:index - 1] value] <= [[enumerated objectAtIndex:index] value]);
+	}
+}
+
 - (void) testDebugDescriptionForNode {
 	CHBinaryTreeNode *node = malloc(sizeof(CHBinaryTreeNode));
 	node->object = [NSString stringWithFormat: @"%@", @"A B C"];	/* Force the creation of a new string object with the same value as the literal. -[NSString stringWithString:] generates a warning that the method is redundant */
@@ -1082,6 +2128,28 @@ static NSArray *abcde;
 	}
 }
 
+- (void) testRemoveObjectScrambled {
+	NSMutableArray *numbers = [NSMutableArray array];
+	for (NSUInteger number = 0; number < 500; number++)
+		[numbers addObject:[NSNumber numberWithUnsignedInteger:(number * 37) % 500]];
+	set = [[[CHRedBlackTree alloc] initWithTreeOptions:CHTreeOptionsOrderStatistics] autorelease];
+	[set addObjectsFromArray:numbers];
+	// Remove in a different order, so nodes with 0, 1 and 2 children are all removed, at every depth
+	NSUInteger count = [numbers count];
+	for (NSUInteger number = 0; number < 500; number++) {
+		NSNumber *removed = [NSNumber numberWithUnsignedInteger:(number * 101) % 500];
+		[set removeObject:removed];
+		XCTAssertEqual([set count], --count);
+		XCTAssertNil([set member:removed]);
+		if (number % 10 == 0) {
+			XCTAssertNoThrow([set verify]);
+			NSArray *sorted = [set allObjects];
+			for (NSUInteger index = 0; index < [sorted count]; index += 7)
+				XCTAssertEqualObjects([set objectAtIndex:index], [sorted objectAtIndex:index]);
+		}
+	}
+}
+
 @end
 
 #pragma mark -
@@ -1478,3 +2546,519 @@ static NSArray *abcde;
 }
 
 @end
+
+#pragma mark -
+
+@interface CHPrimitiveSortedSetTest : XCTestCase
+@end
+
+@implementation CHPrimitiveSortedSetTest
+
+- (void) testInt64SortedSet {
+	CHInt64SortedSet *set = [[[CHInt64SortedSet alloc] init] autorelease];
+	NSMutableArray *expected = [NSMutableArray array];
+	int64_t integer;
+	
+	// Scrambled keys around zero and at the extremes, added twice over
+	for (integer = 0; integer < 2000; integer++)
+		[set addInt64:(integer * 7919) % 1000 - 500];
+	[set addInt64:INT64_MIN];
+	[set addInt64:INT64_MAX];
+	[expected addObject:[NSNumber numberWithLongLong:INT64_MIN]];
+	for (integer = -500; integer < 500; integer++)
+		[expected addObject:[NSNumber numberWithLongLong:integer]];
+	[expected addObject:[NSNumber numberWithLongLong:INT64_MAX]];
+	XCTAssertEqual([set count], (NSUInteger)1002);
+	XCTAssertEqualObjects([set allObjects], expected);
+	XCTAssertEqualObjects([[set reverseObjectEnumerator] allObjects], [[expected reverseObjectEnumerator] allObjects]);
+	XCTAssertEqualObjects([set firstObject], [expected objectAtIndex:0]);
+	XCTAssertEqualObjects([set lastObject], [expected lastObject]);
+	NSUInteger index = 0;
+	for (id object in set)
+		XCTAssertEqualObjects(object, [expected objectAtIndex:index++]);
+	XCTAssertEqual(index, [expected count]);
+	
+	// Primitive and boxed searches agree, and numbers of other types are converted exactly or not at all
+	XCTAssertTrue([set containsInt64:-500]);
+	XCTAssertFalse([set containsInt64:500]);
+	XCTAssertTrue([set containsObject:[NSNumber numberWithInt:42]]);
+	XCTAssertTrue([set containsObject:[NSNumber numberWithDouble:42.0]]);
+	XCTAssertFalse([set containsObject:[NSNumber numberWithDouble:42.5]]);
+	XCTAssertFalse([set containsObject:[NSNumber numberWithUnsignedLongLong:UINT64_MAX]]);
+	XCTAssertFalse([set containsObject:@"42"]);
+	XCTAssertEqualObjects([set member:[NSNumber numberWithShort:7]], [NSNumber numberWithLongLong:7]);
+	XCTAssertThrows([set addObject:nil]);
+	XCTAssertThrows([set addObject:@"42"]);
+	XCTAssertThrows([set addObject:[NSNumber numberWithDouble:0.5]]);
+	
+	// Removal, primitive and boxed
+	[set removeInt64:0];
+	[set removeObject:[NSNumber numberWithLongLong:1]];
+	[set removeFirstObject];
+	[set removeLastObject];
+	XCTAssertEqual([set count], (NSUInteger)998);
+	XCTAssertFalse([set containsInt64:0]);
+	XCTAssertFalse([set containsInt64:INT64_MIN]);
+	int64_t *integers = malloc(sizeof(int64_t) * [set count]);
+	[set getInt64s:integers];
+	for (index = 1; index < [set count]; index++)
+		XCTAssertTrue(integers[index - 1] < integers[index]);
+	free(integers);
+	
+	// Mutating while enumerating raises
+	NSEnumerator *enumerator = [set objectEnumerator];
+	[enumerator nextObject];
+	[set addInt64:1000];
+	XCTAssertThrows([enumerator nextObject]);
+	
+	// Bulk initialization, subsets, copying and archiving
+	int64_t scrambled[] = {5, 3, 9, 3, 1, 7, 5};
+	NSMutableArray *odds = [NSMutableArray array];
+	for (integer = 1; integer <= 9; integer += 2)
+		[odds addObject:[NSNumber numberWithLongLong:integer]];
+	set = [[[CHInt64SortedSet alloc] initWithInt64s:scrambled count:7] autorelease];
+	XCTAssertEqualObjects([set allObjects], odds);
+	XCTAssertEqualObjects([[set subsetFromObject:[odds objectAtIndex:1] toObject:[odds objectAtIndex:3] options:CHSubsetExcludeHighEndpoint] allObjects],
+	                      [odds subarrayWithRange:NSMakeRange(1, 2)]);
+	XCTAssertEqualObjects([[set subsetFromObject:[odds objectAtIndex:3] toObject:[odds objectAtIndex:1] options:0] allObjects],
+	                      ([NSArray arrayWithObjects:[odds objectAtIndex:0], [odds objectAtIndex:1], [odds objectAtIndex:3], [odds objectAtIndex:4], nil]));
+	XCTAssertTrue([[set subsetFromObject:nil toObject:[odds objectAtIndex:2] options:0] isKindOfClass:[CHInt64SortedSet class]]);
+	id copy = [[set copy] autorelease];
+	[set removeAllObjects];
+	XCTAssertEqualObjects([copy allObjects], odds);
+	XCTAssertEqualObjects([NSKeyedUnarchiver unarchiveObjectWithData:[NSKeyedArchiver archivedDataWithRootObject:copy]], copy);
+	XCTAssertEqualObjects(copy, [[[CHAVLTree alloc] initWithArray:[copy allObjects]] autorelease]);
+}
+
+- (void) testDoubleSortedSet {
+	CHDoubleSortedSet *set = [[[CHDoubleSortedSet alloc] init] autorelease];
+	double numbers[] = {INFINITY, 2.5, -0.0, -INFINITY, -1e-300, 1e300, -2.5, 0.0, NAN, 2.5};
+	double sorted[] = {-INFINITY, -2.5, -1e-300, 0.0, 2.5, 1e300, INFINITY};
+	NSUInteger index;
+	
+	for (index = 0; index < 10; index++)
+		[set addDouble:numbers[index]];
+	XCTAssertEqual([set count], (NSUInteger)8);
+	XCTAssertTrue([set containsDouble:-0.0]);
+	XCTAssertTrue([set containsDouble:NAN]);
+	XCTAssertFalse([set containsDouble:1.0]);
+	double *contents = malloc(sizeof(double) * [set count]);
+	[set getDoubles:contents];
+	for (index = 0; index < 7; index++)
+		XCTAssertEqual(contents[index], sorted[index]);
+	XCTAssertTrue(isnan(contents[7]));
+	free(contents);
+	XCTAssertTrue(isnan([[set lastObject] doubleValue]));
+	XCTAssertEqualObjects([set firstObject], [NSNumber numberWithDouble:-INFINITY]);
+	
+	// Boxed numbers of any type are compared by value
+	XCTAssertTrue([set containsObject:[NSNumber numberWithFloat:2.5f]]);
+	XCTAssertTrue([set containsObject:[NSNumber numberWithInt:0]]);
+	XCTAssertEqualObjects([set member:[NSNumber numberWithFloat:-2.5f]], [NSNumber numberWithDouble:-2.5]);
+	[set removeObject:[NSNumber numberWithInt:0]];
+	[set removeDouble:NAN];
+	XCTAssertEqual([set count], (NSUInteger)6);
+	XCTAssertEqualObjects([[set subsetFromObject:[NSNumber numberWithInt:-3] toObject:[NSNumber numberWithInt:3] options:0] allObjects],
+	                      ([NSArray arrayWithObjects:[NSNumber numberWithDouble:-2.5], [NSNumber numberWithDouble:-1e-300], [NSNumber numberWithDouble:2.5], nil]));
+	
+	// Bulk initialization sorts, merges zeros and drops duplicates
+	set = [[[CHDoubleSortedSet alloc] initWithDoubles:numbers count:10] autorelease];
+	XCTAssertEqual([set count], (NSUInteger)8);
+	XCTAssertEqualObjects([set firstObject], [NSNumber numberWithDouble:-INFINITY]);
+}
+
+@end
+
+#pragma mark -
+
+@interface CHBPlusTreeTest : CHSortedSetTest
+@end
+
+@implementation CHBPlusTreeTest
+
+- (Class) classUnderTest {
+	return [CHBPlusTree class];
+}
+
+- (void) testCacheLinesPerNode {
+	// With one cache line per node, leaves and inner nodes split and merge after only a few objects
+	CHBPlusTree *tree = [[[CHBPlusTree alloc] initWithCacheLinesPerNode:1] autorelease];
+	NSMutableArray *expected = [NSMutableArray array];
+	NSUInteger index;
+	
+	XCTAssertEqual([tree cacheLinesPerNode], (NSUInteger)1);
+	XCTAssertEqual([tree height], (NSUInteger)0);
+	for (index = 0; index < 2000; index++)
+		[tree addObject:[NSNumber numberWithUnsignedInteger:(index * 7919) % 1000]];
+	for (index = 0; index < 1000; index++)
+		[expected addObject:[NSNumber numberWithUnsignedInteger:index]];
+	XCTAssertEqual([tree count], (NSUInteger)1000);
+	XCTAssertTrue([tree height] > 3);
+	XCTAssertEqualObjects([tree allObjects], expected);
+	XCTAssertEqualObjects([[tree reverseObjectEnumerator] allObjects], [[expected reverseObjectEnumerator] allObjects]);
+	XCTAssertEqualObjects([tree allObjectsWithTraversalOrder:CHTraverseLevelOrder], expected);
+	
+	// The node size is kept by subsets, copies and archives
+	NSNumber *low = [expected objectAtIndex:10], *high = [expected objectAtIndex:90];
+	XCTAssertEqual([(CHBPlusTree*)[tree subsetFromObject:low toObject:high options:0] cacheLinesPerNode], (NSUInteger)1);
+	XCTAssertEqual([[[tree copy] autorelease] cacheLinesPerNode], (NSUInteger)1);
+	CHBPlusTree *decoded = [NSKeyedUnarchiver unarchiveObjectWithData:[NSKeyedArchiver archivedDataWithRootObject:tree]];
+	XCTAssertEqual([decoded cacheLinesPerNode], (NSUInteger)1);
+	XCTAssertEqualObjects(decoded, tree);
+	
+	// Removing scrambled objects borrows from and merges siblings
+	for (index = 0; index < 1000; index += 2)
+		[tree removeObject:[NSNumber numberWithUnsignedInteger:(index * 7919) % 1000]];
+	[expected removeAllObjects];
+	for (index = 1; index < 1000; index += 2)
+		[expected addObject:[NSNumber numberWithUnsignedInteger:index]];
+	XCTAssertEqualObjects([tree allObjects], expected);
+	while ([tree count] != 0)
+		[tree removeObject:[tree anyObject]];
+	XCTAssertEqual([tree height], (NSUInteger)0);
+	
+	XCTAssertThrows([[[CHBPlusTree alloc] initWithCacheLinesPerNode:0] autorelease]);
+	XCTAssertThrows([[[CHBPlusTree alloc] initWithCacheLinesPerNode:kCHBPlusTreeMaxCacheLinesPerNode + 1] autorelease]);
+}
+
+- (void) testBulkLoading {
+	NSMutableArray *sorted = [NSMutableArray array];
+	NSMutableArray *scrambled = [NSMutableArray array];
+	NSUInteger index;
+	
+	for (index = 0; index < 1000; index++) {
+		[sorted addObject:[NSNumber numberWithUnsignedInteger:index]];
+		[scrambled addObject:[NSNumber numberWithUnsignedInteger:(index * 7919) % 1000]];
+	}
+	[scrambled addObjectsFromArray:[scrambled subarrayWithRange:NSMakeRange(0, 100)]];
+	CHBPlusTree *tree = [[[CHBPlusTree alloc] initWithSortedArray:sorted] autorelease];
+	XCTAssertEqualObjects([tree allObjects], sorted);
+	XCTAssertEqualObjects(tree, [[[CHBPlusTree alloc] initWithArray:scrambled] autorelease]);
+	XCTAssertEqualObjects(tree, [[[CHBPlusTree alloc] initWithSortedArray:scrambled] autorelease]);
+	XCTAssertEqualObjects(tree, [[[CHAVLTree alloc] initWithArray:scrambled] autorelease]);
+	
+	// A tree loaded in bulk can be modified like any other
+	for (index = 0; index < 1000; index += 3)
+		[tree removeObject:[sorted objectAtIndex:index]];
+	for (index = 0; index < 1000; index += 3)
+		[tree addObject:[sorted objectAtIndex:index]];
+	XCTAssertEqualObjects([tree allObjects], sorted);
+}
+
+@end
+
+#pragma mark -
+
+@interface CHSkipListTest : CHSortedSetTest
+@end
+
+@implementation CHSkipListTest
+
+- (Class) classUnderTest {
+	return [CHSkipList class];
+}
+
+- (void) testObjectsByIndex {
+	CHSkipList *list = [[[CHSkipList alloc] init] autorelease];
+	NSMutableArray *expected = [NSMutableArray array];
+	NSUInteger index;
+	
+	XCTAssertThrows([list objectAtIndex:0]);
+	XCTAssertThrows([list removeObjectAtIndex:0]);
+	for (index = 0; index < 1000; index++) {
+		[list addObject:[NSNumber numberWithUnsignedInteger:(index * 7919) % 1000]];
+		[expected addObject:[NSNumber numberWithUnsignedInteger:index]];
+	}
+	for (index = 0; index < 1000; index++) {
+		XCTAssertEqualObjects([list objectAtIndex:index], [expected objectAtIndex:index]);
+		XCTAssertEqual([list indexOfObject:[expected objectAtIndex:index]], index);
+	}
+	XCTAssertEqual([list indexOfObject:[NSNumber numberWithInt:1000]], (NSUInteger)NSNotFound);
+	XCTAssertEqual([list indexOfObject:nil], (NSUInteger)NSNotFound);
+	XCTAssertThrows([list objectAtIndex:1000]);
+	
+	// Removing by position keeps the positions of the remaining objects
+	for (index = 0; index < 300; index++) {
+		NSUInteger position = (index * 7919) % [expected count];
+		[list removeObjectAtIndex:position];
+		[expected removeObjectAtIndex:position];
+	}
+	XCTAssertEqualObjects([list allObjects], expected);
+	for (index = 0; index < [expected count]; index++) {
+		XCTAssertEqualObjects([list objectAtIndex:index], [expected objectAtIndex:index]);
+		XCTAssertEqual([list indexOfObject:[expected objectAtIndex:index]], index);
+	}
+	
+	// Positions are counted within a subset, and kept by an archive
+	NSNumber *low = [expected objectAtIndex:10], *high = [expected objectAtIndex:90];
+	XCTAssertEqualObjects([(CHSkipList*)[list subsetFromObject:low toObject:high options:0] objectAtIndex:80], high);
+	CHSkipList *decoded = [NSKeyedUnarchiver unarchiveObjectWithData:[NSKeyedArchiver archivedDataWithRootObject:list]];
+	XCTAssertEqual([decoded indexOfObject:high], (NSUInteger)90);
+}
+
+- (void) testBulkLoading {
+	NSMutableArray *sorted = [NSMutableArray array];
+	NSMutableArray *scrambled = [NSMutableArray array];
+	NSUInteger index;
+	
+	for (index = 0; index < 1000; index++) {
+		[sorted addObject:[NSNumber numberWithUnsignedInteger:index]];
+		[scrambled addObject:[NSNumber numberWithUnsignedInteger:(index * 7919) % 1000]];
+	}
+	[scrambled addObjectsFromArray:[scrambled subarrayWithRange:NSMakeRange(0, 100)]];
+	CHSkipList *list = [[[CHSkipList alloc] initWithArray:sorted] autorelease];
+	XCTAssertEqualObjects([list allObjects], sorted);
+	XCTAssertEqualObjects(list, [[[CHSkipList alloc] initWithArray:scrambled] autorelease]);
+	XCTAssertEqualObjects(list, [[[CHAVLTree alloc] initWithArray:scrambled] autorelease]);
+	XCTAssertEqualObjects([list objectAtIndex:999], [sorted lastObject]);
+	
+	// A list loaded in bulk can be modified like any other
+	for (index = 0; index < 1000; index += 3)
+		[list removeObject:[sorted objectAtIndex:index]];
+	for (index = 0; index < 1000; index += 3)
+		[list addObject:[sorted objectAtIndex:index]];
+	XCTAssertEqualObjects([list allObjects], sorted);
+	XCTAssertEqual([list indexOfObject:[sorted lastObject]], (NSUInteger)999);
+}
+
+@end
+
+#pragma mark -
+
+// Adds the numbers from first up to limit in steps of stride to a set on its own thread, removes those not divisible by 3, then counts down
+// the threads still running.
+@interface CHConcurrentSkipListWriter : NSObject
+{
+	id<CHSortedSet> set;
+	NSUInteger first, stride, limit;
+	NSCondition *condition;
+	NSUInteger *running;
+}
+- (id) initWithSet:(id<CHSortedSet>)aSet first:(NSUInteger)aFirst stride:(NSUInteger)aStride limit:(NSUInteger)aLimit
+         condition:(NSCondition*)aCondition running:(NSUInteger*)aRunning;
+- (void) run:(id)unused;
+@end
+
+@implementation CHConcurrentSkipListWriter
+
+- (id) initWithSet:(id<CHSortedSet>)aSet first:(NSUInteger)aFirst stride:(NSUInteger)aStride limit:(NSUInteger)aLimit
+         condition:(NSCondition*)aCondition running:(NSUInteger*)aRunning
+{
+	if ((self = [super init]) == nil) return nil;
+	set = aSet;
+	first = aFirst;
+	stride = aStride;
+	limit = aLimit;
+	condition = aCondition;
+	running = aRunning;
+	return self;
+}
+
+- (void) run:(id)unused {
+	(void) unused;
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+	NSUInteger number;
+	for (number = first; number < limit; number += stride)
+		[set addObject:[NSNumber numberWithUnsignedInteger:number]];
+	for (number = first; number < limit; number += stride) {
+		if (number % 3 != 0)
+			[set removeObject:[NSNumber numberWithUnsignedInteger:number]];
+		[set containsObject:[NSNumber numberWithUnsignedInteger:limit - number]];
+	}
+	[pool release];
+	[condition lock];
+	(*running)--;
+	[condition signal];
+	[condition unlock];
+}
+
+@end
+
+@interface CHConcurrentSkipListSetTest : CHSortedSetTest
+@end
+
+@implementation CHConcurrentSkipListSetTest
+
+- (Class) classUnderTest {
+	return [CHConcurrentSkipListSet class];
+}
+
+// Enumeration is weakly consistent, so changes made during it never raise
+- (void) testNSFastEnumeration {
+	NSMutableArray *sorted = [NSMutableArray array];
+	NSUInteger index;
+	for (index = 0; index < 500; index++)
+		[sorted addObject:[NSNumber numberWithUnsignedInteger:index]];
+	[set addObjectsFromArray:sorted];
+	
+	// Removing each object as it is returned, and adding objects ahead of and behind the enumeration, never raises
+	index = 0;
+	XCTAssertNoThrow({
+		for (id object in set) {
+			XCTAssertEqualObjects(object, [sorted objectAtIndex:index]);
+			[set removeObject:object];
+			[set addObject:[NSNumber numberWithInt:-1]];
+			index++;
+		}
+	});
+	XCTAssertEqual(index, [sorted count]);
+	XCTAssertEqualObjects([set allObjects], [NSArray arrayWithObject:[NSNumber numberWithInt:-1]]);
+}
+
+- (void) testObjectEnumerator {
+	NSMutableArray *sorted = [NSMutableArray array];
+	NSUInteger index;
+	for (index = 0; index < 500; index++)
+		[sorted addObject:[NSNumber numberWithUnsignedInteger:index]];
+	[set addObjectsFromArray:sorted];
+	XCTAssertEqualObjects([[set objectEnumerator] allObjects], sorted);
+	
+	// An enumerator skips objects removed ahead of it, and returns those after the one it returned last
+	NSEnumerator *enumerator = [set objectEnumerator];
+	XCTAssertEqualObjects([enumerator nextObject], [NSNumber numberWithInt:0]);
+	[set removeObject:[NSNumber numberWithInt:0]];
+	[set removeObject:[NSNumber numberWithInt:1]];
+	XCTAssertEqualObjects([enumerator nextObject], [NSNumber numberWithInt:2]);
+	enumerator = [set reverseObjectEnumerator];
+	XCTAssertEqualObjects([enumerator nextObject], [NSNumber numberWithInt:499]);
+	[set removeObject:[NSNumber numberWithInt:498]];
+	XCTAssertEqualObjects([enumerator nextObject], [NSNumber numberWithInt:497]);
+}
+
+- (void) testConcurrentWriters {
+	NSUInteger threadCount = 8, limit = 20000, index, running = threadCount;
+	NSCondition *condition = [[[NSCondition alloc] init] autorelease];
+	
+	// Each thread adds every eighth number, so the threads interleave throughout the set, then removes those not divisible by 3
+	for (index = 0; index < threadCount; index++) {
+		CHConcurrentSkipListWriter *writer = [[[CHConcurrentSkipListWriter alloc] initWithSet:set first:index stride:threadCount limit:limit
+		                                                                              condition:condition running:&running] autorelease];
+		[NSThread detachNewThreadSelector:@selector(run:) toTarget:writer withObject:nil];
+	}
+	[condition lock];
+	while (running != 0)
+		[condition wait];
+	[condition unlock];
+	
+	NSMutableArray *expected = [NSMutableArray array];
+	for (index = 0; index < limit; index += 3)
+		[expected addObject:[NSNumber numberWithUnsignedInteger:index]];
+	XCTAssertEqual([set count], [expected count]);
+	XCTAssertEqualObjects([set allObjects], expected);
+}
+
+@end
+
+#pragma mark -
+
+static void removeOddNumbers(id<CHSortedSet> set, void *context) {
+	NSUInteger *removed = context;
+	for (NSNumber *number in set) {
+		if ([number unsignedIntegerValue] % 2 != 0) {
+			[set removeObject:number];
+			(*removed)++;
+		}
+	}
+}
+
+@interface CHConcurrentSortedSetTest : CHSortedSetTest
+@end
+
+@implementation CHConcurrentSortedSetTest
+
+- (Class) classUnderTest {
+	return [CHConcurrentSortedSet class];
+}
+
+// Enumeration is over a snapshot, so changes made during it never raise
+- (void) testNSFastEnumeration {
+	NSMutableArray *sorted = [NSMutableArray array];
+	NSUInteger index;
+	for (index = 0; index < 500; index++)
+		[sorted addObject:[NSNumber numberWithUnsignedInteger:index]];
+	set = [[[CHConcurrentSortedSet alloc] initWithSortedSet:[[[CHRedBlackTree alloc] initWithArray:sorted] autorelease]] autorelease];
+	
+	// The enumeration returns the objects as they were when it began
+	index = 0;
+	XCTAssertNoThrow({
+		for (id object in set) {
+			XCTAssertEqualObjects(object, [sorted objectAtIndex:index++]);
+			[set removeObject:object];
+			[set addObject:[NSNumber numberWithInt:-1]];
+		}
+	});
+	XCTAssertEqual(index, [sorted count]);
+	XCTAssertEqualObjects([set allObjects], [NSArray arrayWithObject:[NSNumber numberWithInt:-1]]);
+}
+
+- (void) testObjectEnumerator {
+	[set addObjectsFromArray:abcde];
+	XCTAssertEqualObjects([[set objectEnumerator] allObjects], abcde);
+	NSEnumerator *enumerator = [set objectEnumerator];
+	[set removeObject:@"A"];
+	XCTAssertEqualObjects([enumerator nextObject], @"A");
+	XCTAssertEqualObjects([set firstObject], @"B");
+}
+
+- (void) testSnapshot {
+	[set addObjectsFromArray:abcde];
+	XCTAssertThrows([[[CHConcurrentSortedSet alloc] initWithSortedSet:nil] autorelease]);
+	
+	// The snapshot is shared until the set is modified
+	NSArray *snapshot = [set allObjects];
+	XCTAssertTrue([set allObjects] == snapshot);
+	[set removeFirstObject];
+	XCTAssertFalse([set allObjects] == snapshot);
+	XCTAssertEqualObjects(snapshot, abcde);
+	
+	// Subsets and unarchived sets are themselves thread safe
+	XCTAssertTrue([[set subsetFromObject:@"B" toObject:@"D" options:0] isKindOfClass:[CHConcurrentSortedSet class]]);
+	id decoded = [NSKeyedUnarchiver unarchiveObjectWithData:[NSKeyedArchiver archivedDataWithRootObject:set]];
+	XCTAssertTrue([decoded isKindOfClass:[CHConcurrentSortedSet class]]);
+	XCTAssertEqualObjects(decoded, set);
+}
+
+- (void) testBatchUpdates {
+	NSMutableArray *sorted = [NSMutableArray array];
+	NSUInteger index, removed = 0;
+	for (index = 0; index < 100; index++)
+		[sorted addObject:[NSNumber numberWithUnsignedInteger:index]];
+	[set addObjectsFromArray:sorted];
+	[set performBatchUpdatesWithFunction:removeOddNumbers context:&removed];
+	XCTAssertEqual(removed, (NSUInteger)50);
+	XCTAssertEqual([set count], (NSUInteger)50);
+	XCTAssertEqualObjects([set lastObject], [NSNumber numberWithInt:98]);
+#if defined (__BLOCKS__)
+	[set performBatchUpdates:^(id<CHSortedSet> batch) {
+		[batch removeAllObjects];
+		[batch addObjectsFromArray:sorted];
+		[batch removeFirstObject];
+	}];
+	XCTAssertEqual([set count], (NSUInteger)99);
+	XCTAssertEqualObjects([set firstObject], [NSNumber numberWithInt:1]);
+#endif	/* defined (__BLOCKS__) */
+	XCTAssertThrows([set performBatchUpdatesWithFunction:NULL context:NULL]);
+}
+
+- (void) testConcurrentWriters {
+	NSUInteger threadCount = 8, limit = 20000, index, running = threadCount;
+	NSCondition *condition = [[[NSCondition alloc] init] autorelease];
+	
+	for (index = 0; index < threadCount; index++) {
+		CHConcurrentSkipListWriter *writer = [[[CHConcurrentSkipListWriter alloc] initWithSet:set first:index stride:threadCount limit:limit
+		                                                                              condition:condition running:&running] autorelease];
+		[NSThread detachNewThreadSelector:@selector(run:) toTarget:writer withObject:nil];
+	}
+	[condition lock];
+	while (running != 0)
+		[condition wait];
+	[condition unlock];
+	
+	NSMutableArray *expected = [NSMutableArray array];
+	for (index = 0; index < limit; index += 3)
+		[expected addObject:[NSNumber numberWithUnsignedInteger:index]];
+	XCTAssertEqual([set count], [expected count]);
+	XCTAssertEqualObjects([set allObjects], expected);
+}
+
+@end